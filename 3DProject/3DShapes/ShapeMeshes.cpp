@@ -116,6 +116,10 @@ void ShapeMeshes::LoadBoxMesh()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_BoxMesh.vbos[1]); // Activates the buffer
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_BOX, verts, m_BoxMesh.nVertices, indices, m_BoxMesh.nIndices);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -300,6 +304,12 @@ void ShapeMeshes::LoadConeMesh()
 	glBindBuffer(GL_ARRAY_BUFFER, m_ConeMesh.vbos[0]); // Activates the buffer
 	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_CONE, verts, m_ConeMesh.nVertices, NULL, 0);
+	AddTriangleFan(SHAPE_CONE, 0, 36);
+	AddTriangleStrip(SHAPE_CONE, 36, 108);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -564,6 +574,13 @@ void ShapeMeshes::LoadCylinderMesh()
 	glBindBuffer(GL_ARRAY_BUFFER, m_CylinderMesh.vbos[0]); // Activates the buffer
 	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_CYLINDER, verts, m_CylinderMesh.nVertices, NULL, 0);
+	AddTriangleFan(SHAPE_CYLINDER, 0, 36);
+	AddTriangleFan(SHAPE_CYLINDER, 36, 36);
+	AddTriangleStrip(SHAPE_CYLINDER, 72, 146);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -614,6 +631,10 @@ void ShapeMeshes::LoadPlaneMesh()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_PlaneMesh.vbos[1]); // Activates the buffer
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_PLANE, verts, m_PlaneMesh.nVertices, indices, m_PlaneMesh.nIndices);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -692,6 +713,11 @@ void ShapeMeshes::LoadPrismMesh()
 	glBindBuffer(GL_ARRAY_BUFFER, m_PrismMesh.vbos[0]); // Activates the buffer
 	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_PRISM, verts, m_PrismMesh.nVertices, NULL, 0);
+	AddTriangleStrip(SHAPE_PRISM, 0, m_PrismMesh.nVertices);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -746,6 +772,11 @@ void ShapeMeshes::LoadPyramid3Mesh()
 	// Sends vertex or coordinate data to the GPU
 	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_PYRAMID3, verts, m_Pyramid3Mesh.nVertices, NULL, 0);
+	AddTriangleStrip(SHAPE_PYRAMID3, 0, m_Pyramid3Mesh.nVertices);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -809,6 +840,11 @@ void ShapeMeshes::LoadPyramid4Mesh()
 	// Sends vertex or coordinate data to the GPU
 	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_PYRAMID4, verts, m_Pyramid4Mesh.nVertices, NULL, 0);
+	AddTriangleStrip(SHAPE_PYRAMID4, 0, m_Pyramid4Mesh.nVertices);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -1695,6 +1731,10 @@ void ShapeMeshes::LoadSphereMesh()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_SphereMesh.vbos[1]); // Activates the index buffer
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_SPHERE, combined_values.data(), (GLuint)(combined_values.size() / 8), indices, m_SphereMesh.nIndices);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -1955,6 +1995,13 @@ void ShapeMeshes::LoadTaperedCylinderMesh()
 	glBindBuffer(GL_ARRAY_BUFFER, m_TaperedCylinderMesh.vbos[0]); // Activates the buffer
 	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_TAPERED_CYLINDER, verts, m_TaperedCylinderMesh.nVertices, NULL, 0);
+	AddTriangleFan(SHAPE_TAPERED_CYLINDER, 0, 36);
+	AddTriangleFan(SHAPE_TAPERED_CYLINDER, 36, 72);
+	AddTriangleStrip(SHAPE_TAPERED_CYLINDER, 72, 146);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -2178,6 +2225,11 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 	glBindBuffer(GL_ARRAY_BUFFER, m_TorusMesh.vbos[0]); // Activates the buffer
 	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
 
+	// keep a triangle list copy of the drawn geometry for
+	// merging static objects
+	StoreGeometry(SHAPE_TORUS, combined_values.data(), m_TorusMesh.nVertices, NULL, 0);
+	AddTriangles(SHAPE_TORUS, 0, m_TorusMesh.nVertices);
+
 	if (m_bMemoryLayoutDone == false)
 	{
 		SetShaderMemoryLayout();
@@ -2399,6 +2451,244 @@ void ShapeMeshes::DrawHalfTorusMesh()
 	glBindVertexArray(0);
 }
 
+///////////////////////////////////////////////////
+//	LoadShapeMesh()
+//
+//	Load the mesh of the passed in shape type.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::LoadShapeMesh(SHAPE_TYPE shape)
+{
+	switch (shape)
+	{
+	case SHAPE_BOX:					LoadBoxMesh(); break;
+	case SHAPE_CONE:				LoadConeMesh(); break;
+	case SHAPE_CYLINDER:			LoadCylinderMesh(); break;
+	case SHAPE_PLANE:				LoadPlaneMesh(); break;
+	case SHAPE_PRISM:				LoadPrismMesh(); break;
+	case SHAPE_PYRAMID3:			LoadPyramid3Mesh(); break;
+	case SHAPE_PYRAMID4:			LoadPyramid4Mesh(); break;
+	case SHAPE_SPHERE:				LoadSphereMesh(); break;
+	case SHAPE_TAPERED_CYLINDER:	LoadTaperedCylinderMesh(); break;
+	case SHAPE_TORUS:				LoadTorusMesh(); break;
+	default: break;
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawShapeMesh()
+//
+//	Draw the mesh of the passed in shape type.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawShapeMesh(SHAPE_TYPE shape)
+{
+	switch (shape)
+	{
+	case SHAPE_BOX:					DrawBoxMesh(); break;
+	case SHAPE_CONE:				DrawConeMesh(); break;
+	case SHAPE_CYLINDER:			DrawCylinderMesh(); break;
+	case SHAPE_PLANE:				DrawPlaneMesh(); break;
+	case SHAPE_PRISM:				DrawPrismMesh(); break;
+	case SHAPE_PYRAMID3:			DrawPyramid3Mesh(); break;
+	case SHAPE_PYRAMID4:			DrawPyramid4Mesh(); break;
+	case SHAPE_SPHERE:				DrawSphereMesh(); break;
+	case SHAPE_TAPERED_CYLINDER:	DrawTaperedCylinderMesh(); break;
+	case SHAPE_TORUS:				DrawTorusMesh(); break;
+	default: break;
+	}
+}
+
+///////////////////////////////////////////////////
+//	GetShapeBounds()
+//
+//	Get the local space bounding box of the vertex
+//  data of the passed in shape type.
+///////////////////////////////////////////////////
+void ShapeMeshes::GetShapeBounds(
+	SHAPE_TYPE shape,
+	glm::vec3& boundsMin,
+	glm::vec3& boundsMax)
+{
+	switch (shape)
+	{
+	case SHAPE_CONE:
+	case SHAPE_CYLINDER:
+	case SHAPE_TAPERED_CYLINDER:
+		boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+		break;
+	case SHAPE_PLANE:
+		boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 0.0f, 1.0f);
+		break;
+	case SHAPE_SPHERE:
+		boundsMin = glm::vec3(-1.0f);
+		boundsMax = glm::vec3(1.0f);
+		break;
+	case SHAPE_TORUS:
+		// main radius of 1 plus the default tube thickness
+		boundsMin = glm::vec3(-1.2f, -1.2f, -0.2f);
+		boundsMax = glm::vec3(1.2f, 1.2f, 0.2f);
+		break;
+	default:
+		// box, prism and pyramids fill the unit cube
+		boundsMin = glm::vec3(-0.5f);
+		boundsMax = glm::vec3(0.5f);
+		break;
+	}
+}
+
+///////////////////////////////////////////////////
+//	GetShapeGeometry()
+//
+//	Get the in-memory triangle list of a loaded shape.
+//  The geometry is empty for shapes not loaded yet.
+///////////////////////////////////////////////////
+const ShapeMeshes::SHAPE_GEOMETRY& ShapeMeshes::GetShapeGeometry(SHAPE_TYPE shape) const
+{
+	return(m_geometry[shape]);
+}
+
+///////////////////////////////////////////////////
+//	StoreGeometry()
+//
+//	Keep a copy of the vertices of a shape.  Indexed
+//  shapes pass in their triangle indices, and shapes
+//  drawn as fans or strips add their triangles with
+//  the methods below, using the same ranges as their
+//  draw commands.
+///////////////////////////////////////////////////
+void ShapeMeshes::StoreGeometry(
+	SHAPE_TYPE shape,
+	const GLfloat* verts,
+	GLuint vertexCount,
+	const GLuint* indices,
+	GLuint indexCount)
+{
+	const GLuint floatsPerVertex = g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV;
+	SHAPE_GEOMETRY& geometry = m_geometry[shape];
+
+	geometry.vertices.assign(verts, verts + vertexCount * floatsPerVertex);
+	geometry.indices.clear();
+	if (NULL != indices)
+	{
+		geometry.indices.assign(indices, indices + indexCount);
+	}
+}
+
+///////////////////////////////////////////////////
+//	AddTriangles()
+//
+//	Add the triangles of a range drawn with
+//  GL_TRIANGLES to the stored geometry.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddTriangles(SHAPE_TYPE shape, GLuint first, GLuint count)
+{
+	SHAPE_GEOMETRY& geometry = m_geometry[shape];
+	GLuint last = ClampVertexRange(geometry, first, count);
+
+	for (GLuint i = first; i + 2 < last; i += 3)
+	{
+		AddTriangle(geometry, i, i + 1, i + 2);
+	}
+}
+
+///////////////////////////////////////////////////
+//	AddTriangleFan()
+//
+//	Add the triangles of a range drawn with
+//  GL_TRIANGLE_FAN to the stored geometry.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddTriangleFan(SHAPE_TYPE shape, GLuint first, GLuint count)
+{
+	SHAPE_GEOMETRY& geometry = m_geometry[shape];
+	GLuint last = ClampVertexRange(geometry, first, count);
+
+	for (GLuint i = first + 1; i + 1 < last; i++)
+	{
+		AddTriangle(geometry, first, i, i + 1);
+	}
+}
+
+///////////////////////////////////////////////////
+//	AddTriangleStrip()
+//
+//	Add the triangles of a range drawn with
+//  GL_TRIANGLE_STRIP to the stored geometry.  Every
+//  other triangle of a strip has its first two
+//  vertices swapped to keep the same winding.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddTriangleStrip(SHAPE_TYPE shape, GLuint first, GLuint count)
+{
+	SHAPE_GEOMETRY& geometry = m_geometry[shape];
+	GLuint last = ClampVertexRange(geometry, first, count);
+
+	for (GLuint i = first; i + 2 < last; i++)
+	{
+		if (((i - first) & 1) == 0)
+		{
+			AddTriangle(geometry, i, i + 1, i + 2);
+		}
+		else
+		{
+			AddTriangle(geometry, i + 1, i, i + 2);
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	ClampVertexRange()
+//
+//	Get the end of a draw range, limited to the
+//  stored vertices the same way the driver would
+//  stop at the end of the vertex buffer.
+///////////////////////////////////////////////////
+GLuint ShapeMeshes::ClampVertexRange(
+	const SHAPE_GEOMETRY& geometry,
+	GLuint first,
+	GLuint count)
+{
+	const GLuint floatsPerVertex = g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV;
+	GLuint vertexCount = (GLuint)(geometry.vertices.size() / floatsPerVertex);
+
+	GLuint last = first + count;
+	if (last > vertexCount)
+	{
+		last = vertexCount;
+	}
+	return(last);
+}
+
+///////////////////////////////////////////////////
+//	AddTriangle()
+//
+//	Add one triangle to the stored geometry, leaving
+//  out the degenerate triangles that strips use for
+//  joining their rows.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddTriangle(
+	SHAPE_GEOMETRY& geometry,
+	GLuint a,
+	GLuint b,
+	GLuint c)
+{
+	const GLuint floatsPerVertex = g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV;
+	const GLfloat* verts = geometry.vertices.data();
+
+	glm::vec3 pa(verts[a * floatsPerVertex], verts[a * floatsPerVertex + 1], verts[a * floatsPerVertex + 2]);
+	glm::vec3 pb(verts[b * floatsPerVertex], verts[b * floatsPerVertex + 1], verts[b * floatsPerVertex + 2]);
+	glm::vec3 pc(verts[c * floatsPerVertex], verts[c * floatsPerVertex + 1], verts[c * floatsPerVertex + 2]);
+	if ((pa == pb) || (pb == pc) || (pa == pc))
+	{
+		return;
+	}
+
+	geometry.indices.push_back(a);
+	geometry.indices.push_back(b);
+	geometry.indices.push_back(c);
+}
+
 glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
 {
 	glm::vec3 Normal(0, 0, 0);
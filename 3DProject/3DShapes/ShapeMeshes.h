@@ -14,6 +14,8 @@
 
 #include <glm/glm.hpp>
 
+#include <vector>
+
 /***********************************************************
  *  ShapeMeshes
  *
@@ -26,6 +28,32 @@ public:
 	// constructor
 	ShapeMeshes();
 
+	// the available 3D shapes, used for selecting a mesh
+	// from data instead of calling the matching method
+	enum SHAPE_TYPE
+	{
+		SHAPE_BOX,
+		SHAPE_CONE,
+		SHAPE_CYLINDER,
+		SHAPE_PLANE,
+		SHAPE_PRISM,
+		SHAPE_PYRAMID3,
+		SHAPE_PYRAMID4,
+		SHAPE_SPHERE,
+		SHAPE_TAPERED_CYLINDER,
+		SHAPE_TORUS,
+		SHAPE_COUNT
+	};
+
+	// the geometry of a loaded shape kept in memory as a
+	// triangle list, used for merging static objects
+	struct SHAPE_GEOMETRY
+	{
+		// position, normal and UV of every vertex
+		std::vector<GLfloat> vertices;
+		std::vector<GLuint> indices;
+	};
+
 private:
 
 	// stores the GL data relative to a given mesh
@@ -51,6 +79,9 @@ private:
 
 	bool m_bMemoryLayoutDone;
 
+	// in-memory copies of the loaded shapes
+	SHAPE_GEOMETRY m_geometry[SHAPE_COUNT];
+
 public:
 	// methods for loading the shape mesh data 
 	// into memory
@@ -87,6 +118,20 @@ public:
 	void DrawTorusMesh();
 	void DrawHalfTorusMesh();
 
+	// methods for loading and drawing a shape mesh
+	// selected by its shape type
+	void LoadShapeMesh(SHAPE_TYPE shape);
+	void DrawShapeMesh(SHAPE_TYPE shape);
+
+	// get the local space bounding box of a shape mesh
+	static void GetShapeBounds(
+		SHAPE_TYPE shape,
+		glm::vec3& boundsMin,
+		glm::vec3& boundsMax);
+
+	// get the triangle list of a loaded shape mesh
+	const SHAPE_GEOMETRY& GetShapeGeometry(SHAPE_TYPE shape) const;
+
 
 private:
 
@@ -98,4 +143,25 @@ private:
 	// called to set the memory layout 
 	// template for shader data
 	void SetShaderMemoryLayout();
+
+	// called to keep the geometry of a loaded
+	// shape in memory as a triangle list
+	void StoreGeometry(
+		SHAPE_TYPE shape,
+		const GLfloat* verts,
+		GLuint vertexCount,
+		const GLuint* indices,
+		GLuint indexCount);
+	void AddTriangles(SHAPE_TYPE shape, GLuint first, GLuint count);
+	void AddTriangleFan(SHAPE_TYPE shape, GLuint first, GLuint count);
+	void AddTriangleStrip(SHAPE_TYPE shape, GLuint first, GLuint count);
+	static GLuint ClampVertexRange(
+		const SHAPE_GEOMETRY& geometry,
+		GLuint first,
+		GLuint count);
+	static void AddTriangle(
+		SHAPE_GEOMETRY& geometry,
+		GLuint a,
+		GLuint b,
+		GLuint c);
 };
\ No newline at end of file
@@ -0,0 +1,275 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchjob.cpp
+// ============
+// list of camera views rendered by the batch mode
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchJob.h"
+#include "ImageWriter.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// same lens as the interactive camera
+	const float g_DefaultFieldOfView = 80.0f;
+
+	// read three floats into a vector
+	bool ReadVec3(std::istringstream& stream, glm::vec3& value)
+	{
+		stream >> value.x >> value.y >> value.z;
+		return(!stream.fail());
+	}
+
+	// check whether a path starts at the root of a drive
+	bool IsAbsolutePath(const std::string& path)
+	{
+		return((path.empty() == false) &&
+			((path[0] == '/') || (path[0] == '\\') || (path.find(':') != std::string::npos)));
+	}
+}
+
+/***********************************************************
+ *  BatchJob()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BatchJob::BatchJob()
+{
+	m_width = 256;
+	m_height = 256;
+	m_nearPlane = 0.1f;
+	m_farPlane = 100.0f;
+	m_outputPattern = "view_####.ppm";
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a batch job file.  Every
+ *  line holds one entry, and lines starting with '#' are
+ *  comments:
+ *
+ *  size <width> <height>
+ *  clip <near> <far>
+ *  output <pattern>
+ *  camera position x y z target x y z fov f output <file>
+ *  turntable center x y z radius r height h frames n fov f
+ *
+ *  The '#' characters of the output pattern are replaced by
+ *  the view number, and a camera with its own output file
+ *  is written there instead.  Output paths are relative to
+ *  the folder of the job file.  A turntable adds views that
+ *  circle the center once, starting in front of it on the
+ *  Z axis and looking at it from the passed in height.
+ ***********************************************************/
+bool BatchJob::Load(const char* filename)
+{
+	std::ifstream file(filename);
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not open batch job file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::string directory(filename);
+	size_t separator = directory.find_last_of("/\\");
+	directory = (separator == std::string::npos) ? std::string() : directory.substr(0, separator + 1);
+
+	m_views.clear();
+	m_outputPattern = directory + m_outputPattern;
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		if (ParseLine(line, directory) == false)
+		{
+			std::cout << "Batch job line " << lineNumber << " is not valid:" << line << std::endl;
+			m_views.clear();
+			return(false);
+		}
+	}
+
+	if ((m_width <= 0) || (m_height <= 0) || (m_nearPlane <= 0.0f) || (m_farPlane <= m_nearPlane))
+	{
+		std::cout << "Batch job has an invalid size or clip range:" << filename << std::endl;
+		m_views.clear();
+		return(false);
+	}
+
+	std::cout << "Successfully loaded batch job:" << filename << ", views:" << m_views.size() << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  ParseLine()
+ *
+ *  This method is used for parsing one line of a job file.
+ *  Properties that are left out keep their default values.
+ ***********************************************************/
+bool BatchJob::ParseLine(const std::string& line, const std::string& directory)
+{
+	std::istringstream stream(line);
+	std::string keyword;
+	if (!(stream >> keyword) || (keyword[0] == '#'))
+	{
+		return(true);
+	}
+
+	bool bValid = true;
+	std::string token;
+
+	if (keyword == "size")
+	{
+		stream >> m_width >> m_height;
+		bValid = !stream.fail();
+	}
+	else if (keyword == "clip")
+	{
+		stream >> m_nearPlane >> m_farPlane;
+		bValid = !stream.fail();
+	}
+	else if (keyword == "output")
+	{
+		bValid = (bool)(stream >> m_outputPattern);
+		if (bValid && (IsAbsolutePath(m_outputPattern) == false))
+		{
+			m_outputPattern = directory + m_outputPattern;
+		}
+	}
+	else if (keyword == "camera")
+	{
+		VIEW view;
+		view.position = glm::vec3(0.0f, 5.0f, 12.0f);
+		view.target = glm::vec3(0.0f);
+		view.fieldOfView = g_DefaultFieldOfView;
+
+		while (bValid && (stream >> token))
+		{
+			if (token == "position")
+				bValid = ReadVec3(stream, view.position);
+			else if (token == "target")
+				bValid = ReadVec3(stream, view.target);
+			else if (token == "fov")
+				bValid = (bool)(stream >> view.fieldOfView);
+			else if (token == "output")
+			{
+				bValid = (bool)(stream >> view.path);
+				if (bValid && (IsAbsolutePath(view.path) == false))
+				{
+					view.path = directory + view.path;
+				}
+			}
+			else
+				bValid = false;
+		}
+		if (bValid)
+		{
+			m_views.push_back(view);
+		}
+	}
+	else if (keyword == "turntable")
+	{
+		glm::vec3 center(0.0f);
+		float radius = 10.0f;
+		float height = 5.0f;
+		int frames = 36;
+		float fieldOfView = g_DefaultFieldOfView;
+
+		while (bValid && (stream >> token))
+		{
+			if (token == "center")
+				bValid = ReadVec3(stream, center);
+			else if (token == "radius")
+				bValid = (bool)(stream >> radius);
+			else if (token == "height")
+				bValid = (bool)(stream >> height);
+			else if (token == "frames")
+				bValid = (bool)(stream >> frames);
+			else if (token == "fov")
+				bValid = (bool)(stream >> fieldOfView);
+			else
+				bValid = false;
+		}
+		bValid = bValid && (frames > 0);
+
+		for (int i = 0; bValid && (i < frames); i++)
+		{
+			float angle = glm::two_pi<float>() * (float)i / (float)frames;
+
+			VIEW view;
+			view.position = center + glm::vec3(radius * sinf(angle), height, radius * cosf(angle));
+			view.target = center;
+			view.fieldOfView = fieldOfView;
+			m_views.push_back(view);
+		}
+	}
+	else
+	{
+		bValid = false;
+	}
+
+	return(bValid);
+}
+
+/***********************************************************
+ *  GetViewMatrix()
+ *
+ *  This method is used for getting the view matrix of a
+ *  camera view.  Views looking straight up or down use the
+ *  -Z axis as their up direction.
+ ***********************************************************/
+glm::mat4 BatchJob::GetViewMatrix(size_t index) const
+{
+	const VIEW& view = m_views[index];
+	glm::vec3 forward = view.target - view.position;
+	glm::vec3 up(0.0f, 1.0f, 0.0f);
+	if (glm::length(glm::cross(forward, up)) < 1e-6f * glm::length(forward))
+	{
+		up = glm::vec3(0.0f, 0.0f, -1.0f);
+	}
+
+	return(glm::lookAt(view.position, view.target, up));
+}
+
+/***********************************************************
+ *  GetProjectionMatrix()
+ *
+ *  This method is used for getting the perspective
+ *  projection of a camera view for the image size.
+ ***********************************************************/
+glm::mat4 BatchJob::GetProjectionMatrix(size_t index) const
+{
+	return(glm::perspective(
+		glm::radians(m_views[index].fieldOfView),
+		(float)m_width / (float)m_height,
+		m_nearPlane,
+		m_farPlane));
+}
+
+/***********************************************************
+ *  GetFramePath()
+ *
+ *  This method is used for getting the image file that a
+ *  view is written to.
+ ***********************************************************/
+std::string BatchJob::GetFramePath(size_t index) const
+{
+	if (m_views[index].path.empty() == false)
+	{
+		return(m_views[index].path);
+	}
+	return(ImageWriter::GetFramePath(m_outputPattern, (int)index));
+}
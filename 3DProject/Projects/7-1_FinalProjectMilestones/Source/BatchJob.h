@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchjob.h
+// ============
+// list of camera views rendered by the batch mode
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  BatchJob
+ *
+ *  This class reads a batch job file (.job), which lists the
+ *  camera views to render from one loaded scene along with
+ *  the image size and where the images are written.  Views
+ *  are listed one by one as camera poses, or generated as a
+ *  turntable that circles a point.
+ ***********************************************************/
+class BatchJob
+{
+public:
+	struct VIEW
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+		float fieldOfView;		// vertical, in degrees
+		std::string path;		// empty to number the output pattern
+	};
+
+	// constructor
+	BatchJob();
+
+	// load a batch job file
+	bool Load(const char* filename);
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	size_t GetViewCount() const { return m_views.size(); }
+
+	// get the camera matrices of a view
+	glm::mat4 GetViewMatrix(size_t index) const;
+	glm::mat4 GetProjectionMatrix(size_t index) const;
+	// get the image file of a view
+	std::string GetFramePath(size_t index) const;
+
+private:
+	// parse one line of a job file
+	bool ParseLine(const std::string& line, const std::string& directory);
+
+	int m_width;
+	int m_height;
+	float m_nearPlane;
+	float m_farPlane;
+	std::string m_outputPattern;
+	std::vector<VIEW> m_views;
+};
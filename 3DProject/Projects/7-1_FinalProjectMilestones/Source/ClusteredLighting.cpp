@@ -0,0 +1,437 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlighting.cpp
+// ============
+// assign point lights to view space clusters for forward shading
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// SSE2 is available on every x64 target and on x86 builds
+// that use the default /arch:SSE2 code generation
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define CLUSTER_USE_SSE2 1
+#endif
+
+// declaration of global variables
+namespace
+{
+	// the cluster grid - screen tiles on X and Y, depth slices on Z
+	const int g_ClusterCountX = 16;
+	const int g_ClusterCountY = 9;
+	const int g_ClusterCountZ = 24;
+	const int g_ClustersPerSlice = g_ClusterCountX * g_ClusterCountY;
+	const int g_ClusterCount = g_ClustersPerSlice * g_ClusterCountZ;
+	// lights past this count in one cluster are left out
+	const uint32_t g_MaxLightsPerCluster = 128;
+
+	static_assert((g_ClustersPerSlice % 4) == 0, "the clusters of a slice are tested four at a time");
+	static_assert(sizeof(ClusteredLighting::POINT_LIGHT) == 12 * sizeof(float), "point lights must match the std430 layout");
+
+	// the nearest plane used for the depth slices
+	const float g_MinNearPlane = 0.01f;
+
+	glm::vec3 Unproject(const glm::mat4& inverseProjection, float x, float y, float z)
+	{
+		glm::vec4 point = inverseProjection * glm::vec4(x, y, z, 1.0f);
+		return(glm::vec3(point) / point.w);
+	}
+}
+
+/***********************************************************
+ *  ClusteredLighting()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ClusteredLighting::ClusteredLighting(ThreadPool* pThreadPool)
+{
+	m_pThreadPool = pThreadPool;
+	m_bLightsChanged = true;
+	m_bBoundsValid = false;
+	m_boundsProjection = glm::mat4(1.0f);
+	m_nearPlane = 0.1f;
+	m_farPlane = 100.0f;
+	m_depthSliceScale = 1.0f;
+	m_buffers[0] = 0;
+	m_buffers[1] = 0;
+	m_buffers[2] = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	m_clusterMinX.resize(g_ClusterCount);
+	m_clusterMinY.resize(g_ClusterCount);
+	m_clusterMinZ.resize(g_ClusterCount);
+	m_clusterMaxX.resize(g_ClusterCount);
+	m_clusterMaxY.resize(g_ClusterCount);
+	m_clusterMaxZ.resize(g_ClusterCount);
+	m_clusterCounts.resize(g_ClusterCount);
+	m_clusterLights.resize((size_t)g_ClusterCount * g_MaxLightsPerCluster);
+	m_clusterRanges.resize((size_t)g_ClusterCount * 2);
+	m_sliceDropped.resize(g_ClusterCountZ);
+}
+
+/***********************************************************
+ *  ~ClusteredLighting()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ClusteredLighting::~ClusteredLighting()
+{
+	if (m_buffers[0] != 0)
+	{
+		glDeleteBuffers(3, m_buffers);
+	}
+	m_pThreadPool = NULL;
+}
+
+/***********************************************************
+ *  ClearLights()
+ *
+ *  This method is used for removing all of the point lights.
+ ***********************************************************/
+void ClusteredLighting::ClearLights()
+{
+	m_lights.clear();
+	m_bLightsChanged = true;
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a point light.  The light
+ *  fades out towards its range and does not reach past it,
+ *  which is what lets it be assigned to a few clusters.
+ ***********************************************************/
+void ClusteredLighting::AddLight(
+	const glm::vec3& position,
+	float range,
+	const glm::vec3& diffuseColor,
+	const glm::vec3& specularColor,
+	float intensity)
+{
+	POINT_LIGHT light;
+	light.positionRange = glm::vec4(position, range);
+	light.diffuseColor = glm::vec4(diffuseColor, 0.0f);
+	light.specularColor = glm::vec4(specularColor, intensity);
+	m_lights.push_back(light);
+	m_bLightsChanged = true;
+}
+
+/***********************************************************
+ *  GetClusterCounts()
+ *
+ *  This method returns the size of the cluster grid.
+ ***********************************************************/
+glm::ivec3 ClusteredLighting::GetClusterCounts()
+{
+	return(glm::ivec3(g_ClusterCountX, g_ClusterCountY, g_ClusterCountZ));
+}
+
+/***********************************************************
+ *  BuildClusterBounds()
+ *
+ *  This method is used for finding the view space box around
+ *  every cluster.  The corners of each screen tile are
+ *  unprojected onto the near and far planes, and the points
+ *  at the depths of the slice are taken along those lines,
+ *  which works for perspective and orthographic projections.
+ *  Depth slices grow exponentially from the near plane, the
+ *  same way the fragment shader picks its slice.
+ ***********************************************************/
+void ClusteredLighting::BuildClusterBounds(const glm::mat4& projection)
+{
+	glm::mat4 inverseProjection = glm::inverse(projection);
+
+	m_nearPlane = std::max(-Unproject(inverseProjection, 0.0f, 0.0f, -1.0f).z, g_MinNearPlane);
+	m_farPlane = std::max(-Unproject(inverseProjection, 0.0f, 0.0f, 1.0f).z, m_nearPlane * 2.0f);
+	m_depthSliceScale = (float)g_ClusterCountZ / logf(m_farPlane / m_nearPlane);
+
+	for (int y = 0; y < g_ClusterCountY; y++)
+	{
+		for (int x = 0; x < g_ClusterCountX; x++)
+		{
+			// the lines through the corners of the screen tile
+			glm::vec3 nearPoints[4];
+			glm::vec3 farPoints[4];
+			for (int corner = 0; corner < 4; corner++)
+			{
+				float ndcX = -1.0f + 2.0f * (float)(x + (corner & 1)) / (float)g_ClusterCountX;
+				float ndcY = -1.0f + 2.0f * (float)(y + ((corner >> 1) & 1)) / (float)g_ClusterCountY;
+				nearPoints[corner] = Unproject(inverseProjection, ndcX, ndcY, -1.0f);
+				farPoints[corner] = Unproject(inverseProjection, ndcX, ndcY, 1.0f);
+			}
+
+			for (int z = 0; z < g_ClusterCountZ; z++)
+			{
+				float sliceDepths[2] = {
+					m_nearPlane * powf(m_farPlane / m_nearPlane, (float)z / (float)g_ClusterCountZ),
+					m_nearPlane * powf(m_farPlane / m_nearPlane, (float)(z + 1) / (float)g_ClusterCountZ)
+				};
+
+				glm::vec3 boundsMin(FLT_MAX);
+				glm::vec3 boundsMax(-FLT_MAX);
+				for (int corner = 0; corner < 4; corner++)
+				{
+					const glm::vec3& nearPoint = nearPoints[corner];
+					const glm::vec3& farPoint = farPoints[corner];
+					for (int depth = 0; depth < 2; depth++)
+					{
+						float t = (sliceDepths[depth] + nearPoint.z) / (nearPoint.z - farPoint.z);
+						glm::vec3 point = nearPoint + (farPoint - nearPoint) * t;
+						boundsMin = glm::min(boundsMin, point);
+						boundsMax = glm::max(boundsMax, point);
+					}
+				}
+
+				int cluster = x + g_ClusterCountX * (y + g_ClusterCountY * z);
+				m_clusterMinX[cluster] = boundsMin.x;
+				m_clusterMinY[cluster] = boundsMin.y;
+				m_clusterMinZ[cluster] = boundsMin.z;
+				m_clusterMaxX[cluster] = boundsMax.x;
+				m_clusterMaxY[cluster] = boundsMax.y;
+				m_clusterMaxZ[cluster] = boundsMax.z;
+			}
+		}
+	}
+
+	m_boundsProjection = projection;
+	m_bBoundsValid = true;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for building the light lists of the
+ *  clusters for the passed in camera.  The lights are moved
+ *  into view space and given the range of depth slices they
+ *  reach, the slices are filled in parallel, and the lists
+ *  are then packed into one index array.
+ ***********************************************************/
+void ClusteredLighting::Update(const glm::mat4& view, const glm::mat4& projection)
+{
+	if ((m_bBoundsValid == false) || (projection != m_boundsProjection))
+	{
+		BuildClusterBounds(projection);
+	}
+
+	size_t lightCount = m_lights.size();
+	m_viewLights.resize(lightCount);
+	m_firstSlice.resize(lightCount);
+	m_lastSlice.resize(lightCount);
+
+	for (size_t i = 0; i < lightCount; i++)
+	{
+		const glm::vec4& positionRange = m_lights[i].positionRange;
+		glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(positionRange), 1.0f));
+		float range = positionRange.w;
+		float depth = -center.z;
+		m_viewLights[i] = glm::vec4(center, range);
+
+		// lights completely in front of or behind the clusters
+		// get an empty slice range
+		if ((depth + range < m_nearPlane) || (depth - range > m_farPlane))
+		{
+			m_firstSlice[i] = 1;
+			m_lastSlice[i] = 0;
+			continue;
+		}
+
+		float nearDepth = std::max(depth - range, m_nearPlane);
+		float farDepth = std::min(depth + range, m_farPlane);
+		m_firstSlice[i] = std::min((int)(logf(nearDepth / m_nearPlane) * m_depthSliceScale), g_ClusterCountZ - 1);
+		m_lastSlice[i] = std::min((int)(logf(farDepth / m_nearPlane) * m_depthSliceScale), g_ClusterCountZ - 1);
+	}
+
+	if (NULL != m_pThreadPool)
+	{
+		m_pThreadPool->ParallelFor(g_ClusterCountZ, [this](int slice)
+		{
+			AssignSlice(slice);
+		});
+	}
+	else
+	{
+		for (int slice = 0; slice < g_ClusterCountZ; slice++)
+		{
+			AssignSlice(slice);
+		}
+	}
+
+	// pack the per cluster lists one after the other
+	m_lightIndices.clear();
+	m_stats.lightCount = (int)lightCount;
+	m_stats.activeClusters = 0;
+	m_stats.droppedCount = 0;
+	for (int cluster = 0; cluster < g_ClusterCount; cluster++)
+	{
+		uint32_t count = m_clusterCounts[cluster];
+		const uint32_t* lights = &m_clusterLights[(size_t)cluster * g_MaxLightsPerCluster];
+
+		m_clusterRanges[cluster * 2] = (uint32_t)m_lightIndices.size();
+		m_clusterRanges[cluster * 2 + 1] = count;
+		m_lightIndices.insert(m_lightIndices.end(), lights, lights + count);
+
+		if (count > 0)
+		{
+			m_stats.activeClusters++;
+		}
+	}
+	for (int slice = 0; slice < g_ClusterCountZ; slice++)
+	{
+		m_stats.droppedCount += m_sliceDropped[slice];
+	}
+	m_stats.indexCount = (int)m_lightIndices.size();
+}
+
+/***********************************************************
+ *  AssignSlice()
+ *
+ *  This method is used for testing the lights that reach a
+ *  depth slice against its clusters.  The distance from the
+ *  light to the closest point of each cluster box is
+ *  compared with the light range, for four clusters at once
+ *  when SSE2 is available.  Every slice only writes its own
+ *  clusters, so the slices can run on any thread.
+ ***********************************************************/
+void ClusteredLighting::AssignSlice(int slice)
+{
+	const int firstCluster = slice * g_ClustersPerSlice;
+	uint32_t* counts = &m_clusterCounts[firstCluster];
+	int dropped = 0;
+
+	memset(counts, 0, sizeof(uint32_t) * g_ClustersPerSlice);
+
+	for (size_t light = 0; light < m_viewLights.size(); light++)
+	{
+		if ((slice < m_firstSlice[light]) || (slice > m_lastSlice[light]))
+		{
+			continue;
+		}
+
+		const glm::vec4& sphere = m_viewLights[light];
+		float rangeSquared = sphere.w * sphere.w;
+
+#ifdef CLUSTER_USE_SSE2
+		const __m128 centerX = _mm_set1_ps(sphere.x);
+		const __m128 centerY = _mm_set1_ps(sphere.y);
+		const __m128 centerZ = _mm_set1_ps(sphere.z);
+		const __m128 range2 = _mm_set1_ps(rangeSquared);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (int local = 0; local < g_ClustersPerSlice; local += 4)
+		{
+			int cluster = firstCluster + local;
+
+			// distance outside the box on each axis, zero inside
+			__m128 dx = _mm_max_ps(_mm_max_ps(
+				_mm_sub_ps(_mm_loadu_ps(&m_clusterMinX[cluster]), centerX),
+				_mm_sub_ps(centerX, _mm_loadu_ps(&m_clusterMaxX[cluster]))), zero);
+			__m128 dy = _mm_max_ps(_mm_max_ps(
+				_mm_sub_ps(_mm_loadu_ps(&m_clusterMinY[cluster]), centerY),
+				_mm_sub_ps(centerY, _mm_loadu_ps(&m_clusterMaxY[cluster]))), zero);
+			__m128 dz = _mm_max_ps(_mm_max_ps(
+				_mm_sub_ps(_mm_loadu_ps(&m_clusterMinZ[cluster]), centerZ),
+				_mm_sub_ps(centerZ, _mm_loadu_ps(&m_clusterMaxZ[cluster]))), zero);
+			__m128 distance2 = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, range2));
+			while (mask != 0)
+			{
+				int lane = 0;
+				while ((mask & (1 << lane)) == 0)
+				{
+					lane++;
+				}
+				mask &= ~(1 << lane);
+
+				uint32_t& count = counts[local + lane];
+				if (count < g_MaxLightsPerCluster)
+				{
+					m_clusterLights[(size_t)(cluster + lane) * g_MaxLightsPerCluster + count] = (uint32_t)light;
+					count++;
+				}
+				else
+				{
+					dropped++;
+				}
+			}
+		}
+#else
+		for (int local = 0; local < g_ClustersPerSlice; local++)
+		{
+			int cluster = firstCluster + local;
+			float dx = std::max(std::max(m_clusterMinX[cluster] - sphere.x, sphere.x - m_clusterMaxX[cluster]), 0.0f);
+			float dy = std::max(std::max(m_clusterMinY[cluster] - sphere.y, sphere.y - m_clusterMaxY[cluster]), 0.0f);
+			float dz = std::max(std::max(m_clusterMinZ[cluster] - sphere.z, sphere.z - m_clusterMaxZ[cluster]), 0.0f);
+			if (dx * dx + dy * dy + dz * dz > rangeSquared)
+			{
+				continue;
+			}
+
+			uint32_t& count = counts[local];
+			if (count < g_MaxLightsPerCluster)
+			{
+				m_clusterLights[(size_t)cluster * g_MaxLightsPerCluster + count] = (uint32_t)light;
+				count++;
+			}
+			else
+			{
+				dropped++;
+			}
+		}
+#endif
+	}
+
+	m_sliceDropped[slice] = dropped;
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for sending the lights and the
+ *  cluster lists to their shader storage buffers.  The
+ *  lights are only sent again when they change, the lists
+ *  every frame.  Empty lists still get one element so every
+ *  buffer can be bound.
+ ***********************************************************/
+void ClusteredLighting::Upload()
+{
+	if (m_buffers[0] == 0)
+	{
+		glGenBuffers(3, m_buffers);
+	}
+
+	if (m_bLightsChanged)
+	{
+		POINT_LIGHT emptyLight;
+		memset(&emptyLight, 0, sizeof(emptyLight));
+		const POINT_LIGHT* lights = m_lights.empty() ? &emptyLight : m_lights.data();
+		size_t lightCount = std::max(m_lights.size(), (size_t)1);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[BINDING_LIGHTS]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(POINT_LIGHT) * lightCount, lights, GL_STATIC_DRAW);
+		m_bLightsChanged = false;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[BINDING_CLUSTERS]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * m_clusterRanges.size(), m_clusterRanges.data(), GL_STREAM_DRAW);
+
+	uint32_t emptyIndex = 0;
+	const uint32_t* indices = m_lightIndices.empty() ? &emptyIndex : m_lightIndices.data();
+	size_t indexCount = std::max(m_lightIndices.size(), (size_t)1);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[BINDING_LIGHT_INDICES]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * indexCount, indices, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_LIGHTS, m_buffers[BINDING_LIGHTS]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_CLUSTERS, m_buffers[BINDING_CLUSTERS]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_LIGHT_INDICES, m_buffers[BINDING_LIGHT_INDICES]);
+}
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlighting.h
+// ============
+// assign point lights to view space clusters for forward shading
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  ClusteredLighting
+ *
+ *  This class splits the view frustum into a grid of
+ *  clusters - screen tiles on X and Y and exponential depth
+ *  slices on Z - and builds the list of the point lights
+ *  that reach each cluster.  The lights are tested as
+ *  spheres against the view space bounds of the clusters,
+ *  four clusters at a time, with the depth slices split
+ *  across the thread pool.
+ *
+ *  The lights, the per cluster offset and count, and the
+ *  light index lists are uploaded as shader storage buffers,
+ *  so every fragment only shades the lights of its cluster.
+ ***********************************************************/
+class ClusteredLighting
+{
+public:
+	// the point light layout shared with the fragment shader
+	struct POINT_LIGHT
+	{
+		glm::vec4 positionRange;	// world position and range
+		glm::vec4 diffuseColor;
+		glm::vec4 specularColor;	// color and intensity
+	};
+
+	// shader storage buffer bindings used by the shader
+	enum BUFFER_BINDING
+	{
+		BINDING_LIGHTS = 0,
+		BINDING_CLUSTERS = 1,
+		BINDING_LIGHT_INDICES = 2
+	};
+
+	struct CLUSTER_STATS
+	{
+		int lightCount;			// point lights in the scene
+		int activeClusters;		// clusters with at least one light
+		int indexCount;			// total light indices of all clusters
+		int droppedCount;		// lights left out of full clusters
+	};
+
+	// constructor
+	ClusteredLighting(ThreadPool* pThreadPool);
+	// destructor
+	~ClusteredLighting();
+
+	// remove all of the point lights
+	void ClearLights();
+	// add a point light in world space - it has no effect past
+	// its range
+	void AddLight(
+		const glm::vec3& position,
+		float range,
+		const glm::vec3& diffuseColor,
+		const glm::vec3& specularColor,
+		float intensity);
+	size_t GetLightCount() const { return m_lights.size(); }
+
+	// assign the lights to the clusters of the passed in camera
+	void Update(const glm::mat4& view, const glm::mat4& projection);
+	// send the lights and the cluster lists to OpenGL and bind
+	// them to their storage buffer bindings
+	void Upload();
+
+	// the values the fragment shader needs to find its cluster
+	static glm::ivec3 GetClusterCounts();
+	float GetNearPlane() const { return m_nearPlane; }
+	// scale that turns log(depth / near) into a depth slice
+	float GetDepthSliceScale() const { return m_depthSliceScale; }
+
+	const CLUSTER_STATS& GetStats() const { return m_stats; }
+
+	// the lists of the last update, for inspection
+	const std::vector<uint32_t>& GetClusterRanges() const { return m_clusterRanges; }
+	const std::vector<uint32_t>& GetLightIndices() const { return m_lightIndices; }
+
+private:
+	// rebuild the view space bounds of the clusters when the
+	// projection changes
+	void BuildClusterBounds(const glm::mat4& projection);
+	// test the lights against the clusters of one depth slice
+	void AssignSlice(int slice);
+
+	ThreadPool* m_pThreadPool;
+
+	std::vector<POINT_LIGHT> m_lights;
+	bool m_bLightsChanged;
+
+	// view space bounds of the clusters, one array per
+	// component so four clusters are tested at once
+	std::vector<float> m_clusterMinX;
+	std::vector<float> m_clusterMinY;
+	std::vector<float> m_clusterMinZ;
+	std::vector<float> m_clusterMaxX;
+	std::vector<float> m_clusterMaxY;
+	std::vector<float> m_clusterMaxZ;
+	glm::mat4 m_boundsProjection;
+	bool m_bBoundsValid;
+	float m_nearPlane;
+	float m_farPlane;
+	float m_depthSliceScale;
+
+	// lights of the current frame in view space, with the
+	// range of depth slices each one reaches
+	std::vector<glm::vec4> m_viewLights;
+	std::vector<int> m_firstSlice;
+	std::vector<int> m_lastSlice;
+
+	// fixed size light lists filled per cluster, then packed
+	std::vector<uint32_t> m_clusterCounts;
+	std::vector<uint32_t> m_clusterLights;
+	std::vector<int> m_sliceDropped;
+
+	// offset and count of every cluster, and the packed lists
+	std::vector<uint32_t> m_clusterRanges;
+	std::vector<uint32_t> m_lightIndices;
+
+	GLuint m_buffers[3];
+	CLUSTER_STATS m_stats;
+};
@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// commandlist.cpp
+// ============
+// compact render commands recorded off the GL thread
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CommandList.h"
+
+#include <cstddef>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// size of the blocks taken from the frame arena
+	const size_t g_BlockSize = 16 * 1024;
+	// commands are kept at 4 byte boundaries, which is enough
+	// for the integers and floats they hold
+	const size_t g_CommandAlignment = 4;
+	// blocks are aligned for the pointer of a jump command
+	const size_t g_BlockAlignment = 8;
+
+	size_t AlignCommandSize(size_t size)
+	{
+		return((size + g_CommandAlignment - 1) & ~(g_CommandAlignment - 1));
+	}
+}
+
+/***********************************************************
+ *  CommandList()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CommandList::CommandList()
+{
+	m_pArena = NULL;
+	m_pFirst = NULL;
+	m_pWrite = NULL;
+	m_pBlockEnd = NULL;
+	m_used = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for starting an empty list.  The
+ *  blocks of the previous commands belong to the arena, so
+ *  nothing is freed here.
+ ***********************************************************/
+void CommandList::Reset(FrameArena* pArena)
+{
+	m_pArena = pArena;
+	m_pFirst = NULL;
+	m_pWrite = NULL;
+	m_pBlockEnd = NULL;
+	m_used = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for reserving room for a command
+ *  after the last one.  Every block keeps room for a jump
+ *  command at its end, which links it to the next block
+ *  when the current one is full.
+ ***********************************************************/
+void* CommandList::Allocate(size_t size)
+{
+	size = AlignCommandSize(size);
+	const size_t jumpSize = AlignCommandSize(sizeof(JUMP_COMMAND));
+
+	if ((NULL == m_pWrite) || (m_pWrite + size + jumpSize > m_pBlockEnd))
+	{
+		char* pBlock = (char*)m_pArena->Allocate(g_BlockSize, g_BlockAlignment);
+
+		if (NULL == m_pWrite)
+		{
+			m_pFirst = pBlock;
+		}
+		else
+		{
+			// the jump is copied in since the end of a block is
+			// only aligned for 4 byte values
+			COMMAND_HEADER header;
+			header.type = (uint16_t)COMMAND_JUMP;
+			header.size = (uint16_t)sizeof(JUMP_COMMAND);
+			memcpy(m_pWrite, &header, sizeof(header));
+			memcpy(m_pWrite + offsetof(JUMP_COMMAND, pNextBlock), &pBlock, sizeof(pBlock));
+		}
+
+		m_pWrite = pBlock;
+		m_pBlockEnd = pBlock + g_BlockSize;
+	}
+
+	void* pCommand = m_pWrite;
+	m_pWrite += size;
+	m_used += size;
+	return(pCommand);
+}
+
+/***********************************************************
+ *  FindCommand()
+ *
+ *  This method is used for finding the command at the passed
+ *  in position, following a jump into the next block.
+ ***********************************************************/
+const CommandList::COMMAND_HEADER* CommandList::FindCommand(const char* pPosition) const
+{
+	if (pPosition == m_pWrite)
+	{
+		return(NULL);
+	}
+
+	const COMMAND_HEADER* pCommand = (const COMMAND_HEADER*)pPosition;
+	if (pCommand->type == COMMAND_JUMP)
+	{
+		char* pNextBlock = NULL;
+		memcpy(&pNextBlock, pPosition + offsetof(JUMP_COMMAND, pNextBlock), sizeof(pNextBlock));
+		pCommand = (const COMMAND_HEADER*)pNextBlock;
+	}
+
+	return(pCommand);
+}
+
+/***********************************************************
+ *  GetFirst()
+ *
+ *  These methods are used for walking the recorded commands
+ *  in the order they were added.
+ ***********************************************************/
+const CommandList::COMMAND_HEADER* CommandList::GetFirst() const
+{
+	if (NULL == m_pFirst)
+	{
+		return(NULL);
+	}
+	return(FindCommand(m_pFirst));
+}
+
+const CommandList::COMMAND_HEADER* CommandList::GetNext(const COMMAND_HEADER* pCommand) const
+{
+	return(FindCommand((const char*)pCommand + AlignCommandSize(pCommand->size)));
+}
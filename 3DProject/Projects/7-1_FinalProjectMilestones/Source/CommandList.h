@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// commandlist.h
+// ============
+// compact render commands recorded off the GL thread
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderQueue.h"
+#include "FrameArena.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************
+ *  CommandList
+ *
+ *  This class records the draws of a range of the render
+ *  queue as a packed buffer of plain commands.  Recording
+ *  does not touch OpenGL, so the lists of a frame can be
+ *  filled by worker threads in parallel and then executed
+ *  in order on the GL thread.  Each list is filled by one
+ *  thread at a time, and the commands are written into
+ *  blocks taken from the frame arena, so recording never
+ *  touches the heap and the lists need no cleanup.
+ ***********************************************************/
+class CommandList
+{
+public:
+	enum COMMAND_TYPE
+	{
+		COMMAND_SET_SHADER,
+		COMMAND_SET_MODEL,
+		COMMAND_SET_TEXTURE,
+		COMMAND_SET_COLOR,
+		COMMAND_SET_MATERIAL,
+		COMMAND_SET_UV_SCALE,
+		COMMAND_BEGIN_BLEND,
+		COMMAND_DRAW_MESH,
+		COMMAND_DRAW_BATCH,
+		// continues the list in another block - never returned
+		// while walking the commands
+		COMMAND_JUMP
+	};
+
+	// every command starts with its type and its size in
+	// bytes, which is used to step to the next command
+	struct COMMAND_HEADER
+	{
+		uint16_t type;
+		uint16_t size;
+	};
+
+	struct SET_SHADER_COMMAND
+	{
+		COMMAND_HEADER header;
+		uint32_t features;
+	};
+
+	// the model view projection and normal matrix are built
+	// with the commands, off the GL thread
+	struct SET_MODEL_COMMAND
+	{
+		COMMAND_HEADER header;
+		float model[16];
+		float modelViewProjection[16];
+		float normalMatrix[9];
+	};
+
+	struct SET_TEXTURE_COMMAND
+	{
+		COMMAND_HEADER header;
+		int32_t textureSlot;
+	};
+
+	struct SET_COLOR_COMMAND
+	{
+		COMMAND_HEADER header;
+		float color[4];
+	};
+
+	struct SET_MATERIAL_COMMAND
+	{
+		COMMAND_HEADER header;
+		int32_t material;
+	};
+
+	struct SET_UV_SCALE_COMMAND
+	{
+		COMMAND_HEADER header;
+		float u;
+		float v;
+	};
+
+	struct BEGIN_BLEND_COMMAND
+	{
+		COMMAND_HEADER header;
+	};
+
+	struct DRAW_MESH_COMMAND
+	{
+		COMMAND_HEADER header;
+		int32_t mesh;
+	};
+
+	struct DRAW_BATCH_COMMAND
+	{
+		COMMAND_HEADER header;
+		int32_t batch;
+	};
+
+	// constructor
+	CommandList();
+
+	// start an empty list whose commands are allocated from
+	// the passed in arena
+	void Reset(FrameArena* pArena);
+
+	// add a command of the passed in type - the returned
+	// pointer is valid until the next command is added
+	template <typename T>
+	T* Add(COMMAND_TYPE type)
+	{
+		T* pCommand = (T*)Allocate(sizeof(T));
+		pCommand->header.type = (uint16_t)type;
+		pCommand->header.size = (uint16_t)sizeof(T);
+		return(pCommand);
+	}
+
+	// walk the commands - the next command is NULL after the
+	// last one
+	const COMMAND_HEADER* GetFirst() const;
+	const COMMAND_HEADER* GetNext(const COMMAND_HEADER* pCommand) const;
+
+	// number of bytes of recorded commands
+	size_t GetSize() const { return m_used; }
+
+	// state change counters of the recorded commands
+	RenderQueue::RENDER_STATS& GetStats() { return m_stats; }
+	const RenderQueue::RENDER_STATS& GetStats() const { return m_stats; }
+
+private:
+	struct JUMP_COMMAND
+	{
+		COMMAND_HEADER header;
+		char* pNextBlock;
+	};
+
+	// reserve the passed in number of bytes after the last
+	// command, starting a new block when the current one is full
+	void* Allocate(size_t size);
+	// follow the jumps from the passed in position to the next
+	// command, or NULL at the end of the list
+	const COMMAND_HEADER* FindCommand(const char* pPosition) const;
+
+	FrameArena* m_pArena;
+	char* m_pFirst;
+	char* m_pWrite;
+	char* m_pBlockEnd;
+	size_t m_used;
+	RenderQueue::RENDER_STATS m_stats;
+};
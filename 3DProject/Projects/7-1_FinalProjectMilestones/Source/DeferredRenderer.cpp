@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.cpp
+// ============
+// G-buffer and lighting pass of the deferred shading path
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DeferredRenderer.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const char* g_AlbedoName = "gBufferAlbedo";
+	const char* g_NormalName = "gBufferNormal";
+	const char* g_DepthName = "gBufferDepth";
+	const char* g_InverseViewProjectionName = "inverseViewProjection";
+	const char* g_ViewPositionName = "viewPosition";
+	const char* g_ViewName = "view";
+
+	// the G-buffer textures are bound after the texture slots
+	// used by the scene textures
+	const GLint g_FirstTextureUnit = 16;
+}
+
+/***********************************************************
+ *  DeferredRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DeferredRenderer::DeferredRenderer()
+{
+	m_pShaderRegistry = NULL;
+	m_pLightingShader = NULL;
+	m_framebuffer = 0;
+	m_albedoTexture = 0;
+	m_normalTexture = 0;
+	m_depthTexture = 0;
+	m_width = 0;
+	m_height = 0;
+	memset(m_viewport, 0, sizeof(m_viewport));
+	m_outputFramebuffer = 0;
+	m_emptyVAO = 0;
+	m_materialBuffer = 0;
+}
+
+/***********************************************************
+ *  ~DeferredRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DeferredRenderer::~DeferredRenderer()
+{
+	ReleaseTargets();
+
+	if (m_emptyVAO != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVAO);
+		m_emptyVAO = 0;
+	}
+	if (m_materialBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_materialBuffer);
+		m_materialBuffer = 0;
+	}
+	if (NULL != m_pLightingShader)
+	{
+		m_pShaderRegistry->Release(m_pLightingShader);
+		m_pLightingShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for loading the shader of the
+ *  lighting pass.  The render targets are created by the
+ *  first geometry pass, once the viewport size is known.
+ ***********************************************************/
+bool DeferredRenderer::Create(
+	ShaderRegistry* pShaderRegistry,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath)
+{
+	m_pShaderRegistry = pShaderRegistry;
+	m_pLightingShader = m_pShaderRegistry->Acquire("deferredLighting", vertexShaderPath, fragmentShaderPath);
+	if (NULL == m_pLightingShader)
+	{
+		return(false);
+	}
+
+	glGenVertexArrays(1, &m_emptyVAO);
+	glGenBuffers(1, &m_materialBuffer);
+
+	// a scene without materials still needs one to index
+	std::vector<MATERIAL_DATA> materials;
+	SetMaterials(materials);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetMaterials()
+ *
+ *  This method is used for sending the materials of the
+ *  scene to the lighting shader, in the order of the
+ *  material indices written into the G-buffer.
+ ***********************************************************/
+void DeferredRenderer::SetMaterials(const std::vector<MATERIAL_DATA>& materials)
+{
+	MATERIAL_DATA emptyMaterial;
+	memset(&emptyMaterial, 0, sizeof(emptyMaterial));
+	const MATERIAL_DATA* pMaterials = materials.empty() ? &emptyMaterial : materials.data();
+	size_t materialCount = materials.empty() ? 1 : materials.size();
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(MATERIAL_DATA) * materialCount, pMaterials, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for creating the G-buffer.  The depth
+ *  uses the same format as the window so it can be copied
+ *  there after the lighting pass.
+ ***********************************************************/
+bool DeferredRenderer::CreateTargets(int width, int height)
+{
+	ReleaseTargets();
+
+	GLuint* textures[3] = { &m_albedoTexture, &m_normalTexture, &m_depthTexture };
+	GLenum internalFormats[3] = { GL_RGBA8, GL_RGBA16F, GL_DEPTH24_STENCIL8 };
+	GLenum formats[3] = { GL_RGBA, GL_RGBA, GL_DEPTH_STENCIL };
+	GLenum types[3] = { GL_UNSIGNED_BYTE, GL_FLOAT, GL_UNSIGNED_INT_24_8 };
+
+	for (int i = 0; i < 3; i++)
+	{
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_2D, *textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, formats[i], types[i], NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedoTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normalTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (bComplete == false)
+	{
+		std::cout << "Could not create the G-buffer, width:" << width << ", height:" << height << std::endl;
+		ReleaseTargets();
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	return(true);
+}
+
+/***********************************************************
+ *  ReleaseTargets()
+ *
+ *  This method is used for freeing the G-buffer.
+ ***********************************************************/
+void DeferredRenderer::ReleaseTargets()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+
+	GLuint textures[3] = { m_albedoTexture, m_normalTexture, m_depthTexture };
+	for (int i = 0; i < 3; i++)
+	{
+		if (textures[i] != 0)
+		{
+			glDeleteTextures(1, &textures[i]);
+		}
+	}
+	m_albedoTexture = 0;
+	m_normalTexture = 0;
+	m_depthTexture = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  BeginGeometryPass()
+ *
+ *  This method is used for binding the G-buffer before the
+ *  opaque objects are drawn.  The targets follow the size of
+ *  the viewport and are created again when it changes.
+ ***********************************************************/
+bool DeferredRenderer::BeginGeometryPass()
+{
+	glGetIntegerv(GL_VIEWPORT, m_viewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_outputFramebuffer);
+	int width = m_viewport[2];
+	int height = m_viewport[3];
+
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	if ((width != m_width) || (height != m_height))
+	{
+		if (CreateTargets(width, height) == false)
+		{
+			return(false);
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, width, height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RunLightingPass()
+ *
+ *  This method is used for shading the G-buffer into the
+ *  window.  The lighting shader is left in use, so the scene
+ *  shader has to be activated again before drawing objects.
+ ***********************************************************/
+void DeferredRenderer::RunLightingPass(
+	const glm::mat4& view,
+	const glm::mat4& projection)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)m_outputFramebuffer);
+	glViewport(m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3]);
+
+	// the samplers are set every frame since the program is
+	// compiled again when the lights of the scene change
+	m_pLightingShader->use();
+	m_pLightingShader->setSampler2DValue(g_AlbedoName, g_FirstTextureUnit);
+	m_pLightingShader->setSampler2DValue(g_NormalName, g_FirstTextureUnit + 1);
+	m_pLightingShader->setSampler2DValue(g_DepthName, g_FirstTextureUnit + 2);
+	m_pLightingShader->setMat4Value(g_InverseViewProjectionName, glm::inverse(projection * view));
+	m_pLightingShader->setMat4Value(g_ViewName, view);
+	m_pLightingShader->setVec3Value(g_ViewPositionName, glm::vec3(glm::inverse(view)[3]));
+
+	GLuint textures[3] = { m_albedoTexture, m_normalTexture, m_depthTexture };
+	for (int i = 0; i < 3; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + g_FirstTextureUnit + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_MATERIALS, m_materialBuffer);
+
+	// every pixel is shaded once - the depth of the window is
+	// neither tested nor written by the triangle
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+
+	// the depth of the opaque objects hides the transparent
+	// objects drawn behind them afterwards
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)m_outputFramebuffer);
+	glBlitFramebuffer(
+		0, 0, m_width, m_height,
+		m_viewport[0], m_viewport[1], m_viewport[0] + m_width, m_viewport[1] + m_height,
+		GL_DEPTH_BUFFER_BIT,
+		GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)m_outputFramebuffer);
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.h
+// ============
+// G-buffer and lighting pass of the deferred shading path
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderRegistry.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  DeferredRenderer
+ *
+ *  This class holds the render targets of the deferred
+ *  shading path.  The geometry pass draws the opaque objects
+ *  with the scene shader into a G-buffer holding the albedo,
+ *  the normal and material index, and the depth.  The
+ *  lighting pass then draws one screen covering triangle
+ *  that shades every pixel once with the scene wide lights
+ *  and the point lights of its cluster, and copies the depth
+ *  to the window so transparent objects can be drawn over
+ *  the result with the forward shader.  The window is
+ *  whichever framebuffer was bound when the geometry pass
+ *  started.
+ ***********************************************************/
+class DeferredRenderer
+{
+public:
+	// the material layout shared with the lighting shader
+	struct MATERIAL_DATA
+	{
+		glm::vec4 ambientColorStrength;
+		glm::vec4 diffuseColorShininess;
+		glm::vec4 specularColor;
+	};
+
+	// shader storage buffer binding of the materials, after
+	// the bindings used by the clustered lights
+	enum BUFFER_BINDING
+	{
+		BINDING_MATERIALS = 3
+	};
+
+	// constructor
+	DeferredRenderer();
+	// destructor
+	~DeferredRenderer();
+
+	// load the lighting shader
+	bool Create(
+		ShaderRegistry* pShaderRegistry,
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath);
+
+	// the program of the lighting pass, which takes the light
+	// uniforms in the deferred path
+	ShaderManager* GetLightingShader() const { return m_pLightingShader; }
+
+	// send the materials of the scene to the lighting shader
+	void SetMaterials(const std::vector<MATERIAL_DATA>& materials);
+
+	// bind the G-buffer for drawing, sized to the viewport
+	bool BeginGeometryPass();
+	// shade the G-buffer into the window and copy its depth
+	void RunLightingPass(
+		const glm::mat4& view,
+		const glm::mat4& projection);
+
+private:
+	// create the render targets for the passed in size
+	bool CreateTargets(int width, int height);
+	// free the render targets
+	void ReleaseTargets();
+
+	ShaderRegistry* m_pShaderRegistry;
+	ShaderManager* m_pLightingShader;
+
+	GLuint m_framebuffer;
+	GLuint m_albedoTexture;
+	GLuint m_normalTexture;
+	GLuint m_depthTexture;
+	int m_width;
+	int m_height;
+	// the viewport of the window, restored for the lighting pass
+	GLint m_viewport[4];
+	// the framebuffer bound before the geometry pass - the
+	// window, or the offscreen target of the headless mode
+	GLint m_outputFramebuffer;
+
+	// the screen covering triangle has no vertex data, but the
+	// core profile needs a vertex array bound to draw
+	GLuint m_emptyVAO;
+	GLuint m_materialBuffer;
+};
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.cpp
+// ============
+// depth only pass that keeps the main pass from shading hidden fragments
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DepthPrepass.h"
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	const char* g_ModelViewProjectionName = "modelViewProjection";
+}
+
+/***********************************************************
+ *  DepthPrepass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DepthPrepass::DepthPrepass()
+{
+	m_pShaderRegistry = NULL;
+	m_pDepthShader = NULL;
+	m_modelViewProjectionLocation = -1;
+	memset(m_queries, 0, sizeof(m_queries));
+	memset(m_bQueriesIssued, 0, sizeof(m_bQueriesIssued));
+	m_frame = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~DepthPrepass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DepthPrepass::~DepthPrepass()
+{
+	if (m_queries[0][0] != 0)
+	{
+		glDeleteQueries(QUERY_FRAMES * 2, &m_queries[0][0]);
+	}
+	if (NULL != m_pDepthShader)
+	{
+		m_pShaderRegistry->Release(m_pDepthShader);
+		m_pDepthShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for loading the depth only shader
+ *  and creating the sample queries.
+ ***********************************************************/
+bool DepthPrepass::Create(
+	ShaderRegistry* pShaderRegistry,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath)
+{
+	m_pShaderRegistry = pShaderRegistry;
+	m_pDepthShader = m_pShaderRegistry->Acquire("depthPrepass", vertexShaderPath, fragmentShaderPath);
+	if (NULL == m_pDepthShader)
+	{
+		return(false);
+	}
+
+	glGenQueries(QUERY_FRAMES * 2, &m_queries[0][0]);
+	return(true);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for starting the depth only draws.
+ *  Color writes are turned off and the queries of this frame
+ *  slot are read before they are used again.  The matrix
+ *  changes for every draw, so its location is looked up
+ *  once here, which also follows a reloaded program.
+ ***********************************************************/
+void DepthPrepass::Begin()
+{
+	m_frame = (m_frame + 1) % QUERY_FRAMES;
+	ReadQueries(m_frame);
+
+	m_pDepthShader->use();
+	m_modelViewProjectionLocation = m_pDepthShader->GetUniformLocation(g_ModelViewProjectionName);
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_frame][0]);
+}
+
+/***********************************************************
+ *  SetModelViewProjection()
+ *
+ *  This method is used for setting the model view
+ *  projection of the next depth only draw.  The main pass
+ *  gets the same matrix, so both passes write the same
+ *  depth.
+ ***********************************************************/
+void DepthPrepass::SetModelViewProjection(const glm::mat4& modelViewProjection)
+{
+	glUniformMatrix4fv(m_modelViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(modelViewProjection));
+}
+
+/***********************************************************
+ *  BeginMainPass()
+ *
+ *  This method is used for switching from laying down depth
+ *  to shading.  Only the fragments whose depth equals the
+ *  stored depth are shaded, and the depth is not written
+ *  again.
+ ***********************************************************/
+void DepthPrepass::BeginMainPass()
+{
+	glEndQuery(GL_SAMPLES_PASSED);
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthFunc(GL_EQUAL);
+	glDepthMask(GL_FALSE);
+	glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_frame][1]);
+}
+
+/***********************************************************
+ *  EndMainPass()
+ *
+ *  This method is used for restoring the default depth test
+ *  after the opaque objects, so transparent objects and the
+ *  depth clear of the next frame work as before.
+ ***********************************************************/
+void DepthPrepass::EndMainPass()
+{
+	glEndQuery(GL_SAMPLES_PASSED);
+	m_bQueriesIssued[m_frame] = true;
+
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+}
+
+/***********************************************************
+ *  ReadQueries()
+ *
+ *  This method is used for reading the sample counts of an
+ *  earlier frame.  A frame whose results are not ready yet
+ *  is skipped, so the last finished counts are kept.
+ ***********************************************************/
+void DepthPrepass::ReadQueries(unsigned int frame)
+{
+	if (m_bQueriesIssued[frame] == false)
+	{
+		return;
+	}
+	m_bQueriesIssued[frame] = false;
+
+	GLuint bAvailable = GL_FALSE;
+	glGetQueryObjectuiv(m_queries[frame][1], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+	if (bAvailable == GL_FALSE)
+	{
+		return;
+	}
+
+	GLuint64 prepassSamples = 0;
+	GLuint64 shadedSamples = 0;
+	glGetQueryObjectui64v(m_queries[frame][0], GL_QUERY_RESULT, &prepassSamples);
+	glGetQueryObjectui64v(m_queries[frame][1], GL_QUERY_RESULT, &shadedSamples);
+
+	m_stats.prepassSamples = prepassSamples;
+	m_stats.shadedSamples = shadedSamples;
+	m_stats.savedSamples = (prepassSamples > shadedSamples) ? (prepassSamples - shadedSamples) : 0;
+}
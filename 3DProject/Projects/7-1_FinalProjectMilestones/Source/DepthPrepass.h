@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.h
+// ============
+// depth only pass that keeps the main pass from shading hidden fragments
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderRegistry.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/***********************************************************
+ *  DepthPrepass
+ *
+ *  This class draws the opaque objects with a shader that
+ *  only reads the vertex positions and writes nothing but
+ *  depth.  The main pass then tests with GL_EQUAL and does
+ *  not write depth, so the lighting of the fragment shader
+ *  runs once for every visible sample instead of once for
+ *  every fragment that passes the depth test in draw order.
+ *
+ *  Both passes are counted with sample queries.  The
+ *  results are read a few frames later so the queries never
+ *  stall the pipeline, and their difference is the estimate
+ *  of the fragment shading that was saved.
+ ***********************************************************/
+class DepthPrepass
+{
+public:
+	struct PREPASS_STATS
+	{
+		uint64_t prepassSamples;	// samples passing the depth test in draw order
+		uint64_t shadedSamples;		// samples shaded by the main pass
+		uint64_t savedSamples;		// fragment shader runs saved by the pre-pass
+	};
+
+	// constructor
+	DepthPrepass();
+	// destructor
+	~DepthPrepass();
+
+	// load the depth only shader
+	bool Create(
+		ShaderRegistry* pShaderRegistry,
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath);
+
+	// start laying down depth
+	void Begin();
+	// set the model view projection of the next depth only
+	// draw, which must be the one the main pass uses
+	void SetModelViewProjection(const glm::mat4& modelViewProjection);
+	// switch the depth test for the main pass - the scene
+	// shader must be activated by the caller
+	void BeginMainPass();
+	// restore the depth state once the opaque objects of the
+	// main pass are drawn
+	void EndMainPass();
+
+	// the sample counts of the latest finished frame
+	const PREPASS_STATS& GetStats() const { return m_stats; }
+
+private:
+	// read the queries of a frame when their results are ready
+	void ReadQueries(unsigned int frame);
+
+	// number of frames the query results are read behind
+	enum { QUERY_FRAMES = 3 };
+
+	ShaderRegistry* m_pShaderRegistry;
+	ShaderManager* m_pDepthShader;
+	GLint m_modelViewProjectionLocation;
+
+	// the pre-pass and the main pass query of every frame
+	GLuint m_queries[QUERY_FRAMES][2];
+	bool m_bQueriesIssued[QUERY_FRAMES];
+	unsigned int m_frame;
+
+	PREPASS_STATS m_stats;
+};
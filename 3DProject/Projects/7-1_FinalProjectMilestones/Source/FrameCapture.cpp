@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// reads rendered frames back without waiting for the GPU
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+#include "FrameEncoder.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// longest wait for a copy that should have finished frames
+	// ago, in nanoseconds
+	const GLuint64 g_FenceTimeout = 1000000000;
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture(FrameEncoder* pEncoder, bool bDropWhenBusy)
+{
+	m_pEncoder = pEncoder;
+	m_bDropWhenBusy = bDropWhenBusy;
+	m_captureCount = 0;
+	m_droppedFrames = 0;
+
+	GLuint buffers[RING_SIZE];
+	glGenBuffers(RING_SIZE, buffers);
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		m_ring[i].buffer = buffers[i];
+		m_ring[i].fence = 0;
+		m_ring[i].capacity = 0;
+		m_ring[i].width = 0;
+		m_ring[i].height = 0;
+	}
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Finish();
+
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		glDeleteBuffers(1, &m_ring[i].buffer);
+	}
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method is used for starting the copy of a frame.
+ *  The frame captured MAP_DELAY captures ago is mapped and
+ *  passed on first, then the new copy is queued into the
+ *  buffer that frees up.  The buffer grows when the frame
+ *  is larger than any before it.
+ ***********************************************************/
+void FrameCapture::Capture(const std::string& path, int width, int height)
+{
+	if ((width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	Retire(m_ring[(m_captureCount + RING_SIZE - MAP_DELAY) % RING_SIZE]);
+
+	READBACK& readback = m_ring[m_captureCount % RING_SIZE];
+	Retire(readback);
+
+	size_t size = (size_t)width * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	if (size > readback.capacity)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		readback.capacity = size;
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.width = width;
+	readback.height = height;
+	readback.path = path;
+	m_captureCount++;
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for passing on the frames that are
+ *  still being copied, oldest first.
+ ***********************************************************/
+void FrameCapture::Finish()
+{
+	for (int i = 0; i < RING_SIZE; i++)
+	{
+		Retire(m_ring[(m_captureCount + i) % RING_SIZE]);
+	}
+}
+
+/***********************************************************
+ *  Retire()
+ *
+ *  This method is used for mapping a finished copy and
+ *  handing its pixels to the encoder.  The fence has
+ *  normally passed by now, so the wait returns at once.
+ ***********************************************************/
+void FrameCapture::Retire(READBACK& readback)
+{
+	if (readback.fence == 0)
+	{
+		return;
+	}
+
+	GLenum waitResult = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+	glDeleteSync(readback.fence);
+	readback.fence = 0;
+	if ((waitResult != GL_ALREADY_SIGNALED) && (waitResult != GL_CONDITION_SATISFIED))
+	{
+		std::cout << "Frame capture timed out:" << readback.path << std::endl;
+		m_droppedFrames++;
+		return;
+	}
+
+	size_t size = (size_t)readback.width * readback.height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+	if (NULL != pMapped)
+	{
+		m_pEncoder->AcquireBuffer(m_pixels);
+		m_pixels.resize(size);
+		memcpy(m_pixels.data(), pMapped, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if ((NULL == pMapped) ||
+		(m_pEncoder->Submit(readback.path, m_pixels, readback.width, readback.height, !m_bDropWhenBusy) == false))
+	{
+		m_droppedFrames++;
+	}
+}
@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// reads rendered frames back without waiting for the GPU
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+class FrameEncoder;
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class copies frames into a ring of pixel pack
+ *  buffers.  The copy of a frame is queued on the GPU along
+ *  with a fence, and the buffer is only mapped two captures
+ *  later, when the GPU has long finished with it, so reading
+ *  frames back never stalls the render loop.  The mapped
+ *  pixels are handed to a frame encoder, whose threads write
+ *  the image files.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor - frames are dropped instead of waited for
+	// when bDropWhenBusy is set and the encoder falls behind
+	FrameCapture(FrameEncoder* pEncoder, bool bDropWhenBusy);
+	// destructor
+	~FrameCapture();
+
+	// start copying the frame in the bound read framebuffer
+	void Capture(const std::string& path, int width, int height);
+	// hand the frames still being copied to the encoder
+	void Finish();
+
+	// number of frames dropped because the encoder was busy
+	unsigned int GetDroppedCount() const { return m_droppedFrames; }
+
+private:
+	enum
+	{
+		RING_SIZE = 3,		// buffers in the ring
+		MAP_DELAY = 2		// captures between copying and mapping
+	};
+
+	struct READBACK
+	{
+		GLuint buffer;
+		GLsync fence;
+		size_t capacity;
+		int width;
+		int height;
+		std::string path;
+	};
+
+	// map a finished copy and pass its pixels on
+	void Retire(READBACK& readback);
+
+	READBACK m_ring[RING_SIZE];
+	unsigned int m_captureCount;
+	unsigned int m_droppedFrames;
+	bool m_bDropWhenBusy;
+	FrameEncoder* m_pEncoder;
+	// pixels of the frame being handed to the encoder
+	std::vector<unsigned char> m_pixels;
+};
@@ -0,0 +1,330 @@
+///////////////////////////////////////////////////////////////////////////////
+// headlesscontext.cpp
+// ============
+// OpenGL context of the headless mode, made without a window
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HeadlessContext.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define HEADLESS_EGLAPI __stdcall
+#else
+#include <dlfcn.h>
+#define HEADLESS_EGLAPI
+#endif
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the EGL values used here, so the EGL headers are not
+	// needed to build the application
+	enum
+	{
+		EGL_NONE = 0x3038,
+		EGL_SURFACE_TYPE = 0x3033,
+		EGL_PBUFFER_BIT = 0x0001,
+		EGL_RENDERABLE_TYPE = 0x3040,
+		EGL_OPENGL_BIT = 0x0008,
+		EGL_WIDTH = 0x3057,
+		EGL_HEIGHT = 0x3056,
+		EGL_OPENGL_API = 0x30A2,
+		EGL_CONTEXT_MAJOR_VERSION = 0x3098,
+		EGL_CONTEXT_MINOR_VERSION = 0x30FB,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK = 0x30FD,
+		EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001,
+		EGL_PLATFORM_SURFACELESS_MESA = 0x31DD
+	};
+
+	typedef void* (HEADLESS_EGLAPI* GetProcAddressFunc)(const char* name);
+	typedef void* (HEADLESS_EGLAPI* GetDisplayFunc)(void* nativeDisplay);
+	typedef void* (HEADLESS_EGLAPI* GetPlatformDisplayFunc)(unsigned int platform, void* nativeDisplay, const int* attributes);
+	typedef unsigned int (HEADLESS_EGLAPI* InitializeFunc)(void* display, int* major, int* minor);
+	typedef unsigned int (HEADLESS_EGLAPI* BindAPIFunc)(unsigned int api);
+	typedef unsigned int (HEADLESS_EGLAPI* ChooseConfigFunc)(void* display, const int* attributes, void** configs, int configSize, int* configCount);
+	typedef void* (HEADLESS_EGLAPI* CreateContextFunc)(void* display, void* config, void* shareContext, const int* attributes);
+	typedef void* (HEADLESS_EGLAPI* CreatePbufferSurfaceFunc)(void* display, void* config, const int* attributes);
+	typedef unsigned int (HEADLESS_EGLAPI* MakeCurrentFunc)(void* display, void* drawSurface, void* readSurface, void* context);
+	typedef unsigned int (HEADLESS_EGLAPI* DestroyContextFunc)(void* display, void* context);
+	typedef unsigned int (HEADLESS_EGLAPI* DestroySurfaceFunc)(void* display, void* surface);
+	typedef unsigned int (HEADLESS_EGLAPI* TerminateFunc)(void* display);
+
+	// the EGL functions, found once the library is loaded
+	struct EGL_FUNCTIONS
+	{
+		GetProcAddressFunc getProcAddress;
+		GetDisplayFunc getDisplay;
+		InitializeFunc initialize;
+		BindAPIFunc bindAPI;
+		ChooseConfigFunc chooseConfig;
+		CreateContextFunc createContext;
+		CreatePbufferSurfaceFunc createPbufferSurface;
+		MakeCurrentFunc makeCurrent;
+		DestroyContextFunc destroyContext;
+		DestroySurfaceFunc destroySurface;
+		TerminateFunc terminate;
+	};
+	EGL_FUNCTIONS g_EGL = {};
+
+	// the core versions tried in turn, the shaders need 4.4
+	const int g_ContextVersions[2][2] = { { 4, 6 }, { 4, 4 } };
+
+	/***********************************************************
+	 *  LoadEGLLibrary()
+	 *
+	 *  This function is used to load the EGL library of the
+	 *  system, returning NULL when there is none.
+	 ***********************************************************/
+	void* LoadEGLLibrary()
+	{
+#ifdef _WIN32
+		return((void*)LoadLibraryA("libEGL.dll"));
+#else
+		void* library = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+		if (NULL == library)
+		{
+			library = dlopen("libEGL.so", RTLD_NOW | RTLD_LOCAL);
+		}
+		return(library);
+#endif
+	}
+
+	/***********************************************************
+	 *  UnloadEGLLibrary()
+	 *
+	 *  This function is used to unload the EGL library.
+	 ***********************************************************/
+	void UnloadEGLLibrary(void* library)
+	{
+#ifdef _WIN32
+		FreeLibrary((HMODULE)library);
+#else
+		dlclose(library);
+#endif
+	}
+
+	/***********************************************************
+	 *  GetEGLSymbol()
+	 *
+	 *  This function is used to find an exported function of
+	 *  the EGL library.
+	 ***********************************************************/
+	void* GetEGLSymbol(void* library, const char* name)
+	{
+#ifdef _WIN32
+		return((void*)GetProcAddress((HMODULE)library, name));
+#else
+		return(dlsym(library, name));
+#endif
+	}
+}
+
+/***********************************************************
+ *  HeadlessContext()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+HeadlessContext::HeadlessContext()
+{
+	m_library = NULL;
+	m_display = NULL;
+	m_surface = NULL;
+	m_context = NULL;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~HeadlessContext()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+HeadlessContext::~HeadlessContext()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used to create the context and make it
+ *  current, with no surface when the driver allows it and
+ *  a small pbuffer surface otherwise.  The frames are drawn
+ *  into framebuffer objects of the passed in size, which is
+ *  kept for the projection.
+ ***********************************************************/
+bool HeadlessContext::Create(int width, int height)
+{
+	Destroy();
+
+	m_library = LoadEGLLibrary();
+	if (NULL == m_library)
+	{
+		std::cout << "Could not load the EGL library for the headless context" << std::endl;
+		return(false);
+	}
+
+	g_EGL.getProcAddress = (GetProcAddressFunc)GetEGLSymbol(m_library, "eglGetProcAddress");
+	g_EGL.getDisplay = (GetDisplayFunc)GetEGLSymbol(m_library, "eglGetDisplay");
+	g_EGL.initialize = (InitializeFunc)GetEGLSymbol(m_library, "eglInitialize");
+	g_EGL.bindAPI = (BindAPIFunc)GetEGLSymbol(m_library, "eglBindAPI");
+	g_EGL.chooseConfig = (ChooseConfigFunc)GetEGLSymbol(m_library, "eglChooseConfig");
+	g_EGL.createContext = (CreateContextFunc)GetEGLSymbol(m_library, "eglCreateContext");
+	g_EGL.createPbufferSurface = (CreatePbufferSurfaceFunc)GetEGLSymbol(m_library, "eglCreatePbufferSurface");
+	g_EGL.makeCurrent = (MakeCurrentFunc)GetEGLSymbol(m_library, "eglMakeCurrent");
+	g_EGL.destroyContext = (DestroyContextFunc)GetEGLSymbol(m_library, "eglDestroyContext");
+	g_EGL.destroySurface = (DestroySurfaceFunc)GetEGLSymbol(m_library, "eglDestroySurface");
+	g_EGL.terminate = (TerminateFunc)GetEGLSymbol(m_library, "eglTerminate");
+	if ((NULL == g_EGL.getProcAddress) || (NULL == g_EGL.getDisplay) || (NULL == g_EGL.initialize) ||
+		(NULL == g_EGL.bindAPI) || (NULL == g_EGL.chooseConfig) || (NULL == g_EGL.createContext) ||
+		(NULL == g_EGL.createPbufferSurface) || (NULL == g_EGL.makeCurrent) || (NULL == g_EGL.destroyContext) ||
+		(NULL == g_EGL.destroySurface) || (NULL == g_EGL.terminate))
+	{
+		std::cout << "The EGL library is missing functions for the headless context" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	if ((InitializeDisplay() == false) || (g_EGL.bindAPI(EGL_OPENGL_API) == 0))
+	{
+		std::cout << "Could not initialize EGL for desktop OpenGL" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	// configs able to make a pbuffer are preferred, for the
+	// drivers that need a surface to make the context current
+	void* config = NULL;
+	int configCount = 0;
+	const int surfaceTypes[2] = { EGL_PBUFFER_BIT, 0 };
+	for (int i = 0; (i < 2) && (configCount == 0); i++)
+	{
+		const int configAttributes[] = {
+			EGL_SURFACE_TYPE, surfaceTypes[i],
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE };
+		if (g_EGL.chooseConfig(m_display, configAttributes, &config, 1, &configCount) == 0)
+		{
+			configCount = 0;
+		}
+	}
+	if ((configCount == 0) || (CreateContext(config) == false))
+	{
+		std::cout << "Could not create an OpenGL 4.4 core context through EGL" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	if (g_EGL.makeCurrent(m_display, NULL, NULL, m_context) == 0)
+	{
+		const int surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		m_surface = g_EGL.createPbufferSurface(m_display, config, surfaceAttributes);
+		if ((NULL == m_surface) || (g_EGL.makeCurrent(m_display, m_surface, m_surface, m_context) == 0))
+		{
+			std::cout << "Could not make the EGL context current" << std::endl;
+			Destroy();
+			return(false);
+		}
+	}
+
+	m_width = width;
+	m_height = height;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used to release the context, the surface
+ *  and the display, and to unload the EGL library.
+ ***********************************************************/
+void HeadlessContext::Destroy()
+{
+	if (NULL != m_display)
+	{
+		g_EGL.makeCurrent(m_display, NULL, NULL, NULL);
+		if (NULL != m_context)
+		{
+			g_EGL.destroyContext(m_display, m_context);
+			m_context = NULL;
+		}
+		if (NULL != m_surface)
+		{
+			g_EGL.destroySurface(m_display, m_surface);
+			m_surface = NULL;
+		}
+		g_EGL.terminate(m_display);
+		m_display = NULL;
+	}
+	if (NULL != m_library)
+	{
+		UnloadEGLLibrary(m_library);
+		m_library = NULL;
+	}
+	g_EGL = EGL_FUNCTIONS();
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  InitializeDisplay()
+ *
+ *  This method is used to get the Mesa surfaceless display,
+ *  which needs no window system, or the default display of
+ *  the EGL library when that platform is not supported.
+ ***********************************************************/
+bool HeadlessContext::InitializeDisplay()
+{
+	GetPlatformDisplayFunc getPlatformDisplay =
+		(GetPlatformDisplayFunc)g_EGL.getProcAddress("eglGetPlatformDisplayEXT");
+	if (NULL != getPlatformDisplay)
+	{
+		m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, NULL, NULL);
+		if ((NULL != m_display) && (g_EGL.initialize(m_display, NULL, NULL) != 0))
+		{
+			return(true);
+		}
+	}
+
+	m_display = g_EGL.getDisplay(NULL);
+	if ((NULL != m_display) && (g_EGL.initialize(m_display, NULL, NULL) != 0))
+	{
+		return(true);
+	}
+	m_display = NULL;
+
+	return(false);
+}
+
+/***********************************************************
+ *  CreateContext()
+ *
+ *  This method is used to create a core context of the
+ *  newest version in the list that the driver supports.
+ ***********************************************************/
+bool HeadlessContext::CreateContext(void* config)
+{
+	for (int i = 0; (i < 2) && (NULL == m_context); i++)
+	{
+		const int contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, g_ContextVersions[i][0],
+			EGL_CONTEXT_MINOR_VERSION, g_ContextVersions[i][1],
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE };
+		m_context = g_EGL.createContext(m_display, config, NULL, contextAttributes);
+	}
+
+	return(NULL != m_context);
+}
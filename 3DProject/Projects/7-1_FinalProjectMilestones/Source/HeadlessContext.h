@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// headlesscontext.h
+// ============
+// OpenGL context of the headless mode, made without a window
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  HeadlessContext
+ *
+ *  This class makes an OpenGL core context current through
+ *  EGL, with no window and no display server.  The Mesa
+ *  surfaceless platform is tried first, so render nodes
+ *  without a display (or the llvmpipe driver on machines
+ *  without a GPU) can draw into framebuffer objects.  The
+ *  EGL library is loaded when the context is created, so
+ *  the application still starts where it is missing.
+ ***********************************************************/
+class HeadlessContext
+{
+public:
+	// constructor
+	HeadlessContext();
+	// destructor
+	~HeadlessContext();
+
+	// create the context and make it current on this thread
+	bool Create(int width, int height);
+	// release the context and unload the EGL library
+	void Destroy();
+
+	bool IsCreated() const { return(NULL != m_context); }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+
+private:
+	// the context is owned by one object only
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// get the display and initialize EGL on it
+	bool InitializeDisplay();
+	// create a core context of the first version supported
+	bool CreateContext(void* config);
+
+	void* m_library;
+	void* m_display;
+	void* m_surface;
+	void* m_context;
+	int m_width;
+	int m_height;
+};
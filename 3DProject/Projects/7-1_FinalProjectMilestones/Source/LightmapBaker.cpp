@@ -0,0 +1,726 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.cpp
+// ============
+// lays out and bakes the lightmap of the static geometry
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightmapBaker.h"
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// position, normal and UV of every merged vertex, the
+	// same layout as the shape meshes
+	const GLuint g_FloatsPerVertex = 8;
+
+	// triangles joined into a chart face at most 45 degrees
+	// away from the first triangle of the chart, so the flat
+	// projection stretches the texels by less than 1.5
+	const float g_ChartNormalLimit = 0.7071f;
+	// texel density of the charts, lowered when the atlas
+	// would grow past its largest size
+	const float g_TexelsPerUnit = 4.0f;
+	const int g_MinAtlasSize = 64;
+	const int g_MaxAtlasSize = 512;
+	// empty texels on every side of a chart, filled from the
+	// chart so filtering does not blend in its neighbours
+	const int g_ChartPadding = 1;
+	// paths gathering the bounced light of every texel
+	const int g_SamplesPerTexel = 64;
+	// atlas rows baked by one worker task
+	const int g_RowsPerTask = 4;
+	// bumped when the baked values change meaning, so the old
+	// cache files are not used
+	const uint32_t g_BakeVersion = 1;
+
+	const char* g_LightmapCacheDirectory = "../../Utilities/textures/cache/";
+	const uint32_t g_LightmapCacheMagic = 0x50414d4c;	// "LMAP"
+
+	struct LIGHTMAP_CACHE_HEADER
+	{
+		uint32_t magic;
+		uint32_t width;
+		uint32_t height;
+		uint32_t reserved;
+		uint64_t key;
+	};
+
+	// file name of the lightmap baked for the passed in key
+	std::string GetCachePath(uint64_t key)
+	{
+		char keyText[17];
+		snprintf(keyText, sizeof(keyText), "%016llx", (unsigned long long)key);
+		return(std::string(g_LightmapCacheDirectory) + keyText + ".lightmap");
+	}
+
+	// exact position of a vertex, which finds the vertices
+	// that shapes split for their normals or UVs
+	struct POSITION_KEY
+	{
+		uint32_t bits[3];
+
+		bool operator<(const POSITION_KEY& other) const
+		{
+			return(std::lexicographical_compare(
+				bits, bits + 3,
+				other.bits, other.bits + 3));
+		}
+	};
+
+	uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return(bits);
+	}
+
+	glm::vec3 ReadVector(const GLfloat* values)
+	{
+		return(glm::vec3(values[0], values[1], values[2]));
+	}
+
+	// edge function of the texel position p against the edge
+	// from a to b
+	float EdgeFunction(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+	{
+		return((b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x));
+	}
+}
+
+/***********************************************************
+ *  LightmapBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightmapBaker::LightmapBaker(ThreadPool* pThreadPool)
+{
+	m_pThreadPool = pThreadPool;
+	m_width = 0;
+	m_height = 0;
+	m_texelsPerUnit = 0.0f;
+	m_cacheKey = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  Unwrap()
+ *
+ *  This method is used for laying out the lightmap of the
+ *  passed in geometry.  The charts are packed at the full
+ *  texel density into the smallest square that holds them,
+ *  and the density is lowered until they fit the largest
+ *  atlas, which also bounds the time the baking takes.
+ ***********************************************************/
+bool LightmapBaker::Unwrap(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices)
+{
+	m_charts.clear();
+	m_vertices.clear();
+	m_indices.clear();
+	m_width = 0;
+	m_height = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	BuildCharts(vertices, indices);
+	if (m_charts.empty())
+	{
+		return(false);
+	}
+
+	float texelsPerUnit = g_TexelsPerUnit;
+	bool bPacked = false;
+	while ((bPacked == false) && (texelsPerUnit > 0.001f))
+	{
+		float area = 0.0f;
+		for (size_t i = 0; i < m_charts.size(); i++)
+		{
+			glm::vec2 size = (m_charts[i].boundsMax - m_charts[i].boundsMin) * texelsPerUnit + (float)(1 + 2 * g_ChartPadding);
+			area += size.x * size.y;
+		}
+
+		int atlasWidth = g_MinAtlasSize;
+		while (((float)atlasWidth * atlasWidth < area) && (atlasWidth < g_MaxAtlasSize))
+		{
+			atlasWidth *= 2;
+		}
+
+		while ((bPacked == false) && (atlasWidth <= g_MaxAtlasSize))
+		{
+			bPacked = PackCharts(atlasWidth, texelsPerUnit);
+			atlasWidth *= 2;
+		}
+		if (bPacked == false)
+		{
+			texelsPerUnit *= 0.75f;
+		}
+	}
+	if (bPacked == false)
+	{
+		return(false);
+	}
+	m_texelsPerUnit = texelsPerUnit;
+
+	BuildGeometry(vertices, indices);
+
+	m_stats.chartCount = m_charts.size();
+	m_stats.width = m_width;
+	m_stats.height = m_height;
+	m_stats.texelsPerUnit = m_texelsPerUnit;
+	return(true);
+}
+
+/***********************************************************
+ *  LoadCache()
+ *
+ *  This method is used for reading the lightmap an earlier
+ *  run baked.  The cache key covers the passed in hash of
+ *  the scene, the unwrapped geometry and the bake settings,
+ *  so a cached lightmap is only used when baking would give
+ *  the same texels.
+ ***********************************************************/
+bool LightmapBaker::LoadCache(uint64_t sceneKey)
+{
+	m_cacheKey = ShaderPreprocessor::HashValue(sceneKey, ShaderPreprocessor::HASH_SEED);
+	m_cacheKey = ShaderPreprocessor::HashValue(g_BakeVersion, m_cacheKey);
+	m_cacheKey = ShaderPreprocessor::HashValue(g_SamplesPerTexel, m_cacheKey);
+	m_cacheKey = ShaderPreprocessor::HashValue(((uint64_t)m_width << 32) | (uint32_t)m_height, m_cacheKey);
+	for (size_t i = 0; i < m_vertices.size(); i++)
+	{
+		m_cacheKey = ShaderPreprocessor::HashValue(FloatBits(m_vertices[i]), m_cacheKey);
+	}
+	for (size_t i = 0; i < m_indices.size(); i++)
+	{
+		m_cacheKey = ShaderPreprocessor::HashValue(m_indices[i], m_cacheKey);
+	}
+
+	std::string cachePath = GetCachePath(m_cacheKey);
+	std::ifstream cacheStream(cachePath.c_str(), std::ios::in | std::ios::binary);
+	if (!cacheStream.is_open())
+	{
+		return(false);
+	}
+
+	LIGHTMAP_CACHE_HEADER header;
+	cacheStream.read((char*)&header, sizeof(header));
+	if (!cacheStream || (header.magic != g_LightmapCacheMagic) || (header.key != m_cacheKey) ||
+		(header.width != (uint32_t)m_width) || (header.height != (uint32_t)m_height))
+	{
+		return(false);
+	}
+
+	m_texels.resize((size_t)m_width * m_height * 3);
+	cacheStream.read((char*)m_texels.data(), sizeof(float) * m_texels.size());
+	if (!cacheStream)
+	{
+		m_texels.clear();
+		return(false);
+	}
+
+	std::cout << "Loaded lightmap:" << cachePath << std::endl;
+	m_stats.bFromCache = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for filling the texels of the
+ *  lightmap, spreading the rows of the atlas over the
+ *  thread pool, and saving them in the cache.
+ ***********************************************************/
+void LightmapBaker::Bake(const PathTracer& tracer)
+{
+	RasterizeCharts();
+
+	m_texels.assign((size_t)m_width * m_height * 3, 0.0f);
+	int taskCount = (m_height + g_RowsPerTask - 1) / g_RowsPerTask;
+	m_pThreadPool->ParallelFor(taskCount, [this, &tracer](int task)
+	{
+		BakeRows(task, tracer);
+	});
+	DilateTexels();
+	SaveCache();
+
+	// the surface points are only needed for baking
+	std::vector<glm::vec3>().swap(m_texelPositions);
+	std::vector<glm::vec3>().swap(m_texelNormals);
+	std::vector<uint8_t>().swap(m_covered);
+	m_stats.bFromCache = false;
+}
+
+/***********************************************************
+ *  TakeGeometry()
+ *
+ *  This method is used for moving the unwrapped geometry
+ *  out, so it can be sent to OpenGL without a copy.
+ ***********************************************************/
+void LightmapBaker::TakeGeometry(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+{
+	vertices.swap(m_vertices);
+	indices.swap(m_indices);
+	m_vertices.clear();
+	m_indices.clear();
+}
+
+/***********************************************************
+ *  BuildCharts()
+ *
+ *  This method is used for growing the charts.  Each chart
+ *  starts at the first triangle that has none and takes in
+ *  the triangles sharing an edge with it, as long as they
+ *  face within the limit of that first triangle.  The edges
+ *  are found by the positions of their corners, since the
+ *  shapes split their vertices where the normals or UVs
+ *  change.
+ ***********************************************************/
+void LightmapBaker::BuildCharts(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices)
+{
+	size_t triangleCount = indices.size() / 3;
+	m_triangleCharts.assign(triangleCount, -1);
+
+	// one ID for all of the vertices at the same position
+	std::vector<uint32_t> positionIDs(vertices.size() / g_FloatsPerVertex);
+	std::map<POSITION_KEY, uint32_t> positions;
+	for (size_t v = 0; v < positionIDs.size(); v++)
+	{
+		POSITION_KEY key;
+		for (int i = 0; i < 3; i++)
+		{
+			key.bits[i] = FloatBits(vertices[v * g_FloatsPerVertex + i]);
+		}
+		std::map<POSITION_KEY, uint32_t>::iterator found = positions.find(key);
+		if (found == positions.end())
+		{
+			found = positions.insert(std::make_pair(key, (uint32_t)positions.size())).first;
+		}
+		positionIDs[v] = found->second;
+	}
+
+	// the face normal of every triangle, turned to the side of
+	// its vertex normals in case a shape winds it the other way
+	std::vector<glm::vec3> faceNormals(triangleCount, glm::vec3(0.0f));
+	std::map<uint64_t, std::vector<uint32_t> > edges;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const GLuint* corners = &indices[t * 3];
+		glm::vec3 p0 = ReadVector(&vertices[corners[0] * g_FloatsPerVertex]);
+		glm::vec3 p1 = ReadVector(&vertices[corners[1] * g_FloatsPerVertex]);
+		glm::vec3 p2 = ReadVector(&vertices[corners[2] * g_FloatsPerVertex]);
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (!(length > 1.0e-12f))
+		{
+			continue;
+		}
+		normal /= length;
+
+		glm::vec3 vertexNormals(0.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			vertexNormals += ReadVector(&vertices[corners[i] * g_FloatsPerVertex + 3]);
+		}
+		if (glm::dot(normal, vertexNormals) < 0.0f)
+		{
+			normal = -normal;
+		}
+		faceNormals[t] = normal;
+
+		for (int i = 0; i < 3; i++)
+		{
+			uint32_t a = positionIDs[corners[i]];
+			uint32_t b = positionIDs[corners[(i + 1) % 3]];
+			uint64_t edge = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+			edges[edge].push_back((uint32_t)t);
+		}
+	}
+
+	std::vector<uint32_t> open;
+	for (size_t seed = 0; seed < triangleCount; seed++)
+	{
+		if ((m_triangleCharts[seed] >= 0) || (faceNormals[seed] == glm::vec3(0.0f)))
+		{
+			continue;
+		}
+
+		int32_t chartIndex = (int32_t)m_charts.size();
+		m_charts.push_back(CHART());
+		CHART& chart = m_charts.back();
+		glm::vec3 normal = faceNormals[seed];
+
+		// the projection axes line up with the world axes for
+		// the faces that do, which keeps their charts tight
+		glm::vec3 helper = (std::fabs(normal.y) < 0.99f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		chart.axisU = glm::normalize(glm::cross(helper, normal));
+		chart.axisV = glm::cross(normal, chart.axisU);
+		chart.boundsMin = glm::vec2(FLT_MAX);
+		chart.boundsMax = glm::vec2(-FLT_MAX);
+
+		m_triangleCharts[seed] = chartIndex;
+		open.push_back((uint32_t)seed);
+		while (open.empty() == false)
+		{
+			uint32_t t = open.back();
+			open.pop_back();
+			chart.triangles.push_back(t);
+
+			const GLuint* corners = &indices[t * 3];
+			for (int i = 0; i < 3; i++)
+			{
+				glm::vec3 position = ReadVector(&vertices[corners[i] * g_FloatsPerVertex]);
+				glm::vec2 projected(glm::dot(position, chart.axisU), glm::dot(position, chart.axisV));
+				chart.boundsMin = glm::min(chart.boundsMin, projected);
+				chart.boundsMax = glm::max(chart.boundsMax, projected);
+
+				uint32_t a = positionIDs[corners[i]];
+				uint32_t b = positionIDs[corners[(i + 1) % 3]];
+				const std::vector<uint32_t>& neighbours = edges[((uint64_t)std::min(a, b) << 32) | std::max(a, b)];
+				for (size_t n = 0; n < neighbours.size(); n++)
+				{
+					uint32_t neighbour = neighbours[n];
+					if ((m_triangleCharts[neighbour] < 0) &&
+						(glm::dot(faceNormals[neighbour], normal) >= g_ChartNormalLimit))
+					{
+						m_triangleCharts[neighbour] = chartIndex;
+						open.push_back(neighbour);
+					}
+				}
+			}
+		}
+
+		// the triangles are kept in their original order
+		std::sort(chart.triangles.begin(), chart.triangles.end());
+	}
+}
+
+/***********************************************************
+ *  PackCharts()
+ *
+ *  This method is used for placing the charts on shelves,
+ *  tallest first, in an atlas of the passed in width.  The
+ *  atlas is only as tall as the shelves need, and packing
+ *  fails when that is taller than it is wide.
+ ***********************************************************/
+bool LightmapBaker::PackCharts(int atlasWidth, float texelsPerUnit)
+{
+	std::vector<uint32_t> order(m_charts.size());
+	for (size_t i = 0; i < m_charts.size(); i++)
+	{
+		CHART& chart = m_charts[i];
+		glm::vec2 size = (chart.boundsMax - chart.boundsMin) * texelsPerUnit;
+		chart.width = (int)std::ceil(size.x) + 1 + 2 * g_ChartPadding;
+		chart.height = (int)std::ceil(size.y) + 1 + 2 * g_ChartPadding;
+		order[i] = (uint32_t)i;
+	}
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+	{
+		return(m_charts[a].height > m_charts[b].height);
+	});
+
+	int x = 0;
+	int y = 0;
+	int shelfHeight = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		CHART& chart = m_charts[order[i]];
+		if (x + chart.width > atlasWidth)
+		{
+			y += shelfHeight;
+			x = 0;
+			shelfHeight = 0;
+		}
+		if ((chart.width > atlasWidth) || (y + chart.height > atlasWidth))
+		{
+			return(false);
+		}
+
+		chart.x = x;
+		chart.y = y;
+		x += chart.width;
+		shelfHeight = std::max(shelfHeight, chart.height);
+	}
+
+	m_width = atlasWidth;
+	m_height = y + shelfHeight;
+	return(true);
+}
+
+/***********************************************************
+ *  BuildGeometry()
+ *
+ *  This method is used for adding the atlas coordinates to
+ *  the vertices.  A vertex used by triangles of several
+ *  charts is copied once for every chart, and the triangles
+ *  without area get coordinates of zero, since they never
+ *  cover a pixel.
+ ***********************************************************/
+void LightmapBaker::BuildGeometry(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices)
+{
+	m_vertices.reserve(vertices.size() / g_FloatsPerVertex * FLOATS_PER_VERTEX);
+	m_indices.resize(indices.size());
+
+	// the copy of every vertex for every chart it is used by
+	std::map<uint64_t, GLuint> copies;
+	glm::vec2 atlasSize((float)m_width, (float)m_height);
+	for (size_t t = 0; t < m_triangleCharts.size(); t++)
+	{
+		int32_t chartIndex = m_triangleCharts[t];
+		for (int i = 0; i < 3; i++)
+		{
+			GLuint vertex = indices[t * 3 + i];
+			uint64_t copyKey = ((uint64_t)vertex << 32) | (uint32_t)(chartIndex + 1);
+			std::map<uint64_t, GLuint>::const_iterator found = copies.find(copyKey);
+			if (found != copies.end())
+			{
+				m_indices[t * 3 + i] = found->second;
+				continue;
+			}
+
+			const GLfloat* source = &vertices[vertex * g_FloatsPerVertex];
+			glm::vec2 atlasCoordinate(0.0f);
+			if (chartIndex >= 0)
+			{
+				const CHART& chart = m_charts[chartIndex];
+				glm::vec3 position = ReadVector(source);
+				glm::vec2 projected(glm::dot(position, chart.axisU), glm::dot(position, chart.axisV));
+				glm::vec2 texel = glm::vec2((float)(chart.x + g_ChartPadding), (float)(chart.y + g_ChartPadding)) + 0.5f +
+					(projected - chart.boundsMin) * m_texelsPerUnit;
+				atlasCoordinate = texel / atlasSize;
+			}
+
+			GLuint copy = (GLuint)(m_vertices.size() / FLOATS_PER_VERTEX);
+			m_vertices.insert(m_vertices.end(), source, source + g_FloatsPerVertex);
+			m_vertices.push_back(atlasCoordinate.x);
+			m_vertices.push_back(atlasCoordinate.y);
+			copies[copyKey] = copy;
+			m_indices[t * 3 + i] = copy;
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterizeCharts()
+ *
+ *  This method is used for finding the position and normal
+ *  of the surface under every texel center covered by a
+ *  triangle.  A triangle too small to cover any center
+ *  still gets the texel under its center, so it is not left
+ *  black.
+ ***********************************************************/
+void LightmapBaker::RasterizeCharts()
+{
+	size_t texelCount = (size_t)m_width * m_height;
+	m_texelPositions.assign(texelCount, glm::vec3(0.0f));
+	m_texelNormals.assign(texelCount, glm::vec3(0.0f));
+	m_covered.assign(texelCount, 0);
+
+	glm::vec2 atlasSize((float)m_width, (float)m_height);
+	for (size_t t = 0; t < m_triangleCharts.size(); t++)
+	{
+		if (m_triangleCharts[t] < 0)
+		{
+			continue;
+		}
+
+		glm::vec3 positions[3];
+		glm::vec3 normals[3];
+		glm::vec2 texels[3];
+		for (int i = 0; i < 3; i++)
+		{
+			const GLfloat* vertex = &m_vertices[m_indices[t * 3 + i] * FLOATS_PER_VERTEX];
+			positions[i] = ReadVector(vertex);
+			normals[i] = ReadVector(vertex + 3);
+			texels[i] = glm::vec2(vertex[8], vertex[9]) * atlasSize;
+		}
+
+		float area = EdgeFunction(texels[0], texels[1], texels[2]);
+		if (area == 0.0f)
+		{
+			continue;
+		}
+
+		glm::ivec2 minTexel = glm::ivec2(glm::floor(glm::min(texels[0], glm::min(texels[1], texels[2]))));
+		glm::ivec2 maxTexel = glm::ivec2(glm::ceil(glm::max(texels[0], glm::max(texels[1], texels[2]))));
+		minTexel = glm::max(minTexel, glm::ivec2(0));
+		maxTexel = glm::min(maxTexel, glm::ivec2(m_width - 1, m_height - 1));
+
+		bool bCoveredAny = false;
+		for (int y = minTexel.y; y <= maxTexel.y; y++)
+		{
+			for (int x = minTexel.x; x <= maxTexel.x; x++)
+			{
+				glm::vec2 center((float)x + 0.5f, (float)y + 0.5f);
+				float w0 = EdgeFunction(texels[1], texels[2], center) / area;
+				float w1 = EdgeFunction(texels[2], texels[0], center) / area;
+				float w2 = 1.0f - w0 - w1;
+				if ((w0 < 0.0f) || (w1 < 0.0f) || (w2 < 0.0f))
+				{
+					continue;
+				}
+
+				size_t texel = (size_t)y * m_width + x;
+				m_texelPositions[texel] = positions[0] * w0 + positions[1] * w1 + positions[2] * w2;
+				m_texelNormals[texel] = normals[0] * w0 + normals[1] * w1 + normals[2] * w2;
+				m_covered[texel] = 1;
+				bCoveredAny = true;
+			}
+		}
+
+		if (bCoveredAny == false)
+		{
+			glm::vec2 center = (texels[0] + texels[1] + texels[2]) / 3.0f;
+			glm::ivec2 texelXY = glm::clamp(glm::ivec2(center), glm::ivec2(0), glm::ivec2(m_width - 1, m_height - 1));
+			size_t texel = (size_t)texelXY.y * m_width + texelXY.x;
+			if (m_covered[texel] == 0)
+			{
+				m_texelPositions[texel] = (positions[0] + positions[1] + positions[2]) / 3.0f;
+				m_texelNormals[texel] = normals[0] + normals[1] + normals[2];
+				m_covered[texel] = 1;
+			}
+		}
+	}
+
+	for (size_t texel = 0; texel < texelCount; texel++)
+	{
+		float length = glm::length(m_texelNormals[texel]);
+		if (length > 0.0f)
+		{
+			m_texelNormals[texel] /= length;
+		}
+		else
+		{
+			m_covered[texel] = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  BakeRows()
+ *
+ *  This method is used for gathering the light of the
+ *  covered texels of one task's rows.  The random numbers
+ *  of a texel are seeded by its index, so the lightmap does
+ *  not depend on the thread count.
+ ***********************************************************/
+void LightmapBaker::BakeRows(int task, const PathTracer& tracer)
+{
+	int firstRow = task * g_RowsPerTask;
+	int lastRow = std::min(firstRow + g_RowsPerTask, m_height);
+	for (int y = firstRow; y < lastRow; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			size_t texel = (size_t)y * m_width + x;
+			if (m_covered[texel] == 0)
+			{
+				continue;
+			}
+
+			glm::vec3 irradiance = tracer.ComputeIrradiance(
+				m_texelPositions[texel],
+				m_texelNormals[texel],
+				g_SamplesPerTexel,
+				(uint32_t)texel);
+			m_texels[texel * 3] = irradiance.r;
+			m_texels[texel * 3 + 1] = irradiance.g;
+			m_texels[texel * 3 + 2] = irradiance.b;
+		}
+	}
+}
+
+/***********************************************************
+ *  DilateTexels()
+ *
+ *  This method is used for growing the charts into their
+ *  padding.  Every pass gives the empty texels next to a
+ *  filled one the average of their filled neighbours.
+ ***********************************************************/
+void LightmapBaker::DilateTexels()
+{
+	std::vector<uint8_t> filled = m_covered;
+	std::vector<uint8_t> nextFilled;
+	for (int pass = 0; pass <= g_ChartPadding; pass++)
+	{
+		nextFilled = filled;
+		for (int y = 0; y < m_height; y++)
+		{
+			for (int x = 0; x < m_width; x++)
+			{
+				size_t texel = (size_t)y * m_width + x;
+				if (filled[texel] != 0)
+				{
+					continue;
+				}
+
+				glm::vec3 sum(0.0f);
+				int count = 0;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int nx = x + dx;
+						int ny = y + dy;
+						if ((nx < 0) || (ny < 0) || (nx >= m_width) || (ny >= m_height))
+						{
+							continue;
+						}
+						size_t neighbour = (size_t)ny * m_width + nx;
+						if (filled[neighbour] != 0)
+						{
+							sum += glm::vec3(m_texels[neighbour * 3], m_texels[neighbour * 3 + 1], m_texels[neighbour * 3 + 2]);
+							count++;
+						}
+					}
+				}
+
+				if (count > 0)
+				{
+					sum /= (float)count;
+					m_texels[texel * 3] = sum.r;
+					m_texels[texel * 3 + 1] = sum.g;
+					m_texels[texel * 3 + 2] = sum.b;
+					nextFilled[texel] = 1;
+				}
+			}
+		}
+		filled.swap(nextFilled);
+	}
+}
+
+/***********************************************************
+ *  SaveCache()
+ *
+ *  This method is used for writing the baked texels under
+ *  the cache key, so the next run can load them.  The
+ *  cache only saves time, so a failed write is ignored.
+ ***********************************************************/
+void LightmapBaker::SaveCache() const
+{
+	std::string cachePath = GetCachePath(m_cacheKey);
+
+	LIGHTMAP_CACHE_HEADER header;
+	header.magic = g_LightmapCacheMagic;
+	header.width = (uint32_t)m_width;
+	header.height = (uint32_t)m_height;
+	header.reserved = 0;
+	header.key = m_cacheKey;
+
+	std::ofstream cacheStream(cachePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (cacheStream.is_open())
+	{
+		cacheStream.write((const char*)&header, sizeof(header));
+		cacheStream.write((const char*)m_texels.data(), sizeof(float) * m_texels.size());
+	}
+}
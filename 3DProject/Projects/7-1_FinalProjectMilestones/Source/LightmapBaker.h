@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.h
+// ============
+// lays out and bakes the lightmap of the static geometry
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "PathTracer.h"
+#include "ThreadPool.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  LightmapBaker
+ *
+ *  This class builds the lightmap of the merged static
+ *  geometry in two steps:
+ *
+ *  - the triangles are split into charts of connected
+ *    triangles facing about the same way, every chart is
+ *    projected flat along the normal of its first triangle,
+ *    and the charts are packed into one atlas.  The atlas
+ *    coordinates are added to the vertices as a second set
+ *    of UVs, with the vertices on the border of two charts
+ *    split in two.
+ *  - the light arriving at every texel of the charts is
+ *    gathered with the path tracer, rows of the atlas spread
+ *    over the thread pool, and the texels around the charts
+ *    are filled from their edges so filtering does not blend
+ *    in the empty space.
+ *
+ *  The baked texels are saved in a cache file named after a
+ *  hash of the scene and the geometry, so a scene is only
+ *  baked again when its static lighting changes.
+ ***********************************************************/
+class LightmapBaker
+{
+public:
+	struct LIGHTMAP_STATS
+	{
+		size_t chartCount;
+		int width;
+		int height;
+		float texelsPerUnit;	// texel density in world units
+		bool bFromCache;		// loaded instead of baked
+	};
+
+	// constructor
+	LightmapBaker(ThreadPool* pThreadPool);
+
+	// lay out the charts of merged geometry with the position,
+	// normal and UV of every vertex, and pack them into the
+	// atlas - returns false when there is nothing to lay out
+	bool Unwrap(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices);
+	// load the lightmap an earlier run baked for the passed in
+	// hash of the scene - returns false when it has to be baked
+	bool LoadCache(uint64_t sceneKey);
+	// gather the light of every texel with the passed in path
+	// tracer and save the lightmap in the cache
+	void Bake(const PathTracer& tracer);
+	// move the unwrapped geometry out once the lightmap is
+	// loaded or baked - every vertex has the atlas coordinates
+	// after its UV, and the indices keep the triangle order
+	void TakeGeometry(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices);
+
+	// RGB texels of the baked lightmap, bottom row first, in
+	// the units of the diffuse term of the shaders
+	const std::vector<float>& GetTexels() const { return m_texels; }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	const LIGHTMAP_STATS& GetStats() const { return m_stats; }
+
+	enum
+	{
+		FLOATS_PER_VERTEX = 10	// floats of every unwrapped vertex
+	};
+
+private:
+	// triangles laid out together in the atlas
+	struct CHART
+	{
+		glm::vec3 axisU;		// projection of the chart
+		glm::vec3 axisV;
+		glm::vec2 boundsMin;	// projected bounds, world units
+		glm::vec2 boundsMax;
+		std::vector<uint32_t> triangles;
+		int x;					// place in the atlas, texels
+		int y;
+		int width;
+		int height;
+	};
+
+	// group the triangles into charts
+	void BuildCharts(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices);
+	// place the charts into an atlas of the passed in width
+	bool PackCharts(int atlasWidth, float texelsPerUnit);
+	// write the atlas coordinates into the split vertices
+	void BuildGeometry(const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices);
+	// find the surface point under every texel center
+	void RasterizeCharts();
+	// gather the light of a few rows of texels
+	void BakeRows(int task, const PathTracer& tracer);
+	// fill the texels around the charts from their edges
+	void DilateTexels();
+	// write the texels into the cache
+	void SaveCache() const;
+
+	ThreadPool* m_pThreadPool;
+	std::vector<CHART> m_charts;
+	// chart of every triangle, -1 for triangles without area
+	std::vector<int32_t> m_triangleCharts;
+
+	// the unwrapped geometry
+	std::vector<GLfloat> m_vertices;
+	std::vector<GLuint> m_indices;
+
+	// the atlas
+	int m_width;
+	int m_height;
+	float m_texelsPerUnit;
+	uint64_t m_cacheKey;
+	std::vector<glm::vec3> m_texelPositions;
+	std::vector<glm::vec3> m_texelNormals;
+	std::vector<uint8_t> m_covered;
+	std::vector<float> m_texels;
+	LIGHTMAP_STATS m_stats;
+};
@@ -1,5 +1,10 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <cstdio>           // FILE
+#include <chrono>
+#include <thread>
+#include <vector>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +18,14 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "ShaderRegistry.h"
+#include "SceneLoader.h"
+#include "SceneSnapshot.h"
+#include "OffscreenTarget.h"
+#include "ImageWriter.h"
+#include "BatchJob.h"
+#include "FrameEncoder.h"
+#include "FrameCapture.h"
 
 // Namespace for declaring global variables
 namespace
@@ -25,6 +38,8 @@ namespace
 
 	// scene manager object for managing the 3D scene prepare and render
 	SceneManager* g_SceneManager = nullptr;
+	// named shader programs of the scene and the render passes
+	ShaderRegistry* g_ShaderRegistry = nullptr;
 	// shader manager object for dynamic interaction with the shader code
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
@@ -35,6 +50,10 @@ namespace
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+bool RenderHeadless(int frameCount, const char* outputPattern, FILE* pFrameOutput, int referenceSamples);
+bool RenderBatch(const char* jobFilename, int referenceSamples);
+void WaitForShaderVariants();
+void PrintFrameStats();
 
 
 /***********************************************************
@@ -45,20 +64,165 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
-	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	// scene file to render, NULL for the default scene
+	const char* sceneFilename = NULL;
+	// binary scene or snapshot file to write instead of
+	// opening a window
+	const char* exportFilename = NULL;
+	// shade the opaque objects with the deferred path
+	bool bDeferredShading = false;
+	// draw the scene with the CPU rasterizer
+	bool bSoftwareRendering = false;
+	// reload the shaders and textures when they change
+	bool bHotReload = false;
+	// render frames into an offscreen target and write them
+	// out instead of showing a window
+	bool bHeadless = false;
+	// number of frames rendered in the headless mode
+	int frameCount = 1;
+	// files of the headless frames, with '#' replaced by the
+	// frame number, or "-" for the standard output
+	const char* outputPattern = "frame_####.ppm";
+	// batch job file listing the camera views to render, which
+	// turns on the headless mode
+	const char* jobFilename = NULL;
+	// files the frames of the window are captured to, with '#'
+	// replaced by the frame number, NULL for no capture
+	const char* capturePattern = NULL;
+	// samples per pixel of the path traced reference frames,
+	// 0 to rasterize the headless frames
+	int referenceSamples = 0;
+
+	for (int i = 1; i < argc; i++)
 	{
-		return(EXIT_FAILURE);
+		if ((strcmp(argv[i], "--scene") == 0) && (i + 1 < argc))
+		{
+			sceneFilename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--export-scene") == 0) && (i + 1 < argc))
+		{
+			exportFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--deferred") == 0)
+		{
+			bDeferredShading = true;
+		}
+		else if (strcmp(argv[i], "--software") == 0)
+		{
+			bSoftwareRendering = true;
+		}
+		else if (strcmp(argv[i], "--hot-reload") == 0)
+		{
+			bHotReload = true;
+		}
+		else if (strcmp(argv[i], "--headless") == 0)
+		{
+			bHeadless = true;
+		}
+		else if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc))
+		{
+			frameCount = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+		{
+			outputPattern = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--batch") == 0) && (i + 1 < argc))
+		{
+			jobFilename = argv[++i];
+			bHeadless = true;
+		}
+		else if ((strcmp(argv[i], "--capture") == 0) && (i + 1 < argc))
+		{
+			capturePattern = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--reference") == 0) && (i + 1 < argc))
+		{
+			referenceSamples = atoi(argv[++i]);
+			bHeadless = true;
+		}
+		else
+		{
+			std::cout << "Unknown argument:" << argv[i] << std::endl;
+		}
+	}
+
+	// convert the scene to the binary or snapshot format,
+	// chosen by the export file extension, without rendering
+	if (NULL != exportFilename)
+	{
+		SceneLoader loader;
+		SceneData scene;
+		bool bExported = false;
+
+		if ((NULL != sceneFilename) && (loader.LoadScene(sceneFilename, scene) == true))
+		{
+			if (SceneSnapshot::IsSnapshotFile(exportFilename))
+				bExported = SceneSnapshot::SaveSnapshot(exportFilename, scene);
+			else
+				bExported = loader.SaveBinaryScene(exportFilename, scene);
+		}
+
+		if (bExported == false)
+		{
+			std::cout << "Could not export scene, use --scene <file> --export-scene <file>" << std::endl;
+			return(EXIT_FAILURE);
+		}
+		return(EXIT_SUCCESS);
 	}
 
-	// try to create a new shader manager object
-	g_ShaderManager = new ShaderManager();
+	// frames piped to another program take the standard
+	// output before anything is printed to it
+	FILE* pFrameOutput = NULL;
+	if ((bHeadless == true) && (NULL == jobFilename) && (strcmp(outputPattern, "-") == 0))
+	{
+		pFrameOutput = ImageWriter::OpenStandardOutput();
+		if (NULL == pFrameOutput)
+		{
+			std::cerr << "Could not open the standard output for the frames" << std::endl;
+			return(EXIT_FAILURE);
+		}
+	}
+
+	// try to create a new shader manager object, which is
+	// loaded once the GL context exists
+	g_ShaderRegistry = new ShaderRegistry();
+	g_ShaderManager = g_ShaderRegistry->Acquire("scene");
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
-	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	// the headless mode makes its context through EGL, which
+	// needs no display, and only falls back to a hidden GLFW
+	// window when that fails
+	bool bHeadlessContext = false;
+	if (bHeadless == true)
+	{
+		bHeadlessContext = g_ViewManager->CreateHeadlessContext();
+	}
+	if (bHeadlessContext == false)
+	{
+		// if GLFW fails initialization, then terminate the application
+		if (InitializeGLFW() == false)
+		{
+			return(EXIT_FAILURE);
+		}
+
+		// try to create the main display window, or the hidden
+		// one holding the context of the headless mode
+		if (bHeadless == true)
+		{
+			g_Window = g_ViewManager->CreateOffscreenWindow(WINDOW_TITLE);
+			if (NULL == g_Window)
+			{
+				return(EXIT_FAILURE);
+			}
+		}
+		else
+		{
+			g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+		}
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -73,13 +237,59 @@ int main(int argc, char* argv[])
 	g_ShaderManager->use();
 
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	g_SceneManager = new SceneManager(g_ShaderManager, g_ShaderRegistry);
+	if ((bDeferredShading == true) && (g_SceneManager->EnableDeferredShading() == false))
+	{
+		std::cout << "Could not load the deferred lighting shader, using forward shading" << std::endl;
+	}
+	if (bSoftwareRendering == true)
+	{
+		g_SceneManager->EnableSoftwareRendering();
+	}
+	if (referenceSamples > 0)
+	{
+		g_SceneManager->EnablePathTracing();
+	}
+	g_SceneManager->PrepareScene(sceneFilename);
+	if (bHotReload == true)
+	{
+		g_SceneManager->EnableHotReload();
+	}
+
+	// the headless mode renders its frames and exits
+	bool bRendered = true;
+	if (NULL != jobFilename)
+	{
+		bRendered = RenderBatch(jobFilename, referenceSamples);
+	}
+	else if (bHeadless == true)
+	{
+		bRendered = RenderHeadless(frameCount, outputPattern, pFrameOutput, referenceSamples);
+		if (NULL != pFrameOutput)
+		{
+			fclose(pFrameOutput);
+		}
+	}
+
+	// the captured frames of the window are dropped when the
+	// encoder falls behind, so capturing never slows the loop
+	FrameEncoder* pCaptureEncoder = NULL;
+	FrameCapture* pFrameCapture = NULL;
+	int captureFrame = 0;
+	if ((bHeadless == false) && (NULL != capturePattern))
+	{
+		pCaptureEncoder = new FrameEncoder();
+		pFrameCapture = new FrameCapture(pCaptureEncoder, true);
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	while ((bHeadless == false) && !glfwWindowShouldClose(g_Window))
 	{
+		// swap in the shaders and textures changed on disk
+		// before anything of the frame is drawn
+		g_SceneManager->ReloadChangedAssets();
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -89,10 +299,21 @@ int main(int argc, char* argv[])
 
 		// convert from 3D object space to 2D view
 		g_ViewManager->PrepareSceneView();
+		g_SceneManager->SetViewTransform(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix());
 
 		// refresh the 3D scene
 		g_SceneManager->RenderScene();
 
+		// copy the finished frame before it is swapped away
+		if (NULL != pFrameCapture)
+		{
+			int width = 0;
+			int height = 0;
+			glfwGetFramebufferSize(g_Window, &width, &height);
+			pFrameCapture->Capture(ImageWriter::GetFramePath(capturePattern, captureFrame++), width, height);
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
@@ -101,6 +322,19 @@ int main(int argc, char* argv[])
 		glfwPollEvents();
 	}
 
+	if (NULL != pFrameCapture)
+	{
+		pFrameCapture->Finish();
+		std::cout << "Captured " << captureFrame << " frames, dropped " << pFrameCapture->GetDroppedCount() << std::endl;
+		delete pFrameCapture;
+		pFrameCapture = NULL;
+	}
+	if (NULL != pCaptureEncoder)
+	{
+		delete pCaptureEncoder;
+		pCaptureEncoder = NULL;
+	}
+
 	// clear the allocated manager objects from memory
 	if (NULL != g_SceneManager)
 	{
@@ -114,12 +348,17 @@ int main(int argc, char* argv[])
 	}
 	if (NULL != g_ShaderManager)
 	{
-		delete g_ShaderManager;
+		g_ShaderRegistry->Release(g_ShaderManager);
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_ShaderRegistry)
+	{
+		delete g_ShaderRegistry;
+		g_ShaderRegistry = NULL;
+	}
 
 	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	exit((bRendered == true) ? EXIT_SUCCESS : EXIT_FAILURE); 
 }
 
 /***********************************************************
@@ -131,7 +370,12 @@ bool InitializeGLFW()
 {
 	// GLFW: initialize and configure library
 	// --------------------------------------
-	glfwInit();
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cerr << "Could not initialize GLFW, a display is needed for the window.  "
+			<< "The --headless and --batch modes need an EGL library to run without one." << std::endl;
+		return(false);
+	}
 
 #ifdef __APPLE__
 	// set the version of OpenGL and profile to use
@@ -149,6 +393,203 @@ bool InitializeGLFW()
 	return(true);
 }
 
+/***********************************************************
+ *	RenderHeadless()
+ *
+ *  This function is used to render frames into an offscreen
+ *  target the size of the window and write them to image
+ *  files, or down the passed in pipe when it is not NULL.
+ *  Frames for files are read back through the frame capture
+ *  ring and written by the encoder threads.  The frames are
+ *  path traced with the passed in samples per pixel instead
+ *  when it is not 0.  The time taken is printed at the end
+ *  for performance runs.
+ ***********************************************************/
+bool RenderHeadless(int frameCount, const char* outputPattern, FILE* pFrameOutput, int referenceSamples)
+{
+	int width = 0;
+	int height = 0;
+	g_ViewManager->GetFramebufferSize(width, height);
+
+	OffscreenTarget target;
+	if (target.Create(width, height) == false)
+	{
+		return(false);
+	}
+
+	WaitForShaderVariants();
+
+	FrameEncoder encoder;
+	FrameCapture capture(&encoder, false);
+	std::vector<unsigned char> pixels;
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		target.Bind();
+		glEnable(GL_DEPTH_TEST);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		g_ViewManager->PrepareSceneView();
+		g_SceneManager->SetViewTransform(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix());
+		if (referenceSamples > 0)
+		{
+			g_SceneManager->RenderReference(width, height, referenceSamples, pixels);
+		}
+		else
+		{
+			g_SceneManager->RenderScene();
+		}
+
+		if (NULL != pFrameOutput)
+		{
+			// frames sent down the pipe must stay in order, so
+			// they are read back and written one at a time
+			if (referenceSamples == 0)
+			{
+				target.ReadPixels(pixels);
+			}
+			if (ImageWriter::WritePPM(pFrameOutput, pixels.data(), width, height) == false)
+			{
+				std::cout << "Could not write frame " << frame << std::endl;
+				return(false);
+			}
+		}
+		else if (referenceSamples > 0)
+		{
+			encoder.Submit(ImageWriter::GetFramePath(outputPattern, frame), pixels, width, height);
+		}
+		else
+		{
+			capture.Capture(ImageWriter::GetFramePath(outputPattern, frame), width, height);
+		}
+	}
+	capture.Finish();
+	bool bWritten = encoder.Finish();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (frameCount > 0)
+	{
+		std::cout << "Rendered " << frameCount << " frames at " << width << "x" << height
+			<< " in " << seconds << " seconds, " << (seconds * 1000.0 / frameCount) << " ms per frame" << std::endl;
+		if (referenceSamples == 0)
+		{
+			PrintFrameStats();
+		}
+	}
+	return(bWritten);
+}
+
+/***********************************************************
+ *	RenderBatch()
+ *
+ *  This function is used to render every view of a batch
+ *  job from the scene that is already loaded, so the
+ *  textures, meshes and shaders are set up once for all of
+ *  the views.  The views are read back through the frame
+ *  capture ring and written by the encoder threads while
+ *  the next views are drawn, or path traced with the passed
+ *  in samples per pixel when it is not 0.
+ ***********************************************************/
+bool RenderBatch(const char* jobFilename, int referenceSamples)
+{
+	BatchJob job;
+	if (job.Load(jobFilename) == false)
+	{
+		return(false);
+	}
+
+	OffscreenTarget target;
+	if (target.Create(job.GetWidth(), job.GetHeight()) == false)
+	{
+		return(false);
+	}
+
+	WaitForShaderVariants();
+
+	FrameEncoder encoder;
+	FrameCapture capture(&encoder, false);
+	std::vector<unsigned char> pixels;
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < job.GetViewCount(); i++)
+	{
+		target.Bind();
+		glEnable(GL_DEPTH_TEST);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		g_SceneManager->SetViewTransform(
+			job.GetViewMatrix(i),
+			job.GetProjectionMatrix(i));
+		if (referenceSamples > 0)
+		{
+			g_SceneManager->RenderReference(job.GetWidth(), job.GetHeight(), referenceSamples, pixels);
+			encoder.Submit(job.GetFramePath(i), pixels, job.GetWidth(), job.GetHeight());
+			continue;
+		}
+		g_SceneManager->RenderScene();
+
+		capture.Capture(job.GetFramePath(i), job.GetWidth(), job.GetHeight());
+	}
+	capture.Finish();
+	bool bWritten = encoder.Finish();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (job.GetViewCount() > 0)
+	{
+		std::cout << "Rendered " << job.GetViewCount() << " views at " << job.GetWidth() << "x" << job.GetHeight()
+			<< " in " << seconds << " seconds, " << (seconds * 1000.0 / job.GetViewCount()) << " ms per view" << std::endl;
+		if (referenceSamples == 0)
+		{
+			PrintFrameStats();
+		}
+	}
+	return(bWritten);
+}
+
+/***********************************************************
+ *	WaitForShaderVariants()
+ *
+ *  This function is used to wait for the shader variants
+ *  that are still compiling, so every frame written out is
+ *  drawn with its final programs.
+ ***********************************************************/
+void WaitForShaderVariants()
+{
+	while (g_ShaderManager->PollVariants() > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+/***********************************************************
+ *	PrintFrameStats()
+ *
+ *  This function is used to print the draw, state change
+ *  and frame arena counters of the last frame, so a steady
+ *  scene can be checked for redundant state changes and for
+ *  heap allocations made by the arena.
+ ***********************************************************/
+void PrintFrameStats()
+{
+	const RenderQueue::RENDER_STATS& renderStats = g_SceneManager->GetRenderStats();
+	std::cout << "Last frame: draws:" << renderStats.drawCount
+		<< ", program changes:" << renderStats.programChanges
+		<< ", material changes:" << renderStats.materialChanges
+		<< ", texture changes:" << renderStats.textureChanges
+		<< ", mesh changes:" << renderStats.meshChanges << std::endl;
+
+	FrameArena::ARENA_STATS arenaStats = g_SceneManager->GetFrameArenaStats();
+	std::cout << "Frame arena: allocations:" << arenaStats.allocationCount
+		<< ", bytes used:" << arenaStats.bytesUsed
+		<< ", capacity:" << arenaStats.capacity
+		<< ", heap allocations:" << arenaStats.heapAllocationCount << std::endl;
+}
+
 /***********************************************************
  *	InitializeGLEW()
  *
@@ -160,8 +601,14 @@ bool InitializeGLEW()
 	// -----------------------------------------
 	GLenum GLEWInitResult = GLEW_OK;
 
-	// try to initialize the GLEW library
+	// try to initialize the GLEW library, the headless context
+	// has no GLX display but the GL functions are loaded before
+	// GLEW looks for one
 	GLEWInitResult = glewInit();
+	if ((NULL == g_Window) && (GLEW_ERROR_NO_GLX_DISPLAY == GLEWInitResult))
+	{
+		GLEWInitResult = GLEW_OK;
+	}
 	if (GLEW_OK != GLEWInitResult)
 	{
 		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
@@ -0,0 +1,661 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.cpp
+// ============
+// CPU software occlusion culling against a low resolution depth buffer
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+// SSE2 is available on every x64 target and on x86 builds
+// that use the default /arch:SSE2 code generation
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define OCCLUSION_USE_SSE2 1
+#endif
+
+// declaration of global variables
+namespace
+{
+	const int TILE_WIDTH = 32;
+	const int TILE_HEIGHT = 4;
+
+	// corner i of the unit box uses bit 0, 1 and 2 for X, Y and Z
+	const float g_BoxCorner = 0.5f;
+	// the box faces as counter clockwise quads seen from outside
+	const int g_BoxFaces[6][4] = {
+		{ 0, 2, 3, 1 },		// -Z
+		{ 4, 5, 7, 6 },		// +Z
+		{ 0, 4, 6, 2 },		// -X
+		{ 1, 3, 7, 5 },		// +X
+		{ 0, 1, 5, 4 },		// -Y
+		{ 2, 6, 7, 3 }		// +Y
+	};
+	// the plane corners as used by ShapeMeshes::LoadPlaneMesh()
+	const glm::vec3 g_PlaneCorners[4] = {
+		glm::vec3(-1.0f, 0.0f, 1.0f),
+		glm::vec3(1.0f, 0.0f, 1.0f),
+		glm::vec3(1.0f, 0.0f, -1.0f),
+		glm::vec3(-1.0f, 0.0f, -1.0f)
+	};
+
+	glm::vec3 BoxCorner(int index)
+	{
+		return glm::vec3(
+			(index & 1) ? g_BoxCorner : -g_BoxCorner,
+			(index & 2) ? g_BoxCorner : -g_BoxCorner,
+			(index & 4) ? g_BoxCorner : -g_BoxCorner);
+	}
+
+	// mask of the bits from first to last, inclusive
+	uint32_t BitRange(int first, int last)
+	{
+		uint64_t upper = (((uint64_t)1) << (last + 1)) - 1;
+		uint64_t lower = (((uint64_t)1) << first) - 1;
+		return (uint32_t)(upper & ~lower);
+	}
+}
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller(ThreadPool* pThreadPool, int width, int height)
+{
+	m_pThreadPool = pThreadPool;
+
+	// the buffer is always made of whole tiles
+	m_tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	m_tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	m_width = m_tilesX * TILE_WIDTH;
+	m_height = m_tilesY * TILE_HEIGHT;
+
+	m_maxOccluders = 16;
+	m_bEnabled = true;
+	m_tiles.resize(m_tilesX * m_tilesY);
+	m_stats = CULLING_STATS();
+	m_testedCount = 0;
+	m_culledCount = 0;
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the culling counters of
+ *  the current frame.
+ ***********************************************************/
+OcclusionCuller::CULLING_STATS OcclusionCuller::GetStats() const
+{
+	CULLING_STATS stats = m_stats;
+	stats.testedCount = m_testedCount;
+	stats.culledCount = m_culledCount;
+	return(stats);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for clearing the depth buffer and the
+ *  occluder candidates before a new frame is culled.
+ ***********************************************************/
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	m_occluders.clear();
+	m_triangles.clear();
+	m_stats = CULLING_STATS();
+	m_testedCount = 0;
+	m_culledCount = 0;
+
+	for (size_t i = 0; i < m_tiles.size(); i++)
+	{
+		m_tiles[i].mask[0] = 0;
+		m_tiles[i].mask[1] = 0;
+		m_tiles[i].mask[2] = 0;
+		m_tiles[i].mask[3] = 0;
+		m_tiles[i].zMax0 = 1.0f;
+		m_tiles[i].zMax1 = 0.0f;
+	}
+}
+
+/***********************************************************
+ *  ClipToScreen()
+ *
+ *  This method is used for converting a clip space position
+ *  into depth buffer pixels, with the depth mapped to [0,1].
+ ***********************************************************/
+glm::vec3 OcclusionCuller::ClipToScreen(const glm::vec4& clip) const
+{
+	float inverseW = 1.0f / clip.w;
+
+	return glm::vec3(
+		(clip.x * inverseW * 0.5f + 0.5f) * m_width,
+		(clip.y * inverseW * 0.5f + 0.5f) * m_height,
+		clip.z * inverseW * 0.5f + 0.5f);
+}
+
+/***********************************************************
+ *  AddOccluder()
+ *
+ *  This method is used for adding an occluder candidate.
+ *  The screen size of the occluder is estimated here so the
+ *  largest candidates can be chosen for rasterization.
+ ***********************************************************/
+void OcclusionCuller::AddOccluder(const glm::mat4& model, OCCLUDER_SHAPE shape)
+{
+	if (m_bEnabled == false)
+	{
+		return;
+	}
+
+	OCCLUDER occluder;
+	occluder.modelViewProjection = m_viewProjection * model;
+	occluder.shape = shape;
+	occluder.screenArea = 0.0f;
+
+	int cornerCount = (shape == OCCLUDER_BOX) ? 8 : 4;
+	glm::vec2 screenMin(1.0e30f);
+	glm::vec2 screenMax(-1.0e30f);
+	bool bCrossesNearPlane = false;
+
+	for (int i = 0; i < cornerCount; i++)
+	{
+		glm::vec3 corner = (shape == OCCLUDER_BOX) ? BoxCorner(i) : g_PlaneCorners[i];
+		glm::vec4 clip = occluder.modelViewProjection * glm::vec4(corner, 1.0f);
+
+		if (clip.z < -clip.w)
+		{
+			bCrossesNearPlane = true;
+			break;
+		}
+
+		glm::vec3 screen = ClipToScreen(clip);
+		screenMin = glm::min(screenMin, glm::vec2(screen));
+		screenMax = glm::max(screenMax, glm::vec2(screen));
+	}
+
+	if (bCrossesNearPlane == true)
+	{
+		// anything reaching past the camera covers most of the view
+		occluder.screenArea = (float)(m_width * m_height);
+	}
+	else
+	{
+		screenMin = glm::max(screenMin, glm::vec2(0.0f));
+		screenMax = glm::min(screenMax, glm::vec2((float)m_width, (float)m_height));
+		glm::vec2 size = glm::max(screenMax - screenMin, glm::vec2(0.0f));
+		occluder.screenArea = size.x * size.y;
+	}
+
+	if (occluder.screenArea > 0.0f)
+	{
+		m_occluders.push_back(occluder);
+	}
+}
+
+/***********************************************************
+ *  RasterizeOccluders()
+ *
+ *  This method is used for rasterizing the largest occluder
+ *  candidates into the depth buffer.  The triangles are set
+ *  up once and then every band of tile rows is rasterized
+ *  on its own thread.
+ ***********************************************************/
+void OcclusionCuller::RasterizeOccluders()
+{
+	if ((m_bEnabled == false) || (m_occluders.size() == 0))
+	{
+		return;
+	}
+
+	// keep only the occluders that cover the most of the screen
+	std::sort(m_occluders.begin(), m_occluders.end(),
+		[](const OCCLUDER& a, const OCCLUDER& b) { return(a.screenArea > b.screenArea); });
+	if ((int)m_occluders.size() > m_maxOccluders)
+	{
+		m_occluders.resize(m_maxOccluders);
+	}
+	m_stats.occluderCount = (int)m_occluders.size();
+
+	for (size_t i = 0; i < m_occluders.size(); i++)
+	{
+		const OCCLUDER& occluder = m_occluders[i];
+
+		if (occluder.shape == OCCLUDER_BOX)
+		{
+			glm::vec4 clip[8];
+			for (int corner = 0; corner < 8; corner++)
+			{
+				clip[corner] = occluder.modelViewProjection * glm::vec4(BoxCorner(corner), 1.0f);
+			}
+			for (int face = 0; face < 6; face++)
+			{
+				const int* quad = g_BoxFaces[face];
+				SetupTriangle(clip[quad[0]], clip[quad[1]], clip[quad[2]]);
+				SetupTriangle(clip[quad[0]], clip[quad[2]], clip[quad[3]]);
+			}
+		}
+		else
+		{
+			glm::vec4 clip[4];
+			for (int corner = 0; corner < 4; corner++)
+			{
+				clip[corner] = occluder.modelViewProjection * glm::vec4(g_PlaneCorners[corner], 1.0f);
+			}
+			SetupTriangle(clip[0], clip[1], clip[2]);
+			SetupTriangle(clip[0], clip[2], clip[3]);
+		}
+	}
+	m_stats.triangleCount = (int)m_triangles.size();
+
+	if (m_triangles.size() == 0)
+	{
+		return;
+	}
+
+	// split the tile rows into a few bands per thread so that
+	// bands with more triangles still balance out
+	int threadCount = (m_pThreadPool != NULL) ? (int)m_pThreadPool->GetThreadCount() : 1;
+	int bandCount = std::min(m_tilesY, threadCount * 2);
+	int rowsPerBand = (m_tilesY + bandCount - 1) / bandCount;
+
+	auto rasterizeBand = [this, rowsPerBand](int band)
+	{
+		int firstRow = band * rowsPerBand;
+		RasterizeBand(firstRow, std::min(firstRow + rowsPerBand, m_tilesY));
+	};
+
+	if (m_pThreadPool != NULL)
+	{
+		m_pThreadPool->ParallelFor(bandCount, rasterizeBand);
+	}
+	else
+	{
+		for (int band = 0; band < bandCount; band++)
+		{
+			rasterizeBand(band);
+		}
+	}
+}
+
+/***********************************************************
+ *  SetupTriangle()
+ *
+ *  This method is used for clipping a clip space triangle
+ *  against the near plane and projecting the result to the
+ *  screen.  Occluders are rasterized from both sides so the
+ *  planes work no matter which side the camera is on.
+ ***********************************************************/
+void OcclusionCuller::SetupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2)
+{
+	const glm::vec4 input[3] = { v0, v1, v2 };
+	float distance[3];
+	int insideCount = 0;
+
+	// signed distance to the OpenGL near plane (z = -w)
+	for (int i = 0; i < 3; i++)
+	{
+		distance[i] = input[i].z + input[i].w;
+		if (distance[i] >= 0.0f)
+		{
+			insideCount++;
+		}
+	}
+
+	if (insideCount == 0)
+	{
+		return;
+	}
+	if (insideCount == 3)
+	{
+		AddScreenTriangle(ClipToScreen(v0), ClipToScreen(v1), ClipToScreen(v2));
+		return;
+	}
+
+	// clip the polygon against the near plane - one plane can
+	// turn a triangle into at most a quad
+	glm::vec4 clipped[4];
+	int clippedCount = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int next = (i + 1) % 3;
+		if (distance[i] >= 0.0f)
+		{
+			clipped[clippedCount++] = input[i];
+		}
+		if ((distance[i] >= 0.0f) != (distance[next] >= 0.0f))
+		{
+			float t = distance[i] / (distance[i] - distance[next]);
+			clipped[clippedCount++] = input[i] + (input[next] - input[i]) * t;
+		}
+	}
+
+	for (int i = 1; i + 1 < clippedCount; i++)
+	{
+		AddScreenTriangle(
+			ClipToScreen(clipped[0]),
+			ClipToScreen(clipped[i]),
+			ClipToScreen(clipped[i + 1]));
+	}
+}
+
+/***********************************************************
+ *  AddScreenTriangle()
+ *
+ *  This method is used for computing the edge functions,
+ *  the depth plane and the pixel bounds of a projected
+ *  triangle.
+ ***********************************************************/
+void OcclusionCuller::AddScreenTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+	glm::vec3 p[3] = { p0, p1, p2 };
+
+	float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+	if (std::fabs(area) < 1.0e-6f)
+	{
+		return;
+	}
+	// the edge functions expect counter clockwise triangles
+	if (area < 0.0f)
+	{
+		std::swap(p[1], p[2]);
+		area = -area;
+	}
+
+	SCREEN_TRIANGLE triangle;
+
+	triangle.minX = std::max(0, (int)std::floor(std::min(p[0].x, std::min(p[1].x, p[2].x))));
+	triangle.minY = std::max(0, (int)std::floor(std::min(p[0].y, std::min(p[1].y, p[2].y))));
+	triangle.maxX = std::min(m_width - 1, (int)std::ceil(std::max(p[0].x, std::max(p[1].x, p[2].x))));
+	triangle.maxY = std::min(m_height - 1, (int)std::ceil(std::max(p[0].y, std::max(p[1].y, p[2].y))));
+	if ((triangle.minX > triangle.maxX) || (triangle.minY > triangle.maxY))
+	{
+		return;
+	}
+
+	triangle.zMin = std::max(0.0f, std::min(p[0].z, std::min(p[1].z, p[2].z)));
+	triangle.zMax = std::min(1.0f, std::max(p[0].z, std::max(p[1].z, p[2].z)));
+	if (triangle.zMin > 1.0f)
+	{
+		return;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec3& a = p[i];
+		const glm::vec3& b = p[(i + 1) % 3];
+		triangle.edgeA[i] = a.y - b.y;
+		triangle.edgeB[i] = b.x - a.x;
+		triangle.edgeC[i] = -(triangle.edgeA[i] * a.x + triangle.edgeB[i] * a.y);
+	}
+
+	// depth is linear in screen space after the perspective divide
+	float dzdx = ((p[1].z - p[0].z) * (p[2].y - p[0].y) - (p[2].z - p[0].z) * (p[1].y - p[0].y)) / area;
+	float dzdy = ((p[2].z - p[0].z) * (p[1].x - p[0].x) - (p[1].z - p[0].z) * (p[2].x - p[0].x)) / area;
+	triangle.zPlane[0] = dzdx;
+	triangle.zPlane[1] = dzdy;
+	triangle.zPlane[2] = p[0].z - dzdx * p[0].x - dzdy * p[0].y;
+
+	m_triangles.push_back(triangle);
+}
+
+/***********************************************************
+ *  RasterizeBand()
+ *
+ *  This method is used for rasterizing every triangle into
+ *  the tiles of the passed in tile rows.  Bands never share
+ *  tiles, so they can run on different threads.
+ ***********************************************************/
+void OcclusionCuller::RasterizeBand(int firstTileRow, int lastTileRow)
+{
+	for (size_t i = 0; i < m_triangles.size(); i++)
+	{
+		const SCREEN_TRIANGLE& triangle = m_triangles[i];
+
+		int firstY = std::max(triangle.minY / TILE_HEIGHT, firstTileRow);
+		int lastY = std::min(triangle.maxY / TILE_HEIGHT, lastTileRow - 1);
+		int firstX = triangle.minX / TILE_WIDTH;
+		int lastX = triangle.maxX / TILE_WIDTH;
+
+		for (int tileY = firstY; tileY <= lastY; tileY++)
+		{
+			for (int tileX = firstX; tileX <= lastX; tileX++)
+			{
+				RasterizeTile(triangle, tileX, tileY);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterizeTile()
+ *
+ *  This method is used for computing the coverage of one
+ *  triangle in one tile and merging it into the masked
+ *  depth of the tile.
+ ***********************************************************/
+void OcclusionCuller::RasterizeTile(const SCREEN_TRIANGLE& triangle, int tileX, int tileY)
+{
+	int pixelX = tileX * TILE_WIDTH;
+	int pixelY = tileY * TILE_HEIGHT;
+	uint32_t coverage[TILE_HEIGHT];
+	uint32_t anyCoverage = 0;
+
+#ifdef OCCLUSION_USE_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	__m128 rowStart[3];
+	__m128 step[3];
+	for (int edge = 0; edge < 3; edge++)
+	{
+		__m128 a = _mm_set1_ps(triangle.edgeA[edge]);
+		rowStart[edge] = _mm_add_ps(_mm_mul_ps(a, _mm_add_ps(_mm_set1_ps((float)pixelX), laneOffsets)),
+			_mm_set1_ps(triangle.edgeC[edge]));
+		step[edge] = _mm_mul_ps(a, _mm_set1_ps(4.0f));
+	}
+
+	for (int row = 0; row < TILE_HEIGHT; row++)
+	{
+		float centerY = (float)(pixelY + row) + 0.5f;
+		__m128 e0 = _mm_add_ps(rowStart[0], _mm_set1_ps(triangle.edgeB[0] * centerY));
+		__m128 e1 = _mm_add_ps(rowStart[1], _mm_set1_ps(triangle.edgeB[1] * centerY));
+		__m128 e2 = _mm_add_ps(rowStart[2], _mm_set1_ps(triangle.edgeB[2] * centerY));
+		uint32_t rowMask = 0;
+
+		// four pixels per step across the 32 pixel row
+		for (int group = 0; group < TILE_WIDTH / 4; group++)
+		{
+			__m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero),
+				_mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+			rowMask |= ((uint32_t)_mm_movemask_ps(inside)) << (group * 4);
+
+			e0 = _mm_add_ps(e0, step[0]);
+			e1 = _mm_add_ps(e1, step[1]);
+			e2 = _mm_add_ps(e2, step[2]);
+		}
+		coverage[row] = rowMask;
+		anyCoverage |= rowMask;
+	}
+#else
+	for (int row = 0; row < TILE_HEIGHT; row++)
+	{
+		float centerY = (float)(pixelY + row) + 0.5f;
+		uint32_t rowMask = 0;
+
+		for (int column = 0; column < TILE_WIDTH; column++)
+		{
+			float centerX = (float)(pixelX + column) + 0.5f;
+			bool bInside = true;
+			for (int edge = 0; edge < 3; edge++)
+			{
+				float value = triangle.edgeA[edge] * centerX + triangle.edgeB[edge] * centerY + triangle.edgeC[edge];
+				bInside = bInside && (value >= 0.0f);
+			}
+			if (bInside == true)
+			{
+				rowMask |= ((uint32_t)1) << column;
+			}
+		}
+		coverage[row] = rowMask;
+		anyCoverage |= rowMask;
+	}
+#endif
+
+	if (anyCoverage == 0)
+	{
+		return;
+	}
+
+	// farthest depth of the triangle inside the tile, taken
+	// from the depth plane at the corners of the covered area
+	float left = (float)std::max(pixelX, triangle.minX);
+	float right = (float)std::min(pixelX + TILE_WIDTH, triangle.maxX + 1);
+	float bottom = (float)std::max(pixelY, triangle.minY);
+	float top = (float)std::min(pixelY + TILE_HEIGHT, triangle.maxY + 1);
+	float zLeftBottom = triangle.zPlane[0] * left + triangle.zPlane[1] * bottom + triangle.zPlane[2];
+	float zRightBottom = triangle.zPlane[0] * right + triangle.zPlane[1] * bottom + triangle.zPlane[2];
+	float zLeftTop = triangle.zPlane[0] * left + triangle.zPlane[1] * top + triangle.zPlane[2];
+	float zRightTop = triangle.zPlane[0] * right + triangle.zPlane[1] * top + triangle.zPlane[2];
+	float zTile = std::max(std::max(zLeftBottom, zRightBottom), std::max(zLeftTop, zRightTop));
+	zTile = std::min(std::max(zTile, triangle.zMin), triangle.zMax);
+
+	DEPTH_TILE& tile = m_tiles[tileY * m_tilesX + tileX];
+
+	// the triangle is behind everything already in the tile
+	if (zTile >= tile.zMax0)
+	{
+		return;
+	}
+
+	// a triangle much closer than the working layer starts a
+	// new layer; dropping the old coverage is always safe
+	// because those pixels remain bounded by zMax0
+	if ((tile.zMax1 - zTile) > (tile.zMax0 - tile.zMax1))
+	{
+		for (int row = 0; row < TILE_HEIGHT; row++)
+		{
+			tile.mask[row] = coverage[row];
+		}
+		tile.zMax1 = zTile;
+	}
+	else
+	{
+		for (int row = 0; row < TILE_HEIGHT; row++)
+		{
+			tile.mask[row] |= coverage[row];
+		}
+		tile.zMax1 = std::max(tile.zMax1, zTile);
+	}
+
+	// once the working layer covers the whole tile it becomes
+	// the new far bound of the tile
+	if ((tile.mask[0] & tile.mask[1] & tile.mask[2] & tile.mask[3]) == 0xFFFFFFFFu)
+	{
+		tile.zMax0 = tile.zMax1;
+		tile.zMax1 = 0.0f;
+		tile.mask[0] = 0;
+		tile.mask[1] = 0;
+		tile.mask[2] = 0;
+		tile.mask[3] = 0;
+	}
+}
+
+/***********************************************************
+ *  IsVisible()
+ *
+ *  This method is used for testing a bounding box against
+ *  the rasterized occluders.  The nearest depth of the box
+ *  is compared with the depth bounds of every tile under its
+ *  screen rectangle.  Boxes that reach past the near plane
+ *  are always reported as visible.
+ ***********************************************************/
+bool OcclusionCuller::IsVisible(const glm::mat4& model, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	if (m_bEnabled == false)
+	{
+		return(true);
+	}
+
+	m_testedCount.fetch_add(1, std::memory_order_relaxed);
+
+	glm::mat4 modelViewProjection = m_viewProjection * model;
+	glm::vec2 screenMin(1.0e30f);
+	glm::vec2 screenMax(-1.0e30f);
+	float zMin = 1.0e30f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner(
+			(i & 1) ? boundsMax.x : boundsMin.x,
+			(i & 2) ? boundsMax.y : boundsMin.y,
+			(i & 4) ? boundsMax.z : boundsMin.z);
+		glm::vec4 clip = modelViewProjection * glm::vec4(corner, 1.0f);
+
+		if (clip.z < -clip.w)
+		{
+			return(true);
+		}
+
+		glm::vec3 screen = ClipToScreen(clip);
+		screenMin = glm::min(screenMin, glm::vec2(screen));
+		screenMax = glm::max(screenMax, glm::vec2(screen));
+		zMin = std::min(zMin, screen.z);
+	}
+
+	int firstX = std::max(0, (int)std::floor(screenMin.x));
+	int firstY = std::max(0, (int)std::floor(screenMin.y));
+	int lastX = std::min(m_width - 1, (int)std::floor(screenMax.x));
+	int lastY = std::min(m_height - 1, (int)std::floor(screenMax.y));
+
+	// completely outside of the view or beyond the far plane
+	if ((firstX > lastX) || (firstY > lastY) || (zMin > 1.0f))
+	{
+		m_culledCount.fetch_add(1, std::memory_order_relaxed);
+		return(false);
+	}
+	zMin = std::max(zMin, 0.0f);
+
+	for (int tileY = firstY / TILE_HEIGHT; tileY <= lastY / TILE_HEIGHT; tileY++)
+	{
+		for (int tileX = firstX / TILE_WIDTH; tileX <= lastX / TILE_WIDTH; tileX++)
+		{
+			const DEPTH_TILE& tile = m_tiles[tileY * m_tilesX + tileX];
+
+			if (zMin > tile.zMax0)
+			{
+				continue;
+			}
+
+			// pixels outside the working layer are only bounded
+			// by the far depth of the whole tile
+			int tilePixelX = tileX * TILE_WIDTH;
+			int tilePixelY = tileY * TILE_HEIGHT;
+			uint32_t columns = BitRange(
+				std::max(firstX - tilePixelX, 0),
+				std::min(lastX - tilePixelX, TILE_WIDTH - 1));
+
+			for (int row = 0; row < TILE_HEIGHT; row++)
+			{
+				int y = tilePixelY + row;
+				if ((y >= firstY) && (y <= lastY) && ((columns & ~tile.mask[row]) != 0))
+				{
+					return(true);
+				}
+			}
+
+			if (zMin <= tile.zMax1)
+			{
+				return(true);
+			}
+		}
+	}
+
+	m_culledCount.fetch_add(1, std::memory_order_relaxed);
+	return(false);
+}
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.h
+// ============
+// CPU software occlusion culling against a low resolution depth buffer
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  OcclusionCuller
+ *
+ *  This class rasterizes the largest occluders of the scene
+ *  into a small tiled depth buffer on the CPU and then tests
+ *  the bounding boxes of other objects against it before
+ *  they are submitted to OpenGL.
+ *
+ *  Every 32x4 pixel tile keeps a masked depth representation
+ *  instead of per pixel depth: a conservative far depth for
+ *  the whole tile plus a coverage mask with the far depth of
+ *  the pixels that have been covered so far.  Rasterization
+ *  is split into bands of tile rows that run on the thread
+ *  pool, and coverage is computed four pixels at a time.
+ ***********************************************************/
+class OcclusionCuller
+{
+public:
+	// the proxy geometry used to rasterize an occluder
+	enum OCCLUDER_SHAPE
+	{
+		OCCLUDER_BOX,		// unit box from -0.5 to 0.5
+		OCCLUDER_PLANE		// plane from -1 to 1 on X and Z
+	};
+
+	struct CULLING_STATS
+	{
+		int occluderCount;		// occluders rasterized this frame
+		int triangleCount;		// occluder triangles after clipping
+		int testedCount;		// occludee bounding boxes tested
+		int culledCount;		// occludees found to be hidden
+	};
+
+	// constructor
+	OcclusionCuller(ThreadPool* pThreadPool, int width = 256, int height = 128);
+
+	// clear the depth buffer and the occluders for a new frame
+	void BeginFrame(const glm::mat4& viewProjection);
+	// add an occluder candidate for this frame
+	void AddOccluder(const glm::mat4& model, OCCLUDER_SHAPE shape);
+	// rasterize the largest occluder candidates into the depth buffer
+	void RasterizeOccluders();
+	// test a local space bounding box transformed by the model
+	// matrix - returns false only when it is certainly hidden.
+	// Once the occluders are rasterized this can be called from
+	// several threads at once.
+	bool IsVisible(const glm::mat4& model, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	// limit the number of occluders rasterized per frame
+	void SetMaxOccluders(int maxOccluders) { m_maxOccluders = maxOccluders; }
+	// enable or disable culling - disabled culling reports
+	// everything as visible
+	void SetEnabled(bool bEnabled) { m_bEnabled = bEnabled; }
+	bool IsEnabled() const { return m_bEnabled; }
+
+	CULLING_STATS GetStats() const;
+
+private:
+	// masked depth data of one 32x4 pixel tile
+	struct DEPTH_TILE
+	{
+		uint32_t mask[4];	// working layer coverage, one row per entry
+		float zMax0;		// far depth bound of the whole tile
+		float zMax1;		// far depth bound of the covered pixels
+	};
+
+	// screen space triangle ready for rasterization
+	struct SCREEN_TRIANGLE
+	{
+		float edgeA[3];		// edge functions A*x + B*y + C
+		float edgeB[3];
+		float edgeC[3];
+		float zPlane[3];	// depth plane dz/dx, dz/dy and offset
+		float zMin;			// depth range of the triangle
+		float zMax;
+		int minX, minY;		// pixel bounding box
+		int maxX, maxY;
+	};
+
+	struct OCCLUDER
+	{
+		glm::mat4 modelViewProjection;
+		OCCLUDER_SHAPE shape;
+		float screenArea;
+	};
+
+	// clip, project and set up one clip space triangle
+	void SetupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+	void AddScreenTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2);
+	// rasterize all of the triangles into a band of tile rows
+	void RasterizeBand(int firstTileRow, int lastTileRow);
+	// rasterize one triangle into one tile
+	void RasterizeTile(const SCREEN_TRIANGLE& triangle, int tileX, int tileY);
+	// convert clip space to screen space (x, y in pixels, z in [0,1])
+	glm::vec3 ClipToScreen(const glm::vec4& clip) const;
+
+	ThreadPool* m_pThreadPool;
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	int m_maxOccluders;
+	bool m_bEnabled;
+
+	glm::mat4 m_viewProjection;
+	std::vector<DEPTH_TILE> m_tiles;
+	std::vector<OCCLUDER> m_occluders;
+	std::vector<SCREEN_TRIANGLE> m_triangles;
+	CULLING_STATS m_stats;
+	// occludee counters, updated by every thread that tests
+	std::atomic<int> m_testedCount;
+	std::atomic<int> m_culledCount;
+};
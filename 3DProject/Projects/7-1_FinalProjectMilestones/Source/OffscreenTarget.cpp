@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreentarget.cpp
+// ============
+// framebuffer the headless mode renders its frames into
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OffscreenTarget.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  OffscreenTarget()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OffscreenTarget::OffscreenTarget()
+{
+	m_framebuffer = 0;
+	m_colorRenderbuffer = 0;
+	m_depthRenderbuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~OffscreenTarget()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OffscreenTarget::~OffscreenTarget()
+{
+	Release();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the framebuffer.  The
+ *  depth uses the same format as the window, so the depth
+ *  copy of the deferred path works the same in both.
+ ***********************************************************/
+bool OffscreenTarget::Create(int width, int height)
+{
+	Release();
+
+	glGenRenderbuffers(1, &m_colorRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &m_depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (bComplete == false)
+	{
+		std::cout << "Could not create the offscreen framebuffer, width:" << width << ", height:" << height << std::endl;
+		Release();
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	return(true);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for freeing the framebuffer.
+ ***********************************************************/
+void OffscreenTarget::Release()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorRenderbuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorRenderbuffer);
+		m_colorRenderbuffer = 0;
+	}
+	if (m_depthRenderbuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+		m_depthRenderbuffer = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for drawing the next frame into the
+ *  framebuffer, with the viewport covering all of it.
+ ***********************************************************/
+void OffscreenTarget::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  ReadPixels()
+ *
+ *  This method is used for reading the pixels of the frame
+ *  drawn last.  The call waits for the frame to finish.
+ ***********************************************************/
+void OffscreenTarget::ReadPixels(std::vector<unsigned char>& pixels)
+{
+	pixels.resize((size_t)m_width * m_height * 4);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
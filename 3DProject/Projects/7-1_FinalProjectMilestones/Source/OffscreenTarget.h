@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreentarget.h
+// ============
+// framebuffer the headless mode renders its frames into
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  OffscreenTarget
+ *
+ *  This class holds a color and depth framebuffer that
+ *  stands in for the window when nothing is shown.  The
+ *  scene is drawn into it the same as into the window, and
+ *  the pixels are read back for writing to disk.
+ ***********************************************************/
+class OffscreenTarget
+{
+public:
+	// constructor
+	OffscreenTarget();
+	// destructor
+	~OffscreenTarget();
+
+	// create the framebuffer for the passed in size
+	bool Create(int width, int height);
+	// draw the next frame into the framebuffer
+	void Bind();
+	// read the RGBA pixels of the last frame, bottom row first
+	void ReadPixels(std::vector<unsigned char>& pixels);
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+
+private:
+	// free the framebuffer
+	void Release();
+
+	GLuint m_framebuffer;
+	GLuint m_colorRenderbuffer;
+	GLuint m_depthRenderbuffer;
+	int m_width;
+	int m_height;
+};
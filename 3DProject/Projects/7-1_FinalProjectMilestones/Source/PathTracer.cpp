@@ -0,0 +1,579 @@
+///////////////////////////////////////////////////////////////////////////////
+// pathtracer.cpp
+// ============
+// path traced reference images and irradiance of the scene
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const int TILE_SIZE = 16;
+
+	// bounces after the first surface, and the bounce after
+	// which paths are ended at random by their throughput
+	const int g_MaxBounces = 4;
+	const int g_RouletteBounce = 2;
+	// diffuse reflectance is kept below one so light does
+	// not build up between surfaces
+	const float g_MaxReflectance = 0.95f;
+	// transparent surfaces a ray passes through at most
+	const int g_MaxTransparentLayers = 16;
+	// distance a ray starts off a surface, relative to the
+	// size of the position
+	const float g_RayOffset = 1.0e-4f;
+	const float g_Pi = 3.14159265358979f;
+
+	// the same as the materials of a program without one
+	const PathTracer::MATERIAL g_NoMaterial = { glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f };
+
+	// PCG hash, used to seed the random numbers of a sample
+	uint32_t HashValue(uint32_t value)
+	{
+		uint32_t state = value * 747796405u + 2891336453u;
+		uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return((word >> 22u) ^ word);
+	}
+
+	// next random number in [0, 1)
+	float NextRandom(uint32_t& state)
+	{
+		state = HashValue(state);
+		return((float)(state >> 8) * (1.0f / 16777216.0f));
+	}
+
+	// the specular exponent of the shaders is always 32
+	float SpecularPower(float value)
+	{
+		value *= value;
+		value *= value;
+		value *= value;
+		value *= value;
+		return(value * value);
+	}
+
+	// direction around the normal with a cosine distribution,
+	// which is the distribution of the light a diffuse surface
+	// reflects
+	glm::vec3 SampleCosineDirection(const glm::vec3& normal, uint32_t& randomState)
+	{
+		// tangent basis without branching on the normal
+		float sign = (normal.z >= 0.0f) ? 1.0f : -1.0f;
+		float a = -1.0f / (sign + normal.z);
+		float b = normal.x * normal.y * a;
+		glm::vec3 tangent(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+		glm::vec3 bitangent(b, sign + normal.y * normal.y * a, -normal.y);
+
+		float radiusSquared = NextRandom(randomState);
+		float angle = 2.0f * g_Pi * NextRandom(randomState);
+		float radius = std::sqrt(radiusSquared);
+		return(tangent * (radius * std::cos(angle)) +
+			bitangent * (radius * std::sin(angle)) +
+			normal * std::sqrt(std::max(1.0f - radiusSquared, 0.0f)));
+	}
+}
+
+/***********************************************************
+ *  PathTracer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PathTracer::PathTracer(ThreadPool* pThreadPool)
+{
+	m_pThreadPool = pThreadPool;
+	m_bTransparentSurfaces = false;
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_inverseViewProjection = glm::mat4(1.0f);
+	m_rayCount = 0;
+	m_stats = TRACE_STATS();
+}
+
+/***********************************************************
+ *  SetTexture()
+ *
+ *  This method is used for copying an RGB or RGBA texture
+ *  image into the passed in slot.
+ ***********************************************************/
+bool PathTracer::SetTexture(int slot, const unsigned char* pixels, int width, int height, int channels)
+{
+	if (slot < 0)
+	{
+		return(false);
+	}
+
+	if ((size_t)slot >= m_textures.size())
+	{
+		m_textures.resize(slot + 1);
+	}
+	return(m_textures[slot].SetImage(pixels, width, height, channels));
+}
+
+/***********************************************************
+ *  SetMaterials()
+ *
+ *  This method is used for setting the materials that the
+ *  draws refer to by index.
+ ***********************************************************/
+void PathTracer::SetMaterials(const std::vector<MATERIAL>& materials)
+{
+	m_materials = materials;
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for setting the scene wide lights
+ *  and the point lights.
+ ***********************************************************/
+void PathTracer::SetLights(const std::vector<LIGHT>& lights, const std::vector<POINT_LIGHT>& pointLights)
+{
+	m_lights = lights;
+	m_pointLights = pointLights;
+}
+
+/***********************************************************
+ *  BuildScene()
+ *
+ *  This method is used for placing the triangles of every
+ *  draw in the world, with the same matrices as the vertex
+ *  shader, and building the tree over them.  The scene is
+ *  fixed from then on, so moving objects need a new build.
+ ***********************************************************/
+void PathTracer::BuildScene(const std::vector<DRAW>& draws)
+{
+	std::vector<glm::vec3> corners;
+	m_surfaces.clear();
+	m_drawLooks.resize(draws.size());
+	m_bTransparentSurfaces = false;
+
+	for (size_t d = 0; d < draws.size(); d++)
+	{
+		const DRAW& draw = draws[d];
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.model)));
+
+		m_drawLooks[d].material = draw.material;
+		m_drawLooks[d].texture = draw.texture;
+		m_drawLooks[d].color = draw.color;
+		m_drawLooks[d].bTransparent = draw.bTransparent;
+		m_bTransparentSurfaces = m_bTransparentSurfaces || draw.bTransparent;
+
+		for (size_t i = 0; i + 2 < draw.indexCount; i += 3)
+		{
+			SURFACE surface;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const GLfloat* vertex = draw.vertices + draw.indices[i + corner] * 8;
+				corners.push_back(glm::vec3(draw.model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f)));
+				surface.normals[corner] = normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+				surface.uvs[corner] = glm::vec2(vertex[6], vertex[7]) * draw.uvScale;
+			}
+
+			const glm::vec3* triangle = &corners[corners.size() - 3];
+			glm::vec3 faceNormal = glm::cross(triangle[1] - triangle[0], triangle[2] - triangle[0]);
+			float length = glm::length(faceNormal);
+			surface.faceNormal = (length > 0.0f) ? faceNormal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			surface.draw = (uint32_t)d;
+			m_surfaces.push_back(surface);
+		}
+	}
+
+	m_bvh.Build(corners);
+}
+
+/***********************************************************
+ *  BeginImage()
+ *
+ *  This method is used for clearing the samples for a new
+ *  image.
+ ***********************************************************/
+void PathTracer::BeginImage(int width, int height, const glm::mat4& view, const glm::mat4& projection)
+{
+	m_width = std::max(width, 0);
+	m_height = std::max(height, 0);
+	m_tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+	m_inverseViewProjection = glm::inverse(projection * view);
+	m_accumulation.assign((size_t)m_width * m_height, glm::vec3(0.0f));
+	m_rayCount = 0;
+
+	m_stats = TRACE_STATS();
+	m_stats.triangleCount = m_bvh.GetStats().triangleCount;
+	m_stats.nodeCount = m_bvh.GetStats().nodeCount;
+}
+
+/***********************************************************
+ *  AddSamples()
+ *
+ *  This method is used for tracing more samples of every
+ *  pixel.  The tiles take very different times, so the work
+ *  stealing of the pool keeps every thread busy.
+ ***********************************************************/
+void PathTracer::AddSamples(int samples)
+{
+	int tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+	if ((samples <= 0) || (m_tilesX * tilesY == 0))
+	{
+		return;
+	}
+
+	m_pThreadPool->ParallelFor(m_tilesX * tilesY, [this, samples](int tileIndex)
+	{
+		RenderTile(tileIndex, samples);
+	});
+
+	m_stats.sampleCount += samples;
+	m_stats.rayCount = m_rayCount;
+}
+
+/***********************************************************
+ *  RenderTile()
+ *
+ *  This method is used for tracing the samples of one tile.
+ *  Each sample goes through a random spot of its pixel.
+ ***********************************************************/
+void PathTracer::RenderTile(int tileIndex, int samples)
+{
+	int x0 = (tileIndex % m_tilesX) * TILE_SIZE;
+	int y0 = (tileIndex / m_tilesX) * TILE_SIZE;
+	int x1 = std::min(x0 + TILE_SIZE, m_width);
+	int y1 = std::min(y0 + TILE_SIZE, m_height);
+	uint64_t rayCount = 0;
+
+	for (int y = y0; y < y1; y++)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			size_t pixel = (size_t)y * m_width + x;
+			glm::vec3 radiance(0.0f);
+			for (int sample = 0; sample < samples; sample++)
+			{
+				uint32_t randomState = HashValue((uint32_t)pixel ^ HashValue((uint32_t)(m_stats.sampleCount + sample)));
+
+				glm::vec2 ndc(
+					((float)x + NextRandom(randomState)) / (float)m_width * 2.0f - 1.0f,
+					((float)y + NextRandom(randomState)) / (float)m_height * 2.0f - 1.0f);
+				glm::vec4 nearPoint = m_inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+				glm::vec4 farPoint = m_inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+
+				TriangleBVH::RAY ray;
+				ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+				ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+				radiance += TracePath(ray, randomState, rayCount);
+			}
+			m_accumulation[pixel] += radiance;
+		}
+	}
+
+	m_rayCount += rayCount;
+}
+
+/***********************************************************
+ *  GetPixels()
+ *
+ *  This method is used for getting the average of the
+ *  samples so far.  The shaders write their results without
+ *  any tone mapping, so neither does this.
+ ***********************************************************/
+void PathTracer::GetPixels(std::vector<unsigned char>& pixels) const
+{
+	pixels.resize(m_accumulation.size() * 4);
+	float scale = (m_stats.sampleCount > 0) ? 1.0f / (float)m_stats.sampleCount : 0.0f;
+	for (size_t i = 0; i < m_accumulation.size(); i++)
+	{
+		glm::vec3 color = glm::clamp(m_accumulation[i] * scale, 0.0f, 1.0f) * 255.0f + 0.5f;
+		pixels[i * 4] = (unsigned char)color.r;
+		pixels[i * 4 + 1] = (unsigned char)color.g;
+		pixels[i * 4 + 2] = (unsigned char)color.b;
+		pixels[i * 4 + 3] = 255;
+	}
+}
+
+/***********************************************************
+ *  TracePath()
+ *
+ *  This method is used for following a path of light back
+ *  from the camera.  Every surface it reaches adds its
+ *  direct light, then the path bounces off in a diffuse
+ *  direction, carrying the reflectance of the surface.
+ ***********************************************************/
+glm::vec3 PathTracer::TracePath(TriangleBVH::RAY ray, uint32_t& randomState, uint64_t& rayCount) const
+{
+	glm::vec3 radiance(0.0f);
+	glm::vec3 throughput(1.0f);
+
+	for (int bounce = 0; bounce <= g_MaxBounces; bounce++)
+	{
+		SURFACE_POINT point;
+		if (FindSurface(ray, randomState, rayCount, point) == false)
+		{
+			break;
+		}
+
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		ComputeDirectLight(point.position, point.normal, point.faceNormal, -ray.direction, rayCount, diffuse, specular);
+		radiance += throughput * point.surfaceColor *
+			(diffuse * point.pMaterial->diffuseColor + specular * (point.pMaterial->shininess * point.pMaterial->specularColor));
+
+		throughput *= glm::min(point.surfaceColor * point.pMaterial->diffuseColor, glm::vec3(g_MaxReflectance));
+		if (bounce >= g_RouletteBounce)
+		{
+			float survival = std::max(throughput.r, std::max(throughput.g, throughput.b));
+			if (NextRandom(randomState) >= survival)
+			{
+				break;
+			}
+			throughput /= survival;
+		}
+
+		ray.origin = OffsetPosition(point.position, point.faceNormal);
+		ray.direction = SampleCosineDirection(point.normal, randomState);
+		if (glm::dot(ray.direction, point.faceNormal) <= 0.0f)
+		{
+			break;
+		}
+	}
+
+	return(radiance);
+}
+
+/***********************************************************
+ *  FindSurface()
+ *
+ *  This method is used for finding the surface a ray stops
+ *  at.  The rasterizer blends a transparent surface by its
+ *  alpha, so a ray stops at one with that chance and passes
+ *  through otherwise, which averages out to the same.
+ ***********************************************************/
+bool PathTracer::FindSurface(TriangleBVH::RAY ray, uint32_t& randomState, uint64_t& rayCount, SURFACE_POINT& point) const
+{
+	for (int layer = 0; layer < g_MaxTransparentLayers; layer++)
+	{
+		TriangleBVH::HIT hit;
+		rayCount++;
+		if (m_bvh.Intersect(ray, FLT_MAX, hit) == false)
+		{
+			return(false);
+		}
+
+		const SURFACE& surface = m_surfaces[hit.triangle];
+		const DRAW_LOOK& look = m_drawLooks[surface.draw];
+		float weights[3] = { 1.0f - hit.u - hit.v, hit.u, hit.v };
+		glm::vec3 normal(0.0f);
+		glm::vec2 uv(0.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			normal += surface.normals[i] * weights[i];
+			uv += surface.uvs[i] * weights[i];
+		}
+
+		bool bTextured = (look.texture >= 0) && ((size_t)look.texture < m_textures.size()) &&
+			(m_textures[look.texture].IsEmpty() == false);
+		glm::vec4 surfaceColor = bTextured ? m_textures[look.texture].Sample(uv) : look.color;
+		float alpha = bTextured ? 1.0f : surfaceColor.a;
+
+		point.position = ray.origin + ray.direction * hit.distance;
+		if (look.bTransparent && (NextRandom(randomState) >= alpha))
+		{
+			ray.origin = OffsetPosition(point.position, (glm::dot(ray.direction, surface.faceNormal) > 0.0f) ? surface.faceNormal : -surface.faceNormal);
+			continue;
+		}
+
+		// the surfaces are lit from both sides, like the
+		// rasterizer draws them
+		float side = (glm::dot(ray.direction, surface.faceNormal) > 0.0f) ? -1.0f : 1.0f;
+		point.faceNormal = surface.faceNormal * side;
+		float length = glm::length(normal);
+		point.normal = (length > 0.0f) ? normal * (side / length) : point.faceNormal;
+		point.surfaceColor = glm::vec3(surfaceColor);
+		point.pMaterial = ((look.material >= 0) && ((size_t)look.material < m_materials.size())) ?
+			&m_materials[look.material] : &g_NoMaterial;
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  ComputeDirectLight()
+ *
+ *  This method is used for adding up the light sources the
+ *  same way as lighting.glsl, without the ambient terms,
+ *  where each light only counts when a shadow ray reaches
+ *  it.  The diffuse and specular terms are returned without
+ *  the material, which the caller applies.
+ ***********************************************************/
+void PathTracer::ComputeDirectLight(
+	const glm::vec3& position,
+	const glm::vec3& normal,
+	const glm::vec3& faceNormal,
+	const glm::vec3& viewDirection,
+	uint64_t& rayCount,
+	glm::vec3& diffuse,
+	glm::vec3& specular) const
+{
+	diffuse = glm::vec3(0.0f);
+	specular = glm::vec3(0.0f);
+	glm::vec3 start = OffsetPosition(position, faceNormal);
+
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		const LIGHT& light = m_lights[i];
+		glm::vec3 lightDirection = glm::normalize(light.position - position);
+		// a light behind the face is shadowed by the face itself
+		if (glm::dot(lightDirection, faceNormal) <= 0.0f)
+		{
+			continue;
+		}
+
+		float impact = std::max(glm::dot(normal, lightDirection), 0.0f);
+		glm::vec3 reflectDir = glm::reflect(-lightDirection, normal);
+		float specularComponent = SpecularPower(std::max(glm::dot(viewDirection, reflectDir), 0.0f));
+		if ((impact <= 0.0f) && (specularComponent <= 0.0f))
+		{
+			continue;
+		}
+
+		float visibility = ComputeTransmittance(start, light.position, rayCount);
+		diffuse += glm::vec3(visibility * impact);
+		specular += glm::vec3(visibility * light.specularIntensity * specularComponent);
+	}
+
+	for (size_t i = 0; i < m_pointLights.size(); i++)
+	{
+		const POINT_LIGHT& light = m_pointLights[i];
+		glm::vec3 toLight = light.position - position;
+		float distanceSquared = glm::dot(toLight, toLight);
+		float falloff = glm::clamp(1.0f - distanceSquared / (light.range * light.range), 0.0f, 1.0f);
+		falloff *= falloff;
+
+		glm::vec3 lightDirection = toLight / std::sqrt(std::max(distanceSquared, 0.0001f));
+		if ((falloff <= 0.0f) || (glm::dot(lightDirection, faceNormal) <= 0.0f))
+		{
+			continue;
+		}
+
+		float impact = std::max(glm::dot(normal, lightDirection), 0.0f);
+		glm::vec3 reflectDir = glm::reflect(-lightDirection, normal);
+		float specularComponent = SpecularPower(std::max(glm::dot(viewDirection, reflectDir), 0.0f));
+		if ((impact <= 0.0f) && (specularComponent <= 0.0f))
+		{
+			continue;
+		}
+
+		float visibility = falloff * ComputeTransmittance(start, light.position, rayCount);
+		diffuse += visibility * impact * light.diffuseColor;
+		specular += visibility * light.specularIntensity * specularComponent * light.specularColor;
+	}
+}
+
+/***********************************************************
+ *  ComputeTransmittance()
+ *
+ *  This method is used for casting a shadow ray.  Any hit
+ *  blocks the light when the scene has no transparent
+ *  surfaces, otherwise the ray is followed through them,
+ *  losing the alpha of each.
+ ***********************************************************/
+float PathTracer::ComputeTransmittance(const glm::vec3& position, const glm::vec3& target, uint64_t& rayCount) const
+{
+	TriangleBVH::RAY ray;
+	ray.origin = position;
+	glm::vec3 toTarget = target - position;
+	float distance = glm::length(toTarget);
+	if (distance <= 0.0f)
+	{
+		return(1.0f);
+	}
+	ray.direction = toTarget / distance;
+
+	if (m_bTransparentSurfaces == false)
+	{
+		rayCount++;
+		return(m_bvh.IsOccluded(ray, distance) ? 0.0f : 1.0f);
+	}
+
+	float transmittance = 1.0f;
+	for (int layer = 0; layer < g_MaxTransparentLayers; layer++)
+	{
+		TriangleBVH::HIT hit;
+		rayCount++;
+		if (m_bvh.Intersect(ray, distance, hit) == false)
+		{
+			return(transmittance);
+		}
+
+		const SURFACE& surface = m_surfaces[hit.triangle];
+		const DRAW_LOOK& look = m_drawLooks[surface.draw];
+		bool bTextured = (look.texture >= 0) && ((size_t)look.texture < m_textures.size()) &&
+			(m_textures[look.texture].IsEmpty() == false);
+		if ((look.bTransparent == false) || bTextured)
+		{
+			return(0.0f);
+		}
+		transmittance *= 1.0f - look.color.a;
+
+		glm::vec3 hitPosition = ray.origin + ray.direction * hit.distance;
+		ray.origin = OffsetPosition(hitPosition, (glm::dot(ray.direction, surface.faceNormal) > 0.0f) ? surface.faceNormal : -surface.faceNormal);
+		distance = glm::length(target - ray.origin);
+	}
+
+	return(0.0f);
+}
+
+/***********************************************************
+ *  ComputeIrradiance()
+ *
+ *  This method is used for gathering the light arriving at
+ *  a surface point for lightmaps.  The direct light is the
+ *  diffuse term of the light sources, and the bounced light
+ *  is the average of paths sent out with a cosine
+ *  distribution, which is what a diffuse surface weights
+ *  the incoming light by.
+ ***********************************************************/
+glm::vec3 PathTracer::ComputeIrradiance(const glm::vec3& position, const glm::vec3& normal, int samples, uint32_t seed) const
+{
+	uint64_t rayCount = 0;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	ComputeDirectLight(position, normal, normal, normal, rayCount, diffuse, specular);
+
+	glm::vec3 bounced(0.0f);
+	for (int sample = 0; sample < samples; sample++)
+	{
+		uint32_t randomState = HashValue(seed ^ HashValue((uint32_t)sample));
+
+		TriangleBVH::RAY ray;
+		ray.origin = OffsetPosition(position, normal);
+		ray.direction = SampleCosineDirection(normal, randomState);
+		bounced += TracePath(ray, randomState, rayCount);
+	}
+	if (samples > 0)
+	{
+		bounced /= (float)samples;
+	}
+
+	return(diffuse + bounced);
+}
+
+/***********************************************************
+ *  OffsetPosition()
+ *
+ *  This method is used for moving the start of a ray off
+ *  the surface it leaves, so it does not hit that surface
+ *  again through rounding.
+ ***********************************************************/
+glm::vec3 PathTracer::OffsetPosition(const glm::vec3& position, const glm::vec3& faceNormal)
+{
+	float size = std::max(std::fabs(position.x), std::max(std::fabs(position.y), std::fabs(position.z)));
+	return(position + faceNormal * (g_RayOffset * std::max(size, 1.0f)));
+}
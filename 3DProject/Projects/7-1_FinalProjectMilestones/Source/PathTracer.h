@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// pathtracer.h
+// ============
+// path traced reference images and irradiance of the scene
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SoftwareRenderer.h"
+#include "TexelImage.h"
+#include "ThreadPool.h"
+#include "TriangleBVH.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  PathTracer
+ *
+ *  This class renders the scene by tracing light paths on
+ *  the CPU, for reference images to check the rasterized
+ *  lighting against and for baking lightmaps.  It takes the
+ *  same materials, lights and meshes as the software
+ *  renderer.  The direct light of every light source is
+ *  shaded like lighting.glsl, with shadow rays, and the
+ *  ambient terms of the shaders are replaced by light that
+ *  bounces off the diffuse surfaces.
+ *
+ *  The image is accumulated progressively, one sample per
+ *  pixel per pass, with the tiles of every pass spread over
+ *  the thread pool.  The random numbers of a sample only
+ *  depend on its pixel and pass, so the image does not
+ *  depend on the thread count.
+ ***********************************************************/
+class PathTracer
+{
+public:
+	typedef SoftwareRenderer::MATERIAL MATERIAL;
+	typedef SoftwareRenderer::LIGHT LIGHT;
+	typedef SoftwareRenderer::POINT_LIGHT POINT_LIGHT;
+	typedef SoftwareRenderer::DRAW DRAW;
+
+	struct TRACE_STATS
+	{
+		size_t triangleCount;
+		size_t nodeCount;
+		int sampleCount;		// samples per pixel so far
+		uint64_t rayCount;		// rays cast for the image
+	};
+
+	// constructor
+	PathTracer(ThreadPool* pThreadPool);
+
+	// copy a texture image into the passed in slot
+	bool SetTexture(int slot, const unsigned char* pixels, int width, int height, int channels);
+	// set the materials, indexed by the draw material
+	void SetMaterials(const std::vector<MATERIAL>& materials);
+	// set the light sources of the scene
+	void SetLights(const std::vector<LIGHT>& lights, const std::vector<POINT_LIGHT>& pointLights);
+	// place the passed in meshes in the world and build the
+	// ray tracing tree over them
+	void BuildScene(const std::vector<DRAW>& draws);
+
+	// start a new image seen with the passed in camera
+	void BeginImage(int width, int height, const glm::mat4& view, const glm::mat4& projection);
+	// add the passed in number of samples to every pixel
+	void AddSamples(int samples);
+	// get the average of the samples as RGBA pixels, bottom
+	// row first
+	void GetPixels(std::vector<unsigned char>& pixels) const;
+
+	// get the light arriving at a surface point, scaled the
+	// same as the diffuse term of the shaders, so multiplying
+	// it by the diffuse color of a surface gives the light the
+	// surface reflects
+	glm::vec3 ComputeIrradiance(const glm::vec3& position, const glm::vec3& normal, int samples, uint32_t seed) const;
+
+	const TRACE_STATS& GetStats() const { return m_stats; }
+
+private:
+	// shading data of a triangle, in the order the tree was
+	// built from
+	struct SURFACE
+	{
+		glm::vec3 normals[3];
+		glm::vec2 uvs[3];
+		glm::vec3 faceNormal;
+		uint32_t draw;
+	};
+
+	// what a draw looks like, the meshes themselves are only
+	// needed while the scene is built
+	struct DRAW_LOOK
+	{
+		int material;
+		int texture;
+		glm::vec4 color;
+		bool bTransparent;
+	};
+
+	// a surface point hit by a ray
+	struct SURFACE_POINT
+	{
+		glm::vec3 position;
+		glm::vec3 normal;			// facing the ray
+		glm::vec3 faceNormal;		// facing the ray
+		glm::vec3 surfaceColor;
+		const MATERIAL* pMaterial;
+	};
+
+	// trace the samples of one tile of the image
+	void RenderTile(int tileIndex, int samples);
+	// radiance arriving along a ray from the first surface
+	glm::vec3 TracePath(TriangleBVH::RAY ray, uint32_t& randomState, uint64_t& rayCount) const;
+	// find the surface a ray stops at, passing through the
+	// transparent surfaces by their alpha
+	bool FindSurface(TriangleBVH::RAY ray, uint32_t& randomState, uint64_t& rayCount, SURFACE_POINT& point) const;
+	// light reaching a surface point straight from the light
+	// sources, as the diffuse and specular terms of the shaders
+	void ComputeDirectLight(
+		const glm::vec3& position,
+		const glm::vec3& normal,
+		const glm::vec3& faceNormal,
+		const glm::vec3& viewDirection,
+		uint64_t& rayCount,
+		glm::vec3& diffuse,
+		glm::vec3& specular) const;
+	// fraction of the light that gets between two points
+	float ComputeTransmittance(const glm::vec3& position, const glm::vec3& target, uint64_t& rayCount) const;
+	// move a ray start off the surface it leaves
+	static glm::vec3 OffsetPosition(const glm::vec3& position, const glm::vec3& faceNormal);
+
+	ThreadPool* m_pThreadPool;
+	std::vector<TexelImage> m_textures;
+	std::vector<MATERIAL> m_materials;
+	std::vector<LIGHT> m_lights;
+	std::vector<POINT_LIGHT> m_pointLights;
+
+	// the scene
+	TriangleBVH m_bvh;
+	std::vector<SURFACE> m_surfaces;
+	std::vector<DRAW_LOOK> m_drawLooks;
+	bool m_bTransparentSurfaces;
+
+	// the image
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	glm::mat4 m_inverseViewProjection;
+	std::vector<glm::vec3> m_accumulation;
+	std::atomic<uint64_t> m_rayCount;
+	TRACE_STATS m_stats;
+};
@@ -0,0 +1,303 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// sorted list of the draws of one frame
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// field sizes of the sort keys
+	const int PASS_BITS = 2;
+	const int TRANSPARENT_BITS = 1;
+	const int VARIANT_BITS = 5;
+	const int MATERIAL_BITS = 10;
+	const int TEXTURE_BITS = 9;
+	const int MESH_BITS = 5;
+	const int DEPTH_BITS = 32;
+
+	// fields shared by both key layouts
+	const int PASS_SHIFT = 64 - PASS_BITS;
+	const int TRANSPARENT_SHIFT = PASS_SHIFT - TRANSPARENT_BITS;
+
+	// opaque layout - state first, then front to back
+	const int OPAQUE_VARIANT_SHIFT = TRANSPARENT_SHIFT - VARIANT_BITS;
+	const int OPAQUE_MATERIAL_SHIFT = OPAQUE_VARIANT_SHIFT - MATERIAL_BITS;
+	const int OPAQUE_TEXTURE_SHIFT = OPAQUE_MATERIAL_SHIFT - TEXTURE_BITS;
+	const int OPAQUE_MESH_SHIFT = OPAQUE_TEXTURE_SHIFT - MESH_BITS;
+
+	// transparent layout - back to front, then state
+	const int TRANSPARENT_DEPTH_SHIFT = TRANSPARENT_SHIFT - DEPTH_BITS;
+	const int TRANSPARENT_VARIANT_SHIFT = TRANSPARENT_DEPTH_SHIFT - VARIANT_BITS;
+	const int TRANSPARENT_MATERIAL_SHIFT = TRANSPARENT_VARIANT_SHIFT - MATERIAL_BITS;
+	const int TRANSPARENT_TEXTURE_SHIFT = TRANSPARENT_MATERIAL_SHIFT - TEXTURE_BITS;
+
+	static_assert(OPAQUE_MESH_SHIFT == DEPTH_BITS, "opaque sort key fields must fill 64 bits");
+	static_assert(TRANSPARENT_TEXTURE_SHIFT == MESH_BITS, "transparent sort key fields must fill 64 bits");
+
+	// set when a texture index too large for its field has
+	// been reported - keys are made on the worker threads, so
+	// the first one to see it reports it
+	std::atomic<bool> g_bTextureClampReported(false);
+
+	// the radix sort handles 8 bits of the keys per pass
+	const int RADIX_BITS = 8;
+	const int RADIX_BUCKETS = 1 << RADIX_BITS;
+	const int RADIX_PASSES = 64 / RADIX_BITS;
+
+	// clamp a value into a key field
+	uint64_t Field(int value, int bits)
+	{
+		int maxValue = (1 << bits) - 1;
+		if (value < 0)
+			value = 0;
+		else if (value > maxValue)
+			value = maxValue;
+		return((uint64_t)value);
+	}
+
+	// read a field of a key
+	int GetField(uint64_t key, int shift, int bits)
+	{
+		return((int)((key >> shift) & ((((uint64_t)1) << bits) - 1)));
+	}
+
+	// the bits of a positive float sort the same way as the
+	// float itself, so the depth can be used as an integer
+	uint32_t DepthBits(float depth)
+	{
+		if (!(depth > 0.0f))
+		{
+			depth = 0.0f;
+		}
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+		return(bits);
+	}
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+	m_keys = NULL;
+	m_objectIndices = NULL;
+	m_sortKeys = NULL;
+	m_sortObjectIndices = NULL;
+	m_count = 0;
+	m_capacity = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for removing the items and the state
+ *  change counters of the previous frame, and taking the
+ *  arrays for this frame from the arena.
+ ***********************************************************/
+void RenderQueue::Reset(FrameArena* pArena, size_t capacity)
+{
+	m_keys = pArena->AllocateArray<uint64_t>(capacity);
+	m_objectIndices = pArena->AllocateArray<uint32_t>(capacity);
+	m_sortKeys = pArena->AllocateArray<uint64_t>(capacity);
+	m_sortObjectIndices = pArena->AllocateArray<uint32_t>(capacity);
+	m_count = 0;
+	m_capacity = capacity;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding the draw of an object.
+ ***********************************************************/
+void RenderQueue::Add(uint64_t key, uint32_t objectIndex)
+{
+	if (m_count < m_capacity)
+	{
+		m_keys[m_count] = key;
+		m_objectIndices[m_count] = objectIndex;
+		m_count++;
+	}
+}
+
+/***********************************************************
+ *  Append()
+ *
+ *  This method is used for adding the draws of several
+ *  objects at once, such as the visible objects found by
+ *  one culling task.
+ ***********************************************************/
+void RenderQueue::Append(const uint64_t* keys, const uint32_t* objectIndices, size_t count)
+{
+	if (count > m_capacity - m_count)
+	{
+		count = m_capacity - m_count;
+	}
+
+	memcpy(m_keys + m_count, keys, count * sizeof(uint64_t));
+	memcpy(m_objectIndices + m_count, objectIndices, count * sizeof(uint32_t));
+	m_count += count;
+}
+
+/***********************************************************
+ *  MakeKey()
+ *
+ *  This method is used for packing the draw state of an
+ *  object into a sort key.  Material and texture indices are
+ *  stored one higher so that none sorts first, and values
+ *  that do not fit their field are clamped.  A clamped
+ *  texture index makes textures share a key value, which is
+ *  reported the first time it happens.
+ ***********************************************************/
+uint64_t RenderQueue::MakeKey(
+	int pass,
+	bool bTransparent,
+	int shaderVariant,
+	int material,
+	int texture,
+	int mesh,
+	float depth)
+{
+	uint64_t key = Field(pass, PASS_BITS) << PASS_SHIFT;
+
+	if ((texture + 1 >= (1 << TEXTURE_BITS)) && (g_bTextureClampReported.exchange(true) == false))
+	{
+		std::cout << "Texture index " << texture << " does not fit the sort keys, textures past " << ((1 << TEXTURE_BITS) - 2) << " share a key value" << std::endl;
+	}
+
+	if (bTransparent)
+	{
+		key |= ((uint64_t)1) << TRANSPARENT_SHIFT;
+		key |= ((uint64_t)(~DepthBits(depth))) << TRANSPARENT_DEPTH_SHIFT;
+		key |= Field(shaderVariant, VARIANT_BITS) << TRANSPARENT_VARIANT_SHIFT;
+		key |= Field(material + 1, MATERIAL_BITS) << TRANSPARENT_MATERIAL_SHIFT;
+		key |= Field(texture + 1, TEXTURE_BITS) << TRANSPARENT_TEXTURE_SHIFT;
+		key |= Field(mesh, MESH_BITS);
+	}
+	else
+	{
+		key |= Field(shaderVariant, VARIANT_BITS) << OPAQUE_VARIANT_SHIFT;
+		key |= Field(material + 1, MATERIAL_BITS) << OPAQUE_MATERIAL_SHIFT;
+		key |= Field(texture + 1, TEXTURE_BITS) << OPAQUE_TEXTURE_SHIFT;
+		key |= Field(mesh, MESH_BITS) << OPAQUE_MESH_SHIFT;
+		key |= (uint64_t)DepthBits(depth);
+	}
+
+	return(key);
+}
+
+/***********************************************************
+ *  GetKeyPass()
+ *
+ *  These methods are used for reading the fields back out
+ *  of a sort key.
+ ***********************************************************/
+int RenderQueue::GetKeyPass(uint64_t key)
+{
+	return(GetField(key, PASS_SHIFT, PASS_BITS));
+}
+
+bool RenderQueue::IsKeyTransparent(uint64_t key)
+{
+	return(GetField(key, TRANSPARENT_SHIFT, TRANSPARENT_BITS) != 0);
+}
+
+int RenderQueue::GetKeyShaderVariant(uint64_t key)
+{
+	int shift = IsKeyTransparent(key) ? TRANSPARENT_VARIANT_SHIFT : OPAQUE_VARIANT_SHIFT;
+	return(GetField(key, shift, VARIANT_BITS));
+}
+
+int RenderQueue::GetKeyMaterial(uint64_t key)
+{
+	int shift = IsKeyTransparent(key) ? TRANSPARENT_MATERIAL_SHIFT : OPAQUE_MATERIAL_SHIFT;
+	return(GetField(key, shift, MATERIAL_BITS) - 1);
+}
+
+int RenderQueue::GetKeyTexture(uint64_t key)
+{
+	int shift = IsKeyTransparent(key) ? TRANSPARENT_TEXTURE_SHIFT : OPAQUE_TEXTURE_SHIFT;
+	return(GetField(key, shift, TEXTURE_BITS) - 1);
+}
+
+int RenderQueue::GetKeyMesh(uint64_t key)
+{
+	int shift = IsKeyTransparent(key) ? 0 : OPAQUE_MESH_SHIFT;
+	return(GetField(key, shift, MESH_BITS));
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the items by their keys
+ *  with a least significant digit radix sort.  The counts of
+ *  all eight digits are gathered in one pass over the keys,
+ *  and digits that are the same for every key are skipped,
+ *  which is common since the high fields change little.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	size_t count = m_count;
+	if (count < 2)
+	{
+		return;
+	}
+
+	uint32_t histograms[RADIX_PASSES][RADIX_BUCKETS];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = m_keys[i];
+		for (int pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+		}
+	}
+
+	for (int pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		uint32_t* histogram = histograms[pass];
+		int shift = pass * RADIX_BITS;
+
+		// every key has the same digit - nothing would move
+		if (histogram[(m_keys[0] >> shift) & (RADIX_BUCKETS - 1)] == count)
+		{
+			continue;
+		}
+
+		// turn the counts into the first position of each digit
+		uint32_t offset = 0;
+		for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+		{
+			uint32_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t key = m_keys[i];
+			uint32_t position = histogram[(key >> shift) & (RADIX_BUCKETS - 1)]++;
+			m_sortKeys[position] = key;
+			m_sortObjectIndices[position] = m_objectIndices[i];
+		}
+
+		std::swap(m_keys, m_sortKeys);
+		std::swap(m_objectIndices, m_sortObjectIndices);
+	}
+}
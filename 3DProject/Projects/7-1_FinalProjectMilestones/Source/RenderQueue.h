@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// sorted list of the draws of one frame
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameArena.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects one 64 bit sort key per visible
+ *  object and sorts the keys with a radix sort, so the draws
+ *  can be submitted with as few state changes as possible.
+ *  The keys live in the frame arena, so filling the queue
+ *  does not touch the heap.
+ *
+ *  Opaque keys, from the highest bits down:
+ *    pass (2) | transparent = 0 (1) | shader variant (5) |
+ *    material (10) | texture (9) | mesh (5) | depth (32)
+ *  so opaque draws are grouped by state and then drawn front
+ *  to back.  Transparent keys put the depth first, inverted,
+ *  so they are drawn back to front across every variant:
+ *    pass (2) | transparent = 1 (1) | inverted depth (32) |
+ *    shader variant (5) | material (10) | texture (9) |
+ *    mesh (5)
+ *  The texture field holds no texture and the first 511
+ *  texture indices, 512 values in all.  Higher indices share
+ *  the last value and are reported once.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// the draws made while executing the queue, counted so
+	// the effect of the sorting can be seen
+	struct RENDER_STATS
+	{
+		int drawCount;
+		int programChanges;
+		int materialChanges;
+		int textureChanges;
+		int meshChanges;
+	};
+
+	// constructor
+	RenderQueue();
+
+	// remove the items of the previous frame and make room for
+	// the passed in number of items in the arena
+	void Reset(FrameArena* pArena, size_t capacity);
+	// add the draw of an object - items past the capacity are
+	// dropped
+	void Add(uint64_t key, uint32_t objectIndex);
+	// add the draws of several objects at once
+	void Append(const uint64_t* keys, const uint32_t* objectIndices, size_t count);
+	// sort the items by their keys
+	void Sort();
+
+	size_t GetCount() const { return m_count; }
+	uint64_t GetKey(size_t index) const { return m_keys[index]; }
+	uint32_t GetObjectIndex(size_t index) const { return m_objectIndices[index]; }
+
+	// build the sort keys - material and texture are indices
+	// where -1 means none, and the depth is the distance from
+	// the camera
+	static uint64_t MakeKey(
+		int pass,
+		bool bTransparent,
+		int shaderVariant,
+		int material,
+		int texture,
+		int mesh,
+		float depth);
+
+	// read the fields back out of a sort key
+	static int GetKeyPass(uint64_t key);
+	static bool IsKeyTransparent(uint64_t key);
+	static int GetKeyShaderVariant(uint64_t key);
+	static int GetKeyMaterial(uint64_t key);
+	static int GetKeyTexture(uint64_t key);
+	static int GetKeyMesh(uint64_t key);
+
+	// the state change counters of the current frame
+	RENDER_STATS& GetStats() { return m_stats; }
+	const RENDER_STATS& GetStats() const { return m_stats; }
+
+private:
+	uint64_t* m_keys;
+	uint32_t* m_objectIndices;
+	// ping pong buffers used by the radix sort
+	uint64_t* m_sortKeys;
+	uint32_t* m_sortObjectIndices;
+	size_t m_count;
+	size_t m_capacity;
+	RENDER_STATS m_stats;
+};
@@ -0,0 +1,1079 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneloader.cpp
+// ============
+// load scene descriptions from text or binary scene files
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneLoader.h"
+#include "ShapeMeshes.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+// declaration of global variables
+namespace
+{
+	// binary scene files start with this tag and version
+	const char g_BinaryMagic[4] = { 'S', 'C', 'N', 'B' };
+	const uint32_t g_BinaryVersion = 4;
+	// bytes stored per object in the binary format, one value
+	// of every per object array
+	const size_t g_BinaryObjectSize =
+		sizeof(uint8_t) +		// mesh
+		sizeof(uint8_t) +		// flags
+		sizeof(int32_t) +		// parent
+		sizeof(int16_t) +		// texture index
+		sizeof(int16_t) +		// material index
+		sizeof(glm::vec3) +		// scale
+		sizeof(glm::vec3) +		// rotation
+		sizeof(glm::vec3) +		// position
+		sizeof(glm::vec4) +		// color
+		sizeof(glm::vec2);		// UV scale
+
+	// the glm vectors are copied as raw arrays of floats
+	static_assert(sizeof(glm::vec2) == 2 * sizeof(float), "glm::vec2 must be tightly packed");
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 must be tightly packed");
+	static_assert(sizeof(glm::vec4) == 4 * sizeof(float), "glm::vec4 must be tightly packed");
+
+	// names of the shapes as written in the text format
+	struct SHAPE_NAME
+	{
+		const char* name;
+		ShapeMeshes::SHAPE_TYPE shape;
+	};
+	const SHAPE_NAME g_ShapeNames[] = {
+		{ "box", ShapeMeshes::SHAPE_BOX },
+		{ "cone", ShapeMeshes::SHAPE_CONE },
+		{ "cylinder", ShapeMeshes::SHAPE_CYLINDER },
+		{ "plane", ShapeMeshes::SHAPE_PLANE },
+		{ "prism", ShapeMeshes::SHAPE_PRISM },
+		{ "pyramid3", ShapeMeshes::SHAPE_PYRAMID3 },
+		{ "pyramid4", ShapeMeshes::SHAPE_PYRAMID4 },
+		{ "sphere", ShapeMeshes::SHAPE_SPHERE },
+		{ "taperedcylinder", ShapeMeshes::SHAPE_TAPERED_CYLINDER },
+		{ "torus", ShapeMeshes::SHAPE_TORUS }
+	};
+
+	/***********************************************************
+	 *  TOKEN
+	 *
+	 *  A word of a scene file line, pointing into the text.
+	 ***********************************************************/
+	struct TOKEN
+	{
+		const char* text;
+		size_t length;
+
+		bool Is(const char* word) const
+		{
+			return((strlen(word) == length) && (strncmp(text, word, length) == 0));
+		}
+		std::string ToString() const
+		{
+			return std::string(text, length);
+		}
+	};
+
+	// skip spaces up to the next word on the current line
+	void SkipSpaces(const char*& cursor)
+	{
+		while ((*cursor == ' ') || (*cursor == '\t') || (*cursor == '\r'))
+		{
+			cursor++;
+		}
+	}
+
+	// read the next word of the current line - comments that
+	// start with '#' run to the end of the line
+	bool NextToken(const char*& cursor, TOKEN& token)
+	{
+		SkipSpaces(cursor);
+		if ((*cursor == '\0') || (*cursor == '\n') || (*cursor == '#'))
+		{
+			return(false);
+		}
+
+		token.text = cursor;
+		while ((*cursor != '\0') && (*cursor != '\n') && (*cursor != ' ') &&
+			(*cursor != '\t') && (*cursor != '\r') && (*cursor != '#'))
+		{
+			cursor++;
+		}
+		token.length = cursor - token.text;
+		return(true);
+	}
+
+	// read a number of floats from the current line
+	bool ReadFloats(const char*& cursor, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			SkipSpaces(cursor);
+			char* end = NULL;
+			values[i] = strtof(cursor, &end);
+			if (end == cursor)
+			{
+				return(false);
+			}
+			cursor = end;
+		}
+		return(true);
+	}
+
+	bool ReadVec2(const char*& cursor, glm::vec2& value)
+	{
+		return(ReadFloats(cursor, &value[0], 2));
+	}
+
+	bool ReadVec3(const char*& cursor, glm::vec3& value)
+	{
+		return(ReadFloats(cursor, &value[0], 3));
+	}
+
+	bool ReadVec4(const char*& cursor, glm::vec4& value)
+	{
+		return(ReadFloats(cursor, &value[0], 4));
+	}
+
+	/***********************************************************
+	 *  BINARY_READER
+	 *
+	 *  Bounds checked reading from an in-memory binary file.
+	 ***********************************************************/
+	struct BINARY_READER
+	{
+		const char* cursor;
+		const char* end;
+
+		bool Read(void* destination, size_t size)
+		{
+			if ((size_t)(end - cursor) < size)
+			{
+				return(false);
+			}
+			if (size > 0)
+			{
+				memcpy(destination, cursor, size);
+			}
+			cursor += size;
+			return(true);
+		}
+
+		bool ReadString(std::string& value)
+		{
+			uint16_t length = 0;
+			if ((Read(&length, sizeof(length)) == false) || ((size_t)(end - cursor) < length))
+			{
+				return(false);
+			}
+			value.assign(cursor, length);
+			cursor += length;
+			return(true);
+		}
+
+		template<typename T>
+		bool ReadArray(std::vector<T>& values)
+		{
+			return(Read(values.data(), values.size() * sizeof(T)));
+		}
+	};
+
+	void WriteString(std::ofstream& file, const std::string& value)
+	{
+		uint16_t length = (uint16_t)value.size();
+		file.write((const char*)&length, sizeof(length));
+		file.write(value.data(), length);
+	}
+
+	template<typename T>
+	void WriteValue(std::ofstream& file, const T& value)
+	{
+		file.write((const char*)&value, sizeof(T));
+	}
+
+	template<typename T>
+	void WriteArray(std::ofstream& file, const std::vector<T>& values)
+	{
+		if (values.size() > 0)
+		{
+			file.write((const char*)values.data(), sizeof(T) * values.size());
+		}
+	}
+
+	// move the values of a per object array into a new order
+	template<typename T>
+	void Reorder(std::vector<T>& values, const std::vector<uint32_t>& order)
+	{
+		std::vector<T> reordered(values.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			reordered[i] = values[order[i]];
+		}
+		values.swap(reordered);
+	}
+
+	// find the index of a texture or material by its tag
+	template<typename T>
+	int FindTag(const std::vector<T>& list, const TOKEN& tag)
+	{
+		for (size_t i = 0; i < list.size(); i++)
+		{
+			if (tag.Is(list[i].tag.c_str()))
+			{
+				return((int)i);
+			}
+		}
+		return(-1);
+	}
+}
+
+/***********************************************************
+ *  SceneData()
+ *
+ *  The constructor for the structure
+ ***********************************************************/
+SceneData::SceneData()
+{
+	renderFlags = 0;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the scene data.
+ ***********************************************************/
+void SceneData::Clear()
+{
+	textures.clear();
+	materials.clear();
+	lights.clear();
+	renderFlags = 0;
+	ResizeObjects(0);
+}
+
+/***********************************************************
+ *  ResizeObjects()
+ *
+ *  This method is used for resizing all of the per object
+ *  arrays together.
+ ***********************************************************/
+void SceneData::ResizeObjects(size_t objectCount)
+{
+	meshes.resize(objectCount);
+	flags.resize(objectCount);
+	parents.resize(objectCount);
+	textureIndices.resize(objectCount);
+	materialIndices.resize(objectCount);
+	scales.resize(objectCount);
+	rotations.resize(objectCount);
+	positions.resize(objectCount);
+	colors.resize(objectCount);
+	uvScales.resize(objectCount);
+	modelMatrices.resize(objectCount);
+	boundsMin.resize(objectCount);
+	boundsMax.resize(objectCount);
+}
+
+/***********************************************************
+ *  CalculateModelMatrix()
+ *
+ *  This method is used for calculating the model matrix from
+ *  the passed in scale, rotation degrees and position.
+ ***********************************************************/
+glm::mat4 SceneData::CalculateModelMatrix(
+	const glm::vec3& scale,
+	const glm::vec3& rotationDegrees,
+	const glm::vec3& position)
+{
+	glm::mat4 rotationX = glm::rotate(glm::radians(rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	glm::mat4 rotationY = glm::rotate(glm::radians(rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 rotationZ = glm::rotate(glm::radians(rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	return(glm::translate(position) * rotationX * rotationY * rotationZ * glm::scale(scale));
+}
+
+/***********************************************************
+ *  SortBreadthFirst()
+ *
+ *  This method is used for reordering the objects so the
+ *  root objects come first, followed by their children, then
+ *  their grandchildren and so on, with the children of every
+ *  object next to each other.  The relative order of the
+ *  objects is kept otherwise.  Every parent must come before
+ *  its children when this is called.
+ ***********************************************************/
+void SceneData::SortBreadthFirst()
+{
+	size_t objectCount = GetObjectCount();
+
+	// in breadth first order the roots come first and the
+	// parents of the other objects never decrease
+	bool bSorted = true;
+	int lastParent = -1;
+	for (size_t i = 0; bSorted && (i < objectCount); i++)
+	{
+		bSorted = (parents[i] >= lastParent);
+		lastParent = parents[i];
+	}
+	if (bSorted)
+	{
+		return;
+	}
+
+	// list the children of every object, in object order
+	std::vector<uint32_t> childStart(objectCount + 1, 0);
+	std::vector<uint32_t> children(objectCount);
+	std::vector<uint32_t> order;
+	order.reserve(objectCount);
+
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		if (parents[i] >= 0)
+			childStart[parents[i] + 1]++;
+		else
+			order.push_back((uint32_t)i);
+	}
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		childStart[i + 1] += childStart[i];
+	}
+	std::vector<uint32_t> childFill(childStart.begin(), childStart.end() - 1);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		if (parents[i] >= 0)
+		{
+			children[childFill[parents[i]]++] = (uint32_t)i;
+		}
+	}
+
+	// the order list doubles as the breadth first queue
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		uint32_t index = order[i];
+		for (uint32_t child = childStart[index]; child < childStart[index + 1]; child++)
+		{
+			order.push_back(children[child]);
+		}
+	}
+
+	std::vector<int32_t> newIndices(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		newIndices[order[i]] = (int32_t)i;
+	}
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		if (parents[i] >= 0)
+		{
+			parents[i] = newIndices[parents[i]];
+		}
+	}
+
+	Reorder(meshes, order);
+	Reorder(flags, order);
+	Reorder(parents, order);
+	Reorder(textureIndices, order);
+	Reorder(materialIndices, order);
+	Reorder(scales, order);
+	Reorder(rotations, order);
+	Reorder(positions, order);
+	Reorder(colors, order);
+	Reorder(uvScales, order);
+}
+
+/***********************************************************
+ *  UpdateDerivedData()
+ *
+ *  This method is used for calculating the model matrix and
+ *  the world space bounding box of every object.  The box is
+ *  found from the center and the extents of the mesh bounds
+ *  so only one matrix multiply is needed per object.  The
+ *  objects must be in breadth first order.
+ ***********************************************************/
+void SceneData::UpdateDerivedData()
+{
+	size_t objectCount = GetObjectCount();
+	modelMatrices.resize(objectCount);
+	boundsMin.resize(objectCount);
+	boundsMax.resize(objectCount);
+
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		// parents come first, so their world matrix is ready
+		glm::mat4 model = CalculateModelMatrix(scales[i], rotations[i], positions[i]);
+		if (parents[i] >= 0)
+		{
+			model = modelMatrices[parents[i]] * model;
+		}
+		modelMatrices[i] = model;
+
+		// groups are not drawn, so their bounds are a point
+		if (meshes[i] == NO_MESH)
+		{
+			boundsMin[i] = glm::vec3(model[3]);
+			boundsMax[i] = glm::vec3(model[3]);
+			continue;
+		}
+
+		glm::vec3 localMin;
+		glm::vec3 localMax;
+		ShapeMeshes::GetShapeBounds((ShapeMeshes::SHAPE_TYPE)meshes[i], localMin, localMax);
+
+		glm::vec3 center = glm::vec3(model * glm::vec4((localMin + localMax) * 0.5f, 1.0f));
+		glm::vec3 halfSize = (localMax - localMin) * 0.5f;
+		glm::vec3 extents(0.0f);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			extents += glm::abs(glm::vec3(model[axis])) * halfSize[axis];
+		}
+
+		boundsMin[i] = center - extents;
+		boundsMax[i] = center + extents;
+	}
+}
+
+/***********************************************************
+ *  GetObjects()
+ *
+ *  This method is used for getting pointers to the per
+ *  object arrays.  They stay valid until the scene changes.
+ ***********************************************************/
+SCENE_OBJECTS SceneData::GetObjects() const
+{
+	SCENE_OBJECTS objects;
+	objects.count = GetObjectCount();
+	objects.meshes = meshes.data();
+	objects.flags = flags.data();
+	objects.parents = parents.data();
+	objects.textureIndices = textureIndices.data();
+	objects.materialIndices = materialIndices.data();
+	objects.scales = scales.data();
+	objects.rotations = rotations.data();
+	objects.positions = positions.data();
+	objects.colors = colors.data();
+	objects.uvScales = uvScales.data();
+	objects.modelMatrices = modelMatrices.data();
+	objects.boundsMin = boundsMin.data();
+	objects.boundsMax = boundsMax.data();
+	return(objects);
+}
+
+/***********************************************************
+ *  CheckIndices()
+ *
+ *  This method is used for checking the meshes, texture and
+ *  material indices and parents of every object, which is
+ *  needed before using scene data read from a binary file.
+ ***********************************************************/
+bool SceneData::CheckIndices() const
+{
+	for (size_t i = 0; i < GetObjectCount(); i++)
+	{
+		if (((meshes[i] >= ShapeMeshes::SHAPE_COUNT) && (meshes[i] != NO_MESH)) ||
+			(textureIndices[i] < -1) || (textureIndices[i] >= (int)textures.size()) ||
+			(materialIndices[i] < -1) || (materialIndices[i] >= (int)materials.size()) ||
+			(parents[i] < -1) || (parents[i] >= (int)i))
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  ReadFile()
+ *
+ *  This method is used for reading a whole file into memory.
+ *  A terminating zero is added so text can be parsed in
+ *  place.
+ ***********************************************************/
+bool SceneLoader::ReadFile(const char* filename, std::vector<char>& contents)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not open scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	file.seekg(0, std::ios::end);
+	size_t size = (size_t)file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	contents.resize(size + 1);
+	file.read(contents.data(), size);
+	contents[size] = '\0';
+
+	return((size_t)file.gcount() == size);
+}
+
+/***********************************************************
+ *  LoadScene()
+ *
+ *  This method is used for loading a scene file.  Files with
+ *  the .sceneb extension are read as binary scenes and all
+ *  other files are read as text scenes.  A binary scene that
+ *  is truncated or out of date is replaced by the text scene
+ *  it was exported from, the same name ending in .scene.
+ ***********************************************************/
+bool SceneLoader::LoadScene(const char* filename, SceneData& scene)
+{
+	size_t length = strlen(filename);
+	const char* binaryExtension = ".sceneb";
+	size_t extensionLength = strlen(binaryExtension);
+
+	if ((length >= extensionLength) && (strcmp(filename + length - extensionLength, binaryExtension) == 0))
+	{
+		if (LoadBinaryScene(filename, scene) == true)
+		{
+			return(true);
+		}
+
+		std::string textFilename(filename, length - 1);
+		std::cout << "Falling back to text scene file:" << textFilename << std::endl;
+		return(LoadTextScene(textFilename.c_str(), scene));
+	}
+
+	return(LoadTextScene(filename, scene));
+}
+
+/***********************************************************
+ *  LoadTextScene()
+ *
+ *  This method is used for loading a scene from the text
+ *  format.  Texture filenames are relative to the folder of
+ *  the scene file.
+ ***********************************************************/
+bool SceneLoader::LoadTextScene(const char* filename, SceneData& scene)
+{
+	std::vector<char> text;
+	if (ReadFile(filename, text) == false)
+	{
+		return(false);
+	}
+
+	std::string directory(filename);
+	size_t separator = directory.find_last_of("/\\");
+	directory = (separator == std::string::npos) ? std::string() : directory.substr(0, separator + 1);
+
+	scene.Clear();
+	if (ParseText(text.data(), directory, scene) == false)
+	{
+		std::cout << "Could not parse scene file:" << filename << std::endl;
+		scene.Clear();
+		return(false);
+	}
+	scene.SortBreadthFirst();
+	scene.UpdateDerivedData();
+
+	std::cout << "Successfully loaded scene:" << filename << ", objects:" << scene.GetObjectCount() << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  ParseText()
+ *
+ *  This method is used for parsing the text scene format.
+ *  Every line holds one entry - a keyword followed by values
+ *  or by pairs of a property name and its values:
+ *
+ *  texture <tag> <filename>
+ *  material <tag> ambient r g b strength s diffuse r g b
+ *           specular r g b shininess s
+ *  light position x y z direction x y z ambient r g b
+ *        diffuse r g b specular r g b focal f intensity i
+ *        range r
+ *  object <shape> scale x y z rotation x y z position x y z
+ *         texture <tag> material <tag> color r g b a
+ *         uvscale u v occluder transparent static
+ *         name <name> parent <name>
+ *  group <name> scale x y z rotation x y z position x y z
+ *        parent <name>
+ *  render depthprepass lightmaps
+ *
+ *  Textures, materials and parents must be defined before
+ *  they are used by an object.  The transform of an object
+ *  with a parent is relative to the parent, and groups are
+ *  named transforms that are not drawn.  Objects with a color
+ *  alpha below one are transparent, and static objects must
+ *  not be moved after loading.  Lights with a range are
+ *  point lights that do not reach past it.  The render line
+ *  turns on scene wide render settings.  Properties that
+ *  are left out keep their default values.
+ ***********************************************************/
+bool SceneLoader::ParseText(const char* text, const std::string& directory, SceneData& scene)
+{
+	// an upper bound for the object count avoids regrowing
+	// the object arrays while parsing large scenes
+	size_t lineCount = 1;
+	for (const char* scan = text; *scan != '\0'; scan++)
+	{
+		if (*scan == '\n')
+		{
+			lineCount++;
+		}
+	}
+	scene.meshes.reserve(lineCount);
+	scene.flags.reserve(lineCount);
+	scene.parents.reserve(lineCount);
+	scene.textureIndices.reserve(lineCount);
+	scene.materialIndices.reserve(lineCount);
+	scene.scales.reserve(lineCount);
+	scene.rotations.reserve(lineCount);
+	scene.positions.reserve(lineCount);
+	scene.colors.reserve(lineCount);
+	scene.uvScales.reserve(lineCount);
+
+	// object index of every named object or group
+	std::unordered_map<std::string, int32_t> objectNames;
+
+	const char* cursor = text;
+	int lineNumber = 0;
+	TOKEN keyword;
+	TOKEN token;
+
+	while (*cursor != '\0')
+	{
+		lineNumber++;
+		bool bValid = true;
+
+		if (NextToken(cursor, keyword) == true)
+		{
+			if (keyword.Is("object") || keyword.Is("group"))
+			{
+				bool bGroup = keyword.Is("group");
+				std::string name;
+				int shape = SceneData::NO_MESH;
+
+				bValid = NextToken(cursor, token);
+				if (bGroup)
+				{
+					name = bValid ? token.ToString() : std::string();
+				}
+				else
+				{
+					shape = -1;
+					for (size_t i = 0; bValid && (i < sizeof(g_ShapeNames) / sizeof(g_ShapeNames[0])); i++)
+					{
+						if (token.Is(g_ShapeNames[i].name))
+						{
+							shape = g_ShapeNames[i].shape;
+						}
+					}
+					bValid = bValid && (shape >= 0);
+				}
+
+				uint8_t flags = 0;
+				int32_t parent = -1;
+				int16_t textureIndex = -1;
+				int16_t materialIndex = -1;
+				glm::vec3 scale(1.0f);
+				glm::vec3 rotation(0.0f);
+				glm::vec3 position(0.0f);
+				glm::vec4 color(1.0f);
+				glm::vec2 uvScale(1.0f);
+
+				while (bValid && NextToken(cursor, token))
+				{
+					if (token.Is("scale"))
+						bValid = ReadVec3(cursor, scale);
+					else if (token.Is("rotation"))
+						bValid = ReadVec3(cursor, rotation);
+					else if (token.Is("position"))
+						bValid = ReadVec3(cursor, position);
+					else if (token.Is("color"))
+						bValid = ReadVec4(cursor, color);
+					else if (token.Is("parent"))
+					{
+						bValid = NextToken(cursor, token);
+						std::unordered_map<std::string, int32_t>::const_iterator found =
+							bValid ? objectNames.find(token.ToString()) : objectNames.end();
+						bValid = bValid && (found != objectNames.end());
+						parent = bValid ? found->second : -1;
+					}
+					else if (bGroup)
+						bValid = false;
+					else if (token.Is("uvscale"))
+						bValid = ReadVec2(cursor, uvScale);
+					else if (token.Is("occluder"))
+						flags |= SceneData::OBJECT_OCCLUDER;
+					else if (token.Is("transparent"))
+						flags |= SceneData::OBJECT_TRANSPARENT;
+					else if (token.Is("static"))
+						flags |= SceneData::OBJECT_STATIC;
+					else if (token.Is("name"))
+					{
+						bValid = NextToken(cursor, token);
+						name = bValid ? token.ToString() : std::string();
+					}
+					else if (token.Is("texture"))
+					{
+						bValid = NextToken(cursor, token);
+						textureIndex = bValid ? (int16_t)FindTag(scene.textures, token) : -1;
+						bValid = bValid && (textureIndex >= 0);
+					}
+					else if (token.Is("material"))
+					{
+						bValid = NextToken(cursor, token);
+						materialIndex = bValid ? (int16_t)FindTag(scene.materials, token) : -1;
+						bValid = bValid && (materialIndex >= 0);
+					}
+					else
+						bValid = false;
+				}
+
+				// only boxes and planes have a matching occluder proxy
+				if ((flags & SceneData::OBJECT_OCCLUDER) &&
+					(shape != ShapeMeshes::SHAPE_BOX) && (shape != ShapeMeshes::SHAPE_PLANE))
+				{
+					std::cout << "Scene line " << lineNumber << ": only boxes and planes can be occluders" << std::endl;
+					flags &= ~SceneData::OBJECT_OCCLUDER;
+				}
+
+				if ((textureIndex < 0) && (color.a < 1.0f))
+				{
+					flags |= SceneData::OBJECT_TRANSPARENT;
+				}
+
+				// names have to be unique to find the parents
+				if (bValid && (name.empty() == false))
+				{
+					bValid = objectNames.insert(std::make_pair(name, (int32_t)scene.meshes.size())).second;
+				}
+
+				if (bValid)
+				{
+					scene.meshes.push_back((uint8_t)shape);
+					scene.flags.push_back(flags);
+					scene.parents.push_back(parent);
+					scene.textureIndices.push_back(textureIndex);
+					scene.materialIndices.push_back(materialIndex);
+					scene.scales.push_back(scale);
+					scene.rotations.push_back(rotation);
+					scene.positions.push_back(position);
+					scene.colors.push_back(color);
+					scene.uvScales.push_back(uvScale);
+				}
+			}
+			else if (keyword.Is("render"))
+			{
+				while (bValid && NextToken(cursor, token))
+				{
+					if (token.Is("depthprepass"))
+						scene.renderFlags |= SceneData::RENDER_DEPTH_PREPASS;
+					else if (token.Is("lightmaps"))
+						scene.renderFlags |= SceneData::RENDER_LIGHTMAPS;
+					else
+						bValid = false;
+				}
+			}
+			else if (keyword.Is("texture"))
+			{
+				SceneData::TEXTURE texture;
+				TOKEN tag;
+				bValid = NextToken(cursor, tag) && NextToken(cursor, token);
+				if (bValid)
+				{
+					texture.tag = tag.ToString();
+					texture.filename = token.ToString();
+					// relative filenames start from the scene folder
+					if ((texture.filename[0] != '/') && (texture.filename[0] != '\\') &&
+						(texture.filename.find(':') == std::string::npos))
+					{
+						texture.filename = directory + texture.filename;
+					}
+					scene.textures.push_back(texture);
+				}
+			}
+			else if (keyword.Is("material"))
+			{
+				SceneData::MATERIAL material;
+				material.ambientStrength = 0.0f;
+				material.ambientColor = glm::vec3(0.0f);
+				material.diffuseColor = glm::vec3(1.0f);
+				material.specularColor = glm::vec3(0.0f);
+				material.shininess = 1.0f;
+
+				bValid = NextToken(cursor, token);
+				if (bValid)
+				{
+					material.tag = token.ToString();
+				}
+				while (bValid && NextToken(cursor, token))
+				{
+					if (token.Is("ambient"))
+						bValid = ReadVec3(cursor, material.ambientColor);
+					else if (token.Is("strength"))
+						bValid = ReadFloats(cursor, &material.ambientStrength, 1);
+					else if (token.Is("diffuse"))
+						bValid = ReadVec3(cursor, material.diffuseColor);
+					else if (token.Is("specular"))
+						bValid = ReadVec3(cursor, material.specularColor);
+					else if (token.Is("shininess"))
+						bValid = ReadFloats(cursor, &material.shininess, 1);
+					else
+						bValid = false;
+				}
+				if (bValid)
+				{
+					scene.materials.push_back(material);
+				}
+			}
+			else if (keyword.Is("light"))
+			{
+				SceneData::LIGHT light;
+				light.position = glm::vec3(0.0f);
+				light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+				light.ambientColor = glm::vec3(0.0f);
+				light.diffuseColor = glm::vec3(1.0f);
+				light.specularColor = glm::vec3(1.0f);
+				light.focalStrength = 32.0f;
+				light.specularIntensity = 1.0f;
+				light.range = 0.0f;
+
+				while (bValid && NextToken(cursor, token))
+				{
+					if (token.Is("position"))
+						bValid = ReadVec3(cursor, light.position);
+					else if (token.Is("direction"))
+						bValid = ReadVec3(cursor, light.direction);
+					else if (token.Is("ambient"))
+						bValid = ReadVec3(cursor, light.ambientColor);
+					else if (token.Is("diffuse"))
+						bValid = ReadVec3(cursor, light.diffuseColor);
+					else if (token.Is("specular"))
+						bValid = ReadVec3(cursor, light.specularColor);
+					else if (token.Is("focal"))
+						bValid = ReadFloats(cursor, &light.focalStrength, 1);
+					else if (token.Is("intensity"))
+						bValid = ReadFloats(cursor, &light.specularIntensity, 1);
+					else if (token.Is("range"))
+						bValid = ReadFloats(cursor, &light.range, 1);
+					else
+						bValid = false;
+				}
+				if (bValid)
+				{
+					scene.lights.push_back(light);
+				}
+			}
+			else
+			{
+				bValid = false;
+			}
+		}
+
+		if (bValid == false)
+		{
+			std::cout << "Scene line " << lineNumber << ": could not be parsed" << std::endl;
+			return(false);
+		}
+
+		// move on to the start of the next line
+		while ((*cursor != '\0') && (*cursor != '\n'))
+		{
+			cursor++;
+		}
+		if (*cursor == '\n')
+		{
+			cursor++;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadBinaryScene()
+ *
+ *  This method is used for loading a scene from the binary
+ *  format.  The file holds the shared resources followed by
+ *  every per object array as one block, in the byte order
+ *  of the machine that wrote it (little endian).
+ ***********************************************************/
+bool SceneLoader::LoadBinaryScene(const char* filename, SceneData& scene)
+{
+	std::vector<char> contents;
+	if (ReadFile(filename, contents) == false)
+	{
+		return(false);
+	}
+
+	BINARY_READER reader;
+	reader.cursor = contents.data();
+	reader.end = contents.data() + contents.size() - 1;
+
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t textureCount = 0;
+	uint32_t materialCount = 0;
+	uint32_t lightCount = 0;
+	uint32_t objectCount = 0;
+	uint32_t renderFlags = 0;
+
+	bool bValid = reader.Read(magic, sizeof(magic)) &&
+		(memcmp(magic, g_BinaryMagic, sizeof(magic)) == 0) &&
+		reader.Read(&version, sizeof(version)) &&
+		(version == g_BinaryVersion) &&
+		reader.Read(&textureCount, sizeof(textureCount)) &&
+		reader.Read(&materialCount, sizeof(materialCount)) &&
+		reader.Read(&lightCount, sizeof(lightCount)) &&
+		reader.Read(&objectCount, sizeof(objectCount)) &&
+		reader.Read(&renderFlags, sizeof(renderFlags));
+
+	scene.Clear();
+	scene.renderFlags = renderFlags;
+
+	for (uint32_t i = 0; bValid && (i < textureCount); i++)
+	{
+		SceneData::TEXTURE texture;
+		bValid = reader.ReadString(texture.tag) && reader.ReadString(texture.filename);
+		scene.textures.push_back(texture);
+	}
+
+	for (uint32_t i = 0; bValid && (i < materialCount); i++)
+	{
+		SceneData::MATERIAL material;
+		bValid = reader.ReadString(material.tag) &&
+			reader.Read(&material.ambientStrength, sizeof(float)) &&
+			reader.Read(&material.ambientColor, sizeof(glm::vec3)) &&
+			reader.Read(&material.diffuseColor, sizeof(glm::vec3)) &&
+			reader.Read(&material.specularColor, sizeof(glm::vec3)) &&
+			reader.Read(&material.shininess, sizeof(float));
+		scene.materials.push_back(material);
+	}
+
+	for (uint32_t i = 0; bValid && (i < lightCount); i++)
+	{
+		SceneData::LIGHT light;
+		bValid = reader.Read(&light.position, sizeof(glm::vec3)) &&
+			reader.Read(&light.direction, sizeof(glm::vec3)) &&
+			reader.Read(&light.ambientColor, sizeof(glm::vec3)) &&
+			reader.Read(&light.diffuseColor, sizeof(glm::vec3)) &&
+			reader.Read(&light.specularColor, sizeof(glm::vec3)) &&
+			reader.Read(&light.focalStrength, sizeof(float)) &&
+			reader.Read(&light.specularIntensity, sizeof(float)) &&
+			reader.Read(&light.range, sizeof(float));
+		scene.lights.push_back(light);
+	}
+
+	// the object count is checked against the bytes left
+	// before any array is sized, so a corrupt count fails the
+	// load instead of the allocation
+	bValid = bValid && ((size_t)(reader.end - reader.cursor) / g_BinaryObjectSize >= objectCount);
+
+	if (bValid)
+	{
+		scene.ResizeObjects(objectCount);
+		bValid = reader.ReadArray(scene.meshes) &&
+			reader.ReadArray(scene.flags) &&
+			reader.ReadArray(scene.parents) &&
+			reader.ReadArray(scene.textureIndices) &&
+			reader.ReadArray(scene.materialIndices) &&
+			reader.ReadArray(scene.scales) &&
+			reader.ReadArray(scene.rotations) &&
+			reader.ReadArray(scene.positions) &&
+			reader.ReadArray(scene.colors) &&
+			reader.ReadArray(scene.uvScales) &&
+			scene.CheckIndices();
+	}
+
+	if (bValid == false)
+	{
+		std::cout << "Could not parse binary scene file:" << filename << std::endl;
+		scene.Clear();
+		return(false);
+	}
+	scene.SortBreadthFirst();
+	scene.UpdateDerivedData();
+
+	std::cout << "Successfully loaded scene:" << filename << ", objects:" << scene.GetObjectCount() << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  SaveBinaryScene()
+ *
+ *  This method is used for saving a scene in the binary
+ *  format read by LoadBinaryScene().
+ ***********************************************************/
+bool SceneLoader::SaveBinaryScene(const char* filename, const SceneData& scene)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not create scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	uint32_t textureCount = (uint32_t)scene.textures.size();
+	uint32_t materialCount = (uint32_t)scene.materials.size();
+	uint32_t lightCount = (uint32_t)scene.lights.size();
+	uint32_t objectCount = (uint32_t)scene.GetObjectCount();
+
+	file.write(g_BinaryMagic, sizeof(g_BinaryMagic));
+	WriteValue(file, g_BinaryVersion);
+	WriteValue(file, textureCount);
+	WriteValue(file, materialCount);
+	WriteValue(file, lightCount);
+	WriteValue(file, objectCount);
+	WriteValue(file, scene.renderFlags);
+
+	for (size_t i = 0; i < scene.textures.size(); i++)
+	{
+		WriteString(file, scene.textures[i].tag);
+		WriteString(file, scene.textures[i].filename);
+	}
+
+	for (size_t i = 0; i < scene.materials.size(); i++)
+	{
+		const SceneData::MATERIAL& material = scene.materials[i];
+		WriteString(file, material.tag);
+		WriteValue(file, material.ambientStrength);
+		WriteValue(file, material.ambientColor);
+		WriteValue(file, material.diffuseColor);
+		WriteValue(file, material.specularColor);
+		WriteValue(file, material.shininess);
+	}
+
+	for (size_t i = 0; i < scene.lights.size(); i++)
+	{
+		const SceneData::LIGHT& light = scene.lights[i];
+		WriteValue(file, light.position);
+		WriteValue(file, light.direction);
+		WriteValue(file, light.ambientColor);
+		WriteValue(file, light.diffuseColor);
+		WriteValue(file, light.specularColor);
+		WriteValue(file, light.focalStrength);
+		WriteValue(file, light.specularIntensity);
+		WriteValue(file, light.range);
+	}
+
+	WriteArray(file, scene.meshes);
+	WriteArray(file, scene.flags);
+	WriteArray(file, scene.parents);
+	WriteArray(file, scene.textureIndices);
+	WriteArray(file, scene.materialIndices);
+	WriteArray(file, scene.scales);
+	WriteArray(file, scene.rotations);
+	WriteArray(file, scene.positions);
+	WriteArray(file, scene.colors);
+	WriteArray(file, scene.uvScales);
+
+	bool bSuccess = file.good();
+	file.close();
+
+	if (bSuccess == false)
+	{
+		std::cout << "Could not write scene file:" << filename << std::endl;
+	}
+	return(bSuccess);
+}
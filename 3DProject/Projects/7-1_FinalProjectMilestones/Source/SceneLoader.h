@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneloader.h
+// ============
+// load scene descriptions from text or binary scene files
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SCENE_OBJECTS
+ *
+ *  This structure points at the per object arrays of a scene
+ *  wherever they are stored - in a SceneData or directly in
+ *  a memory mapped scene snapshot.
+ ***********************************************************/
+struct SCENE_OBJECTS
+{
+	size_t count;
+	const uint8_t* meshes;
+	const uint8_t* flags;
+	const int32_t* parents;
+	const int16_t* textureIndices;
+	const int16_t* materialIndices;
+	const glm::vec3* scales;
+	const glm::vec3* rotations;
+	const glm::vec3* positions;
+	const glm::vec4* colors;
+	const glm::vec2* uvScales;
+	const glm::mat4* modelMatrices;
+	const glm::vec3* boundsMin;
+	const glm::vec3* boundsMax;
+};
+
+/***********************************************************
+ *  SceneData
+ *
+ *  This structure holds everything needed for rendering a
+ *  3D scene.  The shared resources are stored as lists and
+ *  the objects are stored as parallel arrays (one entry per
+ *  object in every array) so the render loop only touches
+ *  the data that it needs.
+ ***********************************************************/
+struct SceneData
+{
+	struct TEXTURE
+	{
+		std::string tag;
+		std::string filename;
+	};
+
+	struct MATERIAL
+	{
+		float ambientStrength;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+		std::string tag;
+	};
+
+	struct LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 direction;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+		// point lights with a range are shaded per cluster, a
+		// range of zero lights the whole scene
+		float range;
+	};
+
+	// bits of the per object flags
+	enum OBJECT_FLAGS
+	{
+		OBJECT_OCCLUDER = 0x01,		// rasterized for occlusion culling
+		OBJECT_TRANSPARENT = 0x02,	// blended and drawn back to front
+		OBJECT_STATIC = 0x04		// never moves, merged into static batches
+	};
+
+	// bits of the scene wide render settings
+	enum RENDER_FLAGS
+	{
+		RENDER_DEPTH_PREPASS = 0x01,	// lay down depth before shading
+		RENDER_LIGHTMAPS = 0x02		// bake the light of the static objects
+	};
+
+	// mesh value of group objects, which only hold a transform
+	// for their children and are not drawn
+	enum { NO_MESH = 0xFF };
+
+	// constructor
+	SceneData();
+
+	// shared scene resources
+	std::vector<TEXTURE> textures;
+	std::vector<MATERIAL> materials;
+	std::vector<LIGHT> lights;
+	uint32_t renderFlags;				// RENDER_FLAGS bits
+
+	// per object data - a texture or material index of -1
+	// means the object does not use one.  The objects are
+	// kept in breadth first order and the transform of an
+	// object with a parent is relative to that parent.
+	std::vector<uint8_t> meshes;			// ShapeMeshes::SHAPE_TYPE or NO_MESH
+	std::vector<uint8_t> flags;				// OBJECT_FLAGS bits
+	std::vector<int32_t> parents;			// parent object or -1
+	std::vector<int16_t> textureIndices;
+	std::vector<int16_t> materialIndices;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::vec3> rotations;		// degrees around X, Y and Z
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec4> colors;			// used when there is no texture
+	std::vector<glm::vec2> uvScales;
+
+	// per object data calculated from the values above
+	std::vector<glm::mat4> modelMatrices;
+	std::vector<glm::vec3> boundsMin;		// world space bounding box
+	std::vector<glm::vec3> boundsMax;
+
+	size_t GetObjectCount() const { return meshes.size(); }
+	void Clear();
+	void ResizeObjects(size_t objectCount);
+	// check that all of the indices stored per object are
+	// in range and that every parent comes before its children
+	bool CheckIndices() const;
+	// reorder the objects into breadth first order
+	void SortBreadthFirst();
+	// calculate the model matrices and world space bounds
+	void UpdateDerivedData();
+	// get pointers to the per object arrays
+	SCENE_OBJECTS GetObjects() const;
+
+	// calculate a model matrix from scale, rotation and position
+	static glm::mat4 CalculateModelMatrix(
+		const glm::vec3& scale,
+		const glm::vec3& rotationDegrees,
+		const glm::vec3& position);
+};
+
+/***********************************************************
+ *  SceneLoader
+ *
+ *  This class reads scene files into SceneData.  Two formats
+ *  are supported: a readable text format (.scene) that is
+ *  meant to be edited by hand, and a binary format
+ *  (.sceneb) that is loaded with one copy per array.
+ ***********************************************************/
+class SceneLoader
+{
+public:
+	// load a scene, choosing the format from the file extension
+	// - a binary scene that cannot be used falls back to the
+	// text scene of the same name
+	bool LoadScene(const char* filename, SceneData& scene);
+
+	// load a scene from the readable text format
+	bool LoadTextScene(const char* filename, SceneData& scene);
+	// load a scene from the binary format
+	bool LoadBinaryScene(const char* filename, SceneData& scene);
+	// save a scene in the binary format
+	bool SaveBinaryScene(const char* filename, const SceneData& scene);
+
+private:
+	// parse the text of a scene file
+	bool ParseText(const char* text, const std::string& directory, SceneData& scene);
+	// read a whole file into memory
+	bool ReadFile(const char* filename, std::vector<char>& contents);
+};
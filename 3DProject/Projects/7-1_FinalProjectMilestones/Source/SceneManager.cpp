@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "ShaderPreprocessor.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -15,15 +16,84 @@
 #endif
 
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
 
 // declaration of global variables
 namespace
 {
 	const char* g_ModelName = "model";
+	const char* g_ModelViewProjectionName = "modelViewProjection";
+	const char* g_NormalMatrixName = "normalMatrix";
 	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	const char* g_ViewName = "view";
+	const char* g_ViewPositionName = "viewPosition";
+	const char* g_ClusterCountsName = "clusterCounts";
+	const char* g_ClusterTileSizeName = "clusterTileSize";
+	const char* g_ClusterNearName = "clusterNear";
+	const char* g_ClusterDepthScaleName = "clusterDepthScale";
+	const char* g_MaterialIndexName = "materialIndex";
+	const char* g_LightmapValueName = "lightmapTexture";
+	const char* g_LightmapTag = "lightmap";
+
+	// fields of the lightSources uniform array, in the order
+	// they are set
+	const char* g_LightFieldNames[] =
+	{
+		"position",
+		"direction",
+		"ambientColor",
+		"diffuseColor",
+		"specularColor",
+		"focalStrength",
+		"specularIntensity"
+	};
+	const size_t g_LightFieldCount = sizeof(g_LightFieldNames) / sizeof(g_LightFieldNames[0]);
+
+	// defines of the shader feature bits, in bit order
+	const char* g_ShaderFeatureNames[] =
+	{
+		"USE_TEXTURE",
+		"USE_LIGHTING",
+		"USE_CLUSTERED_LIGHTS",
+		"WRITE_GBUFFER",
+		"USE_LIGHTMAP"
+	};
+
+	// scene loaded when no scene file is passed in
+	const char* g_DefaultSceneName = "../../Utilities/scenes/room.scene";
+	// number of scene wide light sources supported by the
+	// fragment shader - point lights with a range are not
+	// limited, they are shaded per cluster
+	const size_t g_MaxLights = 4;
+	// number of texture slots available for scene textures
+	const int g_MaxTextures = 16;
+	// objects culled by one worker task
+	const size_t g_CullChunkSize = 1024;
+	// sorted draws recorded into one command list
+	const size_t g_RecordChunkSize = 256;
+	// size of the grid cells that split the static batches
+	const float g_StaticBatchCellSize = 10.0f;
+	// shaders of the lighting pass of the deferred path
+	const char* g_DeferredVertexShaderName = "../../Utilities/shaders/deferredVertexShader.glsl";
+	const char* g_DeferredLightingShaderName = "../../Utilities/shaders/deferredLightingShader.glsl";
+	// shaders of the depth pre-pass
+	const char* g_DepthVertexShaderName = "../../Utilities/shaders/depthVertexShader.glsl";
+	const char* g_DepthFragmentShaderName = "../../Utilities/shaders/depthFragmentShader.glsl";
+
+	// mix the passed in floats into the hash of a scene
+	uint64_t HashFloats(const float* values, size_t count, uint64_t hash)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t bits;
+			memcpy(&bits, &values[i], sizeof(bits));
+			hash = ShaderPreprocessor::HashValue(bits, hash);
+		}
+		return(hash);
+	}
 }
 
 /***********************************************************
@@ -31,10 +101,43 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderManager *pShaderManager, ShaderRegistry* pShaderRegistry)
 {
 	m_pShaderManager = pShaderManager;
+	m_pShaderRegistry = pShaderRegistry;
 	m_basicMeshes = new ShapeMeshes();
+	m_loadedTextures = 0;
+	m_pThreadPool = new ThreadPool();
+	m_pOcclusionCuller = new OcclusionCuller(m_pThreadPool);
+	m_pClusteredLighting = new ClusteredLighting(m_pThreadPool);
+	m_pDeferredRenderer = NULL;
+	m_bGeometryPassActive = false;
+	m_pDepthPrepass = NULL;
+	m_bDepthPrepassActive = false;
+	m_pSoftwareRenderer = NULL;
+	m_pPathTracer = NULL;
+	m_sceneShaderFeatures = 0;
+	m_lightmapSlot = -1;
+	m_clusterTileSize = glm::vec2(1.0f);
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_bViewUniformsDirty = true;
+	m_modelMatrix = glm::mat4(1.0f);
+	m_objects = m_scene.GetObjects();
+	m_pChunkKeys = NULL;
+	m_pChunkObjects = NULL;
+	m_pChunkCounts = NULL;
+	m_pCommandLists = NULL;
+	m_pModelViewProjections = NULL;
+	m_pNormalMatrices = NULL;
+	m_pFileWatcher = NULL;
+
+	m_pShaderManager->SetVariantFeatures(
+		g_ShaderFeatureNames,
+		sizeof(g_ShaderFeatureNames) / sizeof(g_ShaderFeatureNames[0]));
+	// a variant writing the G-buffer cannot stand in for one
+	// drawing to the window, or the other way around
+	m_pShaderManager->SetFallbackRequiredFeatures(FEATURE_GBUFFER);
 }
 
 /***********************************************************
@@ -44,9 +147,32 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	// the images still being decoded are waited for and freed
+	for (size_t i = 0; i < m_textureReloads.size(); i++)
+	{
+		stbi_image_free(m_textureReloads[i].image.get().pixels);
+	}
+	m_textureReloads.clear();
+	delete m_pFileWatcher;
+	m_pFileWatcher = NULL;
+
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_pOcclusionCuller;
+	m_pOcclusionCuller = NULL;
+	delete m_pClusteredLighting;
+	m_pClusteredLighting = NULL;
+	delete m_pDeferredRenderer;
+	m_pDeferredRenderer = NULL;
+	delete m_pDepthPrepass;
+	m_pDepthPrepass = NULL;
+	delete m_pSoftwareRenderer;
+	m_pSoftwareRenderer = NULL;
+	delete m_pPathTracer;
+	m_pPathTracer = NULL;
+	delete m_pThreadPool;
+	m_pThreadPool = NULL;
 }
 
 /***********************************************************
@@ -105,6 +231,16 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		// generate the texture mipmaps for mapping textures to lower resolutions
 		glGenerateMipmap(GL_TEXTURE_2D);
 
+		// the renderers on the CPU keep their own copies of the texels
+		if (NULL != m_pSoftwareRenderer)
+		{
+			m_pSoftwareRenderer->SetTexture(m_loadedTextures, image, width, height, colorChannels);
+		}
+		if (NULL != m_pPathTracer)
+		{
+			m_pPathTracer->SetTexture(m_loadedTextures, image, width, height, colorChannels);
+		}
+
 		// free the image data from local memory
 		stbi_image_free(image);
 		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
@@ -153,13 +289,82 @@ void SceneManager::DestroyGLTextures()
 	}
 }
 
+/***********************************************************
+ *  DecodeTextureImage()
+ *
+ *  This method is used for reading a texture image file
+ *  without touching OpenGL, so it can run in the
+ *  background.  The pixels are NULL when the file cannot be
+ *  read, which happens while it is still being written.
+ ***********************************************************/
+SceneManager::TEXTURE_IMAGE SceneManager::DecodeTextureImage(std::string filename)
+{
+	TEXTURE_IMAGE image;
+	image.width = 0;
+	image.height = 0;
+	image.channels = 0;
+	image.pixels = stbi_load(
+		filename.c_str(),
+		&image.width,
+		&image.height,
+		&image.channels,
+		0);
+
+	return(image);
+}
+
+/***********************************************************
+ *  ReplaceGLTexture()
+ *
+ *  This method is used for loading a new image into the
+ *  texture of the passed in slot.  The texture object is
+ *  kept, so everything drawing with the slot picks up the
+ *  new image, and an image that cannot be used leaves the
+ *  old one in place.
+ ***********************************************************/
+bool SceneManager::ReplaceGLTexture(int slot, const TEXTURE_IMAGE& image)
+{
+	GLenum internalFormat = GL_RGB8;
+	GLenum format = GL_RGB;
+	if (image.channels == 4)
+	{
+		internalFormat = GL_RGBA8;
+		format = GL_RGBA;
+	}
+	else if (image.channels != 3)
+	{
+		std::cout << "Not implemented to handle image with " << image.channels << " channels" << std::endl;
+		return(false);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_textureIDs[slot].ID);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	// the slot keeps the texture bound to its unit
+	glActiveTexture(GL_TEXTURE0 + slot);
+	glBindTexture(GL_TEXTURE_2D, m_textureIDs[slot].ID);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (NULL != m_pSoftwareRenderer)
+	{
+		m_pSoftwareRenderer->SetTexture(slot, image.pixels, image.width, image.height, image.channels);
+	}
+	if (NULL != m_pPathTracer)
+	{
+		m_pPathTracer->SetTexture(slot, image.pixels, image.width, image.height, image.channels);
+	}
+
+	return(true);
+}
+
 /***********************************************************
  *  FindTextureID()
  *
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const char* tag)
 {
 	int textureID = -1;
 	int index = 0;
@@ -185,7 +390,7 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const char* tag)
 {
 	int textureSlot = -1;
 	int index = 0;
@@ -211,7 +416,7 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const char* tag, OBJECT_MATERIAL& material)
 {
 	if (m_objectMaterials.size() == 0)
 	{
@@ -240,6 +445,51 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 	return(true);
 }
 
+/***********************************************************
+ *  SetModelMatrix()
+ *
+ *  This method is used for setting an already calculated
+ *  model matrix into the transform buffer.
+ ***********************************************************/
+void SceneManager::SetModelMatrix(
+	const glm::mat4& model)
+{
+	const glm::mat4* pModel = &model;
+	glm::mat4 modelViewProjection;
+	glm::mat3 normalMatrix;
+	TransformStore::ComputeDrawMatrices(
+		m_projectionMatrix * m_viewMatrix,
+		&pModel,
+		1,
+		&modelViewProjection,
+		&normalMatrix);
+
+	SetDrawMatrices(model, modelViewProjection, normalMatrix);
+}
+
+/***********************************************************
+ *  SetDrawMatrices()
+ *
+ *  This method is used for setting the model matrix of the
+ *  next draw along with its model view projection and
+ *  normal matrix, which are built on the CPU once for each
+ *  object instead of for every vertex.
+ ***********************************************************/
+void SceneManager::SetDrawMatrices(
+	const glm::mat4& model,
+	const glm::mat4& modelViewProjection,
+	const glm::mat3& normalMatrix)
+{
+	m_modelMatrix = model;
+
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->setMat4Value(g_ModelName, model);
+		m_pShaderManager->setMat4Value(g_ModelViewProjectionName, modelViewProjection);
+		m_pShaderManager->setMat3Value(g_NormalMatrixName, normalMatrix);
+	}
+}
+
 /***********************************************************
  *  SetTransformations()
  *
@@ -253,29 +503,10 @@ void SceneManager::SetTransformations(
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	SetModelMatrix(SceneData::CalculateModelMatrix(
+		scaleXYZ,
+		glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees),
+		positionXYZ));
 }
 
 /***********************************************************
@@ -300,7 +531,6 @@ void SceneManager::SetShaderColor(
 
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
 		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
 	}
 }
@@ -312,12 +542,10 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
 {
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
 		int textureID = -1;
 		textureID = FindTextureSlot(textureTag);
 		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
@@ -347,32 +575,24 @@ void SceneManager::SetTextureUVScale(float u, float v)
   ***********************************************************/
 void SceneManager::LoadSceneTextures()
 {
+	m_sceneTextureSlots.assign(m_scene.textures.size(), -1);
 
-	bool bReturn = false;
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/static3.jpg", "static"
-	);
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/blackxbox4.jpg", "xbox"
-	);
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/monster2.jpg", "monster"
-	);
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/rusticwood.jpg", "rusticwood"
-	);
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/blackwall.jpg", "wall"
-	);
+	for (size_t i = 0; i < m_scene.textures.size(); i++)
+	{
+		if (m_loadedTextures >= g_MaxTextures)
+		{
+			std::cout << "No texture slot left for texture:" << m_scene.textures[i].tag << std::endl;
+			continue;
+		}
 
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/stainless.jpg", "stainless"
-	);
+		// remember which slot the texture was loaded into so
+		// objects can be drawn without looking up the tag
+		int slot = m_loadedTextures;
+		if (CreateGLTexture(m_scene.textures[i].filename.c_str(), m_scene.textures[i].tag) == true)
+		{
+			m_sceneTextureSlots[i] = slot;
+		}
+	}
 
 	// after the texture image data is loaded into memory, the
 	// loaded textures need to be bound to texture slots - there
@@ -387,7 +607,7 @@ void SceneManager::LoadSceneTextures()
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
 	if (m_objectMaterials.size() > 0)
 	{
@@ -406,368 +626,1554 @@ void SceneManager::SetShaderMaterial(
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
 /***********************************************************
-  *  DefineObjectMaterials()
-  *
-  *  This method is used for configuring the various material
-  *  settings for all of the objects within the 3D scene.
-  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the values of an already
+ *  looked up material into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	const OBJECT_MATERIAL& material)
 {
-	OBJECT_MATERIAL cementMaterial;
-	cementMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	cementMaterial.ambientStrength = 0.2f;
-	cementMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	cementMaterial.specularColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	cementMaterial.shininess = 0.5;
-	cementMaterial.tag = "cement";
-
-	m_objectMaterials.push_back(cementMaterial);
-
-	OBJECT_MATERIAL glassMaterial;
-	glassMaterial.ambientColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	glassMaterial.ambientStrength = 0.3f;
-	glassMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);
-	glassMaterial.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);
-	glassMaterial.shininess = 90.0;
-	glassMaterial.tag = "glass";
-
-	m_objectMaterials.push_back(glassMaterial);
-
-	OBJECT_MATERIAL clayMaterial;
-	clayMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.3f);
-	clayMaterial.ambientStrength = 0.3f;
-	clayMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.5f);
-	clayMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.4f);
-	clayMaterial.shininess = 0.5;
-	clayMaterial.tag = "clay";
-
-	m_objectMaterials.push_back(clayMaterial);
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
+		m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
+		m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
+		m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
+		m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+	}
 }
 
 /***********************************************************
- *  SetupSceneLights()
+ *  SetShaderTextureSlot()
  *
- *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  This method is used for setting the texture in the passed
+ *  in slot into the shader.  A slot of -1 means the texture
+ *  failed to load, which is drawn the same way as before.
  ***********************************************************/
-void SceneManager::SetupSceneLights()
+void SceneManager::SetShaderTextureSlot(
+	int textureSlot)
 {
-	// ENable custom lighting; the 3D scene will be black if no light sources are added
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
-
-	// Light source simulating sunlight coming from a window positioned in front, above and to the left
-	glm::vec3 lightPosition(-5.0f, 10.0f, 5.0f);
-	glm::vec3 lightDirection(0.5f, -1.0f, -0.5f);
-	glm::vec3 color(1.5f, 1.4f, 0.9f);
-	
-	m_pShaderManager->setVec3Value("lightSources[0].position", lightPosition.x, lightPosition.y, lightPosition.z);
-	m_pShaderManager->setVec3Value("lightSources[0].direction", lightDirection.x, lightDirection.y, lightDirection.z);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", color.x * 0.2f, color.y * 0.2f, color.z * 0.2f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", color.x, color.y, color.z);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", color.x, color.y, color.z);
-
-	// Set focal strength and specular intensity to moderate values
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 100.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 1.0f);
-	
-	// 2nd light source
-	glm::vec3 lightPosition2(5.0f, 10.0f, 5.0f);
-	glm::vec3 lightDirection2(-0.5f, -1.0f, -0.5f);
-	glm::vec3 secondColor(0.2f, 0.6f, 1.0f);
-
-
-	m_pShaderManager->setVec3Value("lightSources[1].position", lightPosition2.x, lightPosition2.y, lightPosition2.z);
-	m_pShaderManager->setVec3Value("lightSources[1].direction", lightDirection2.x, lightDirection2.y, lightDirection2.z);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", secondColor.x * 0.2f, secondColor.y * 0.2f, secondColor.z * 0.2f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", secondColor.x, secondColor.y, secondColor.z);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", secondColor.x, secondColor.y, secondColor.z);
-
-	// Set focal strength and specular intensity to moderate values
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 100.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 1.0f);
-
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureSlot);
+	}
 }
 
 /***********************************************************
- *  PrepareScene()
+ *  SetViewTransform()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for passing the camera matrices of
+ *  the current frame, which are needed for culling.  The
+ *  scene variant still in use from the last frame is given
+ *  the new camera the next time a variant is activated.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::SetViewTransform(
+	const glm::mat4& view,
+	const glm::mat4& projection)
 {
-	// define the materials for objects in the scene
-	DefineObjectMaterials();
-	// add and define the light sources for the scene
-	SetupSceneLights();
-	// load the textures for the 3D scene
-	LoadSceneTextures();
-
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+	m_bViewUniformsDirty = true;
+}
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
-	m_basicMeshes->LoadPrismMesh();
-	m_basicMeshes->LoadCylinderMesh();
+/***********************************************************
+ *  IsObjectVisible()
+ *
+ *  This method is used for testing the mesh bounds, placed
+ *  with the passed in model matrix, against the occluders
+ *  that have been rasterized this frame.
+ ***********************************************************/
+bool SceneManager::IsObjectVisible(
+	const glm::mat4& model,
+	const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax)
+{
+	return(m_pOcclusionCuller->IsVisible(model, boundsMin, boundsMax));
 }
 
 /***********************************************************
- *  RenderScene()
+ *  CullObjectChunk()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for testing one chunk of objects
+ *  against the occluders and building the sort keys of the
+ *  visible ones.  The keys are written starting at the first
+ *  object of the chunk, so the chunks never share memory and
+ *  can run on any thread.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::CullObjectChunk(int chunk)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 0.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, -10.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	const glm::mat4* worldMatrices = m_transforms.GetWorldMatrices();
+	size_t first = (size_t)chunk * g_CullChunkSize;
+	size_t last = first + g_CullChunkSize;
+	if (last > m_objects.count)
+	{
+		last = m_objects.count;
+	}
 
-	//SetShaderColor(1, 1, 1, 1);
-	SetShaderTexture("rusticwood");
-	SetShaderMaterial("clay");
+	uint32_t visibleCount = 0;
+	for (size_t i = first; i < last; i++)
+	{
+		// groups only position their children, and static
+		// objects are drawn as part of their batch
+		if ((m_objects.meshes[i] == SceneData::NO_MESH) ||
+			m_staticBatcher.IsBatched(i))
+		{
+			continue;
+		}
+		ShapeMeshes::SHAPE_TYPE shape = (ShapeMeshes::SHAPE_TYPE)m_objects.meshes[i];
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
+		// the occluders themselves are always drawn
+		if ((m_objects.flags[i] & SceneData::OBJECT_OCCLUDER) == 0)
+		{
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+			ShapeMeshes::GetShapeBounds(shape, boundsMin, boundsMax);
+			if (IsObjectVisible(worldMatrices[i], boundsMin, boundsMax) == false)
+			{
+				continue;
+			}
+		}
 
-	scaleXYZ = glm::vec3(20.0f, 0.0f, 8.0f);
+		// distance of the object origin in front of the camera
+		float depth = -(m_viewMatrix * worldMatrices[i][3]).z;
+		bool bTransparent = (m_objects.flags[i] & SceneData::OBJECT_TRANSPARENT) != 0;
+
+		m_pChunkKeys[first + visibleCount] = RenderQueue::MakeKey(
+			0,
+			bTransparent,
+			GetShaderFeatures(m_objects.textureIndices[i], bTransparent, false),
+			m_objects.materialIndices[i],
+			m_objects.textureIndices[i],
+			shape,
+			depth);
+		m_pChunkObjects[first + visibleCount] = (uint32_t)i;
+		visibleCount++;
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	m_pChunkCounts[chunk] = visibleCount;
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 8.0f, -10.0f);
+/***********************************************************
+ *  RecordCommandList()
+ *
+ *  This method is used for recording the commands of one
+ *  chunk of the sorted render queue.  The texture, color,
+ *  material and UV scale are only recorded when they change
+ *  from the previous draw of the chunk, and are set again at
+ *  the start of every list and after every shader change,
+ *  since the lists are recorded without knowing each other
+ *  and every program keeps its own uniforms.  The shader
+ *  variant, mesh and blending are read from the draw before
+ *  the chunk, so those are recorded the same as a single
+ *  list would.
+ ***********************************************************/
+void SceneManager::RecordCommandList(int listIndex)
+{
+	CommandList& commandList = m_pCommandLists[listIndex];
+	RenderQueue::RENDER_STATS& stats = commandList.GetStats();
+	const glm::mat4* worldMatrices = m_transforms.GetWorldMatrices();
+	const glm::mat4 identity(1.0f);
+
+	size_t first = (size_t)listIndex * g_RecordChunkSize;
+	size_t last = first + g_RecordChunkSize;
+	if (last > m_renderQueue.GetCount())
+	{
+		last = m_renderQueue.GetCount();
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("wall");
-	SetShaderMaterial("cement");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
-
-	glm::vec3 boxScale = glm::vec3(9.0f, 4.0f, 1.0f);
-	glm::vec3 boxPosition = glm::vec3(0.0f, 4.5f, -9.0f);
-
-	float boxRotationX = 0.0f;
-	float boxRotationY = 0.0f;
-	float boxRotationZ = 0.0f;
-	
-	SetTransformations(
-		boxScale,
-		boxRotationX,
-		boxRotationY,
-		boxRotationZ,
-		boxPosition
-	);
-
-	//SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f);
-	SetShaderTexture("static");
-
-	// Inner monitor
-	m_basicMeshes->DrawBoxMesh();
-	/****************************************************************/
-
-	glm::vec3 boxMacScale = glm::vec3(2.0f, 1.0f, 1.0f);
-	glm::vec3 boxMacPosition = glm::vec3(4.0f, 0.5f, -7.0f);
-
-	float boxMacRotationX = 0.0f;
-	float boxMacRotationY = 0.0f;
-	float boxMacRotationZ = 0.0f;
-
-	SetTransformations(
-		boxMacScale,
-		boxMacRotationX,
-		boxMacRotationY,
-		boxMacRotationZ,
-		boxMacPosition
-	);
-
-	//SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f);
-	SetShaderTexture("stainless");
-
-	// Inner monitor
-	m_basicMeshes->DrawBoxMesh();
-	/****************************************************************/
-
-	glm::vec3 boxXScale = glm::vec3(2.0f, 5.0f, 1.0f);
-	glm::vec3 boxXPosition = glm::vec3(-7.0f, 0.5f, -8.0f);
-
-	float boxXRotationX = 180.0f;
-	float boxXRotationY = 0.0f;
-	float boxXRotationZ = 0.0f;
-
-	SetTransformations(
-		boxXScale,
-		boxXRotationX,
-		boxXRotationY,
-		boxXRotationZ,
-		boxXPosition
-	);
-
-	//SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f);
-	SetShaderTexture("xbox");
-
-	// Inner monitor
-	m_basicMeshes->DrawBoxMesh();
-	/****************************************************************/
-
-	glm::vec3 box2Scale = glm::vec3(10.0f, 5.0f, 1.0f);
-	glm::vec3 box2Position = glm::vec3(0.0f, 4.5f, -9.0f);
-
-	float box2RotationX = 0.0f;
-	float box2RotationY = 0.0f;
-	float box2RotationZ = 0.0f;
-
-	SetTransformations(
-		box2Scale,
-		box2RotationX,
-		box2RotationY,
-		box2RotationZ,
-		box2Position
-	);
-
-	SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f);
-
-	// Monitor outline
-	m_basicMeshes->DrawBoxMesh();
-	/****************************************************************/
-
-	glm::vec3 taperedCylinderScale = glm::vec3(0.7f, 2.0f, 0.2f);
-	glm::vec3 taperedCylinderPosition = glm::vec3(0.0f, 0.0f, -9.0f);
+	commandList.Reset(&m_frameArena);
 
-	float taperedCylinderRotationX = -10.0f;
-	float taperedCylinderRotationY = 0.0f;
-	float taperedCylinderRotationZ = 0.0f;
+	// the matrices of the whole chunk are built in one pass
+	// before the commands are recorded
+	const glm::mat4** models = m_frameArena.AllocateArray<const glm::mat4*>(last - first);
+	for (size_t item = first; item < last; item++)
+	{
+		size_t i = m_renderQueue.GetObjectIndex(item);
+		models[item - first] = (i >= m_objects.count) ? &identity : &worldMatrices[i];
+	}
+	TransformStore::ComputeDrawMatrices(
+		m_projectionMatrix * m_viewMatrix,
+		models,
+		last - first,
+		m_pModelViewProjections + first,
+		m_pNormalMatrices + first);
+
+	int lastVariant = -1;
+	int lastTexture = -2;
+	int lastMaterial = -2;
+	int lastMesh = -1;
+	glm::vec4 lastColor(-1.0f);
+	glm::vec2 lastUVScale(-1.0f);
+	bool bBlending = false;
+
+	if (first > 0)
+	{
+		uint64_t previousKey = m_renderQueue.GetKey(first - 1);
+		lastVariant = RenderQueue::GetKeyShaderVariant(previousKey);
+		lastMesh = RenderQueue::GetKeyMesh(previousKey);
+		bBlending = RenderQueue::IsKeyTransparent(previousKey);
+	}
 
-	SetTransformations(
-		taperedCylinderScale,
-		taperedCylinderRotationX,
-		taperedCylinderRotationY,
-		taperedCylinderRotationZ,
-		taperedCylinderPosition
-	);
+	for (size_t item = first; item < last; item++)
+	{
+		uint64_t key = m_renderQueue.GetKey(item);
+		size_t i = m_renderQueue.GetObjectIndex(item);
+
+		// items past the objects are static batches, which are
+		// already in world space
+		const StaticBatcher::STATIC_BATCH* pBatch = NULL;
+		const glm::mat4* pModel = models[item - first];
+		int textureIndex;
+		int materialIndex;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		if (i >= m_objects.count)
+		{
+			pBatch = &m_staticBatcher.GetBatch(i - m_objects.count);
+			textureIndex = pBatch->texture;
+			materialIndex = pBatch->material;
+			color = pBatch->color;
+			uvScale = pBatch->uvScale;
+		}
+		else
+		{
+			textureIndex = m_objects.textureIndices[i];
+			materialIndex = m_objects.materialIndices[i];
+			color = m_objects.colors[i];
+			uvScale = m_objects.uvScales[i];
+		}
 
-	SetShaderTexture("wall");
-	SetShaderMaterial("cement");
-
-	m_basicMeshes->DrawTaperedCylinderMesh();
-	/****************************************************************/
+		// transparent items are sorted after all of the opaque
+		// items and are blended without writing depth
+		if ((bBlending == false) && RenderQueue::IsKeyTransparent(key))
+		{
+			commandList.Add<CommandList::BEGIN_BLEND_COMMAND>(CommandList::COMMAND_BEGIN_BLEND);
+			bBlending = true;
+		}
 
-	glm::vec3 prismScale = glm::vec3(6.0f, 0.8f, 0.3f);
-	glm::vec3 prismPosition = glm::vec3(0.1f, 0.4f, -9.5f);
+		// the items are sorted by shader variant, so the
+		// program changes once for every run of a variant
+		int variant = RenderQueue::GetKeyShaderVariant(key);
+		if (variant != lastVariant)
+		{
+			CommandList::SET_SHADER_COMMAND* pShader =
+				commandList.Add<CommandList::SET_SHADER_COMMAND>(CommandList::COMMAND_SET_SHADER);
+			pShader->features = (uint32_t)variant;
+			lastVariant = variant;
+			lastTexture = -2;
+			lastMaterial = -2;
+			lastColor = glm::vec4(-1.0f);
+			lastUVScale = glm::vec2(-1.0f);
+			stats.programChanges++;
+		}
 
-	float prismRotationX = 0.0f;
-	float prismRotationY = 130.0f;
-	float prismRotationZ = 0.0f;
+		// the world matrices are cached by the transform store
+		CommandList::SET_MODEL_COMMAND* pModelCommand =
+			commandList.Add<CommandList::SET_MODEL_COMMAND>(CommandList::COMMAND_SET_MODEL);
+		memcpy(pModelCommand->model, glm::value_ptr(*pModel), sizeof(pModelCommand->model));
+		memcpy(pModelCommand->modelViewProjection, glm::value_ptr(m_pModelViewProjections[item]), sizeof(pModelCommand->modelViewProjection));
+		memcpy(pModelCommand->normalMatrix, glm::value_ptr(m_pNormalMatrices[item]), sizeof(pModelCommand->normalMatrix));
 
-	SetTransformations(
-		prismScale,
-		prismRotationX,
-		prismRotationY,
-		prismRotationZ,
-		prismPosition
-	);
+		if (textureIndex >= 0)
+		{
+			if (textureIndex != lastTexture)
+			{
+				CommandList::SET_TEXTURE_COMMAND* pTexture =
+					commandList.Add<CommandList::SET_TEXTURE_COMMAND>(CommandList::COMMAND_SET_TEXTURE);
+				pTexture->textureSlot = m_sceneTextureSlots[textureIndex];
+				lastTexture = textureIndex;
+				stats.textureChanges++;
+			}
+		}
+		else if ((lastTexture != -1) || (color != lastColor))
+		{
+			CommandList::SET_COLOR_COMMAND* pColor =
+				commandList.Add<CommandList::SET_COLOR_COMMAND>(CommandList::COMMAND_SET_COLOR);
+			memcpy(pColor->color, glm::value_ptr(color), sizeof(pColor->color));
+			lastTexture = -1;
+			lastColor = color;
+			stats.textureChanges++;
+		}
 
-	SetShaderTexture("wall");
-	SetShaderMaterial("cement");
+		if ((materialIndex >= 0) && (materialIndex != lastMaterial))
+		{
+			CommandList::SET_MATERIAL_COMMAND* pMaterial =
+				commandList.Add<CommandList::SET_MATERIAL_COMMAND>(CommandList::COMMAND_SET_MATERIAL);
+			pMaterial->material = materialIndex;
+			lastMaterial = materialIndex;
+			stats.materialChanges++;
+		}
 
-	m_basicMeshes->DrawPrismMesh();
+		if (uvScale != lastUVScale)
+		{
+			CommandList::SET_UV_SCALE_COMMAND* pUVScale =
+				commandList.Add<CommandList::SET_UV_SCALE_COMMAND>(CommandList::COMMAND_SET_UV_SCALE);
+			pUVScale->u = uvScale.x;
+			pUVScale->v = uvScale.y;
+			lastUVScale = uvScale;
+		}
 
-	/****************************************************************/
+		int mesh = RenderQueue::GetKeyMesh(key);
+		if (mesh != lastMesh)
+		{
+			stats.meshChanges++;
+			lastMesh = mesh;
+		}
 
-	glm::vec3 prism2Scale = glm::vec3(6.0f, 0.8f, 0.3f);
-	glm::vec3 prism2Position = glm::vec3(-0.1f, 0.4f, -9.5f);
+		if (NULL != pBatch)
+		{
+			CommandList::DRAW_BATCH_COMMAND* pDraw =
+				commandList.Add<CommandList::DRAW_BATCH_COMMAND>(CommandList::COMMAND_DRAW_BATCH);
+			pDraw->batch = (int32_t)(i - m_objects.count);
+		}
+		else
+		{
+			CommandList::DRAW_MESH_COMMAND* pDraw =
+				commandList.Add<CommandList::DRAW_MESH_COMMAND>(CommandList::COMMAND_DRAW_MESH);
+			pDraw->mesh = mesh;
+		}
+		stats.drawCount++;
+	}
+}
 
-	float prism2RotationX = 0.0f;
-	float prism2RotationY = -130.0f;
-	float prism2RotationZ = 0.0f;
+/***********************************************************
+ *  ExecuteCommandList()
+ *
+ *  This method is used for sending the recorded commands of
+ *  a list to OpenGL.  It must be called on the GL thread.
+ ***********************************************************/
+void SceneManager::ExecuteCommandList(const CommandList& commandList)
+{
+	const CommandList::COMMAND_HEADER* pCommand = commandList.GetFirst();
+	while (NULL != pCommand)
+	{
+		switch (pCommand->type)
+		{
+		case CommandList::COMMAND_SET_SHADER:
+			UseShaderVariant(((const CommandList::SET_SHADER_COMMAND*)pCommand)->features);
+			break;
+		case CommandList::COMMAND_SET_MODEL:
+		{
+			const CommandList::SET_MODEL_COMMAND* pModel = (const CommandList::SET_MODEL_COMMAND*)pCommand;
+			SetDrawMatrices(
+				glm::make_mat4(pModel->model),
+				glm::make_mat4(pModel->modelViewProjection),
+				glm::make_mat3(pModel->normalMatrix));
+			break;
+		}
+		case CommandList::COMMAND_SET_TEXTURE:
+			SetShaderTextureSlot(((const CommandList::SET_TEXTURE_COMMAND*)pCommand)->textureSlot);
+			break;
+		case CommandList::COMMAND_SET_COLOR:
+		{
+			const float* color = ((const CommandList::SET_COLOR_COMMAND*)pCommand)->color;
+			SetShaderColor(color[0], color[1], color[2], color[3]);
+			break;
+		}
+		case CommandList::COMMAND_SET_MATERIAL:
+		{
+			int32_t material = ((const CommandList::SET_MATERIAL_COMMAND*)pCommand)->material;
+			SetShaderMaterial(m_objectMaterials[material]);
+			if (m_bGeometryPassActive)
+			{
+				m_pShaderManager->setIntValue(g_MaterialIndexName, material);
+			}
+			break;
+		}
+		case CommandList::COMMAND_SET_UV_SCALE:
+		{
+			const CommandList::SET_UV_SCALE_COMMAND* pUVScale = (const CommandList::SET_UV_SCALE_COMMAND*)pCommand;
+			SetTextureUVScale(pUVScale->u, pUVScale->v);
+			break;
+		}
+		case CommandList::COMMAND_BEGIN_BLEND:
+			// transparent objects are drawn with the forward
+			// shader over the lit result of the deferred path
+			if (m_bGeometryPassActive)
+			{
+				EndGeometryPass();
+			}
+			// the transparent objects were not in the pre-pass
+			if (m_bDepthPrepassActive)
+			{
+				EndDepthPrepass();
+			}
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_FALSE);
+			break;
+		case CommandList::COMMAND_DRAW_MESH:
+			m_basicMeshes->DrawShapeMesh((ShapeMeshes::SHAPE_TYPE)((const CommandList::DRAW_MESH_COMMAND*)pCommand)->mesh);
+			break;
+		case CommandList::COMMAND_DRAW_BATCH:
+			m_staticBatcher.DrawBatch(((const CommandList::DRAW_BATCH_COMMAND*)pCommand)->batch);
+			break;
+		}
 
-	SetTransformations(
-		prism2Scale,
-		prism2RotationX,
-		prism2RotationY,
-		prism2RotationZ,
-		prism2Position
-	);
+		pCommand = commandList.GetNext(pCommand);
+	}
+}
 
-	SetShaderTexture("wall");
-	SetShaderMaterial("cement");
+/***********************************************************
+ *  GetShaderFeatures()
+ *
+ *  This method returns the shader features of an object.
+ *  The opaque objects of the deferred path only write the
+ *  G-buffer, so their variant only keeps whether they are
+ *  lit and leaves out the lights.  The lightmapped static
+ *  batches take their light from the lightmap alone.
+ ***********************************************************/
+uint32_t SceneManager::GetShaderFeatures(int textureIndex, bool bTransparent, bool bLightmapped) const
+{
+	uint32_t features = m_sceneShaderFeatures;
+	if (bLightmapped == true)
+	{
+		features = FEATURE_LIGHTMAP;
+	}
+	if ((NULL != m_pDeferredRenderer) && (bTransparent == false))
+	{
+		features = FEATURE_GBUFFER | (features & (FEATURE_LIGHTING | FEATURE_LIGHTMAP));
+	}
+	if (textureIndex >= 0)
+	{
+		features |= FEATURE_TEXTURE;
+	}
+	return(features);
+}
 
-	m_basicMeshes->DrawPrismMesh();
+/***********************************************************
+ *  UseShaderVariant()
+ *
+ *  This method is used for activating the scene shader
+ *  variant of the passed in features.  Every program keeps
+ *  its own uniforms, so the camera, lights and clusters are
+ *  set again when the program changes.  A program kept from
+ *  the last frame, which is the only one that can miss a
+ *  new camera, is given the camera and clusters again after
+ *  the camera changed.
+ ***********************************************************/
+void SceneManager::UseShaderVariant(uint32_t features)
+{
+	bool bProgramChanged = m_pShaderManager->UseVariant(features);
+	if ((bProgramChanged == false) && (m_bViewUniformsDirty == false))
+	{
+		return;
+	}
+	m_bViewUniformsDirty = false;
 
-	/****************************************************************/
+	m_pShaderManager->setMat4Value(g_ViewName, m_viewMatrix);
+	m_pShaderManager->setVec3Value(g_ViewPositionName, glm::vec3(glm::inverse(m_viewMatrix)[3]));
 
-	glm::vec3 cylinderScale = glm::vec3(0.5f, 1.8f, 0.5f);
-	glm::vec3 cylinderPosition = glm::vec3(-4.7f, 0.0f, -6.0f);
+	if (features & FEATURE_CLUSTERED_LIGHTS)
+	{
+		SetClusterUniforms(m_pShaderManager);
+	}
+	if (bProgramChanged == false)
+	{
+		return;
+	}
 
-	float cylinderRotationX = -1.0f;
-	float cylinderRotationY = 90.0f;
-	float cylinderRotationZ = 0.0f;
+	if (features & FEATURE_LIGHTING)
+	{
+		SetLightUniforms(m_pShaderManager);
+	}
+	if (features & FEATURE_LIGHTMAP)
+	{
+		m_pShaderManager->setSampler2DValue(g_LightmapValueName, m_lightmapSlot);
+	}
+}
 
-	SetTransformations(
-		cylinderScale,
-		cylinderRotationX,
-		cylinderRotationY,
-		cylinderRotationZ,
-		cylinderPosition
-	);
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
 
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("monster");
-	SetShaderMaterial("glass");
+/***********************************************************
+  *  DefineObjectMaterials()
+  *
+  *  This method is used for configuring the various material
+  *  settings for all of the objects within the 3D scene.
+  ***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	m_objectMaterials.clear();
+	m_objectMaterials.reserve(m_scene.materials.size());
 
-	m_basicMeshes->DrawCylinderMesh();
+	// the materials are kept in the same order as the scene file
+	// so the object material indices can be used directly
+	for (size_t i = 0; i < m_scene.materials.size(); i++)
+	{
+		const SceneData::MATERIAL& sceneMaterial = m_scene.materials[i];
 
-	/****************************************************************/
+		OBJECT_MATERIAL material;
+		material.ambientColor = sceneMaterial.ambientColor;
+		material.ambientStrength = sceneMaterial.ambientStrength;
+		material.diffuseColor = sceneMaterial.diffuseColor;
+		material.specularColor = sceneMaterial.specularColor;
+		material.shininess = sceneMaterial.shininess;
+		material.tag = sceneMaterial.tag;
+
+		m_objectMaterials.push_back(material);
+	}
 }
 
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is called to add and configure the light
+ *  sources for the 3D scene.  There are up to 4 scene wide
+ *  light sources, and any number of point lights with a
+ *  range, which are assigned to clusters every frame.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	m_pClusteredLighting->ClearLights();
+
+	size_t globalLightCount = 0;
+	size_t skippedLightCount = 0;
+	for (size_t i = 0; i < m_scene.lights.size(); i++)
+	{
+		const SceneData::LIGHT& light = m_scene.lights[i];
+		if (light.range > 0.0f)
+		{
+			m_pClusteredLighting->AddLight(
+				light.position,
+				light.range,
+				light.diffuseColor,
+				light.specularColor,
+				light.specularIntensity);
+		}
+		else if (globalLightCount == g_MaxLights)
+		{
+			skippedLightCount++;
+		}
+		else
+		{
+			globalLightCount++;
+		}
+	}
+
+	if (skippedLightCount > 0)
+	{
+		std::cout << "Scene has " << (globalLightCount + skippedLightCount) << " light sources without a range, only the first " << g_MaxLights << " are used" << std::endl;
+	}
+
+	m_lightUniformNames.clear();
+	for (size_t light = 0; light < globalLightCount; light++)
+	{
+		std::string lightName = "lightSources[" + std::to_string(light) + "].";
+		for (size_t field = 0; field < g_LightFieldCount; field++)
+		{
+			m_lightUniformNames.push_back(lightName + g_LightFieldNames[field]);
+		}
+	}
+
+	// ENable custom lighting; the 3D scene will be black if no light sources are added
+	m_sceneShaderFeatures = FEATURE_LIGHTING;
+	if (m_pClusteredLighting->GetLightCount() > 0)
+	{
+		m_sceneShaderFeatures |= FEATURE_CLUSTERED_LIGHTS;
+	}
+
+	// the number of scene wide lights is compiled into the
+	// shaders, so the loops only run over the lights in use
+	std::string defines = "#define TOTAL_LIGHTS " + std::to_string(globalLightCount) + "\n";
+	m_pShaderManager->SetVariantDefines(defines);
+	// the lit variants take the light uniforms when they are
+	// activated, so the frame starts from the program without
+	// features
+	m_pShaderManager->UseVariant(0);
+
+	// every variant the scene can draw with is submitted at
+	// once, and is drawn with a fallback until it is compiled
+	std::vector<uint32_t> featureSets;
+	int textureIndices[2] = { -1, 0 };
+	for (int i = 0; i < 2; i++)
+	{
+		featureSets.push_back(GetShaderFeatures(textureIndices[i], false, false));
+		featureSets.push_back(GetShaderFeatures(textureIndices[i], true, false));
+		if (m_scene.renderFlags & SceneData::RENDER_LIGHTMAPS)
+		{
+			featureSets.push_back(GetShaderFeatures(textureIndices[i], false, true));
+		}
+	}
+	m_pShaderManager->CompileVariants(featureSets);
+
+	// the lights are shaded by the lighting pass in the
+	// deferred path, which has a single variant per scene
+	if (NULL != m_pDeferredRenderer)
+	{
+		if (m_sceneShaderFeatures & FEATURE_CLUSTERED_LIGHTS)
+		{
+			defines += "#define USE_CLUSTERED_LIGHTS\n";
+		}
+
+		ShaderManager* pLightShader = m_pDeferredRenderer->GetLightingShader();
+		pLightShader->SetVariantDefines(defines);
+		pLightShader->use();
+		SetLightUniforms(pLightShader);
+		m_pShaderManager->use();
+	}
+}
+
+/***********************************************************
+ *  SetLightUniforms()
+ *
+ *  This method is used for passing the scene wide light
+ *  sources to the passed in program, which must be in use.
+ *  The point lights with a range are read from the cluster
+ *  buffers instead.  The uniform names were built by
+ *  SetupSceneLights(), so this runs on every program change
+ *  without touching the heap.
+ ***********************************************************/
+void SceneManager::SetLightUniforms(ShaderManager* pShader)
+{
+	size_t firstName = 0;
+	for (size_t i = 0; (i < m_scene.lights.size()) && (firstName < m_lightUniformNames.size()); i++)
+	{
+		const SceneData::LIGHT& light = m_scene.lights[i];
+		if (light.range > 0.0f)
+		{
+			continue;
+		}
+
+		const std::string* names = &m_lightUniformNames[firstName];
+		firstName += g_LightFieldCount;
+
+		pShader->setVec3Value(names[0].c_str(), light.position);
+		pShader->setVec3Value(names[1].c_str(), light.direction);
+		pShader->setVec3Value(names[2].c_str(), light.ambientColor);
+		pShader->setVec3Value(names[3].c_str(), light.diffuseColor);
+		pShader->setVec3Value(names[4].c_str(), light.specularColor);
+		pShader->setFloatValue(names[5].c_str(), light.focalStrength);
+		pShader->setFloatValue(names[6].c_str(), light.specularIntensity);
+	}
+}
+
+/***********************************************************
+ *  UpdateClusteredLights()
+ *
+ *  This method is used for assigning the point lights to the
+ *  clusters of the current camera and passing the lists and
+ *  the cluster grid to the fragment shader.
+ ***********************************************************/
+void SceneManager::UpdateClusteredLights()
+{
+	m_pClusteredLighting->Update(m_viewMatrix, m_projectionMatrix);
+	m_pClusteredLighting->Upload();
+
+	// the screen tiles of the clusters follow the viewport
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glm::ivec3 clusterCounts = ClusteredLighting::GetClusterCounts();
+	m_clusterTileSize.x = (float)viewport[2] / (float)clusterCounts.x;
+	m_clusterTileSize.y = (float)viewport[3] / (float)clusterCounts.y;
+
+	// the other clustered variants of the scene shader are
+	// given the grid when they are activated
+	ShaderManager* pLightShader = GetLightShader();
+	pLightShader->use();
+	SetClusterUniforms(pLightShader);
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  SetClusterUniforms()
+ *
+ *  This method is used for passing the cluster grid of the
+ *  current frame to the passed in program, which must be in
+ *  use.
+ ***********************************************************/
+void SceneManager::SetClusterUniforms(ShaderManager* pShader)
+{
+	glm::ivec3 clusterCounts = ClusteredLighting::GetClusterCounts();
+
+	pShader->setIVec3Value(g_ClusterCountsName, clusterCounts.x, clusterCounts.y, clusterCounts.z);
+	pShader->setVec2Value(g_ClusterTileSizeName, m_clusterTileSize);
+	pShader->setFloatValue(g_ClusterNearName, m_pClusteredLighting->GetNearPlane());
+	pShader->setFloatValue(g_ClusterDepthScaleName, m_pClusteredLighting->GetDepthSliceScale());
+}
+
+/***********************************************************
+ *  EnableDeferredShading()
+ *
+ *  This method is used for switching to the deferred shading
+ *  path, which must be done before the scene is prepared.
+ *  The forward path is kept when the lighting shader cannot
+ *  be loaded.
+ ***********************************************************/
+bool SceneManager::EnableDeferredShading()
+{
+	if (NULL != m_pDeferredRenderer)
+	{
+		return(true);
+	}
+
+	m_pDeferredRenderer = new DeferredRenderer();
+	bool bCreated = m_pDeferredRenderer->Create(m_pShaderRegistry, g_DeferredVertexShaderName, g_DeferredLightingShaderName);
+	if (bCreated == false)
+	{
+		delete m_pDeferredRenderer;
+		m_pDeferredRenderer = NULL;
+	}
+
+	m_pShaderManager->use();
+	return(bCreated);
+}
+
+/***********************************************************
+ *  EnableSoftwareRendering()
+ *
+ *  This method is used for drawing the scene on the CPU
+ *  instead of with OpenGL, which must be done before the
+ *  scene is prepared so the renderer gets the textures.
+ *  OpenGL is still used to show the finished frames.
+ ***********************************************************/
+void SceneManager::EnableSoftwareRendering()
+{
+	if (NULL == m_pSoftwareRenderer)
+	{
+		m_pSoftwareRenderer = new SoftwareRenderer(m_pThreadPool);
+	}
+}
+
+/***********************************************************
+ *  EnablePathTracing()
+ *
+ *  This method is used for setting up the path tracer for
+ *  reference images, which must be done before the scene is
+ *  prepared so it gets the textures and meshes.
+ ***********************************************************/
+void SceneManager::EnablePathTracing()
+{
+	if (NULL == m_pPathTracer)
+	{
+		m_pPathTracer = new PathTracer(m_pThreadPool);
+	}
+}
+
+/***********************************************************
+ *  EnableHotReload()
+ *
+ *  This method is used for watching the files the prepared
+ *  scene was built from.  The files are checked on a
+ *  background thread, so this costs the render loop nothing
+ *  until one of them changes.
+ ***********************************************************/
+void SceneManager::EnableHotReload()
+{
+	if (NULL == m_pFileWatcher)
+	{
+		m_pFileWatcher = new FileWatcher();
+	}
+
+	std::vector<std::string> files;
+	m_pShaderRegistry->GetSourceFiles(files);
+	for (size_t i = 0; i < m_scene.textures.size(); i++)
+	{
+		if ((i < m_sceneTextureSlots.size()) && (m_sceneTextureSlots[i] >= 0))
+		{
+			files.push_back(m_scene.textures[i].filename);
+		}
+	}
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		m_pFileWatcher->Watch(files[i]);
+	}
+	std::cout << "Watching " << m_pFileWatcher->GetCount() << " files for changes" << std::endl;
+}
+
+/***********************************************************
+ *  ReloadChangedAssets()
+ *
+ *  This method is used for reloading the files that changed
+ *  since the last frame.  Only the programs that use a
+ *  changed shader file are compiled again, and only a
+ *  changed texture is decoded again, both in the background.
+ *  The results are swapped in here, between frames, once
+ *  they are complete - a program that fails to compile or
+ *  an image that cannot be read leaves the old one in use.
+ ***********************************************************/
+void SceneManager::ReloadChangedAssets()
+{
+	if (NULL == m_pFileWatcher)
+	{
+		return;
+	}
+
+	std::vector<std::string> changedFiles;
+	m_pFileWatcher->PollChanges(changedFiles);
+	for (size_t i = 0; i < changedFiles.size(); i++)
+	{
+		if (m_pShaderRegistry->ReloadFile(changedFiles[i]) > 0)
+		{
+			continue;
+		}
+
+		for (size_t texture = 0; texture < m_scene.textures.size(); texture++)
+		{
+			if ((m_scene.textures[texture].filename != changedFiles[i]) ||
+				(texture >= m_sceneTextureSlots.size()) ||
+				(m_sceneTextureSlots[texture] < 0))
+			{
+				continue;
+			}
+
+			TEXTURE_RELOAD reload;
+			reload.slot = m_sceneTextureSlots[texture];
+			reload.filename = changedFiles[i];
+			reload.image = std::async(std::launch::async, &SceneManager::DecodeTextureImage, reload.filename);
+			m_textureReloads.push_back(std::move(reload));
+		}
+	}
+
+	std::vector<TEXTURE_RELOAD>::iterator reload = m_textureReloads.begin();
+	while (reload != m_textureReloads.end())
+	{
+		if (reload->image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++reload;
+			continue;
+		}
+
+		TEXTURE_IMAGE image = reload->image.get();
+		if ((NULL != image.pixels) && (ReplaceGLTexture(reload->slot, image) == true))
+		{
+			std::cout << "Reloaded image:" << reload->filename << ", width:" << image.width << ", height:" << image.height << std::endl;
+		}
+		else
+		{
+			std::cout << "Could not reload image:" << reload->filename << ", keeping the current texture" << std::endl;
+		}
+		stbi_image_free(image.pixels);
+		reload = m_textureReloads.erase(reload);
+	}
+
+	// the scene shader takes its uniforms again on the next
+	// variant change, which a swapped program always reports,
+	// but the lights of the lighting pass are only set once
+	if ((m_pShaderRegistry->PollReloads() > 0) && (NULL != m_pDeferredRenderer))
+	{
+		ShaderManager* pLightShader = m_pDeferredRenderer->GetLightingShader();
+		pLightShader->use();
+		SetLightUniforms(pLightShader);
+	}
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  GetLightShader()
+ *
+ *  This method returns the shader program that shades the
+ *  lights - the scene shader in the forward path and the
+ *  lighting pass in the deferred path.
+ ***********************************************************/
+ShaderManager* SceneManager::GetLightShader()
+{
+	if (NULL != m_pDeferredRenderer)
+	{
+		return(m_pDeferredRenderer->GetLightingShader());
+	}
+	return(m_pShaderManager);
+}
+
+/***********************************************************
+ *  BeginGeometryPass()
+ *
+ *  This method is used for switching the scene shader to
+ *  writing the G-buffer before the opaque objects are drawn.
+ ***********************************************************/
+void SceneManager::BeginGeometryPass()
+{
+	if (m_pDeferredRenderer->BeginGeometryPass() == true)
+	{
+		m_bGeometryPassActive = true;
+	}
+}
+
+/***********************************************************
+ *  EndGeometryPass()
+ *
+ *  This method is used for lighting the G-buffer into the
+ *  window once the opaque objects are drawn, and switching
+ *  the scene shader back to forward shading for the
+ *  transparent objects.
+ ***********************************************************/
+void SceneManager::EndGeometryPass()
+{
+	m_pDeferredRenderer->RunLightingPass(m_viewMatrix, m_projectionMatrix);
+
+	m_pShaderManager->use();
+	m_bGeometryPassActive = false;
+}
+
+/***********************************************************
+ *  RunDepthPrepass()
+ *
+ *  This method is used for drawing the opaque items of the
+ *  sorted render queue with the depth only shader.  Only the
+ *  model view projection changes between the draws, so the
+ *  queue is drawn directly instead of through the command
+ *  lists, with the matrices built while recording them.
+ ***********************************************************/
+void SceneManager::RunDepthPrepass()
+{
+	m_pDepthPrepass->Begin();
+	for (size_t item = 0; item < m_renderQueue.GetCount(); item++)
+	{
+		uint64_t key = m_renderQueue.GetKey(item);
+		if (RenderQueue::IsKeyTransparent(key))
+		{
+			break;
+		}
+
+		size_t i = m_renderQueue.GetObjectIndex(item);
+		m_pDepthPrepass->SetModelViewProjection(m_pModelViewProjections[item]);
+		if (i >= m_objects.count)
+		{
+			m_staticBatcher.DrawBatch(i - m_objects.count);
+		}
+		else
+		{
+			m_basicMeshes->DrawShapeMesh((ShapeMeshes::SHAPE_TYPE)RenderQueue::GetKeyMesh(key));
+		}
+	}
+
+	m_pShaderManager->use();
+	m_pDepthPrepass->BeginMainPass();
+	m_bDepthPrepassActive = true;
+}
+
+/***********************************************************
+ *  EndDepthPrepass()
+ *
+ *  This method is used for restoring the depth test once
+ *  the opaque objects are shaded.
+ ***********************************************************/
+void SceneManager::EndDepthPrepass()
+{
+	m_pDepthPrepass->EndMainPass();
+	m_bDepthPrepassActive = false;
+}
+
+/***********************************************************
+ *  RenderSceneSoftware()
+ *
+ *  This method is used for drawing every object with a mesh
+ *  with the software renderer, at the size of the viewport.
+ *  The static objects are drawn one by one from their own
+ *  meshes instead of from the merged batches, and there is
+ *  no occlusion culling, since the renderer rejects hidden
+ *  pixels before shading them.
+ ***********************************************************/
+void SceneManager::RenderSceneSoftware()
+{
+	m_transforms.UpdateWorldMatrices();
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_pSoftwareRenderer->BeginFrame(viewport[2], viewport[3], m_viewMatrix, m_projectionMatrix);
+
+	BuildSoftwareDraws(m_softwareDraws, false);
+	for (size_t i = 0; i < m_softwareDraws.size(); i++)
+	{
+		m_pSoftwareRenderer->AddDraw(m_softwareDraws[i]);
+	}
+
+	m_pSoftwareRenderer->EndFrame();
+	m_pSoftwareRenderer->Present(viewport[0], viewport[1]);
+}
+
+/***********************************************************
+ *  BuildSoftwareDraws()
+ *
+ *  This method is used for describing every object with a
+ *  mesh for the renderers that run on the CPU, placed with
+ *  the current world matrices.  The lightmap bake only
+ *  takes the static objects, whose light never changes.
+ ***********************************************************/
+void SceneManager::BuildSoftwareDraws(std::vector<SoftwareRenderer::DRAW>& draws, bool bStaticOnly)
+{
+	const glm::mat4* worldMatrices = m_transforms.GetWorldMatrices();
+	draws.clear();
+
+	for (size_t i = 0; i < m_objects.count; i++)
+	{
+		if ((m_objects.meshes[i] == SceneData::NO_MESH) ||
+			((bStaticOnly == true) && ((m_objects.flags[i] & SceneData::OBJECT_STATIC) == 0)))
+		{
+			continue;
+		}
+		ShapeMeshes::SHAPE_TYPE shape = (ShapeMeshes::SHAPE_TYPE)m_objects.meshes[i];
+		const ShapeMeshes::SHAPE_GEOMETRY& geometry = m_basicMeshes->GetShapeGeometry(shape);
+
+		SoftwareRenderer::DRAW draw;
+		draw.vertices = geometry.vertices.data();
+		draw.vertexCount = geometry.vertices.size() / 8;
+		draw.indices = geometry.indices.data();
+		draw.indexCount = geometry.indices.size();
+		ShapeMeshes::GetShapeBounds(shape, draw.boundsMin, draw.boundsMax);
+		draw.model = worldMatrices[i];
+		draw.material = m_objects.materialIndices[i];
+		draw.texture = -1;
+		if ((m_objects.textureIndices[i] >= 0) && ((size_t)m_objects.textureIndices[i] < m_sceneTextureSlots.size()))
+		{
+			draw.texture = m_sceneTextureSlots[m_objects.textureIndices[i]];
+		}
+		draw.color = m_objects.colors[i];
+		draw.uvScale = m_objects.uvScales[i];
+		draw.bTransparent = (m_objects.flags[i] & SceneData::OBJECT_TRANSPARENT) != 0;
+		draws.push_back(draw);
+	}
+}
+
+/***********************************************************
+ *  BuildSoftwareLighting()
+ *
+ *  This method is used for describing the materials and
+ *  light sources of the prepared scene for the renderers
+ *  that run on the CPU.  The light sources without a range
+ *  past the first few are left out, the same as in the
+ *  shaders.
+ ***********************************************************/
+void SceneManager::BuildSoftwareLighting(
+	std::vector<SoftwareRenderer::MATERIAL>& materials,
+	std::vector<SoftwareRenderer::LIGHT>& lights,
+	std::vector<SoftwareRenderer::POINT_LIGHT>& pointLights)
+{
+	materials.assign(m_objectMaterials.size(), SoftwareRenderer::MATERIAL());
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		materials[i].ambientColor = material.ambientColor;
+		materials[i].ambientStrength = material.ambientStrength;
+		materials[i].diffuseColor = material.diffuseColor;
+		materials[i].specularColor = material.specularColor;
+		materials[i].shininess = material.shininess;
+	}
+
+	lights.clear();
+	pointLights.clear();
+	for (size_t i = 0; i < m_scene.lights.size(); i++)
+	{
+		const SceneData::LIGHT& light = m_scene.lights[i];
+		if (light.range > 0.0f)
+		{
+			SoftwareRenderer::POINT_LIGHT pointLight;
+			pointLight.position = light.position;
+			pointLight.range = light.range;
+			pointLight.diffuseColor = light.diffuseColor;
+			pointLight.specularColor = light.specularColor;
+			pointLight.specularIntensity = light.specularIntensity;
+			pointLights.push_back(pointLight);
+		}
+		else if (lights.size() < g_MaxLights)
+		{
+			SoftwareRenderer::LIGHT sceneLight;
+			sceneLight.position = light.position;
+			sceneLight.ambientColor = light.ambientColor;
+			sceneLight.diffuseColor = light.diffuseColor;
+			sceneLight.specularColor = light.specularColor;
+			sceneLight.specularIntensity = light.specularIntensity;
+			lights.push_back(sceneLight);
+		}
+	}
+}
+
+/***********************************************************
+ *  SetupSoftwareScene()
+ *
+ *  This method is used for passing the materials and light
+ *  sources of the prepared scene to the renderers that run
+ *  on the CPU, and placing the meshes of the path tracer.
+ ***********************************************************/
+void SceneManager::SetupSoftwareScene()
+{
+	std::vector<SoftwareRenderer::MATERIAL> materials;
+	std::vector<SoftwareRenderer::LIGHT> lights;
+	std::vector<SoftwareRenderer::POINT_LIGHT> pointLights;
+	BuildSoftwareLighting(materials, lights, pointLights);
+
+	if (NULL != m_pSoftwareRenderer)
+	{
+		m_pSoftwareRenderer->SetMaterials(materials);
+		m_pSoftwareRenderer->SetLights(lights, pointLights);
+	}
+	if (NULL != m_pPathTracer)
+	{
+		m_pPathTracer->SetMaterials(materials);
+		m_pPathTracer->SetLights(lights, pointLights);
+
+		BuildSoftwareDraws(m_softwareDraws, false);
+		m_pPathTracer->BuildScene(m_softwareDraws);
+	}
+}
+
+/***********************************************************
+ *  BakeLightmaps()
+ *
+ *  This method is used for giving the static batches the
+ *  light baked into a lightmap.  The merged geometry is
+ *  unwrapped, and the lightmap is read from the cache when
+ *  an earlier run baked the same scene, or else path traced
+ *  from the static objects alone.  The lightmap takes the
+ *  next texture slot, so the batches stay lit per fragment
+ *  when there is none left.
+ ***********************************************************/
+void SceneManager::BakeLightmaps()
+{
+	if (m_loadedTextures >= g_MaxTextures)
+	{
+		std::cout << "No texture slot left for the lightmap" << std::endl;
+		return;
+	}
+
+	LightmapBaker baker(m_pThreadPool);
+	if (baker.Unwrap(m_staticBatcher.GetVertices(), m_staticBatcher.GetIndices()) == false)
+	{
+		return;
+	}
+
+	std::vector<SoftwareRenderer::MATERIAL> materials;
+	std::vector<SoftwareRenderer::LIGHT> lights;
+	std::vector<SoftwareRenderer::POINT_LIGHT> pointLights;
+	std::vector<SoftwareRenderer::DRAW> draws;
+	BuildSoftwareLighting(materials, lights, pointLights);
+	BuildSoftwareDraws(draws, true);
+
+	// everything the baked light depends on besides the
+	// geometry, which the baker adds itself
+	uint64_t sceneKey = ShaderPreprocessor::HASH_SEED;
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		sceneKey = HashFloats(glm::value_ptr(materials[i].diffuseColor), 3, sceneKey);
+		sceneKey = HashFloats(glm::value_ptr(materials[i].specularColor), 3, sceneKey);
+		sceneKey = HashFloats(&materials[i].shininess, 1, sceneKey);
+	}
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		sceneKey = HashFloats(glm::value_ptr(lights[i].position), 3, sceneKey);
+		sceneKey = HashFloats(glm::value_ptr(lights[i].diffuseColor), 3, sceneKey);
+		sceneKey = HashFloats(glm::value_ptr(lights[i].specularColor), 3, sceneKey);
+		sceneKey = HashFloats(&lights[i].specularIntensity, 1, sceneKey);
+	}
+	for (size_t i = 0; i < pointLights.size(); i++)
+	{
+		sceneKey = HashFloats(glm::value_ptr(pointLights[i].position), 3, sceneKey);
+		sceneKey = HashFloats(&pointLights[i].range, 1, sceneKey);
+		sceneKey = HashFloats(glm::value_ptr(pointLights[i].diffuseColor), 3, sceneKey);
+		sceneKey = HashFloats(glm::value_ptr(pointLights[i].specularColor), 3, sceneKey);
+		sceneKey = HashFloats(&pointLights[i].specularIntensity, 1, sceneKey);
+	}
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		sceneKey = HashFloats(glm::value_ptr(draws[i].model), 16, sceneKey);
+		sceneKey = HashFloats(glm::value_ptr(draws[i].color), 4, sceneKey);
+		sceneKey = HashFloats(glm::value_ptr(draws[i].uvScale), 2, sceneKey);
+		sceneKey = ShaderPreprocessor::HashValue((uint32_t)draws[i].material, sceneKey);
+		sceneKey = ShaderPreprocessor::HashValue((uint32_t)draws[i].texture, sceneKey);
+		sceneKey = ShaderPreprocessor::HashValue(draws[i].indexCount, sceneKey);
+		sceneKey = ShaderPreprocessor::HashValue(draws[i].bTransparent ? 1 : 0, sceneKey);
+	}
+	// the bounced light takes the colors of the textures, so
+	// an edited texture file must not match the old lightmap
+	for (size_t i = 0; i < m_scene.textures.size(); i++)
+	{
+		FileWatcher::FILE_STAMP stamp = FileWatcher::GetFileStamp(m_scene.textures[i].filename);
+		sceneKey = ShaderPreprocessor::HashText(m_scene.textures[i].filename.c_str(), sceneKey);
+		sceneKey = ShaderPreprocessor::HashValue((uint64_t)stamp.modifiedTime, sceneKey);
+		sceneKey = ShaderPreprocessor::HashValue((uint64_t)stamp.size, sceneKey);
+	}
+
+	if (baker.LoadCache(sceneKey) == false)
+	{
+		PathTracer tracer(m_pThreadPool);
+		tracer.SetMaterials(materials);
+		tracer.SetLights(lights, pointLights);
+		for (size_t i = 0; i < m_sceneTextureSlots.size(); i++)
+		{
+			if (m_sceneTextureSlots[i] < 0)
+			{
+				continue;
+			}
+
+			TEXTURE_IMAGE image = DecodeTextureImage(m_scene.textures[i].filename);
+			if (NULL != image.pixels)
+			{
+				tracer.SetTexture(m_sceneTextureSlots[i], image.pixels, image.width, image.height, image.channels);
+				stbi_image_free(image.pixels);
+			}
+		}
+		tracer.BuildScene(draws);
+		baker.Bake(tracer);
+	}
+
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	baker.TakeGeometry(vertices, indices);
+	m_staticBatcher.SetLightmapGeometry(vertices, indices);
+	if (m_staticBatcher.HasLightmapUVs() == false)
+	{
+		return;
+	}
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	// the charts are padded, and mipmaps would blend them
+	// into their neighbours
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, baker.GetWidth(), baker.GetHeight(), 0, GL_RGB, GL_FLOAT, baker.GetTexels().data());
+
+	m_lightmapSlot = m_loadedTextures;
+	m_textureIDs[m_loadedTextures].ID = textureID;
+	m_textureIDs[m_loadedTextures].tag = g_LightmapTag;
+	m_loadedTextures++;
+
+	glActiveTexture(GL_TEXTURE0 + m_lightmapSlot);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glActiveTexture(GL_TEXTURE0);
+
+	const LightmapBaker::LIGHTMAP_STATS& stats = baker.GetStats();
+	std::cout << (stats.bFromCache ? "Loaded lightmap:" : "Baked lightmap:") << " charts:" << stats.chartCount << ", width:" << stats.width << ", height:" << stats.height << ", texels per unit:" << stats.texelsPerUnit << std::endl;
+}
+
+/***********************************************************
+ *  RenderReference()
+ *
+ *  This method is used for path tracing the scene from the
+ *  camera of the current frame.  The meshes are placed as
+ *  they were when the scene was prepared.
+ ***********************************************************/
+bool SceneManager::RenderReference(int width, int height, int samples, std::vector<unsigned char>& pixels)
+{
+	if (NULL == m_pPathTracer)
+	{
+		return(false);
+	}
+
+	m_pPathTracer->BeginImage(width, height, m_viewMatrix, m_projectionMatrix);
+	m_pPathTracer->AddSamples(samples);
+	m_pPathTracer->GetPixels(pixels);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetDepthPrepassStats()
+ *
+ *  This method returns the sample counts of the depth
+ *  pre-pass.  The saved samples are the fragments that the
+ *  forward path would have shaded and then overwritten.
+ ***********************************************************/
+DepthPrepass::PREPASS_STATS SceneManager::GetDepthPrepassStats() const
+{
+	DepthPrepass::PREPASS_STATS stats;
+	memset(&stats, 0, sizeof(stats));
+	if (NULL != m_pDepthPrepass)
+	{
+		stats = m_pDepthPrepass->GetStats();
+	}
+	return(stats);
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene(const char* sceneFilename)
+{
+	SceneLoader loader;
+	bool bLoaded = false;
+
+	if (NULL == sceneFilename)
+	{
+		sceneFilename = g_DefaultSceneName;
+	}
+
+	// snapshots are mapped and their object arrays are used in
+	// place, every other format is read into the scene data
+	if (SceneSnapshot::IsSnapshotFile(sceneFilename))
+	{
+		bLoaded = m_snapshot.Open(sceneFilename);
+		m_snapshot.GetResources(m_scene);
+		m_objects = m_snapshot.GetObjects();
+	}
+	else
+	{
+		bLoaded = loader.LoadScene(sceneFilename, m_scene);
+		m_objects = m_scene.GetObjects();
+	}
+
+	// an empty scene is still rendered so the window stays usable
+	if (bLoaded == false)
+	{
+		std::cout << "Could not load scene:" << sceneFilename << std::endl;
+		m_snapshot.Close();
+		m_scene.Clear();
+		m_objects = m_scene.GetObjects();
+	}
+
+	// the scene picks whether the opaque objects get a depth
+	// pre-pass
+	delete m_pDepthPrepass;
+	m_pDepthPrepass = NULL;
+	if (m_scene.renderFlags & SceneData::RENDER_DEPTH_PREPASS)
+	{
+		m_pDepthPrepass = new DepthPrepass();
+		if (m_pDepthPrepass->Create(m_pShaderRegistry, g_DepthVertexShaderName, g_DepthFragmentShaderName) == false)
+		{
+			std::cout << "Could not load the depth pre-pass shader" << std::endl;
+			delete m_pDepthPrepass;
+			m_pDepthPrepass = NULL;
+		}
+		m_pShaderManager->use();
+	}
+
+	// define the materials for objects in the scene
+	DefineObjectMaterials();
+	if (NULL != m_pDeferredRenderer)
+	{
+		// the G-buffer holds the material index, so the lighting
+		// pass reads the materials from a buffer
+		std::vector<DeferredRenderer::MATERIAL_DATA> materials(m_objectMaterials.size());
+		for (size_t i = 0; i < m_objectMaterials.size(); i++)
+		{
+			const OBJECT_MATERIAL& material = m_objectMaterials[i];
+			materials[i].ambientColorStrength = glm::vec4(material.ambientColor, material.ambientStrength);
+			materials[i].diffuseColorShininess = glm::vec4(material.diffuseColor, material.shininess);
+			materials[i].specularColor = glm::vec4(material.specularColor, 0.0f);
+		}
+		m_pDeferredRenderer->SetMaterials(materials);
+	}
+	// add and define the light sources for the scene
+	SetupSceneLights();
+	// load the textures for the 3D scene
+	LoadSceneTextures();
+
+	// the scene files hold the world matrices, so the
+	// transforms start out up to date
+	m_transforms.Clear();
+	m_transforms.Reserve(m_objects.count);
+	for (size_t i = 0; i < m_objects.count; i++)
+	{
+		m_transforms.Add(
+			m_objects.positions[i],
+			TransformStore::RotationFromDegrees(m_objects.rotations[i]),
+			m_objects.scales[i],
+			m_objects.parents[i],
+			&m_objects.modelMatrices[i]);
+	}
+
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+	bool bMeshUsed[ShapeMeshes::SHAPE_COUNT] = { false };
+	for (size_t i = 0; i < m_objects.count; i++)
+	{
+		if (m_objects.meshes[i] != SceneData::NO_MESH)
+		{
+			bMeshUsed[m_objects.meshes[i]] = true;
+		}
+	}
+	for (int shape = 0; shape < ShapeMeshes::SHAPE_COUNT; shape++)
+	{
+		if (bMeshUsed[shape] == true)
+		{
+			m_basicMeshes->LoadShapeMesh((ShapeMeshes::SHAPE_TYPE)shape);
+		}
+	}
+
+	// the static objects never move, so they are merged into
+	// batches once their meshes are loaded
+	m_staticBatcher.Build(m_objects, m_transforms.GetWorldMatrices(), *m_basicMeshes, g_StaticBatchCellSize);
+	m_lightmapSlot = -1;
+	if (m_scene.renderFlags & SceneData::RENDER_LIGHTMAPS)
+	{
+		BakeLightmaps();
+	}
+	m_staticBatcher.CreateBuffers();
+	if ((NULL != m_pSoftwareRenderer) || (NULL != m_pPathTracer))
+	{
+		SetupSoftwareScene();
+	}
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  transforming and drawing the basic 3D shapes
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	if (NULL != m_pSoftwareRenderer)
+	{
+		RenderSceneSoftware();
+		return;
+	}
+
+	const size_t objectCount = m_objects.count;
+
+	// everything allocated for the previous use of this
+	// frame's arena buffer is released at once
+	m_frameArena.BeginFrame();
+
+	// rebuild the world matrices of the objects that moved
+	// since the last frame - static scenes do no work here
+	m_transforms.UpdateWorldMatrices();
+	const glm::mat4* worldMatrices = m_transforms.GetWorldMatrices();
+
+	// start the occlusion culling for this frame - the objects
+	// flagged as occluders are rasterized first so every other
+	// object can be tested against them
+	m_pOcclusionCuller->BeginFrame(m_projectionMatrix * m_viewMatrix);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		if (m_objects.flags[i] & SceneData::OBJECT_OCCLUDER)
+		{
+			OcclusionCuller::OCCLUDER_SHAPE occluderShape = OcclusionCuller::OCCLUDER_BOX;
+			if (m_objects.meshes[i] == ShapeMeshes::SHAPE_PLANE)
+			{
+				occluderShape = OcclusionCuller::OCCLUDER_PLANE;
+			}
+
+			m_pOcclusionCuller->AddOccluder(worldMatrices[i], occluderShape);
+		}
+	}
+	m_pOcclusionCuller->RasterizeOccluders();
+
+	// the objects are culled in chunks on the worker threads,
+	// and the visible objects of every chunk are then added to
+	// the render queue in object order
+	size_t cullChunkCount = (objectCount + g_CullChunkSize - 1) / g_CullChunkSize;
+	m_pChunkKeys = m_frameArena.AllocateArray<uint64_t>(objectCount);
+	m_pChunkObjects = m_frameArena.AllocateArray<uint32_t>(objectCount);
+	m_pChunkCounts = m_frameArena.AllocateArray<uint32_t>(cullChunkCount);
+	m_pThreadPool->ParallelFor((int)cullChunkCount, [this](int chunk)
+	{
+		CullObjectChunk(chunk);
+	});
+
+	size_t visibleCount = 0;
+	for (size_t chunk = 0; chunk < cullChunkCount; chunk++)
+	{
+		visibleCount += m_pChunkCounts[chunk];
+	}
+	m_renderQueue.Reset(&m_frameArena, visibleCount + m_staticBatcher.GetBatchCount());
+	for (size_t chunk = 0; chunk < cullChunkCount; chunk++)
+	{
+		size_t first = chunk * g_CullChunkSize;
+		m_renderQueue.Append(m_pChunkKeys + first, m_pChunkObjects + first, m_pChunkCounts[chunk]);
+	}
+
+	// the static batches follow the objects in the queue and
+	// use a mesh value past the shapes in their sort keys
+	const glm::mat4 identity(1.0f);
+	for (size_t batchIndex = 0; batchIndex < m_staticBatcher.GetBatchCount(); batchIndex++)
+	{
+		const StaticBatcher::STATIC_BATCH& batch = m_staticBatcher.GetBatch(batchIndex);
+		if ((batch.bOccluder == false) &&
+			(IsObjectVisible(identity, batch.boundsMin, batch.boundsMax) == false))
+		{
+			continue;
+		}
+
+		glm::vec3 center = (batch.boundsMin + batch.boundsMax) * 0.5f;
+		float depth = -(m_viewMatrix * glm::vec4(center, 1.0f)).z;
+
+		m_renderQueue.Add(
+			RenderQueue::MakeKey(
+				0,
+				false,
+				GetShaderFeatures(batch.texture, false, m_lightmapSlot >= 0),
+				batch.material,
+				batch.texture,
+				ShapeMeshes::SHAPE_COUNT,
+				depth),
+			(uint32_t)(objectCount + batchIndex));
+	}
+	m_renderQueue.Sort();
+
+	// the point lights are assigned to the clusters of this
+	// camera before the draws are recorded
+	if (m_pClusteredLighting->GetLightCount() > 0)
+	{
+		UpdateClusteredLights();
+	}
+
+	// the sorted draws are recorded into command lists on the
+	// worker threads, one list per chunk of draws
+	size_t drawCount = m_renderQueue.GetCount();
+	size_t listCount = (drawCount + g_RecordChunkSize - 1) / g_RecordChunkSize;
+	m_pCommandLists = m_frameArena.NewArray<CommandList>(listCount);
+	m_pModelViewProjections = m_frameArena.AllocateArray<glm::mat4>(drawCount);
+	m_pNormalMatrices = m_frameArena.AllocateArray<glm::mat3>(drawCount);
+	m_pThreadPool->ParallelFor((int)listCount, [this](int listIndex)
+	{
+		RecordCommandList(listIndex);
+	});
+
+	// the opaque draws fill the G-buffer in the deferred path,
+	// which shades every pixel once anyway - the forward path
+	// can lay down the depth of the opaque draws first
+	if (NULL != m_pDeferredRenderer)
+	{
+		BeginGeometryPass();
+	}
+	else if (NULL != m_pDepthPrepass)
+	{
+		RunDepthPrepass();
+	}
+
+	// pick up the shader variants the driver finished since
+	// the last frame
+	m_pShaderManager->PollVariants();
+
+	// the lists are executed in order on this thread, which
+	// is the only one that talks to OpenGL
+	RenderQueue::RENDER_STATS& stats = m_renderQueue.GetStats();
+	for (size_t list = 0; list < listCount; list++)
+	{
+		ExecuteCommandList(m_pCommandLists[list]);
+
+		const RenderQueue::RENDER_STATS& listStats = m_pCommandLists[list].GetStats();
+		stats.drawCount += listStats.drawCount;
+		stats.programChanges += listStats.programChanges;
+		stats.materialChanges += listStats.materialChanges;
+		stats.textureChanges += listStats.textureChanges;
+		stats.meshChanges += listStats.meshChanges;
+	}
+
+	// light the G-buffer or restore the depth test when there
+	// were no transparent draws
+	if (m_bGeometryPassActive)
+	{
+		EndGeometryPass();
+	}
+	if (m_bDepthPrepassActive)
+	{
+		EndDepthPrepass();
+	}
+
+	// the transparent draws are last, so blending is on after
+	// the frame when the last draw is transparent
+	bool bBlending = (drawCount > 0) &&
+		RenderQueue::IsKeyTransparent(m_renderQueue.GetKey(drawCount - 1));
+	if (bBlending)
+	{
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+	}
+}
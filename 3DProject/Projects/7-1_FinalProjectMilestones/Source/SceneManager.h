@@ -10,8 +10,26 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "ShaderRegistry.h"
 #include "ShapeMeshes.h"
+#include "ThreadPool.h"
+#include "OcclusionCuller.h"
+#include "SceneLoader.h"
+#include "SceneSnapshot.h"
+#include "TransformStore.h"
+#include "RenderQueue.h"
+#include "CommandList.h"
+#include "FrameArena.h"
+#include "StaticBatcher.h"
+#include "ClusteredLighting.h"
+#include "DeferredRenderer.h"
+#include "DepthPrepass.h"
+#include "SoftwareRenderer.h"
+#include "PathTracer.h"
+#include "LightmapBaker.h"
+#include "FileWatcher.h"
 
+#include <future>
 #include <string>
 #include <vector>
 
@@ -26,7 +44,7 @@ class SceneManager
 
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(ShaderManager *pShaderManager, ShaderRegistry* pShaderRegistry);
 	// destructor
 	~SceneManager();
 
@@ -46,9 +64,39 @@ public:
 		std::string tag;
 	};
 
+	// features of the scene shader variants, which are kept
+	// in the 5 shader variant bits of the sort keys
+	enum SHADER_FEATURE
+	{
+		FEATURE_TEXTURE = 0x01,
+		FEATURE_LIGHTING = 0x02,
+		FEATURE_CLUSTERED_LIGHTS = 0x04,
+		FEATURE_GBUFFER = 0x08,
+		FEATURE_LIGHTMAP = 0x10
+	};
+
 private:
+	// a texture image decoded off the GL thread
+	struct TEXTURE_IMAGE
+	{
+		unsigned char* pixels;
+		int width;
+		int height;
+		int channels;
+	};
+
+	// a changed texture file being decoded for its slot
+	struct TEXTURE_RELOAD
+	{
+		int slot;
+		std::string filename;
+		std::future<TEXTURE_IMAGE> image;
+	};
+
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// shader programs of the other render passes
+	ShaderRegistry* m_pShaderRegistry;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
 	// total number of loaded textures
@@ -57,6 +105,79 @@ private:
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// worker threads for the CPU side frame preparation
+	ThreadPool* m_pThreadPool;
+	// software occlusion culling of the scene objects
+	OcclusionCuller* m_pOcclusionCuller;
+	// point lights assigned to view space clusters
+	ClusteredLighting* m_pClusteredLighting;
+	// G-buffer and lighting pass, NULL in the forward path
+	DeferredRenderer* m_pDeferredRenderer;
+	// the opaque objects are being drawn into the G-buffer
+	bool m_bGeometryPassActive;
+	// depth only pass, NULL unless the scene turns it on
+	DepthPrepass* m_pDepthPrepass;
+	// the opaque objects are being shaded with GL_EQUAL
+	bool m_bDepthPrepassActive;
+	// CPU rasterizer drawing the scene, NULL when OpenGL does
+	SoftwareRenderer* m_pSoftwareRenderer;
+	// path tracer for reference images, NULL unless enabled
+	PathTracer* m_pPathTracer;
+	// objects with a mesh as described to the CPU renderers
+	std::vector<SoftwareRenderer::DRAW> m_softwareDraws;
+	// shader features used by every lit object of the scene
+	uint32_t m_sceneShaderFeatures;
+	// screen size of the light cluster tiles this frame
+	glm::vec2 m_clusterTileSize;
+	// camera matrices of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// set when the camera changed, until the next scene
+	// variant in use has been given the camera uniforms
+	bool m_bViewUniformsDirty;
+	// model matrix of the object being drawn
+	glm::mat4 m_modelMatrix;
+	// the loaded scene description
+	SceneData m_scene;
+	// the mapped scene snapshot, when one is loaded
+	SceneSnapshot m_snapshot;
+	// per object arrays of the scene data or the snapshot
+	SCENE_OBJECTS m_objects;
+	// transforms and cached world matrices of the objects
+	TransformStore m_transforms;
+	// sorted draws of the current frame
+	RenderQueue m_renderQueue;
+	// merged geometry of the static objects
+	StaticBatcher m_staticBatcher;
+	// texture slot of every scene texture, -1 if not loaded
+	std::vector<int> m_sceneTextureSlots;
+	// texture slot of the lightmap of the static batches, -1
+	// when they are lit per fragment
+	int m_lightmapSlot;
+	// uniform names of the fields of every scene wide light,
+	// built with the lights so switching programs does not
+	// format them again
+	std::vector<std::string> m_lightUniformNames;
+	// memory for the transient data of each frame
+	FrameArena m_frameArena;
+	// visible objects found by each culling chunk, written at
+	// the offset of the first object of the chunk - these
+	// arrays are taken from the frame arena
+	uint64_t* m_pChunkKeys;
+	uint32_t* m_pChunkObjects;
+	uint32_t* m_pChunkCounts;
+	// commands recorded from the sorted render queue, one
+	// list per chunk of draws, also in the frame arena
+	CommandList* m_pCommandLists;
+	// model view projection and normal matrix of every item
+	// of the render queue, built while recording
+	glm::mat4* m_pModelViewProjections;
+	glm::mat3* m_pNormalMatrices;
+	// watches the shader and texture files, NULL unless hot
+	// reloading is turned on
+	FileWatcher* m_pFileWatcher;
+	// changed textures still being decoded
+	std::vector<TEXTURE_RELOAD> m_textureReloads;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
@@ -64,11 +185,24 @@ private:
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
+	// decode a texture image file - called off the GL thread
+	static TEXTURE_IMAGE DecodeTextureImage(std::string filename);
+	// replace the image of a loaded texture
+	bool ReplaceGLTexture(int slot, const TEXTURE_IMAGE& image);
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const char* tag);
+	int FindTextureSlot(const char* tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const char* tag, OBJECT_MATERIAL& material);
+
+	// set an already calculated model matrix
+	void SetModelMatrix(
+		const glm::mat4& model);
+	// set the matrices of the next draw
+	void SetDrawMatrices(
+		const glm::mat4& model,
+		const glm::mat4& modelViewProjection,
+		const glm::mat3& normalMatrix);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -88,7 +222,11 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
+
+	// set the texture in the passed in slot into the shader
+	void SetShaderTextureSlot(
+		int textureSlot);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -98,13 +236,109 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+	void SetShaderMaterial(
+		const OBJECT_MATERIAL& material);
+
+	// test the placed mesh bounds against the occluders
+	bool IsObjectVisible(
+		const glm::mat4& model,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax);
+
+	// cull one chunk of objects and build the sort keys of
+	// the visible ones - called from the worker threads
+	void CullObjectChunk(int chunk);
+	// record the commands of one chunk of the sorted render
+	// queue - called from the worker threads
+	void RecordCommandList(int listIndex);
+	// send the recorded commands to OpenGL
+	void ExecuteCommandList(const CommandList& commandList);
+	// the shader features of an object with the passed in
+	// texture index - called from the worker threads
+	uint32_t GetShaderFeatures(int textureIndex, bool bTransparent, bool bLightmapped) const;
+	// activate the scene shader variant of the passed in
+	// features and give it the uniforms of the frame
+	void UseShaderVariant(uint32_t features);
+	// pass the scene wide lights and the cluster grid to the
+	// passed in program
+	void SetLightUniforms(ShaderManager* pShader);
+	void SetClusterUniforms(ShaderManager* pShader);
+	// assign the point lights to the clusters of the camera
+	// and pass them to the shader
+	void UpdateClusteredLights();
+	// the program that takes the light uniforms
+	ShaderManager* GetLightShader();
+	// draw the opaque objects into the G-buffer, then light it
+	void BeginGeometryPass();
+	void EndGeometryPass();
+	// lay down the depth of the opaque draws of the queue
+	void RunDepthPrepass();
+	void EndDepthPrepass();
+	// draw the scene with the software renderer and copy it
+	// into the bound framebuffer
+	void RenderSceneSoftware();
+	// describe the objects with a mesh for the CPU renderers,
+	// or only the static ones
+	void BuildSoftwareDraws(std::vector<SoftwareRenderer::DRAW>& draws, bool bStaticOnly);
+	// describe the materials and light sources for the CPU
+	// renderers
+	void BuildSoftwareLighting(
+		std::vector<SoftwareRenderer::MATERIAL>& materials,
+		std::vector<SoftwareRenderer::LIGHT>& lights,
+		std::vector<SoftwareRenderer::POINT_LIGHT>& pointLights);
+	// pass the prepared scene to the CPU renderers
+	void SetupSoftwareScene();
+	// load or bake the lightmap of the static batches and put
+	// it into the next texture slot
+	void BakeLightmaps();
 
 public:
 
+	// get the object transforms, for moving scene objects
+	TransformStore& GetTransforms() { return m_transforms; }
+
+	// get the draw and state change counts of the last frame
+	const RenderQueue::RENDER_STATS& GetRenderStats() const { return m_renderQueue.GetStats(); }
+	// get the allocation counters of the last frame
+	FrameArena::ARENA_STATS GetFrameArenaStats() const { return m_frameArena.GetStats(); }
+	// get the sample counts of the depth pre-pass, which are
+	// all zero when the scene does not use it
+	DepthPrepass::PREPASS_STATS GetDepthPrepassStats() const;
+	// get the light cluster counters of the last frame
+	const ClusteredLighting::CLUSTER_STATS& GetClusterStats() const { return m_pClusteredLighting->GetStats(); }
+
+	// use the deferred shading path - call before the scene
+	// is prepared
+	bool EnableDeferredShading();
+	// draw the scene on the CPU with the software renderer -
+	// call before the scene is prepared
+	void EnableSoftwareRendering();
+	// set up the path tracer for reference images - call
+	// before the scene is prepared
+	void EnablePathTracing();
+	// path trace the scene from the camera of this frame into
+	// RGBA pixels, bottom row first
+	bool RenderReference(int width, int height, int samples, std::vector<unsigned char>& pixels);
+
+	// watch the shader and texture files of the prepared
+	// scene, and reload them when they change on disk
+	void EnableHotReload();
+	// pick up the reloaded shaders and textures - call
+	// between frames
+	void ReloadChangedAssets();
+
+	// set the camera matrices used for culling and shading
+	// this frame
+	void SetViewTransform(
+		const glm::mat4& view,
+		const glm::mat4& projection);
+
 	// The following methods are for the students to 
 	// customize for their own 3D scene
-	void PrepareScene();
+	// load the passed in scene file, or the default scene
+	// when no file is passed in
+	void PrepareScene(const char* sceneFilename = NULL);
 	void RenderScene();
 
 	// pre-set light sources for 3D scene
@@ -0,0 +1,452 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenesnapshot.cpp
+// ============
+// memory mapped scene snapshots that are used in place
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneSnapshot.h"
+#include "ShapeMeshes.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// snapshot files start with this tag and version
+	const char g_SnapshotMagic[4] = { 'S', 'C', 'N', 'S' };
+	const uint32_t g_SnapshotVersion = 3;
+	// every section starts on a cache line
+	const uint64_t g_SectionAlignment = 64;
+
+	// the sections of a snapshot file
+	enum SNAPSHOT_SECTION_ID
+	{
+		SECTION_STRINGS,
+		SECTION_TEXTURES,
+		SECTION_MATERIALS,
+		SECTION_LIGHTS,
+		SECTION_MESHES,
+		SECTION_FLAGS,
+		SECTION_PARENTS,
+		SECTION_TEXTURE_INDICES,
+		SECTION_MATERIAL_INDICES,
+		SECTION_SCALES,
+		SECTION_ROTATIONS,
+		SECTION_POSITIONS,
+		SECTION_COLORS,
+		SECTION_UV_SCALES,
+		SECTION_MODEL_MATRICES,
+		SECTION_BOUNDS_MIN,
+		SECTION_BOUNDS_MAX,
+		SECTION_COUNT
+	};
+
+	// location of a section, relative to the start of the file
+	struct SNAPSHOT_SECTION
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct SNAPSHOT_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t objectCount;
+		uint32_t textureCount;
+		uint32_t materialCount;
+		uint32_t lightCount;
+		uint32_t sectionCount;
+		uint32_t renderFlags;
+		SNAPSHOT_SECTION sections[SECTION_COUNT];
+	};
+
+	// strings are stored in the string section and referenced
+	// by their offset into it
+	struct SNAPSHOT_STRING
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	struct SNAPSHOT_TEXTURE
+	{
+		SNAPSHOT_STRING tag;
+		SNAPSHOT_STRING filename;
+	};
+
+	struct SNAPSHOT_MATERIAL
+	{
+		SNAPSHOT_STRING tag;
+		float ambientStrength;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	// the file layout must not depend on the compiler
+	static_assert(sizeof(SNAPSHOT_HEADER) == 32 + SECTION_COUNT * 16, "unexpected snapshot header layout");
+	static_assert(sizeof(SNAPSHOT_TEXTURE) == 16, "unexpected snapshot texture layout");
+	static_assert(sizeof(SNAPSHOT_MATERIAL) == 52, "unexpected snapshot material layout");
+	static_assert(sizeof(SceneData::LIGHT) == 18 * sizeof(float), "unexpected scene light layout");
+	static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "glm::mat4 must be tightly packed");
+
+	// size of one element of every section - the string
+	// section is a plain block of characters
+	const uint64_t g_SectionElementSizes[SECTION_COUNT] = {
+		1,
+		sizeof(SNAPSHOT_TEXTURE),
+		sizeof(SNAPSHOT_MATERIAL),
+		sizeof(SceneData::LIGHT),
+		sizeof(uint8_t),
+		sizeof(uint8_t),
+		sizeof(int32_t),
+		sizeof(int16_t),
+		sizeof(int16_t),
+		sizeof(glm::vec3),
+		sizeof(glm::vec3),
+		sizeof(glm::vec3),
+		sizeof(glm::vec4),
+		sizeof(glm::vec2),
+		sizeof(glm::mat4),
+		sizeof(glm::vec3),
+		sizeof(glm::vec3)
+	};
+
+	// add a string to the string section
+	SNAPSHOT_STRING AddString(std::string& strings, const std::string& value)
+	{
+		SNAPSHOT_STRING result;
+		result.offset = (uint32_t)strings.size();
+		result.length = (uint32_t)value.size();
+		strings += value;
+		return(result);
+	}
+
+	// read a string from the string section, checking that it
+	// lies inside of the section
+	bool ReadString(const char* strings, uint64_t stringsSize, const SNAPSHOT_STRING& value, std::string& result)
+	{
+		if ((uint64_t)value.offset + value.length > stringsSize)
+		{
+			return(false);
+		}
+		result.assign(strings + value.offset, value.length);
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  SceneSnapshot()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneSnapshot::SceneSnapshot()
+{
+	memset(&m_objects, 0, sizeof(m_objects));
+}
+
+/***********************************************************
+ *  IsSnapshotFile()
+ *
+ *  This method is used for checking whether the passed in
+ *  filename has the .scenesnap extension.
+ ***********************************************************/
+bool SceneSnapshot::IsSnapshotFile(const char* filename)
+{
+	size_t length = strlen(filename);
+	const char* snapshotExtension = ".scenesnap";
+	size_t extensionLength = strlen(snapshotExtension);
+
+	return((length >= extensionLength) && (strcmp(filename + length - extensionLength, snapshotExtension) == 0));
+}
+
+/***********************************************************
+ *  SaveSnapshot()
+ *
+ *  This method is used for writing a snapshot of the passed
+ *  in scene.  The layout is calculated first and then every
+ *  section is written with padding up to its offset.
+ ***********************************************************/
+bool SceneSnapshot::SaveSnapshot(const char* filename, const SceneData& scene)
+{
+	size_t objectCount = scene.GetObjectCount();
+	if ((scene.modelMatrices.size() != objectCount) ||
+		(scene.boundsMin.size() != objectCount) ||
+		(scene.boundsMax.size() != objectCount))
+	{
+		std::cout << "Scene derived data is missing, cannot write snapshot:" << filename << std::endl;
+		return(false);
+	}
+
+	// gather the shared resources and their strings
+	std::string strings;
+	std::vector<SNAPSHOT_TEXTURE> textures(scene.textures.size());
+	std::vector<SNAPSHOT_MATERIAL> materials(scene.materials.size());
+
+	for (size_t i = 0; i < scene.textures.size(); i++)
+	{
+		textures[i].tag = AddString(strings, scene.textures[i].tag);
+		textures[i].filename = AddString(strings, scene.textures[i].filename);
+	}
+	for (size_t i = 0; i < scene.materials.size(); i++)
+	{
+		const SceneData::MATERIAL& material = scene.materials[i];
+		materials[i].tag = AddString(strings, material.tag);
+		materials[i].ambientStrength = material.ambientStrength;
+		materials[i].ambientColor = material.ambientColor;
+		materials[i].diffuseColor = material.diffuseColor;
+		materials[i].specularColor = material.specularColor;
+		materials[i].shininess = material.shininess;
+	}
+
+	const void* sectionData[SECTION_COUNT] = {
+		strings.data(),
+		textures.data(),
+		materials.data(),
+		scene.lights.data(),
+		scene.meshes.data(),
+		scene.flags.data(),
+		scene.parents.data(),
+		scene.textureIndices.data(),
+		scene.materialIndices.data(),
+		scene.scales.data(),
+		scene.rotations.data(),
+		scene.positions.data(),
+		scene.colors.data(),
+		scene.uvScales.data(),
+		scene.modelMatrices.data(),
+		scene.boundsMin.data(),
+		scene.boundsMax.data()
+	};
+
+	SNAPSHOT_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, g_SnapshotMagic, sizeof(header.magic));
+	header.version = g_SnapshotVersion;
+	header.objectCount = (uint32_t)objectCount;
+	header.textureCount = (uint32_t)textures.size();
+	header.materialCount = (uint32_t)materials.size();
+	header.lightCount = (uint32_t)scene.lights.size();
+	header.sectionCount = SECTION_COUNT;
+	header.renderFlags = scene.renderFlags;
+
+	uint64_t offset = sizeof(header);
+	for (int section = 0; section < SECTION_COUNT; section++)
+	{
+		uint64_t elementCount = objectCount;
+		if (section == SECTION_STRINGS)
+			elementCount = strings.size();
+		else if (section == SECTION_TEXTURES)
+			elementCount = header.textureCount;
+		else if (section == SECTION_MATERIALS)
+			elementCount = header.materialCount;
+		else if (section == SECTION_LIGHTS)
+			elementCount = header.lightCount;
+
+		offset = (offset + g_SectionAlignment - 1) & ~(g_SectionAlignment - 1);
+		header.sections[section].offset = offset;
+		header.sections[section].size = elementCount * g_SectionElementSizes[section];
+		offset += header.sections[section].size;
+	}
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not create snapshot file:" << filename << std::endl;
+		return(false);
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	uint64_t written = sizeof(header);
+	const char padding[g_SectionAlignment] = { 0 };
+
+	for (int section = 0; section < SECTION_COUNT; section++)
+	{
+		file.write(padding, (std::streamsize)(header.sections[section].offset - written));
+		if (header.sections[section].size > 0)
+		{
+			file.write((const char*)sectionData[section], (std::streamsize)header.sections[section].size);
+		}
+		written = header.sections[section].offset + header.sections[section].size;
+	}
+
+	bool bSuccess = file.good();
+	file.close();
+
+	if (bSuccess == false)
+	{
+		std::cout << "Could not write snapshot file:" << filename << std::endl;
+	}
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a snapshot file.  Only
+ *  the header is checked in full - every section has to lie
+ *  inside of the file with the size expected for its element
+ *  count.  The mesh, texture and material indices are also
+ *  range checked since they are used to index other arrays,
+ *  and the parents have to be in breadth first order.
+ ***********************************************************/
+bool SceneSnapshot::Open(const char* filename)
+{
+	Close();
+
+	if (m_file.Open(filename) == false)
+	{
+		return(false);
+	}
+
+	const SNAPSHOT_HEADER* pHeader = (const SNAPSHOT_HEADER*)m_file.GetData();
+	uint64_t fileSize = m_file.GetSize();
+
+	bool bValid = (fileSize >= sizeof(SNAPSHOT_HEADER)) &&
+		(memcmp(pHeader->magic, g_SnapshotMagic, sizeof(pHeader->magic)) == 0) &&
+		(pHeader->version == g_SnapshotVersion) &&
+		(pHeader->sectionCount == SECTION_COUNT);
+
+	for (int section = 0; bValid && (section < SECTION_COUNT); section++)
+	{
+		const SNAPSHOT_SECTION& location = pHeader->sections[section];
+
+		uint64_t elementCount = pHeader->objectCount;
+		if (section == SECTION_STRINGS)
+			elementCount = location.size;
+		else if (section == SECTION_TEXTURES)
+			elementCount = pHeader->textureCount;
+		else if (section == SECTION_MATERIALS)
+			elementCount = pHeader->materialCount;
+		else if (section == SECTION_LIGHTS)
+			elementCount = pHeader->lightCount;
+
+		bValid = ((location.offset % g_SectionAlignment) == 0) &&
+			(location.offset <= fileSize) &&
+			(location.size <= fileSize - location.offset) &&
+			(location.size == elementCount * g_SectionElementSizes[section]);
+	}
+
+	if (bValid)
+	{
+		m_objects.count = pHeader->objectCount;
+		m_objects.meshes = (const uint8_t*)GetSection(SECTION_MESHES);
+		m_objects.flags = (const uint8_t*)GetSection(SECTION_FLAGS);
+		m_objects.parents = (const int32_t*)GetSection(SECTION_PARENTS);
+		m_objects.textureIndices = (const int16_t*)GetSection(SECTION_TEXTURE_INDICES);
+		m_objects.materialIndices = (const int16_t*)GetSection(SECTION_MATERIAL_INDICES);
+		m_objects.scales = (const glm::vec3*)GetSection(SECTION_SCALES);
+		m_objects.rotations = (const glm::vec3*)GetSection(SECTION_ROTATIONS);
+		m_objects.positions = (const glm::vec3*)GetSection(SECTION_POSITIONS);
+		m_objects.colors = (const glm::vec4*)GetSection(SECTION_COLORS);
+		m_objects.uvScales = (const glm::vec2*)GetSection(SECTION_UV_SCALES);
+		m_objects.modelMatrices = (const glm::mat4*)GetSection(SECTION_MODEL_MATRICES);
+		m_objects.boundsMin = (const glm::vec3*)GetSection(SECTION_BOUNDS_MIN);
+		m_objects.boundsMax = (const glm::vec3*)GetSection(SECTION_BOUNDS_MAX);
+
+		int lastParent = -1;
+		for (size_t i = 0; bValid && (i < m_objects.count); i++)
+		{
+			int parent = m_objects.parents[i];
+			bValid = ((m_objects.meshes[i] < ShapeMeshes::SHAPE_COUNT) || (m_objects.meshes[i] == SceneData::NO_MESH)) &&
+				(parent >= lastParent) && (parent < (int)i) &&
+				(m_objects.textureIndices[i] >= -1) &&
+				(m_objects.textureIndices[i] < (int)pHeader->textureCount) &&
+				(m_objects.materialIndices[i] >= -1) &&
+				(m_objects.materialIndices[i] < (int)pHeader->materialCount);
+			lastParent = parent;
+		}
+	}
+
+	if (bValid == false)
+	{
+		std::cout << "Could not use snapshot file:" << filename << std::endl;
+		Close();
+		return(false);
+	}
+
+	std::cout << "Successfully mapped snapshot:" << filename << ", objects:" << m_objects.count << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the snapshot file.
+ ***********************************************************/
+void SceneSnapshot::Close()
+{
+	m_file.Close();
+	memset(&m_objects, 0, sizeof(m_objects));
+}
+
+/***********************************************************
+ *  GetSection()
+ *
+ *  This method is used for getting the start of a section of
+ *  the mapped snapshot.
+ ***********************************************************/
+const char* SceneSnapshot::GetSection(int section) const
+{
+	const SNAPSHOT_HEADER* pHeader = (const SNAPSHOT_HEADER*)m_file.GetData();
+	return((const char*)m_file.GetData() + pHeader->sections[section].offset);
+}
+
+/***********************************************************
+ *  GetResources()
+ *
+ *  This method is used for copying the textures, materials,
+ *  lights and render settings out of the snapshot.  These lists are short
+ *  and hold strings, so they are not used in place.
+ ***********************************************************/
+void SceneSnapshot::GetResources(SceneData& scene) const
+{
+	scene.Clear();
+	if (IsOpen() == false)
+	{
+		return;
+	}
+
+	const SNAPSHOT_HEADER* pHeader = (const SNAPSHOT_HEADER*)m_file.GetData();
+	const char* strings = GetSection(SECTION_STRINGS);
+	uint64_t stringsSize = pHeader->sections[SECTION_STRINGS].size;
+
+	const SNAPSHOT_TEXTURE* textures = (const SNAPSHOT_TEXTURE*)GetSection(SECTION_TEXTURES);
+	for (uint32_t i = 0; i < pHeader->textureCount; i++)
+	{
+		SceneData::TEXTURE texture;
+		if ((ReadString(strings, stringsSize, textures[i].tag, texture.tag) == false) ||
+			(ReadString(strings, stringsSize, textures[i].filename, texture.filename) == false))
+		{
+			std::cout << "Snapshot texture " << i << " has an invalid name" << std::endl;
+		}
+		scene.textures.push_back(texture);
+	}
+
+	const SNAPSHOT_MATERIAL* materials = (const SNAPSHOT_MATERIAL*)GetSection(SECTION_MATERIALS);
+	for (uint32_t i = 0; i < pHeader->materialCount; i++)
+	{
+		SceneData::MATERIAL material;
+		if (ReadString(strings, stringsSize, materials[i].tag, material.tag) == false)
+		{
+			std::cout << "Snapshot material " << i << " has an invalid name" << std::endl;
+		}
+		material.ambientStrength = materials[i].ambientStrength;
+		material.ambientColor = materials[i].ambientColor;
+		material.diffuseColor = materials[i].diffuseColor;
+		material.specularColor = materials[i].specularColor;
+		material.shininess = materials[i].shininess;
+		scene.materials.push_back(material);
+	}
+
+	const SceneData::LIGHT* lights = (const SceneData::LIGHT*)GetSection(SECTION_LIGHTS);
+	scene.lights.assign(lights, lights + pHeader->lightCount);
+	scene.renderFlags = pHeader->renderFlags;
+}
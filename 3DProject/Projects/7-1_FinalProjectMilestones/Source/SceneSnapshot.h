@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenesnapshot.h
+// ============
+// memory mapped scene snapshots that are used in place
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneLoader.h"
+#include "MappedFile.h"
+
+/***********************************************************
+ *  SceneSnapshot
+ *
+ *  This class writes and opens scene snapshots (.scenesnap).
+ *  A snapshot is a header followed by flat arrays that are
+ *  found through offsets from the start of the file, so the
+ *  file is mapped into memory and the per object arrays are
+ *  used directly without parsing or copying.  Along with the
+ *  scene values the snapshot holds the model matrices and
+ *  the world space bounds of every object.
+ ***********************************************************/
+class SceneSnapshot
+{
+public:
+	// constructor
+	SceneSnapshot();
+
+	// check whether a filename has the snapshot extension
+	static bool IsSnapshotFile(const char* filename);
+	// write a snapshot of the passed in scene
+	static bool SaveSnapshot(const char* filename, const SceneData& scene);
+
+	// map a snapshot file and check its layout
+	bool Open(const char* filename);
+	// unmap the snapshot file
+	void Close();
+	bool IsOpen() const { return m_file.IsOpen(); }
+
+	// copy the textures, materials, lights and render settings
+	// into the scene - the per object arrays are left empty
+	void GetResources(SceneData& scene) const;
+	// get pointers to the per object arrays in the mapping,
+	// which stay valid until the snapshot is closed
+	const SCENE_OBJECTS& GetObjects() const { return m_objects; }
+
+private:
+	// get the start of a section of the mapped file
+	const char* GetSection(int section) const;
+
+	MappedFile m_file;
+	SCENE_OBJECTS m_objects;
+};
@@ -0,0 +1,885 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerenderer.cpp
+// ============
+// tile based rasterizer drawing the scene on the CPU
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRenderer.h"
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// SSE2 is available on every x64 target and on x86 builds
+// that use the default /arch:SSE2 code generation
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define SOFTWARE_USE_SSE2 1
+#endif
+
+// declaration of global variables
+namespace
+{
+	const int TILE_SIZE = 64;
+
+	// triangles of the frame set up by one chunk, which is
+	// small enough for the clipped triangles of a chunk to be
+	// found with g_LocalBits bits
+	const size_t g_ChunkTriangles = 4096;
+	const int g_LocalBits = 14;
+	const uint32_t g_NoTriangle = 0xFFFFFFFF;
+
+	// the frame is cleared the same as the window
+	const float g_ClearDepth = 1.0f;
+	const uint32_t g_ClearColor = 0xFF000000;
+
+	// the uniforms of a program without a material
+	const SoftwareRenderer::MATERIAL g_NoMaterial = { glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f };
+
+	// the specular exponent of the shaders is always 32
+	float SpecularPower(float value)
+	{
+		value *= value;
+		value *= value;
+		value *= value;
+		value *= value;
+		return(value * value);
+	}
+
+	// CalcLightSource() of lighting.glsl
+	glm::vec3 CalcLightSource(
+		const SoftwareRenderer::LIGHT& light,
+		const SoftwareRenderer::MATERIAL& material,
+		const glm::vec3& lightNormal,
+		const glm::vec3& vertexPosition,
+		const glm::vec3& viewDirection)
+	{
+		glm::vec3 ambient = light.ambientColor + (material.ambientColor * material.ambientStrength);
+
+		glm::vec3 lightDirection = glm::normalize(light.position - vertexPosition);
+		float impact = std::max(glm::dot(lightNormal, lightDirection), 0.0f);
+		glm::vec3 diffuse = impact * material.diffuseColor;
+
+		glm::vec3 reflectDir = glm::reflect(-lightDirection, lightNormal);
+		float specularComponent = SpecularPower(std::max(glm::dot(viewDirection, reflectDir), 0.0f));
+		glm::vec3 specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
+
+		return(ambient + diffuse + specular);
+	}
+
+	// CalcPointLight() of lighting.glsl
+	glm::vec3 CalcPointLight(
+		const SoftwareRenderer::POINT_LIGHT& light,
+		const SoftwareRenderer::MATERIAL& material,
+		const glm::vec3& lightNormal,
+		const glm::vec3& vertexPosition,
+		const glm::vec3& viewDirection)
+	{
+		glm::vec3 toLight = light.position - vertexPosition;
+		float distanceSquared = glm::dot(toLight, toLight);
+		float falloff = glm::clamp(1.0f - distanceSquared / (light.range * light.range), 0.0f, 1.0f);
+		falloff *= falloff;
+
+		glm::vec3 lightDirection = toLight / std::sqrt(std::max(distanceSquared, 0.0001f));
+		float impact = std::max(glm::dot(lightNormal, lightDirection), 0.0f);
+		glm::vec3 diffuse = impact * light.diffuseColor * material.diffuseColor;
+
+		glm::vec3 reflectDir = glm::reflect(-lightDirection, lightNormal);
+		float specularComponent = SpecularPower(std::max(glm::dot(viewDirection, reflectDir), 0.0f));
+		glm::vec3 specular = (light.specularIntensity * material.shininess) * specularComponent * light.specularColor * material.specularColor;
+
+		return(falloff * (diffuse + specular));
+	}
+
+	// test a block of four pixels of a row, starting at x,
+	// against the edges and the depth buffer - the depths of
+	// the triangle are written to z and the covered pixels are
+	// returned as bits.  The edge functions are evaluated the
+	// same way for every triangle, so the two triangles of a
+	// shared edge get exactly opposite values and the top left
+	// rule gives each pixel on it to one of them.
+	int TestBlock(
+		const float* edgeA,
+		const float* edgeB,
+		const float* edgeC,
+		uint32_t topLeftMask,
+		const float* zPlane,
+		int x,
+		float py,
+		const float* depths,
+		float* z)
+	{
+#ifdef SOFTWARE_USE_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		__m128 px = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int i = 0; i < 3; i++)
+		{
+			__m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[i]), px), _mm_set1_ps(edgeB[i] * py + edgeC[i]));
+			__m128 test = (topLeftMask & (1u << i)) ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero);
+			inside = _mm_and_ps(inside, test);
+		}
+
+		__m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zPlane[0]), px), _mm_set1_ps(zPlane[1] * py + zPlane[2]));
+		inside = _mm_and_ps(inside, _mm_cmplt_ps(depth, _mm_loadu_ps(depths)));
+		_mm_storeu_ps(z, depth);
+
+		return(_mm_movemask_ps(inside));
+#else
+		int covered = 0;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			float px = (float)x + (0.5f + (float)lane);
+			bool bInside = true;
+			for (int i = 0; i < 3; i++)
+			{
+				float edge = edgeA[i] * px + (edgeB[i] * py + edgeC[i]);
+				bInside = bInside && ((topLeftMask & (1u << i)) ? (edge >= 0.0f) : (edge > 0.0f));
+			}
+
+			z[lane] = zPlane[0] * px + (zPlane[1] * py + zPlane[2]);
+			if (bInside && (z[lane] < depths[lane]))
+			{
+				covered |= 1 << lane;
+			}
+		}
+		return(covered);
+#endif
+	}
+}
+
+/***********************************************************
+ *  SoftwareRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRenderer::SoftwareRenderer(ThreadPool* pThreadPool)
+{
+	m_pThreadPool = pThreadPool;
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_viewProjection = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_firstTransparentDraw = 0;
+	m_chunkCount = 0;
+	m_stats = RASTER_STATS();
+	m_presentTexture = 0;
+	m_presentFramebuffer = 0;
+	m_presentWidth = 0;
+	m_presentHeight = 0;
+}
+
+/***********************************************************
+ *  ~SoftwareRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRenderer::~SoftwareRenderer()
+{
+	if (m_presentFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_presentFramebuffer);
+	}
+	if (m_presentTexture != 0)
+	{
+		glDeleteTextures(1, &m_presentTexture);
+	}
+	m_pThreadPool = NULL;
+}
+
+/***********************************************************
+ *  SetTexture()
+ *
+ *  This method is used for copying an RGB or RGBA texture
+ *  image into the passed in slot.
+ ***********************************************************/
+bool SoftwareRenderer::SetTexture(int slot, const unsigned char* pixels, int width, int height, int channels)
+{
+	if (slot < 0)
+	{
+		return(false);
+	}
+
+	if ((size_t)slot >= m_textures.size())
+	{
+		m_textures.resize(slot + 1);
+	}
+	return(m_textures[slot].SetImage(pixels, width, height, channels));
+}
+
+/***********************************************************
+ *  SetMaterials()
+ *
+ *  This method is used for setting the materials that the
+ *  draws refer to by index.
+ ***********************************************************/
+void SoftwareRenderer::SetMaterials(const std::vector<MATERIAL>& materials)
+{
+	m_materials = materials;
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for setting the scene wide lights
+ *  and the point lights.
+ ***********************************************************/
+void SoftwareRenderer::SetLights(const std::vector<LIGHT>& lights, const std::vector<POINT_LIGHT>& pointLights)
+{
+	m_lights = lights;
+	m_pointLights = pointLights;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a new frame.
+ ***********************************************************/
+void SoftwareRenderer::BeginFrame(int width, int height, const glm::mat4& view, const glm::mat4& projection)
+{
+	m_width = std::max(width, 0);
+	m_height = std::max(height, 0);
+	m_tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+	m_viewProjection = projection * view;
+	m_viewPosition = glm::vec3(glm::inverse(view)[3]);
+	m_draws.clear();
+	m_stats = RASTER_STATS();
+}
+
+/***********************************************************
+ *  AddDraw()
+ *
+ *  This method is used for adding a mesh to the frame.
+ ***********************************************************/
+void SoftwareRenderer::AddDraw(const DRAW& draw)
+{
+	m_draws.push_back(draw);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for drawing the frame.  The opaque
+ *  draws are sorted front to back, so later triangles fail
+ *  the depth test early, and the transparent draws follow
+ *  back to front, the same order as the OpenGL path.
+ ***********************************************************/
+void SoftwareRenderer::EndFrame()
+{
+	size_t drawCount = m_draws.size();
+	m_stats.drawCount = (int)drawCount;
+
+	// sort by the distance of the draw origin from the camera,
+	// which is what the render queue sorts by
+	std::vector<std::pair<float, uint32_t> > order(drawCount);
+	for (size_t i = 0; i < drawCount; i++)
+	{
+		order[i].first = glm::length(glm::vec3(m_draws[i].model[3]) - m_viewPosition);
+		order[i].second = (uint32_t)i;
+	}
+	const std::vector<DRAW>& draws = m_draws;
+	std::stable_sort(order.begin(), order.end(),
+		[&draws](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b)
+	{
+		bool bTransparentA = draws[a.second].bTransparent;
+		bool bTransparentB = draws[b.second].bTransparent;
+		if (bTransparentA != bTransparentB)
+		{
+			return(bTransparentB);
+		}
+		return(bTransparentA ? (a.first > b.first) : (a.first < b.first));
+	});
+
+	std::vector<DRAW> sortedDraws(drawCount);
+	m_firstTransparentDraw = drawCount;
+	for (size_t i = 0; i < drawCount; i++)
+	{
+		sortedDraws[i] = m_draws[order[i].second];
+		if (sortedDraws[i].bTransparent && (m_firstTransparentDraw == drawCount))
+		{
+			m_firstTransparentDraw = i;
+		}
+	}
+	m_draws.swap(sortedDraws);
+
+	m_vertexOffsets.resize(drawCount + 1);
+	m_triangleOffsets.resize(drawCount + 1);
+	m_vertexOffsets[0] = 0;
+	m_triangleOffsets[0] = 0;
+	for (size_t i = 0; i < drawCount; i++)
+	{
+		m_vertexOffsets[i + 1] = m_vertexOffsets[i] + m_draws[i].vertexCount;
+		m_triangleOffsets[i + 1] = m_triangleOffsets[i] + m_draws[i].indexCount / 3;
+	}
+	m_vertices.resize(m_vertexOffsets[drawCount]);
+	m_culled.assign(drawCount, 0);
+	m_drawLights.resize(drawCount);
+
+	m_pThreadPool->ParallelFor((int)drawCount, [this](int drawIndex)
+	{
+		ProcessDraw(drawIndex);
+	});
+
+	m_chunkCount = (m_triangleOffsets[drawCount] + g_ChunkTriangles - 1) / g_ChunkTriangles;
+	if (m_chunks.size() < m_chunkCount)
+	{
+		m_chunks.resize(m_chunkCount);
+	}
+	m_pThreadPool->ParallelFor((int)m_chunkCount, [this](int chunkIndex)
+	{
+		SetupChunk(chunkIndex);
+	});
+
+	for (size_t i = 0; i < drawCount; i++)
+	{
+		m_stats.culledCount += m_culled[i];
+	}
+	for (size_t chunk = 0; chunk < m_chunkCount; chunk++)
+	{
+		m_stats.triangleCount += (int)m_chunks[chunk].triangles.size();
+		for (size_t tile = 0; tile < m_chunks[chunk].bins.size(); tile++)
+		{
+			m_stats.binnedCount += (int)m_chunks[chunk].bins[tile].size();
+		}
+	}
+
+	// the tiles take very different times, so the work
+	// stealing of the pool keeps every thread busy
+	m_pixels.resize((size_t)m_width * m_height);
+	m_pThreadPool->ParallelFor(m_tilesX * m_tilesY, [this](int tileIndex)
+	{
+		RenderTile(tileIndex);
+	});
+}
+
+/***********************************************************
+ *  ProcessDraw()
+ *
+ *  This method is used for transforming the vertices of a
+ *  draw with the same matrices as the vertex shader.  A draw
+ *  whose bounding box is outside one of the clip planes is
+ *  dropped, and the point lights reaching its box are kept
+ *  for shading it.
+ ***********************************************************/
+void SoftwareRenderer::ProcessDraw(int drawIndex)
+{
+	const DRAW& draw = m_draws[drawIndex];
+	const glm::mat4* pModel = &draw.model;
+	glm::mat4 modelViewProjection;
+	glm::mat3 normalMatrix;
+	TransformStore::ComputeDrawMatrices(m_viewProjection, &pModel, 1, &modelViewProjection, &normalMatrix);
+
+	uint32_t outsideAll = 0x3F;
+	glm::vec3 worldMin(FLT_MAX);
+	glm::vec3 worldMax(-FLT_MAX);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 local(
+			(corner & 1) ? draw.boundsMax.x : draw.boundsMin.x,
+			(corner & 2) ? draw.boundsMax.y : draw.boundsMin.y,
+			(corner & 4) ? draw.boundsMax.z : draw.boundsMin.z,
+			1.0f);
+		glm::vec4 clip = modelViewProjection * local;
+
+		uint32_t outside = 0;
+		outside |= (clip.x < -clip.w) ? 0x01 : 0;
+		outside |= (clip.x > clip.w) ? 0x02 : 0;
+		outside |= (clip.y < -clip.w) ? 0x04 : 0;
+		outside |= (clip.y > clip.w) ? 0x08 : 0;
+		outside |= (clip.z < -clip.w) ? 0x10 : 0;
+		outside |= (clip.z > clip.w) ? 0x20 : 0;
+		outsideAll &= outside;
+
+		glm::vec3 world = glm::vec3(draw.model * local);
+		worldMin = glm::min(worldMin, world);
+		worldMax = glm::max(worldMax, world);
+	}
+	if (outsideAll != 0)
+	{
+		m_culled[drawIndex] = 1;
+		return;
+	}
+
+	std::vector<uint32_t>& lights = m_drawLights[drawIndex];
+	lights.clear();
+	for (size_t i = 0; i < m_pointLights.size(); i++)
+	{
+		const POINT_LIGHT& light = m_pointLights[i];
+		glm::vec3 offset = glm::clamp(light.position, worldMin, worldMax) - light.position;
+		if (glm::dot(offset, offset) < light.range * light.range)
+		{
+			lights.push_back((uint32_t)i);
+		}
+	}
+
+	SHADED_VERTEX* pOutput = m_vertices.data() + m_vertexOffsets[drawIndex];
+	for (size_t v = 0; v < draw.vertexCount; v++)
+	{
+		const GLfloat* vertex = draw.vertices + v * 8;
+		glm::vec4 position(vertex[0], vertex[1], vertex[2], 1.0f);
+
+		pOutput[v].clip = modelViewProjection * position;
+		pOutput[v].position = glm::vec3(draw.model * position);
+		pOutput[v].normal = normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+		pOutput[v].uv = glm::vec2(vertex[6], vertex[7]) * draw.uvScale;
+	}
+}
+
+/***********************************************************
+ *  SetupChunk()
+ *
+ *  This method is used for clipping and setting up one
+ *  chunk of the frame triangles, in draw order.  Every
+ *  chunk keeps its own bins, so the chunks never share
+ *  memory, and the tiles read the bins in chunk order to
+ *  keep the draw order.
+ ***********************************************************/
+void SoftwareRenderer::SetupChunk(int chunkIndex)
+{
+	TRIANGLE_CHUNK& chunk = m_chunks[chunkIndex];
+	chunk.triangles.clear();
+	chunk.bins.resize(m_tilesX * m_tilesY);
+	for (size_t tile = 0; tile < chunk.bins.size(); tile++)
+	{
+		chunk.bins[tile].clear();
+	}
+
+	size_t first = (size_t)chunkIndex * g_ChunkTriangles;
+	size_t last = std::min(first + g_ChunkTriangles, m_triangleOffsets.back());
+	size_t draw = (size_t)(std::upper_bound(m_triangleOffsets.begin(), m_triangleOffsets.end(), first) - m_triangleOffsets.begin()) - 1;
+
+	for (size_t triangle = first; triangle < last; triangle++)
+	{
+		while (triangle >= m_triangleOffsets[draw + 1])
+		{
+			draw++;
+		}
+		if (m_culled[draw])
+		{
+			continue;
+		}
+
+		const DRAW& drawData = m_draws[draw];
+		const GLuint* indices = drawData.indices + (triangle - m_triangleOffsets[draw]) * 3;
+		const SHADED_VERTEX* base = m_vertices.data() + m_vertexOffsets[draw];
+		const SHADED_VERTEX* vertices[3] = { base + indices[0], base + indices[1], base + indices[2] };
+
+		ClipTriangle(chunk, (uint32_t)draw, vertices);
+	}
+}
+
+/***********************************************************
+ *  ClipTriangle()
+ *
+ *  This method is used for clipping a clip space triangle
+ *  against the near plane.  The attributes are linear in
+ *  clip space, so the new vertices interpolate them the same
+ *  as their positions.  Everything past the other planes is
+ *  left to the bounding boxes and the depth test.
+ ***********************************************************/
+void SoftwareRenderer::ClipTriangle(TRIANGLE_CHUNK& chunk, uint32_t draw, const SHADED_VERTEX* vertices[3])
+{
+	float distance[3];
+	int insideCount = 0;
+
+	// signed distance to the OpenGL near plane (z = -w)
+	for (int i = 0; i < 3; i++)
+	{
+		distance[i] = vertices[i]->clip.z + vertices[i]->clip.w;
+		if (distance[i] >= 0.0f)
+		{
+			insideCount++;
+		}
+	}
+
+	if (insideCount == 0)
+	{
+		return;
+	}
+	if (insideCount == 3)
+	{
+		AddTriangle(chunk, draw, *vertices[0], *vertices[1], *vertices[2]);
+		return;
+	}
+
+	// one plane can turn a triangle into at most a quad
+	SHADED_VERTEX clipped[4];
+	int clippedCount = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int next = (i + 1) % 3;
+		if (distance[i] >= 0.0f)
+		{
+			clipped[clippedCount++] = *vertices[i];
+		}
+		if ((distance[i] >= 0.0f) != (distance[next] >= 0.0f))
+		{
+			float t = distance[i] / (distance[i] - distance[next]);
+			const SHADED_VERTEX& a = *vertices[i];
+			const SHADED_VERTEX& b = *vertices[next];
+
+			SHADED_VERTEX& vertex = clipped[clippedCount++];
+			vertex.clip = a.clip + (b.clip - a.clip) * t;
+			vertex.position = a.position + (b.position - a.position) * t;
+			vertex.normal = a.normal + (b.normal - a.normal) * t;
+			vertex.uv = a.uv + (b.uv - a.uv) * t;
+		}
+	}
+
+	for (int i = 1; i + 1 < clippedCount; i++)
+	{
+		AddTriangle(chunk, draw, clipped[0], clipped[i], clipped[i + 1]);
+	}
+}
+
+/***********************************************************
+ *  AddTriangle()
+ *
+ *  This method is used for projecting a clipped triangle to
+ *  the screen and computing its edge functions, depth plane
+ *  and pixel bounds.  Triangles are drawn from both sides,
+ *  like the OpenGL path, so clockwise ones are turned
+ *  around.  The triangle is added to the bin of every tile
+ *  that its edges do not rule out.
+ ***********************************************************/
+void SoftwareRenderer::AddTriangle(TRIANGLE_CHUNK& chunk, uint32_t draw, const SHADED_VERTEX& v0, const SHADED_VERTEX& v1, const SHADED_VERTEX& v2)
+{
+	const SHADED_VERTEX* vertices[3] = { &v0, &v1, &v2 };
+	glm::vec3 screen[3];
+	float inverseW[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec4& clip = vertices[i]->clip;
+		inverseW[i] = 1.0f / clip.w;
+		screen[i] = glm::vec3(
+			(clip.x * inverseW[i] * 0.5f + 0.5f) * m_width,
+			(clip.y * inverseW[i] * 0.5f + 0.5f) * m_height,
+			clip.z * inverseW[i] * 0.5f + 0.5f);
+	}
+
+	float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+	if ((area == 0.0f) || (std::isfinite(area) == false))
+	{
+		return;
+	}
+	// the edge functions expect counter clockwise triangles
+	if (area < 0.0f)
+	{
+		std::swap(vertices[1], vertices[2]);
+		std::swap(screen[1], screen[2]);
+		std::swap(inverseW[1], inverseW[2]);
+		area = -area;
+	}
+
+	SETUP_TRIANGLE triangle;
+	triangle.minX = std::max(0, (int)std::floor(std::min(screen[0].x, std::min(screen[1].x, screen[2].x))));
+	triangle.minY = std::max(0, (int)std::floor(std::min(screen[0].y, std::min(screen[1].y, screen[2].y))));
+	triangle.maxX = std::min(m_width - 1, (int)std::ceil(std::max(screen[0].x, std::max(screen[1].x, screen[2].x))));
+	triangle.maxY = std::min(m_height - 1, (int)std::ceil(std::max(screen[0].y, std::max(screen[1].y, screen[2].y))));
+	if ((triangle.minX > triangle.maxX) || (triangle.minY > triangle.maxY) ||
+		(std::min(screen[0].z, std::min(screen[1].z, screen[2].z)) > g_ClearDepth))
+	{
+		return;
+	}
+
+	triangle.topLeftMask = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec3& a = screen[(i + 1) % 3];
+		const glm::vec3& b = screen[(i + 2) % 3];
+		triangle.edgeA[i] = a.y - b.y;
+		triangle.edgeB[i] = b.x - a.x;
+		triangle.edgeC[i] = a.x * b.y - a.y * b.x;
+		if ((triangle.edgeA[i] > 0.0f) || ((triangle.edgeA[i] == 0.0f) && (triangle.edgeB[i] > 0.0f)))
+		{
+			triangle.topLeftMask |= 1u << i;
+		}
+
+		triangle.inverseW[i] = inverseW[i];
+		triangle.position[i] = vertices[i]->position;
+		triangle.normal[i] = vertices[i]->normal;
+		triangle.uv[i] = vertices[i]->uv;
+	}
+
+	// depth is linear in screen space after the perspective divide
+	triangle.zPlane[0] = ((screen[1].z - screen[0].z) * (screen[2].y - screen[0].y) - (screen[2].z - screen[0].z) * (screen[1].y - screen[0].y)) / area;
+	triangle.zPlane[1] = ((screen[2].z - screen[0].z) * (screen[1].x - screen[0].x) - (screen[1].z - screen[0].z) * (screen[2].x - screen[0].x)) / area;
+	triangle.zPlane[2] = screen[0].z - triangle.zPlane[0] * screen[0].x - triangle.zPlane[1] * screen[0].y;
+	triangle.inverseArea = 1.0f / area;
+	triangle.draw = draw;
+
+	uint16_t local = (uint16_t)chunk.triangles.size();
+	chunk.triangles.push_back(triangle);
+
+	// a tile is skipped when the corner of the tile furthest
+	// inside one of the edges is still outside it
+	for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++)
+		{
+			bool bOverlaps = true;
+			for (int i = 0; (i < 3) && bOverlaps; i++)
+			{
+				float x = (float)(tileX * TILE_SIZE + ((triangle.edgeA[i] > 0.0f) ? TILE_SIZE : 0));
+				float y = (float)(tileY * TILE_SIZE + ((triangle.edgeB[i] > 0.0f) ? TILE_SIZE : 0));
+				bOverlaps = (triangle.edgeA[i] * x + triangle.edgeB[i] * y + triangle.edgeC[i]) >= 0.0f;
+			}
+			if (bOverlaps)
+			{
+				chunk.bins[tileY * m_tilesX + tileX].push_back(local);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  RenderTile()
+ *
+ *  This method is used for drawing one tile of the frame.
+ *  The opaque triangles only write the depth and the
+ *  triangle of every pixel, and each covered pixel is then
+ *  shaded once, so hidden surfaces cost no shading.  The
+ *  transparent triangles come after the opaque ones in the
+ *  bins and are blended over the shaded tile in order.
+ ***********************************************************/
+void SoftwareRenderer::RenderTile(int tileIndex)
+{
+	int x0 = (tileIndex % m_tilesX) * TILE_SIZE;
+	int y0 = (tileIndex / m_tilesX) * TILE_SIZE;
+	int x1 = std::min(x0 + TILE_SIZE, m_width);
+	int y1 = std::min(y0 + TILE_SIZE, m_height);
+
+	float depths[TILE_SIZE * TILE_SIZE];
+	uint32_t triangleIDs[TILE_SIZE * TILE_SIZE];
+	for (int i = 0; i < TILE_SIZE * TILE_SIZE; i++)
+	{
+		depths[i] = g_ClearDepth;
+		triangleIDs[i] = g_NoTriangle;
+	}
+
+	// the opaque triangles, up to the first transparent one
+	size_t transparentChunk = m_chunkCount;
+	size_t transparentEntry = 0;
+	float z[4];
+	for (size_t chunkIndex = 0; (chunkIndex < m_chunkCount) && (transparentChunk == m_chunkCount); chunkIndex++)
+	{
+		const TRIANGLE_CHUNK& chunk = m_chunks[chunkIndex];
+		const std::vector<uint16_t>& bin = chunk.bins[tileIndex];
+		for (size_t entry = 0; entry < bin.size(); entry++)
+		{
+			const SETUP_TRIANGLE& triangle = chunk.triangles[bin[entry]];
+			if (triangle.draw >= m_firstTransparentDraw)
+			{
+				transparentChunk = chunkIndex;
+				transparentEntry = entry;
+				break;
+			}
+
+			uint32_t triangleID = (uint32_t)((chunkIndex << g_LocalBits) | bin[entry]);
+			int minX = std::max(triangle.minX, x0);
+			int maxX = std::min(triangle.maxX, x1 - 1);
+			int minY = std::max(triangle.minY, y0);
+			int maxY = std::min(triangle.maxY, y1 - 1);
+
+			// the blocks are aligned to the tile, so a block
+			// never reaches past the end of a tile row
+			int firstBlock = x0 + ((minX - x0) & ~3);
+			for (int y = minY; y <= maxY; y++)
+			{
+				float py = (float)y + 0.5f;
+				int row = (y - y0) * TILE_SIZE - x0;
+				for (int x = firstBlock; x <= maxX; x += 4)
+				{
+					int covered = TestBlock(triangle.edgeA, triangle.edgeB, triangle.edgeC, triangle.topLeftMask,
+						triangle.zPlane, x, py, depths + row + x, z);
+					for (int lane = 0; covered != 0; lane++, covered >>= 1)
+					{
+						if (covered & 1)
+						{
+							depths[row + x + lane] = z[lane];
+							triangleIDs[row + x + lane] = triangleID;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// shade the closest triangle of every pixel
+	for (int y = y0; y < y1; y++)
+	{
+		uint32_t* pixels = m_pixels.data() + (size_t)y * m_width;
+		const uint32_t* rowIDs = triangleIDs + (y - y0) * TILE_SIZE - x0;
+		for (int x = x0; x < x1; x++)
+		{
+			uint32_t triangleID = rowIDs[x];
+			if (triangleID == g_NoTriangle)
+			{
+				pixels[x] = g_ClearColor;
+				continue;
+			}
+
+			const SETUP_TRIANGLE& triangle = m_chunks[triangleID >> g_LocalBits].triangles[triangleID & ((1u << g_LocalBits) - 1)];
+			pixels[x] = TexelImage::PackColor(ShadePixel(triangle, (float)x + 0.5f, (float)y + 0.5f));
+		}
+	}
+
+	// blend the transparent triangles in order, testing but
+	// not writing the depth
+	for (size_t chunkIndex = transparentChunk; chunkIndex < m_chunkCount; chunkIndex++)
+	{
+		const TRIANGLE_CHUNK& chunk = m_chunks[chunkIndex];
+		const std::vector<uint16_t>& bin = chunk.bins[tileIndex];
+		size_t firstEntry = (chunkIndex == transparentChunk) ? transparentEntry : 0;
+		for (size_t entry = firstEntry; entry < bin.size(); entry++)
+		{
+			const SETUP_TRIANGLE& triangle = chunk.triangles[bin[entry]];
+			int minX = std::max(triangle.minX, x0);
+			int maxX = std::min(triangle.maxX, x1 - 1);
+			int minY = std::max(triangle.minY, y0);
+			int maxY = std::min(triangle.maxY, y1 - 1);
+
+			int firstBlock = x0 + ((minX - x0) & ~3);
+			for (int y = minY; y <= maxY; y++)
+			{
+				float py = (float)y + 0.5f;
+				int row = (y - y0) * TILE_SIZE - x0;
+				uint32_t* pixels = m_pixels.data() + (size_t)y * m_width;
+				for (int x = firstBlock; x <= maxX; x += 4)
+				{
+					int covered = TestBlock(triangle.edgeA, triangle.edgeB, triangle.edgeC, triangle.topLeftMask,
+						triangle.zPlane, x, py, depths + row + x, z);
+					for (int lane = 0; covered != 0; lane++, covered >>= 1)
+					{
+						// lanes past the frame edge are in the tile
+						// buffers but not in the frame
+						if (((covered & 1) == 0) || (x + lane >= x1))
+						{
+							continue;
+						}
+
+						glm::vec4 source = ShadePixel(triangle, (float)(x + lane) + 0.5f, py);
+						glm::vec4 destination = TexelImage::UnpackColor(pixels[x + lane]);
+						pixels[x + lane] = TexelImage::PackColor(source * source.a + destination * (1.0f - source.a));
+					}
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ShadePixel()
+ *
+ *  This method is used for shading a pixel of a triangle the
+ *  same as the scene fragment shader.  The screen space
+ *  weights of the vertices are divided by their w, which
+ *  makes the interpolation perspective correct.
+ ***********************************************************/
+glm::vec4 SoftwareRenderer::ShadePixel(const SETUP_TRIANGLE& triangle, float x, float y) const
+{
+	float weights[3];
+	float weightSum = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		float edge = triangle.edgeA[i] * x + (triangle.edgeB[i] * y + triangle.edgeC[i]);
+		weights[i] = std::max(edge * triangle.inverseArea, 0.0f) * triangle.inverseW[i];
+		weightSum += weights[i];
+	}
+	float inverseSum = (weightSum > 0.0f) ? (1.0f / weightSum) : 0.0f;
+
+	glm::vec3 position(0.0f);
+	glm::vec3 normal(0.0f);
+	glm::vec2 uv(0.0f);
+	for (int i = 0; i < 3; i++)
+	{
+		float weight = weights[i] * inverseSum;
+		position += triangle.position[i] * weight;
+		normal += triangle.normal[i] * weight;
+		uv += triangle.uv[i] * weight;
+	}
+
+	const DRAW& draw = m_draws[triangle.draw];
+	bool bTextured = (draw.texture >= 0) && ((size_t)draw.texture < m_textures.size()) &&
+		(m_textures[draw.texture].IsEmpty() == false);
+	glm::vec4 surfaceColor = bTextured ? m_textures[draw.texture].Sample(uv) : draw.color;
+
+	const MATERIAL& material = ((draw.material >= 0) && ((size_t)draw.material < m_materials.size())) ?
+		m_materials[draw.material] : g_NoMaterial;
+	glm::vec3 lightNormal = glm::normalize(normal);
+	glm::vec3 viewDirection = glm::normalize(m_viewPosition - position);
+
+	glm::vec3 phongResult(0.0f);
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		phongResult += CalcLightSource(m_lights[i], material, lightNormal, position, viewDirection);
+	}
+	const std::vector<uint32_t>& pointLights = m_drawLights[triangle.draw];
+	for (size_t i = 0; i < pointLights.size(); i++)
+	{
+		phongResult += CalcPointLight(m_pointLights[pointLights[i]], material, lightNormal, position, viewDirection);
+	}
+
+	return(glm::vec4(phongResult * glm::vec3(surfaceColor), bTextured ? 1.0f : surfaceColor.a));
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  This method is used for copying the frame into the bound
+ *  draw framebuffer.  The frame is loaded into a texture and
+ *  blitted, so it lands in the window or in an offscreen
+ *  target the same way.
+ ***********************************************************/
+void SoftwareRenderer::Present(int x, int y)
+{
+	if ((m_width <= 0) || (m_height <= 0))
+	{
+		return;
+	}
+
+	GLint boundTexture = 0;
+	GLint readFramebuffer = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+
+	if (m_presentTexture == 0)
+	{
+		glGenTextures(1, &m_presentTexture);
+		glGenFramebuffers(1, &m_presentFramebuffer);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_presentTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	if ((m_width != m_presentWidth) || (m_height != m_presentHeight))
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		m_presentWidth = m_width;
+		m_presentHeight = m_height;
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebuffer);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_presentTexture, 0);
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.data());
+	}
+	glBindTexture(GL_TEXTURE_2D, (GLuint)boundTexture);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebuffer);
+	glBlitFramebuffer(
+		0, 0, m_width, m_height,
+		x, y, x + m_width, y + m_height,
+		GL_COLOR_BUFFER_BIT,
+		GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)readFramebuffer);
+}
@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerenderer.h
+// ============
+// tile based rasterizer drawing the scene on the CPU
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TexelImage.h"
+#include "ThreadPool.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  SoftwareRenderer
+ *
+ *  This class draws the scene meshes on the CPU, with the
+ *  same Phong lighting as the scene fragment shader, for
+ *  machines without a GPU.  A frame runs in three steps
+ *  that are each split across the thread pool:
+ *
+ *  - the vertices of every draw are transformed, and draws
+ *    outside the view are dropped
+ *  - the triangles are clipped against the near plane, set
+ *    up and sorted into bins of 64x64 pixel tiles
+ *  - every tile rasterizes its opaque triangles into a tile
+ *    sized depth and triangle buffer, four pixels at a time,
+ *    then shades each covered pixel once and blends the
+ *    transparent triangles over the result
+ *
+ *  The finished frame is copied into the bound framebuffer.
+ ***********************************************************/
+class SoftwareRenderer
+{
+public:
+	struct MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	// scene wide light source
+	struct LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float specularIntensity;
+	};
+
+	// point light that does not reach past its range
+	struct POINT_LIGHT
+	{
+		glm::vec3 position;
+		float range;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float specularIntensity;
+	};
+
+	// one mesh to draw - the vertex and index arrays must stay
+	// valid until the end of the frame
+	struct DRAW
+	{
+		const GLfloat* vertices;	// position, normal and UV of every vertex
+		size_t vertexCount;
+		const GLuint* indices;
+		size_t indexCount;
+		glm::vec3 boundsMin;		// local space bounding box
+		glm::vec3 boundsMax;
+		glm::mat4 model;
+		int material;				// -1 for no material
+		int texture;				// texture slot, -1 to use the color
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		bool bTransparent;
+	};
+
+	struct RASTER_STATS
+	{
+		int drawCount;			// draws added this frame
+		int culledCount;		// draws outside the view
+		int triangleCount;		// triangles after clipping
+		int binnedCount;		// triangle and tile pairs
+	};
+
+	// constructor
+	SoftwareRenderer(ThreadPool* pThreadPool);
+	// destructor
+	~SoftwareRenderer();
+
+	// copy a texture image into the passed in slot, with the
+	// rows starting at the bottom like the OpenGL textures
+	bool SetTexture(int slot, const unsigned char* pixels, int width, int height, int channels);
+	// set the materials, indexed by the draw material
+	void SetMaterials(const std::vector<MATERIAL>& materials);
+	// set the light sources of the scene
+	void SetLights(const std::vector<LIGHT>& lights, const std::vector<POINT_LIGHT>& pointLights);
+
+	// start a frame of the passed in size
+	void BeginFrame(int width, int height, const glm::mat4& view, const glm::mat4& projection);
+	// add a mesh to the frame
+	void AddDraw(const DRAW& draw);
+	// draw the frame
+	void EndFrame();
+	// copy the frame into the bound draw framebuffer at the
+	// passed in position
+	void Present(int x, int y);
+
+	// RGBA pixels of the last frame, bottom row first
+	const uint32_t* GetPixels() const { return m_pixels.data(); }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	const RASTER_STATS& GetStats() const { return m_stats; }
+
+private:
+	// a vertex after the vertex step
+	struct SHADED_VERTEX
+	{
+		glm::vec4 clip;
+		glm::vec3 position;		// world space
+		glm::vec3 normal;		// world space
+		glm::vec2 uv;			// with the UV scale applied
+	};
+
+	// a triangle ready for rasterization.  Edge i is opposite
+	// vertex i, so its edge function divided by the doubled
+	// area is the screen space weight of that vertex.
+	struct SETUP_TRIANGLE
+	{
+		float edgeA[3];			// edge functions A*x + B*y + C
+		float edgeB[3];
+		float edgeC[3];
+		uint32_t topLeftMask;	// edges owning the pixels exactly on them
+		float zPlane[3];		// depth plane dz/dx, dz/dy and offset
+		float inverseArea;
+		float inverseW[3];
+		glm::vec3 position[3];
+		glm::vec3 normal[3];
+		glm::vec2 uv[3];
+		uint32_t draw;
+		int minX, minY;			// pixel bounding box
+		int maxX, maxY;
+	};
+
+	// triangles set up by one chunk of the frame triangles and
+	// the bin of every tile, which hold indices into them
+	struct TRIANGLE_CHUNK
+	{
+		std::vector<SETUP_TRIANGLE> triangles;
+		std::vector<std::vector<uint16_t> > bins;
+	};
+
+	// transform the vertices of one draw
+	void ProcessDraw(int drawIndex);
+	// clip, set up and bin one chunk of triangles
+	void SetupChunk(int chunkIndex);
+	// clip one clip space triangle against the near plane
+	void ClipTriangle(TRIANGLE_CHUNK& chunk, uint32_t draw, const SHADED_VERTEX* vertices[3]);
+	// set up a triangle of three clipped vertices
+	void AddTriangle(TRIANGLE_CHUNK& chunk, uint32_t draw, const SHADED_VERTEX& v0, const SHADED_VERTEX& v1, const SHADED_VERTEX& v2);
+	// rasterize and shade one tile
+	void RenderTile(int tileIndex);
+	// shade one pixel of a triangle
+	glm::vec4 ShadePixel(const SETUP_TRIANGLE& triangle, float x, float y) const;
+
+	ThreadPool* m_pThreadPool;
+	std::vector<TexelImage> m_textures;
+	std::vector<MATERIAL> m_materials;
+	std::vector<LIGHT> m_lights;
+	std::vector<POINT_LIGHT> m_pointLights;
+
+	// the current frame
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	glm::mat4 m_viewProjection;
+	glm::vec3 m_viewPosition;
+	std::vector<DRAW> m_draws;
+	// first vertex and first triangle of every draw, with the
+	// totals at the end
+	std::vector<size_t> m_vertexOffsets;
+	std::vector<size_t> m_triangleOffsets;
+	std::vector<SHADED_VERTEX> m_vertices;
+	// the draws outside the view
+	std::vector<uint8_t> m_culled;
+	// point lights reaching the bounds of every draw
+	std::vector<std::vector<uint32_t> > m_drawLights;
+	// the draws are sorted with the transparent ones last,
+	// starting at this index
+	size_t m_firstTransparentDraw;
+	std::vector<TRIANGLE_CHUNK> m_chunks;
+	size_t m_chunkCount;
+	std::vector<uint32_t> m_pixels;
+	RASTER_STATS m_stats;
+
+	// texture and framebuffer for copying the frame to OpenGL
+	GLuint m_presentTexture;
+	GLuint m_presentFramebuffer;
+	int m_presentWidth;
+	int m_presentHeight;
+};
@@ -0,0 +1,331 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatcher.cpp
+// ============
+// merge the static objects of a scene into a few large draws
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticBatcher.h"
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+// declaration of global variables
+namespace
+{
+	// position, normal and UV of every vertex, the same layout
+	// as the shape meshes
+	const GLuint g_FloatsPerVertex = 8;
+
+	// the values that must match for objects to share a batch
+	struct BATCH_KEY
+	{
+		int32_t values[11];
+
+		bool operator<(const BATCH_KEY& other) const
+		{
+			return(std::lexicographical_compare(
+				values, values + 11,
+				other.values, other.values + 11));
+		}
+	};
+
+	int32_t FloatBits(float value)
+	{
+		int32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return(bits);
+	}
+
+	// get the world space box around a transformed local box
+	void TransformBounds(
+		const glm::mat4& model,
+		const glm::vec3& localMin,
+		const glm::vec3& localMax,
+		glm::vec3& worldMin,
+		glm::vec3& worldMax)
+	{
+		worldMin = glm::vec3(FLT_MAX);
+		worldMax = glm::vec3(-FLT_MAX);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 local(
+				(corner & 1) ? localMax.x : localMin.x,
+				(corner & 2) ? localMax.y : localMin.y,
+				(corner & 4) ? localMax.z : localMin.z);
+			glm::vec3 world = glm::vec3(model * glm::vec4(local, 1.0f));
+			worldMin = glm::min(worldMin, world);
+			worldMax = glm::max(worldMax, world);
+		}
+	}
+}
+
+/***********************************************************
+ *  StaticBatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticBatcher::StaticBatcher()
+{
+	m_batchedObjectCount = 0;
+	m_bLightmapUVs = false;
+	m_vao = 0;
+	m_vbos[0] = 0;
+	m_vbos[1] = 0;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for merging the static objects into
+ *  batches.  Objects are grouped by their shader state and
+ *  by the grid cell holding the center of their bounds, and
+ *  the vertices of each group are moved into world space.
+ *  The normals are moved with the normal matrix of their
+ *  object, the same one the objects drawn one by one get,
+ *  so the batches are drawn with an identity model matrix.
+ ***********************************************************/
+void StaticBatcher::Build(
+	const SCENE_OBJECTS& objects,
+	const glm::mat4* worldMatrices,
+	const ShapeMeshes& meshes,
+	float cellSize)
+{
+	Release();
+	m_batched.assign(objects.count, 0);
+
+	if (!(cellSize > 0.0f))
+	{
+		cellSize = 1.0f;
+	}
+
+	std::map<BATCH_KEY, std::vector<uint32_t> > groups;
+	for (size_t i = 0; i < objects.count; i++)
+	{
+		if (((objects.flags[i] & SceneData::OBJECT_STATIC) == 0) ||
+			(objects.flags[i] & SceneData::OBJECT_TRANSPARENT) ||
+			(objects.meshes[i] == SceneData::NO_MESH))
+		{
+			continue;
+		}
+
+		// only meshes that have been loaded have geometry
+		ShapeMeshes::SHAPE_TYPE shape = (ShapeMeshes::SHAPE_TYPE)objects.meshes[i];
+		if (meshes.GetShapeGeometry(shape).indices.empty())
+		{
+			continue;
+		}
+
+		glm::vec3 localMin;
+		glm::vec3 localMax;
+		glm::vec3 worldMin;
+		glm::vec3 worldMax;
+		ShapeMeshes::GetShapeBounds(shape, localMin, localMax);
+		TransformBounds(worldMatrices[i], localMin, localMax, worldMin, worldMax);
+		glm::vec3 cell = glm::floor(((worldMin + worldMax) * 0.5f) / cellSize);
+
+		// the color is only used by objects without a texture
+		glm::vec4 color(0.0f);
+		if (objects.textureIndices[i] < 0)
+		{
+			color = objects.colors[i];
+		}
+
+		BATCH_KEY key;
+		key.values[0] = objects.materialIndices[i];
+		key.values[1] = objects.textureIndices[i];
+		key.values[2] = FloatBits(color.r);
+		key.values[3] = FloatBits(color.g);
+		key.values[4] = FloatBits(color.b);
+		key.values[5] = FloatBits(color.a);
+		key.values[6] = FloatBits(objects.uvScales[i].x);
+		key.values[7] = FloatBits(objects.uvScales[i].y);
+		key.values[8] = (int32_t)cell.x;
+		key.values[9] = (int32_t)cell.y;
+		key.values[10] = (int32_t)cell.z;
+
+		groups[key].push_back((uint32_t)i);
+	}
+
+	for (std::map<BATCH_KEY, std::vector<uint32_t> >::const_iterator group = groups.begin();
+		group != groups.end();
+		++group)
+	{
+		const std::vector<uint32_t>& members = group->second;
+		uint32_t first = members[0];
+
+		STATIC_BATCH batch;
+		batch.material = objects.materialIndices[first];
+		batch.texture = objects.textureIndices[first];
+		batch.color = objects.colors[first];
+		batch.uvScale = objects.uvScales[first];
+		batch.firstIndex = (uint32_t)m_indices.size();
+		batch.boundsMin = glm::vec3(FLT_MAX);
+		batch.boundsMax = glm::vec3(-FLT_MAX);
+		batch.bOccluder = false;
+
+		for (size_t member = 0; member < members.size(); member++)
+		{
+			uint32_t i = members[member];
+			const ShapeMeshes::SHAPE_GEOMETRY& geometry =
+				meshes.GetShapeGeometry((ShapeMeshes::SHAPE_TYPE)objects.meshes[i]);
+			const glm::mat4& model = worldMatrices[i];
+			const glm::mat4* pModel = &model;
+			glm::mat4 modelViewProjection;
+			glm::mat3 normalMatrix;
+			TransformStore::ComputeDrawMatrices(glm::mat4(1.0f), &pModel, 1, &modelViewProjection, &normalMatrix);
+			GLuint baseVertex = (GLuint)(m_vertices.size() / g_FloatsPerVertex);
+
+			for (size_t v = 0; v + g_FloatsPerVertex <= geometry.vertices.size(); v += g_FloatsPerVertex)
+			{
+				const GLfloat* vertex = &geometry.vertices[v];
+				glm::vec3 position = glm::vec3(model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f));
+				glm::vec3 normal = normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+				if (glm::dot(normal, normal) > 0.0f)
+				{
+					normal = glm::normalize(normal);
+				}
+
+				m_vertices.push_back(position.x);
+				m_vertices.push_back(position.y);
+				m_vertices.push_back(position.z);
+				m_vertices.push_back(normal.x);
+				m_vertices.push_back(normal.y);
+				m_vertices.push_back(normal.z);
+				m_vertices.insert(m_vertices.end(), vertex + 6, vertex + g_FloatsPerVertex);
+
+				batch.boundsMin = glm::min(batch.boundsMin, position);
+				batch.boundsMax = glm::max(batch.boundsMax, position);
+			}
+
+			for (size_t index = 0; index < geometry.indices.size(); index++)
+			{
+				m_indices.push_back(baseVertex + geometry.indices[index]);
+			}
+
+			if (objects.flags[i] & SceneData::OBJECT_OCCLUDER)
+			{
+				batch.bOccluder = true;
+			}
+			m_batched[i] = 1;
+			m_batchedObjectCount++;
+		}
+
+		batch.indexCount = (uint32_t)m_indices.size() - batch.firstIndex;
+		m_batches.push_back(batch);
+	}
+}
+
+/***********************************************************
+ *  SetLightmapGeometry()
+ *
+ *  This method is used for swapping in the merged geometry
+ *  with a lightmap UV added to every vertex.  The vertices
+ *  may have been split where lightmap charts meet, but the
+ *  index ranges of the batches must still hold.
+ ***********************************************************/
+void StaticBatcher::SetLightmapGeometry(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+{
+	if (indices.size() != m_indices.size())
+	{
+		return;
+	}
+
+	m_vertices.swap(vertices);
+	m_indices.swap(indices);
+	m_bLightmapUVs = true;
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for sending the merged geometry to
+ *  OpenGL.  The copy in memory is freed afterwards, since
+ *  the batches never change.
+ ***********************************************************/
+void StaticBatcher::CreateBuffers()
+{
+	if (m_indices.empty())
+	{
+		return;
+	}
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	glGenBuffers(2, m_vbos);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vbos[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_indices.size(), m_indices.data(), GL_STATIC_DRAW);
+
+	// the same layout as the shape meshes, followed by the
+	// lightmap UV when there is one
+	GLint stride = sizeof(GLfloat) * (m_bLightmapUVs ? g_FloatsPerVertex + 2 : g_FloatsPerVertex);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(GLfloat) * 3));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(GLfloat) * 6));
+	glEnableVertexAttribArray(2);
+	if (m_bLightmapUVs)
+	{
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(GLfloat) * 8));
+		glEnableVertexAttribArray(3);
+	}
+
+	glBindVertexArray(0);
+
+	std::vector<GLfloat>().swap(m_vertices);
+	std::vector<GLuint>().swap(m_indices);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for freeing the OpenGL buffers and
+ *  removing the batches of the previous scene.
+ ***********************************************************/
+void StaticBatcher::Release()
+{
+	if (m_vao != 0)
+	{
+		glDeleteBuffers(2, m_vbos);
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+		m_vbos[0] = 0;
+		m_vbos[1] = 0;
+	}
+
+	m_batches.clear();
+	m_batched.clear();
+	m_batchedObjectCount = 0;
+	m_vertices.clear();
+	m_indices.clear();
+	m_bLightmapUVs = false;
+}
+
+/***********************************************************
+ *  DrawBatch()
+ *
+ *  This method is used for drawing one batch.  The shader
+ *  state of the batch and an identity model matrix must be
+ *  set before.
+ ***********************************************************/
+void StaticBatcher::DrawBatch(size_t index) const
+{
+	const STATIC_BATCH& batch = m_batches[index];
+
+	glBindVertexArray(m_vao);
+	glDrawElements(
+		GL_TRIANGLES,
+		batch.indexCount,
+		GL_UNSIGNED_INT,
+		(void*)(sizeof(GLuint) * batch.firstIndex));
+}
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatcher.h
+// ============
+// merge the static objects of a scene into a few large draws
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneLoader.h"
+#include "ShapeMeshes.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  StaticBatcher
+ *
+ *  This class merges the objects flagged as static into
+ *  batches when a scene is loaded.  The vertices of every
+ *  static object are moved into world space and appended to
+ *  one shared vertex and index buffer, and the objects are
+ *  grouped by their material, texture, color and UV scale
+ *  as well as by a grid cell, so each batch keeps tight
+ *  bounds for culling.  A batch is drawn with one call and
+ *  an identity model matrix in place of its objects.
+ *
+ *  Transparent objects are never batched, since they have to
+ *  be sorted back to front one by one.
+ *
+ *  The merged geometry can be replaced before it is sent to
+ *  OpenGL with one that has a second set of UVs after the
+ *  first, for the lightmap of the batches.
+ ***********************************************************/
+class StaticBatcher
+{
+public:
+	struct STATIC_BATCH
+	{
+		// the shader state shared by the objects of the batch
+		int32_t material;
+		int32_t texture;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		// range of the batch in the shared index buffer
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		// world space bounds of the batch
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		// batches holding an occluder are always drawn
+		bool bOccluder;
+	};
+
+	// constructor
+	StaticBatcher();
+
+	// merge the static objects - the meshes of the objects
+	// must be loaded so their geometry is available
+	void Build(
+		const SCENE_OBJECTS& objects,
+		const glm::mat4* worldMatrices,
+		const ShapeMeshes& meshes,
+		float cellSize);
+	// replace the merged geometry with vertices that have a
+	// lightmap UV after their UV - the triangles must keep
+	// their order, so the batches keep their index ranges
+	void SetLightmapGeometry(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices);
+	// send the merged geometry to OpenGL and free the copy
+	// kept in memory
+	void CreateBuffers();
+	// free the OpenGL buffers and the batches
+	void Release();
+
+	// check whether an object is drawn as part of a batch
+	bool IsBatched(size_t objectIndex) const
+	{
+		return((objectIndex < m_batched.size()) && (m_batched[objectIndex] != 0));
+	}
+
+	size_t GetBatchCount() const { return m_batches.size(); }
+	const STATIC_BATCH& GetBatch(size_t index) const { return m_batches[index]; }
+	// number of objects merged into the batches
+	size_t GetBatchedObjectCount() const { return m_batchedObjectCount; }
+	// the merged geometry, only kept until the buffers are
+	// created - position, normal and UV of every vertex
+	const std::vector<GLfloat>& GetVertices() const { return m_vertices; }
+	const std::vector<GLuint>& GetIndices() const { return m_indices; }
+	// check whether the vertices have lightmap UVs
+	bool HasLightmapUVs() const { return m_bLightmapUVs; }
+
+	// draw a batch with the shader state already set
+	void DrawBatch(size_t index) const;
+
+private:
+	std::vector<STATIC_BATCH> m_batches;
+	std::vector<uint8_t> m_batched;
+	size_t m_batchedObjectCount;
+
+	// merged geometry waiting to be sent to OpenGL
+	std::vector<GLfloat> m_vertices;
+	std::vector<GLuint> m_indices;
+	bool m_bLightmapUVs;
+
+	GLuint m_vao;
+	GLuint m_vbos[2];
+};
@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// texelimage.cpp
+// ============
+// copy of a texture image sampled on the CPU
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TexelImage.h"
+
+#include <cmath>
+
+/***********************************************************
+ *  TexelImage()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TexelImage::TexelImage()
+{
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  SetImage()
+ *
+ *  This method is used for copying an RGB or RGBA image into
+ *  RGBA texels.  An image that cannot be used leaves the
+ *  old one in place.
+ ***********************************************************/
+bool TexelImage::SetImage(const unsigned char* pixels, int width, int height, int channels)
+{
+	if ((NULL == pixels) || (width <= 0) || (height <= 0) ||
+		((channels != 3) && (channels != 4)))
+	{
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_texels.resize((size_t)width * height);
+	for (size_t i = 0; i < m_texels.size(); i++)
+	{
+		const unsigned char* source = pixels + i * channels;
+		uint32_t alpha = (channels == 4) ? source[3] : 255;
+		m_texels[i] = source[0] | (source[1] << 8) | (source[2] << 16) | (alpha << 24);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Sample()
+ *
+ *  This method is used for reading the image with bilinear
+ *  filtering, wrapping around at the edges.
+ ***********************************************************/
+glm::vec4 TexelImage::Sample(const glm::vec2& uv) const
+{
+	if (m_texels.empty())
+	{
+		return(glm::vec4(1.0f));
+	}
+
+	// the fraction is taken first, so large coordinates keep
+	// their precision
+	float u = (uv.x - std::floor(uv.x)) * m_width - 0.5f;
+	float v = (uv.y - std::floor(uv.y)) * m_height - 0.5f;
+	float left = std::floor(u);
+	float bottom = std::floor(v);
+	float fractionX = u - left;
+	float fractionY = v - bottom;
+
+	int x0 = (int)left;
+	int y0 = (int)bottom;
+	x0 = (x0 < 0) ? x0 + m_width : x0;
+	y0 = (y0 < 0) ? y0 + m_height : y0;
+	int x1 = (x0 + 1 < m_width) ? x0 + 1 : 0;
+	int y1 = (y0 + 1 < m_height) ? y0 + 1 : 0;
+
+	const uint32_t* row0 = m_texels.data() + (size_t)y0 * m_width;
+	const uint32_t* row1 = m_texels.data() + (size_t)y1 * m_width;
+	glm::vec4 bottomColor = glm::mix(UnpackColor(row0[x0]), UnpackColor(row0[x1]), fractionX);
+	glm::vec4 topColor = glm::mix(UnpackColor(row1[x0]), UnpackColor(row1[x1]), fractionX);
+
+	return(glm::mix(bottomColor, topColor, fractionY));
+}
+
+/***********************************************************
+ *  PackColor()
+ *
+ *  This method is used for rounding a color to RGBA8.
+ ***********************************************************/
+uint32_t TexelImage::PackColor(const glm::vec4& color)
+{
+	glm::vec4 clamped = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+	return((uint32_t)clamped.r | ((uint32_t)clamped.g << 8) | ((uint32_t)clamped.b << 16) | ((uint32_t)clamped.a << 24));
+}
+
+/***********************************************************
+ *  UnpackColor()
+ *
+ *  This method is used for reading an RGBA8 color.
+ ***********************************************************/
+glm::vec4 TexelImage::UnpackColor(uint32_t color)
+{
+	return(glm::vec4(
+		(float)(color & 0xFF),
+		(float)((color >> 8) & 0xFF),
+		(float)((color >> 16) & 0xFF),
+		(float)(color >> 24)) * (1.0f / 255.0f));
+}
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// texelimage.h
+// ============
+// copy of a texture image sampled on the CPU
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TexelImage
+ *
+ *  This class keeps the texels of a scene texture for the
+ *  renderers that run on the CPU, and samples them the way
+ *  the scene textures are set up in OpenGL - repeating, with
+ *  bilinear filtering and without mipmaps.
+ ***********************************************************/
+class TexelImage
+{
+public:
+	// constructor
+	TexelImage();
+
+	// copy an RGB or RGBA image, with the rows starting at the
+	// bottom like the OpenGL textures
+	bool SetImage(const unsigned char* pixels, int width, int height, int channels);
+	// whether an image has been set
+	bool IsEmpty() const { return m_texels.empty(); }
+
+	// get the filtered color at the passed in coordinates
+	glm::vec4 Sample(const glm::vec2& uv) const;
+
+	// pack a color into RGBA8, red in the lowest byte
+	static uint32_t PackColor(const glm::vec4& color);
+	// unpack an RGBA8 color
+	static glm::vec4 UnpackColor(uint32_t color);
+
+private:
+	std::vector<uint32_t> m_texels;
+	int m_width;
+	int m_height;
+};
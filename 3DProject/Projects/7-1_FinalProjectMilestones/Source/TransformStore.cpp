@@ -0,0 +1,488 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformstore.cpp
+// ============
+// object transforms with cached world matrices and dirty tracking
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <iostream>
+
+// SSE2 is available on every x64 target and on x86 builds
+// that use the default /arch:SSE2 code generation
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define TRANSFORM_USE_SSE2 1
+#endif
+
+// declaration of global variables
+namespace
+{
+#ifdef TRANSFORM_USE_SSE2
+	// load one component of four transforms - runs of
+	// neighboring indices are loaded with a single read.  All
+	// four indices are compared, since nothing keeps the dirty
+	// list in order.
+	inline __m128 Load4(const std::vector<float>& values, const uint32_t* indices)
+	{
+		if ((indices[1] == indices[0] + 1) &&
+			(indices[2] == indices[0] + 2) &&
+			(indices[3] == indices[0] + 3))
+		{
+			return(_mm_loadu_ps(&values[indices[0]]));
+		}
+		return(_mm_setr_ps(values[indices[0]], values[indices[1]], values[indices[2]], values[indices[3]]));
+	}
+#endif
+}
+
+/***********************************************************
+ *  TransformStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformStore::TransformStore()
+{
+	m_lastParent = -1;
+	m_lastUpdateCount = 0;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the transforms.
+ ***********************************************************/
+void TransformStore::Clear()
+{
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_rotationX.clear();
+	m_rotationY.clear();
+	m_rotationZ.clear();
+	m_rotationW.clear();
+	m_scaleX.clear();
+	m_scaleY.clear();
+	m_scaleZ.clear();
+	m_parents.clear();
+	m_firstChild.clear();
+	m_childCount.clear();
+	m_worldMatrices.clear();
+	m_localMatrices.clear();
+	m_dirtyFlags.clear();
+	m_dirtyIndices.clear();
+	m_lastParent = -1;
+	m_lastUpdateCount = 0;
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for reserving memory in every array
+ *  so adding transforms does not reallocate.
+ ***********************************************************/
+void TransformStore::Reserve(size_t count)
+{
+	m_positionX.reserve(count);
+	m_positionY.reserve(count);
+	m_positionZ.reserve(count);
+	m_rotationX.reserve(count);
+	m_rotationY.reserve(count);
+	m_rotationZ.reserve(count);
+	m_rotationW.reserve(count);
+	m_scaleX.reserve(count);
+	m_scaleY.reserve(count);
+	m_scaleZ.reserve(count);
+	m_parents.reserve(count);
+	m_firstChild.reserve(count);
+	m_childCount.reserve(count);
+	m_worldMatrices.reserve(count);
+	m_dirtyFlags.reserve(count);
+	m_dirtyIndices.reserve(count);
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding a transform.  Without a
+ *  world matrix the transform is dirty until the next
+ *  UpdateWorldMatrices() call.  A parent that would break
+ *  the breadth first order is ignored.
+ ***********************************************************/
+int TransformStore::Add(
+	const glm::vec3& position,
+	const glm::quat& rotation,
+	const glm::vec3& scale,
+	int parent,
+	const glm::mat4* pWorldMatrix)
+{
+	int index = (int)m_worldMatrices.size();
+	glm::quat unitRotation = glm::normalize(rotation);
+
+	if ((parent >= index) || ((parent >= 0) && (parent < m_lastParent)))
+	{
+		std::cout << "Transform " << index << " is not in breadth first order, parent " << parent << " ignored" << std::endl;
+		parent = -1;
+	}
+	if (parent >= 0)
+	{
+		if (m_childCount[parent] == 0)
+		{
+			m_firstChild[parent] = (uint32_t)index;
+		}
+		m_childCount[parent]++;
+		m_lastParent = parent;
+	}
+
+	m_positionX.push_back(position.x);
+	m_positionY.push_back(position.y);
+	m_positionZ.push_back(position.z);
+	m_rotationX.push_back(unitRotation.x);
+	m_rotationY.push_back(unitRotation.y);
+	m_rotationZ.push_back(unitRotation.z);
+	m_rotationW.push_back(unitRotation.w);
+	m_scaleX.push_back(scale.x);
+	m_scaleY.push_back(scale.y);
+	m_scaleZ.push_back(scale.z);
+	m_parents.push_back(parent);
+	m_firstChild.push_back(0);
+	m_childCount.push_back(0);
+	m_worldMatrices.push_back((NULL != pWorldMatrix) ? *pWorldMatrix : glm::mat4(1.0f));
+	m_dirtyFlags.push_back(0);
+
+	if (NULL == pWorldMatrix)
+	{
+		MarkDirty(index);
+	}
+
+	return(index);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for adding a transform to the list of
+ *  world matrices that need to be rebuilt.
+ ***********************************************************/
+void TransformStore::MarkDirty(int index)
+{
+	if (m_dirtyFlags[index] == 0)
+	{
+		m_dirtyFlags[index] = 1;
+		m_dirtyIndices.push_back((uint32_t)index);
+	}
+}
+
+/***********************************************************
+ *  SetPosition()
+ *
+ *  This method is used for moving a transform.
+ ***********************************************************/
+void TransformStore::SetPosition(int index, const glm::vec3& position)
+{
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  SetRotation()
+ *
+ *  This method is used for rotating a transform.
+ ***********************************************************/
+void TransformStore::SetRotation(int index, const glm::quat& rotation)
+{
+	glm::quat unitRotation = glm::normalize(rotation);
+	m_rotationX[index] = unitRotation.x;
+	m_rotationY[index] = unitRotation.y;
+	m_rotationZ[index] = unitRotation.z;
+	m_rotationW[index] = unitRotation.w;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  SetScale()
+ *
+ *  This method is used for scaling a transform.
+ ***********************************************************/
+void TransformStore::SetScale(int index, const glm::vec3& scale)
+{
+	m_scaleX[index] = scale.x;
+	m_scaleY[index] = scale.y;
+	m_scaleZ[index] = scale.z;
+	MarkDirty(index);
+}
+
+glm::vec3 TransformStore::GetPosition(int index) const
+{
+	return(glm::vec3(m_positionX[index], m_positionY[index], m_positionZ[index]));
+}
+
+glm::quat TransformStore::GetRotation(int index) const
+{
+	return(glm::quat(m_rotationW[index], m_rotationX[index], m_rotationY[index], m_rotationZ[index]));
+}
+
+glm::vec3 TransformStore::GetScale(int index) const
+{
+	return(glm::vec3(m_scaleX[index], m_scaleY[index], m_scaleZ[index]));
+}
+
+/***********************************************************
+ *  RotationFromDegrees()
+ *
+ *  This method is used for converting rotation degrees into
+ *  a quaternion that matches rotating around X, then Y, then
+ *  Z the same way SceneData::CalculateModelMatrix() does.
+ ***********************************************************/
+glm::quat TransformStore::RotationFromDegrees(const glm::vec3& rotationDegrees)
+{
+	glm::quat rotationX = glm::angleAxis(glm::radians(rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	glm::quat rotationY = glm::angleAxis(glm::radians(rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::quat rotationZ = glm::angleAxis(glm::radians(rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	return(rotationX * rotationY * rotationZ);
+}
+
+/***********************************************************
+ *  UpdateWorldMatrices()
+ *
+ *  This method is used for rebuilding the world matrices of
+ *  the dirty transforms and of everything below them in the
+ *  hierarchy, then clearing their dirty state.
+ ***********************************************************/
+void TransformStore::UpdateWorldMatrices()
+{
+	if (m_dirtyIndices.size() == 0)
+	{
+		m_lastUpdateCount = 0;
+		return;
+	}
+
+	// add the subtrees of the dirty transforms - the list grows
+	// while it is walked so grandchildren are found as well
+	for (size_t i = 0; i < m_dirtyIndices.size(); i++)
+	{
+		uint32_t index = m_dirtyIndices[i];
+		uint32_t lastChild = m_firstChild[index] + m_childCount[index];
+		for (uint32_t child = m_firstChild[index]; child < lastChild; child++)
+		{
+			MarkDirty((int)child);
+		}
+	}
+
+	// parents come before their children in breadth first
+	// order, so updating by increasing index is enough
+	size_t dirtyCount = m_dirtyIndices.size();
+	if (dirtyCount == m_worldMatrices.size())
+	{
+		for (size_t i = 0; i < dirtyCount; i++)
+		{
+			m_dirtyIndices[i] = (uint32_t)i;
+		}
+	}
+	else
+	{
+		std::sort(m_dirtyIndices.begin(), m_dirtyIndices.end());
+	}
+
+	m_localMatrices.resize(dirtyCount);
+	size_t i = 0;
+#ifdef TRANSFORM_USE_SSE2
+	for (; i + 4 <= dirtyCount; i += 4)
+	{
+		ComposeLocalMatrices4(&m_dirtyIndices[i], &m_localMatrices[i]);
+	}
+#endif
+	for (; i < dirtyCount; i++)
+	{
+		ComposeLocalMatrix(m_dirtyIndices[i], m_localMatrices[i]);
+	}
+
+	for (i = 0; i < dirtyCount; i++)
+	{
+		uint32_t index = m_dirtyIndices[i];
+		int parent = m_parents[index];
+		if (parent < 0)
+		{
+			m_worldMatrices[index] = m_localMatrices[i];
+		}
+		else
+		{
+			m_worldMatrices[index] = m_worldMatrices[parent] * m_localMatrices[i];
+		}
+		m_dirtyFlags[index] = 0;
+	}
+
+	m_lastUpdateCount = dirtyCount;
+	m_dirtyIndices.clear();
+}
+
+/***********************************************************
+ *  ComposeLocalMatrix()
+ *
+ *  This method is used for building the local matrix of one
+ *  transform as translation * rotation * scale, with the
+ *  rotation matrix taken directly from the quaternion.
+ ***********************************************************/
+void TransformStore::ComposeLocalMatrix(uint32_t index, glm::mat4& local)
+{
+	float x = m_rotationX[index];
+	float y = m_rotationY[index];
+	float z = m_rotationZ[index];
+	float w = m_rotationW[index];
+	float sx = m_scaleX[index];
+	float sy = m_scaleY[index];
+	float sz = m_scaleZ[index];
+
+	local[0] = glm::vec4((1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + w * z) * sx, 2.0f * (x * z - w * y) * sx, 0.0f);
+	local[1] = glm::vec4(2.0f * (x * y - w * z) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + w * x) * sy, 0.0f);
+	local[2] = glm::vec4(2.0f * (x * z + w * y) * sz, 2.0f * (y * z - w * x) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz, 0.0f);
+	local[3] = glm::vec4(m_positionX[index], m_positionY[index], m_positionZ[index], 1.0f);
+}
+
+/***********************************************************
+ *  ComposeLocalMatrices4()
+ *
+ *  This method is used for building the local matrices of
+ *  four transforms at once.  Every SSE lane works on one
+ *  transform, and the finished columns are transposed into
+ *  the four matrices at the end.
+ ***********************************************************/
+void TransformStore::ComposeLocalMatrices4(const uint32_t* indices, glm::mat4* locals)
+{
+#ifdef TRANSFORM_USE_SSE2
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	__m128 x = Load4(m_rotationX, indices);
+	__m128 y = Load4(m_rotationY, indices);
+	__m128 z = Load4(m_rotationZ, indices);
+	__m128 w = Load4(m_rotationW, indices);
+	__m128 sx = Load4(m_scaleX, indices);
+	__m128 sy = Load4(m_scaleY, indices);
+	__m128 sz = Load4(m_scaleZ, indices);
+
+	__m128 xx = _mm_mul_ps(x, x);
+	__m128 yy = _mm_mul_ps(y, y);
+	__m128 zz = _mm_mul_ps(z, z);
+	__m128 xy = _mm_mul_ps(x, y);
+	__m128 xz = _mm_mul_ps(x, z);
+	__m128 yz = _mm_mul_ps(y, z);
+	__m128 wx = _mm_mul_ps(w, x);
+	__m128 wy = _mm_mul_ps(w, y);
+	__m128 wz = _mm_mul_ps(w, z);
+
+	// rows of the three rotation and scale columns
+	__m128 column0[4];
+	__m128 column1[4];
+	__m128 column2[4];
+	__m128 column3[4];
+
+	column0[0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+	column0[1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+	column0[2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+	column0[3] = _mm_setzero_ps();
+
+	column1[0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+	column1[1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+	column1[2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+	column1[3] = _mm_setzero_ps();
+
+	column2[0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+	column2[1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+	column2[2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+	column2[3] = _mm_setzero_ps();
+
+	column3[0] = Load4(m_positionX, indices);
+	column3[1] = Load4(m_positionY, indices);
+	column3[2] = Load4(m_positionZ, indices);
+	column3[3] = one;
+
+	// after transposing, entry i of each column array holds
+	// that column of transform i
+	_MM_TRANSPOSE4_PS(column0[0], column0[1], column0[2], column0[3]);
+	_MM_TRANSPOSE4_PS(column1[0], column1[1], column1[2], column1[3]);
+	_MM_TRANSPOSE4_PS(column2[0], column2[1], column2[2], column2[3]);
+	_MM_TRANSPOSE4_PS(column3[0], column3[1], column3[2], column3[3]);
+
+	for (int i = 0; i < 4; i++)
+	{
+		glm::mat4& local = locals[i];
+		_mm_storeu_ps(&local[0][0], column0[i]);
+		_mm_storeu_ps(&local[1][0], column1[i]);
+		_mm_storeu_ps(&local[2][0], column2[i]);
+		_mm_storeu_ps(&local[3][0], column3[i]);
+	}
+#else
+	for (int i = 0; i < 4; i++)
+	{
+		ComposeLocalMatrix(indices[i], locals[i]);
+	}
+#endif
+}
+
+/***********************************************************
+ *  ComputeDrawMatrices()
+ *
+ *  This method is used for building the matrices of a
+ *  batch of draws.  The model view projection takes the
+ *  columns of the view projection scaled by each column of
+ *  the model matrix.  The normal matrix is the inverse
+ *  transpose of the upper 3x3 of the model matrix, which is
+ *  the cross products of its columns over its determinant,
+ *  so scaled and rotated objects keep correct normals.
+ ***********************************************************/
+void TransformStore::ComputeDrawMatrices(
+	const glm::mat4& viewProjection,
+	const glm::mat4* const* models,
+	size_t count,
+	glm::mat4* modelViewProjections,
+	glm::mat3* normalMatrices)
+{
+#ifdef TRANSFORM_USE_SSE2
+	const __m128 viewProjection0 = _mm_loadu_ps(&viewProjection[0][0]);
+	const __m128 viewProjection1 = _mm_loadu_ps(&viewProjection[1][0]);
+	const __m128 viewProjection2 = _mm_loadu_ps(&viewProjection[2][0]);
+	const __m128 viewProjection3 = _mm_loadu_ps(&viewProjection[3][0]);
+#endif
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::mat4& model = *models[i];
+
+#ifdef TRANSFORM_USE_SSE2
+		for (int column = 0; column < 4; column++)
+		{
+			__m128 result = _mm_mul_ps(viewProjection0, _mm_set1_ps(model[column][0]));
+			result = _mm_add_ps(result, _mm_mul_ps(viewProjection1, _mm_set1_ps(model[column][1])));
+			result = _mm_add_ps(result, _mm_mul_ps(viewProjection2, _mm_set1_ps(model[column][2])));
+			result = _mm_add_ps(result, _mm_mul_ps(viewProjection3, _mm_set1_ps(model[column][3])));
+			_mm_storeu_ps(&modelViewProjections[i][column][0], result);
+		}
+#else
+		modelViewProjections[i] = viewProjection * model;
+#endif
+
+		glm::vec3 column0(model[0]);
+		glm::vec3 column1(model[1]);
+		glm::vec3 column2(model[2]);
+		glm::vec3 cross12 = glm::cross(column1, column2);
+		glm::vec3 cross20 = glm::cross(column2, column0);
+		glm::vec3 cross01 = glm::cross(column0, column1);
+		float determinant = glm::dot(column0, cross12);
+
+		// a flattened object has no inverse - its normals
+		// are left to the shader to normalize
+		float inverseDeterminant = (determinant != 0.0f) ? (1.0f / determinant) : 1.0f;
+		normalMatrices[i] = glm::mat3(
+			cross12 * inverseDeterminant,
+			cross20 * inverseDeterminant,
+			cross01 * inverseDeterminant);
+	}
+}
@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformstore.h
+// ============
+// object transforms with cached world matrices and dirty tracking
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TransformStore
+ *
+ *  This class holds the position, rotation and scale of every
+ *  object as separate arrays of floats, along with a cached
+ *  world matrix for each object.  Changing a transform only
+ *  marks the object as dirty, and UpdateWorldMatrices()
+ *  rebuilds the matrices of the dirty objects four at a time.
+ *  When nothing has moved the update does no work at all.
+ *
+ *  Transforms can have a parent, in which case they are
+ *  relative to the world matrix of the parent.  The
+ *  transforms must be added in breadth first order - every
+ *  parent before its children and the children of one parent
+ *  next to each other - so a dirty transform can find its
+ *  whole subtree and every parent is updated before its
+ *  children in one pass over increasing indices.
+ ***********************************************************/
+class TransformStore
+{
+public:
+	// constructor
+	TransformStore();
+
+	// remove all of the transforms
+	void Clear();
+	// reserve memory for the passed in number of transforms
+	void Reserve(size_t count);
+
+	// add a transform and return its index - a parent of -1
+	// means the transform is in world space, and when a world
+	// matrix is passed in it is cached as already up to date
+	int Add(
+		const glm::vec3& position,
+		const glm::quat& rotation,
+		const glm::vec3& scale,
+		int parent = -1,
+		const glm::mat4* pWorldMatrix = NULL);
+
+	// change a transform, marking it as dirty
+	void SetPosition(int index, const glm::vec3& position);
+	void SetRotation(int index, const glm::quat& rotation);
+	void SetScale(int index, const glm::vec3& scale);
+
+	glm::vec3 GetPosition(int index) const;
+	glm::quat GetRotation(int index) const;
+	glm::vec3 GetScale(int index) const;
+	int GetParent(int index) const { return m_parents[index]; }
+
+	// rebuild the world matrices of the dirty transforms
+	void UpdateWorldMatrices();
+
+	size_t GetCount() const { return m_worldMatrices.size(); }
+	const glm::mat4* GetWorldMatrices() const { return m_worldMatrices.data(); }
+	const glm::mat4& GetWorldMatrix(int index) const { return m_worldMatrices[index]; }
+	// number of matrices rebuilt by the last update, which
+	// includes the subtrees of the dirty transforms
+	size_t GetLastUpdateCount() const { return m_lastUpdateCount; }
+
+	// convert rotation degrees around X, then Y, then Z, as
+	// used by the scene files, into a quaternion
+	static glm::quat RotationFromDegrees(const glm::vec3& rotationDegrees);
+
+	// build the model view projection and normal matrix of
+	// every passed in model matrix, so the vertex shader does
+	// not multiply the matrices for every vertex
+	static void ComputeDrawMatrices(
+		const glm::mat4& viewProjection,
+		const glm::mat4* const* models,
+		size_t count,
+		glm::mat4* modelViewProjections,
+		glm::mat3* normalMatrices);
+
+private:
+	void MarkDirty(int index);
+	// build the local matrix of one transform
+	void ComposeLocalMatrix(uint32_t index, glm::mat4& local);
+	// build the local matrices of four transforms at once
+	void ComposeLocalMatrices4(const uint32_t* indices, glm::mat4* locals);
+
+	// transform components, one array per component
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	std::vector<float> m_rotationX;
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	std::vector<float> m_rotationW;
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+
+	// hierarchy - parent index or -1, and the range of the
+	// children that follow each other in breadth first order
+	std::vector<int32_t> m_parents;
+	std::vector<uint32_t> m_firstChild;
+	std::vector<uint32_t> m_childCount;
+	int m_lastParent;
+
+	// cached world matrices
+	std::vector<glm::mat4> m_worldMatrices;
+	// local matrices of the transforms being updated
+	std::vector<glm::mat4> m_localMatrices;
+	// dirty state - the flags keep every index in the list once
+	std::vector<uint8_t> m_dirtyFlags;
+	std::vector<uint32_t> m_dirtyIndices;
+	size_t m_lastUpdateCount;
+};
@@ -0,0 +1,612 @@
+///////////////////////////////////////////////////////////////////////////////
+// trianglebvh.cpp
+// ============
+// bounding volume hierarchy for casting rays against triangles
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// SSE2 is available on every x64 target and on x86 builds
+// that use the default /arch:SSE2 code generation
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define BVH_USE_SSE2 1
+#endif
+
+// declaration of global variables
+namespace
+{
+	// bins per axis when searching for the cheapest split
+	const int g_BinCount = 12;
+	// ranges this small always become leaves, and ranges up to
+	// g_MaxLeafTriangles become leaves when no split is cheaper
+	const uint32_t g_MinSplitTriangles = 4;
+	const uint32_t g_MaxLeafTriangles = 16;
+	// cost of visiting a node, relative to testing a triangle
+	const float g_TraversalCost = 1.0f;
+	// deeper ranges become leaves, which bounds the traversal
+	// stack to three entries per level
+	const int g_MaxDepth = 64;
+	const int g_StackSize = 3 * g_MaxDepth + 4;
+	// smallest determinant of a triangle the ray is not
+	// parallel to
+	const float g_MinDeterminant = 1.0e-14f;
+
+	float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = boundsMax - boundsMin;
+		return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+	}
+
+	struct BIN
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		uint32_t count;
+	};
+}
+
+/***********************************************************
+ *  TriangleBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TriangleBVH::TriangleBVH()
+{
+	m_stats = BVH_STATS();
+	m_pCorners = NULL;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the
+ *  passed in triangles.  The hits report the triangles by
+ *  their position in the passed in list.
+ ***********************************************************/
+void TriangleBVH::Build(const std::vector<glm::vec3>& corners)
+{
+	m_nodes.clear();
+	m_blocks.clear();
+	m_stats = BVH_STATS();
+
+	uint32_t triangleCount = (uint32_t)(corners.size() / 3);
+	m_stats.triangleCount = triangleCount;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	m_pCorners = &corners;
+	m_buildOrder.resize(triangleCount);
+	m_centroids.resize(triangleCount);
+	m_triangleMin.resize(triangleCount);
+	m_triangleMax.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		const glm::vec3* triangle = &corners[i * 3];
+		m_buildOrder[i] = i;
+		m_triangleMin[i] = glm::min(triangle[0], glm::min(triangle[1], triangle[2]));
+		m_triangleMax[i] = glm::max(triangle[0], glm::max(triangle[1], triangle[2]));
+		m_centroids[i] = (m_triangleMin[i] + m_triangleMax[i]) * 0.5f;
+	}
+
+	m_buildNodes.clear();
+	m_buildNodes.reserve(triangleCount * 2);
+	int32_t root = BuildRange(0, triangleCount, 0);
+	CollapseNode(root);
+
+	m_stats.nodeCount = m_nodes.size();
+	m_stats.blockCount = m_blocks.size();
+
+	// only the final tree is kept
+	m_pCorners = NULL;
+	std::vector<BUILD_NODE>().swap(m_buildNodes);
+	std::vector<uint32_t>().swap(m_buildOrder);
+	std::vector<glm::vec3>().swap(m_centroids);
+	std::vector<glm::vec3>().swap(m_triangleMin);
+	std::vector<glm::vec3>().swap(m_triangleMax);
+}
+
+/***********************************************************
+ *  BuildRange()
+ *
+ *  This method is used for splitting a range of the build
+ *  order in two.  The centroids are sorted into bins along
+ *  every axis, and the range is split at the bin boundary
+ *  with the lowest surface area cost, or becomes a leaf
+ *  when testing its triangles is cheaper.
+ ***********************************************************/
+int32_t TriangleBVH::BuildRange(uint32_t first, uint32_t count, int depth)
+{
+	BUILD_NODE node;
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+	node.children[0] = -1;
+	node.children[1] = -1;
+	node.first = first;
+	node.count = count;
+
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		uint32_t triangle = m_buildOrder[i];
+		node.boundsMin = glm::min(node.boundsMin, m_triangleMin[triangle]);
+		node.boundsMax = glm::max(node.boundsMax, m_triangleMax[triangle]);
+		centroidMin = glm::min(centroidMin, m_centroids[triangle]);
+		centroidMax = glm::max(centroidMax, m_centroids[triangle]);
+	}
+
+	int32_t index = (int32_t)m_buildNodes.size();
+	m_buildNodes.push_back(node);
+	m_stats.depth = std::max(m_stats.depth, depth + 1);
+	if ((count <= g_MinSplitTriangles) || (depth >= g_MaxDepth))
+	{
+		return(index);
+	}
+
+	float parentArea = SurfaceArea(node.boundsMin, node.boundsMax);
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		BIN bins[g_BinCount];
+		for (int b = 0; b < g_BinCount; b++)
+		{
+			bins[b].boundsMin = glm::vec3(FLT_MAX);
+			bins[b].boundsMax = glm::vec3(-FLT_MAX);
+			bins[b].count = 0;
+		}
+		float scale = (float)g_BinCount / extent;
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			uint32_t triangle = m_buildOrder[i];
+			int b = std::min((int)((m_centroids[triangle][axis] - centroidMin[axis]) * scale), g_BinCount - 1);
+			bins[b].boundsMin = glm::min(bins[b].boundsMin, m_triangleMin[triangle]);
+			bins[b].boundsMax = glm::max(bins[b].boundsMax, m_triangleMax[triangle]);
+			bins[b].count++;
+		}
+
+		// cost of the bins right of every boundary
+		float rightCost[g_BinCount];
+		glm::vec3 rightMin(FLT_MAX);
+		glm::vec3 rightMax(-FLT_MAX);
+		uint32_t rightCount = 0;
+		for (int b = g_BinCount - 1; b > 0; b--)
+		{
+			rightMin = glm::min(rightMin, bins[b].boundsMin);
+			rightMax = glm::max(rightMax, bins[b].boundsMax);
+			rightCount += bins[b].count;
+			rightCost[b] = (rightCount > 0) ? SurfaceArea(rightMin, rightMax) * rightCount : 0.0f;
+		}
+
+		glm::vec3 leftMin(FLT_MAX);
+		glm::vec3 leftMax(-FLT_MAX);
+		uint32_t leftCount = 0;
+		for (int split = 1; split < g_BinCount; split++)
+		{
+			leftMin = glm::min(leftMin, bins[split - 1].boundsMin);
+			leftMax = glm::max(leftMax, bins[split - 1].boundsMax);
+			leftCount += bins[split - 1].count;
+			if ((leftCount == 0) || (leftCount == count))
+			{
+				continue;
+			}
+
+			float cost = SurfaceArea(leftMin, leftMax) * leftCount + rightCost[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	// every centroid in the same spot cannot be split
+	if (bestAxis < 0)
+	{
+		return(index);
+	}
+	bestCost = g_TraversalCost + bestCost / std::max(parentArea, FLT_MIN);
+	if ((count <= g_MaxLeafTriangles) && (bestCost >= (float)count))
+	{
+		return(index);
+	}
+
+	float splitMin = centroidMin[bestAxis];
+	float splitScale = (float)g_BinCount / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	uint32_t* pMiddle = std::partition(
+		m_buildOrder.data() + first,
+		m_buildOrder.data() + first + count,
+		[this, bestAxis, bestSplit, splitMin, splitScale](uint32_t triangle)
+	{
+		int b = std::min((int)((m_centroids[triangle][bestAxis] - splitMin) * splitScale), g_BinCount - 1);
+		return(b < bestSplit);
+	});
+	uint32_t leftCount = (uint32_t)(pMiddle - (m_buildOrder.data() + first));
+
+	int32_t left = BuildRange(first, leftCount, depth + 1);
+	int32_t right = BuildRange(first + leftCount, count - leftCount, depth + 1);
+	m_buildNodes[index].children[0] = left;
+	m_buildNodes[index].children[1] = right;
+
+	return(index);
+}
+
+/***********************************************************
+ *  CollapseNode()
+ *
+ *  This method is used for building a four wide node from
+ *  a binary node.  The inner child with the largest surface
+ *  area is replaced by its own children until there are
+ *  four, since those are the most likely to be entered.
+ ***********************************************************/
+int32_t TriangleBVH::CollapseNode(int32_t buildNode)
+{
+	int32_t children[4];
+	int childCount = 0;
+	if (m_buildNodes[buildNode].children[0] < 0)
+	{
+		// only a root can be a leaf here
+		children[childCount++] = buildNode;
+	}
+	else
+	{
+		children[childCount++] = m_buildNodes[buildNode].children[0];
+		children[childCount++] = m_buildNodes[buildNode].children[1];
+	}
+
+	while (childCount < 4)
+	{
+		int expand = -1;
+		float largestArea = -1.0f;
+		for (int i = 0; i < childCount; i++)
+		{
+			const BUILD_NODE& child = m_buildNodes[children[i]];
+			float area = SurfaceArea(child.boundsMin, child.boundsMax);
+			if ((child.children[0] >= 0) && (area > largestArea))
+			{
+				expand = i;
+				largestArea = area;
+			}
+		}
+		if (expand < 0)
+		{
+			break;
+		}
+
+		const BUILD_NODE& expanded = m_buildNodes[children[expand]];
+		children[expand] = expanded.children[0];
+		children[childCount++] = expanded.children[1];
+	}
+
+	int32_t nodeIndex = (int32_t)m_nodes.size();
+	m_nodes.push_back(NODE());
+
+	NODE node;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			node.boundsMin[axis][i] = 0.0f;
+			node.boundsMax[axis][i] = 0.0f;
+		}
+		node.children[i] = -1;
+		node.blockCounts[i] = 0;
+	}
+
+	for (int i = 0; i < childCount; i++)
+	{
+		const BUILD_NODE& child = m_buildNodes[children[i]];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			node.boundsMin[axis][i] = child.boundsMin[axis];
+			node.boundsMax[axis][i] = child.boundsMax[axis];
+		}
+
+		if (child.children[0] < 0)
+		{
+			node.children[i] = (int32_t)m_blocks.size();
+			node.blockCounts[i] = AddLeafBlocks(child);
+		}
+		else
+		{
+			node.children[i] = CollapseNode(children[i]);
+		}
+	}
+
+	m_nodes[nodeIndex] = node;
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  AddLeafBlocks()
+ *
+ *  This method is used for copying the triangles of a leaf
+ *  into blocks of four.  The lanes past the last triangle
+ *  have no area, so the rays never hit them.
+ ***********************************************************/
+uint32_t TriangleBVH::AddLeafBlocks(const BUILD_NODE& leaf)
+{
+	const std::vector<glm::vec3>& corners = *m_pCorners;
+	uint32_t blockCount = (leaf.count + 3) / 4;
+
+	for (uint32_t block = 0; block < blockCount; block++)
+	{
+		TRIANGLE_BLOCK triangles;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			uint32_t i = block * 4 + lane;
+			glm::vec3 corner(0.0f);
+			glm::vec3 edge1(0.0f);
+			glm::vec3 edge2(0.0f);
+			uint32_t triangle = 0;
+			if (i < leaf.count)
+			{
+				triangle = m_buildOrder[leaf.first + i];
+				corner = corners[triangle * 3];
+				edge1 = corners[triangle * 3 + 1] - corner;
+				edge2 = corners[triangle * 3 + 2] - corner;
+			}
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				triangles.corner[axis][lane] = corner[axis];
+				triangles.edge1[axis][lane] = edge1[axis];
+				triangles.edge2[axis][lane] = edge2[axis];
+			}
+			triangles.triangles[lane] = triangle;
+		}
+		m_blocks.push_back(triangles);
+	}
+
+	return(blockCount);
+}
+
+/***********************************************************
+ *  Intersect()
+ *
+ *  This method is used for finding the closest hit of a ray.
+ ***********************************************************/
+bool TriangleBVH::Intersect(const RAY& ray, float maxDistance, HIT& hit) const
+{
+	return(Traverse(ray, maxDistance, false, hit));
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for testing a shadow ray, where any
+ *  hit will do.
+ ***********************************************************/
+bool TriangleBVH::IsOccluded(const RAY& ray, float maxDistance) const
+{
+	HIT hit;
+	return(Traverse(ray, maxDistance, true, hit));
+}
+
+/***********************************************************
+ *  Traverse()
+ *
+ *  This method is used for walking the tree along a ray.
+ *  The children of a node are visited nearest first - the
+ *  leaves are tested at once and the nodes are pushed so the
+ *  nearest is taken next - and nodes entered past the
+ *  closest hit found so far are skipped.
+ ***********************************************************/
+bool TriangleBVH::Traverse(const RAY& ray, float maxDistance, bool bAnyHit, HIT& hit) const
+{
+	if (m_nodes.empty())
+	{
+		return(false);
+	}
+
+	struct STACK_ENTRY
+	{
+		int32_t node;
+		float distance;
+	};
+	STACK_ENTRY stack[g_StackSize];
+	int stackSize = 0;
+	stack[stackSize].node = 0;
+	stack[stackSize].distance = 0.0f;
+	stackSize++;
+
+	glm::vec3 inverseDirection = 1.0f / ray.direction;
+	float closest = maxDistance;
+	bool bHit = false;
+
+#ifdef BVH_USE_SSE2
+	const __m128 origin[3] = { _mm_set1_ps(ray.origin.x), _mm_set1_ps(ray.origin.y), _mm_set1_ps(ray.origin.z) };
+	const __m128 direction[3] = { _mm_set1_ps(ray.direction.x), _mm_set1_ps(ray.direction.y), _mm_set1_ps(ray.direction.z) };
+	const __m128 inverse[3] = { _mm_set1_ps(inverseDirection.x), _mm_set1_ps(inverseDirection.y), _mm_set1_ps(inverseDirection.z) };
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 minDeterminant = _mm_set1_ps(g_MinDeterminant);
+#endif
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		if (stack[stackSize].distance > closest)
+		{
+			continue;
+		}
+		const NODE& node = m_nodes[stack[stackSize].node];
+
+		// slab test of the four child boxes
+		float entryDistances[4];
+		int hitMask = 0;
+#ifdef BVH_USE_SSE2
+		__m128 tNear = zero;
+		__m128 tFar = _mm_set1_ps(closest);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMin[axis]), origin[axis]), inverse[axis]);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMax[axis]), origin[axis]), inverse[axis]);
+			tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+			tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+		}
+		hitMask = _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+		_mm_storeu_ps(entryDistances, tNear);
+#else
+		for (int i = 0; i < 4; i++)
+		{
+			float tNear = 0.0f;
+			float tFar = closest;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float t0 = (node.boundsMin[axis][i] - ray.origin[axis]) * inverseDirection[axis];
+				float t1 = (node.boundsMax[axis][i] - ray.origin[axis]) * inverseDirection[axis];
+				tNear = std::max(tNear, std::min(t0, t1));
+				tFar = std::min(tFar, std::max(t0, t1));
+			}
+			entryDistances[i] = tNear;
+			hitMask |= (tNear <= tFar) ? (1 << i) : 0;
+		}
+#endif
+
+		// order the children that were hit nearest first
+		int order[4];
+		int orderCount = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (((hitMask & (1 << i)) == 0) || (node.children[i] < 0))
+			{
+				continue;
+			}
+			int slot = orderCount++;
+			while ((slot > 0) && (entryDistances[order[slot - 1]] > entryDistances[i]))
+			{
+				order[slot] = order[slot - 1];
+				slot--;
+			}
+			order[slot] = i;
+		}
+
+		for (int k = 0; k < orderCount; k++)
+		{
+			int i = order[k];
+			if ((node.blockCounts[i] == 0) || (entryDistances[i] > closest))
+			{
+				continue;
+			}
+
+			for (uint32_t block = 0; block < node.blockCounts[i]; block++)
+			{
+				const TRIANGLE_BLOCK& triangles = m_blocks[node.children[i] + block];
+				float distances[4];
+				float u[4];
+				float v[4];
+				int triangleMask = 0;
+#ifdef BVH_USE_SSE2
+				// Moller-Trumbore for four triangles at once
+				__m128 edge1[3] = { _mm_loadu_ps(triangles.edge1[0]), _mm_loadu_ps(triangles.edge1[1]), _mm_loadu_ps(triangles.edge1[2]) };
+				__m128 edge2[3] = { _mm_loadu_ps(triangles.edge2[0]), _mm_loadu_ps(triangles.edge2[1]), _mm_loadu_ps(triangles.edge2[2]) };
+				__m128 p[3] = {
+					_mm_sub_ps(_mm_mul_ps(direction[1], edge2[2]), _mm_mul_ps(direction[2], edge2[1])),
+					_mm_sub_ps(_mm_mul_ps(direction[2], edge2[0]), _mm_mul_ps(direction[0], edge2[2])),
+					_mm_sub_ps(_mm_mul_ps(direction[0], edge2[1]), _mm_mul_ps(direction[1], edge2[0])) };
+				__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1[0], p[0]), _mm_mul_ps(edge1[1], p[1])), _mm_mul_ps(edge1[2], p[2]));
+				__m128 inverseDeterminant = _mm_div_ps(one, determinant);
+
+				__m128 t[3] = {
+					_mm_sub_ps(origin[0], _mm_loadu_ps(triangles.corner[0])),
+					_mm_sub_ps(origin[1], _mm_loadu_ps(triangles.corner[1])),
+					_mm_sub_ps(origin[2], _mm_loadu_ps(triangles.corner[2])) };
+				__m128 weightU = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(t[0], p[0]), _mm_mul_ps(t[1], p[1])), _mm_mul_ps(t[2], p[2])), inverseDeterminant);
+				__m128 q[3] = {
+					_mm_sub_ps(_mm_mul_ps(t[1], edge1[2]), _mm_mul_ps(t[2], edge1[1])),
+					_mm_sub_ps(_mm_mul_ps(t[2], edge1[0]), _mm_mul_ps(t[0], edge1[2])),
+					_mm_sub_ps(_mm_mul_ps(t[0], edge1[1]), _mm_mul_ps(t[1], edge1[0])) };
+				__m128 weightV = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], q[0]), _mm_mul_ps(direction[1], q[1])), _mm_mul_ps(direction[2], q[2])), inverseDeterminant);
+				__m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2[0], q[0]), _mm_mul_ps(edge2[1], q[1])), _mm_mul_ps(edge2[2], q[2])), inverseDeterminant);
+
+				__m128 inside = _mm_cmpgt_ps(_mm_and_ps(determinant, absMask), minDeterminant);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(weightU, zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(weightV, zero));
+				inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_add_ps(weightU, weightV), one));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, zero));
+				inside = _mm_and_ps(inside, _mm_cmplt_ps(distance, _mm_set1_ps(closest)));
+				triangleMask = _mm_movemask_ps(inside);
+				_mm_storeu_ps(distances, distance);
+				_mm_storeu_ps(u, weightU);
+				_mm_storeu_ps(v, weightV);
+#else
+				for (int lane = 0; lane < 4; lane++)
+				{
+					glm::vec3 edge1(triangles.edge1[0][lane], triangles.edge1[1][lane], triangles.edge1[2][lane]);
+					glm::vec3 edge2(triangles.edge2[0][lane], triangles.edge2[1][lane], triangles.edge2[2][lane]);
+					glm::vec3 corner(triangles.corner[0][lane], triangles.corner[1][lane], triangles.corner[2][lane]);
+					glm::vec3 p = glm::cross(ray.direction, edge2);
+					float determinant = glm::dot(edge1, p);
+					if (std::fabs(determinant) <= g_MinDeterminant)
+					{
+						continue;
+					}
+					float inverseDeterminant = 1.0f / determinant;
+					glm::vec3 t = ray.origin - corner;
+					glm::vec3 q = glm::cross(t, edge1);
+					u[lane] = glm::dot(t, p) * inverseDeterminant;
+					v[lane] = glm::dot(ray.direction, q) * inverseDeterminant;
+					distances[lane] = glm::dot(edge2, q) * inverseDeterminant;
+					if ((u[lane] >= 0.0f) && (v[lane] >= 0.0f) && (u[lane] + v[lane] <= 1.0f) &&
+						(distances[lane] > 0.0f) && (distances[lane] < closest))
+					{
+						triangleMask |= 1 << lane;
+					}
+				}
+#endif
+				for (int lane = 0; triangleMask != 0; lane++, triangleMask >>= 1)
+				{
+					if (((triangleMask & 1) == 0) || (distances[lane] >= closest))
+					{
+						continue;
+					}
+
+					closest = distances[lane];
+					hit.distance = distances[lane];
+					hit.triangle = triangles.triangles[lane];
+					hit.u = u[lane];
+					hit.v = v[lane];
+					bHit = true;
+					if (bAnyHit)
+					{
+						return(true);
+					}
+				}
+			}
+		}
+
+		// the nearest node goes on the stack last
+		for (int k = orderCount - 1; k >= 0; k--)
+		{
+			int i = order[k];
+			if ((node.blockCounts[i] == 0) && (stackSize < g_StackSize))
+			{
+				stack[stackSize].node = node.children[i];
+				stack[stackSize].distance = entryDistances[i];
+				stackSize++;
+			}
+		}
+	}
+
+	return(bHit);
+}
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// trianglebvh.h
+// ============
+// bounding volume hierarchy for casting rays against triangles
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TriangleBVH
+ *
+ *  This class finds the triangles that rays hit.  The
+ *  triangles are split into a binary tree with the surface
+ *  area heuristic, which is then collapsed into a tree with
+ *  four children per node.  A ray is tested against the four
+ *  child boxes of a node at once, and the leaves hold blocks
+ *  of four triangles that are also tested at once, so every
+ *  ray uses the full SIMD width no matter how incoherent the
+ *  rays of a path tracer get.
+ ***********************************************************/
+class TriangleBVH
+{
+public:
+	struct RAY
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+	};
+
+	struct HIT
+	{
+		float distance;			// along the ray direction
+		uint32_t triangle;		// index of the triangle as built
+		float u;				// weights of the second and third
+		float v;				// corners at the hit point
+	};
+
+	struct BVH_STATS
+	{
+		size_t triangleCount;
+		size_t nodeCount;		// four wide nodes
+		size_t blockCount;		// blocks of four triangles
+		int depth;				// levels of the binary tree
+	};
+
+	// constructor
+	TriangleBVH();
+
+	// build the tree over triangles given as three corners each
+	void Build(const std::vector<glm::vec3>& corners);
+
+	// find the closest triangle the ray hits before the passed
+	// in distance
+	bool Intersect(const RAY& ray, float maxDistance, HIT& hit) const;
+	// find whether the ray hits any triangle before the passed
+	// in distance, which stops at the first one found
+	bool IsOccluded(const RAY& ray, float maxDistance) const;
+
+	const BVH_STATS& GetStats() const { return m_stats; }
+
+private:
+	// four child boxes, stored by axis so they load straight
+	// into SIMD registers
+	struct NODE
+	{
+		float boundsMin[3][4];
+		float boundsMax[3][4];
+		int32_t children[4];		// node, first block of a leaf, or -1
+		uint32_t blockCounts[4];	// blocks of a leaf, 0 for a node
+	};
+
+	// four triangles as a corner and two edges
+	struct TRIANGLE_BLOCK
+	{
+		float corner[3][4];
+		float edge1[3][4];
+		float edge2[3][4];
+		uint32_t triangles[4];
+	};
+
+	// node of the binary tree, only kept while building
+	struct BUILD_NODE
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		int32_t children[2];		// -1 for a leaf
+		uint32_t first;				// triangles of a leaf in the
+		uint32_t count;				// build order
+	};
+
+	// split a range of the build order into a binary subtree
+	int32_t BuildRange(uint32_t first, uint32_t count, int depth);
+	// convert a binary subtree into four wide nodes
+	int32_t CollapseNode(int32_t buildNode);
+	// copy the triangles of a binary leaf into blocks
+	uint32_t AddLeafBlocks(const BUILD_NODE& leaf);
+	// traverse the tree, stopping at the first hit when
+	// bAnyHit is set
+	bool Traverse(const RAY& ray, float maxDistance, bool bAnyHit, HIT& hit) const;
+
+	std::vector<NODE> m_nodes;
+	std::vector<TRIANGLE_BLOCK> m_blocks;
+	BVH_STATS m_stats;
+
+	// build data
+	const std::vector<glm::vec3>* m_pCorners;
+	std::vector<BUILD_NODE> m_buildNodes;
+	std::vector<uint32_t> m_buildOrder;
+	std::vector<glm::vec3> m_centroids;
+	std::vector<glm::vec3> m_triangleMin;
+	std::vector<glm::vec3> m_triangleMax;
+};
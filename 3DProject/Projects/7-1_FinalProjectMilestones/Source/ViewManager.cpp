@@ -52,6 +52,9 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_pHeadlessContext = NULL;
+	projection = glm::mat4(1.0f);
+	view = glm::mat4(1.0f);
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -75,6 +78,11 @@ ViewManager::~ViewManager()
 		delete g_pCamera;
 		g_pCamera = NULL;
 	}
+	if (NULL != m_pHeadlessContext)
+	{
+		delete m_pHeadlessContext;
+		m_pHeadlessContext = NULL;
+	}
 }
 
 /***********************************************************
@@ -118,6 +126,98 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	return(window);
 }
 
+/***********************************************************
+ *  CreateOffscreenWindow()
+ *
+ *  This method is used to create a window that is never
+ *  shown, for rendering frames into a framebuffer object
+ *  when the EGL headless context cannot be created.  The
+ *  native context is tried first, then the software OSMesa
+ *  context and then EGL.  GLFW still needs a display to
+ *  create any of them.
+ ***********************************************************/
+GLFWwindow* ViewManager::CreateOffscreenWindow(const char* windowTitle)
+{
+	GLFWwindow* window = nullptr;
+	const int contextAPIs[3] = { GLFW_NATIVE_CONTEXT_API, GLFW_OSMESA_CONTEXT_API, GLFW_EGL_CONTEXT_API };
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	for (int i = 0; (i < 3) && (window == NULL); i++)
+	{
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextAPIs[i]);
+		window = glfwCreateWindow(
+			WINDOW_WIDTH,
+			WINDOW_HEIGHT,
+			windowTitle,
+			NULL, NULL);
+	}
+	if (window == NULL)
+	{
+		std::cout << "Failed to create an offscreen GLFW context" << std::endl;
+		glfwTerminate();
+		return NULL;
+	}
+	glfwMakeContextCurrent(window);
+
+	// enable blending for supporting tranparent rendering
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_pWindow = window;
+
+	return(window);
+}
+
+/***********************************************************
+ *  CreateHeadlessContext()
+ *
+ *  This method is used to create the context of the
+ *  headless mode through EGL, which needs no window or
+ *  display, for rendering frames into framebuffer objects
+ *  the size of the window.
+ ***********************************************************/
+bool ViewManager::CreateHeadlessContext()
+{
+	if (NULL == m_pHeadlessContext)
+	{
+		m_pHeadlessContext = new HeadlessContext();
+	}
+	if (m_pHeadlessContext->Create(WINDOW_WIDTH, WINDOW_HEIGHT) == false)
+	{
+		delete m_pHeadlessContext;
+		m_pHeadlessContext = NULL;
+		return(false);
+	}
+
+	// enable blending for supporting tranparent rendering
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetFramebufferSize()
+ *
+ *  This method is used to get the size of the frames drawn
+ *  for the window, or for the headless context when there
+ *  is no window.
+ ***********************************************************/
+void ViewManager::GetFramebufferSize(int& width, int& height) const
+{
+	width = 0;
+	height = 0;
+	if (NULL != m_pWindow)
+	{
+		glfwGetFramebufferSize(m_pWindow, &width, &height);
+	}
+	else if (NULL != m_pHeadlessContext)
+	{
+		width = m_pHeadlessContext->GetWidth();
+		height = m_pHeadlessContext->GetHeight();
+	}
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -225,6 +325,21 @@ void ViewManager::ProcessKeyboardEvents()
 	{
 		bOrthographicProjection = true;
 	}
+}
+
+/***********************************************************
+ *  UpdateProjection()
+ *
+ *  This method is used to calculate the projection matrix
+ *  for the orthographic or perspective mode.
+ ***********************************************************/
+void ViewManager::UpdateProjection()
+{
+	// if the camera object is null, then exit this method
+	if (NULL == g_pCamera)
+	{
+		return;
+	}
 
 	// Calculate the aspect ratio based on the window's dimensions.
 	/// This ensures the scene scales correctly on different screen sizes.
@@ -254,19 +369,22 @@ void ViewManager::ProcessKeyboardEvents()
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
-	glm::mat4 view;
-
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
-
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// the headless context has no window to take input from
+	if (NULL != m_pWindow)
+	{
+		// per-frame timing
+		float currentFrame = glfwGetTime();
+		gDeltaTime = currentFrame - gLastFrame;
+		gLastFrame = currentFrame;
+
+		// process any keyboard events that may be waiting in the 
+		// event queue
+		ProcessKeyboardEvents();
+	}
+	UpdateProjection();
 
 	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	this->view = g_pCamera->GetViewMatrix();
 
 	// define the current projection matrix
 	// projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
@@ -275,7 +393,7 @@ void ViewManager::PrepareSceneView()
 	if (NULL != m_pShaderManager)
 	{
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
+		m_pShaderManager->setMat4Value(g_ViewName, this->view);
 		// set the view matrix into the shader for proper rendering
 		m_pShaderManager->setMat4Value(g_ProjectionName, this->projection);
 		// set the view position of the camera into the shader for proper rendering
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "HeadlessContext.h"
 #include "camera.h"
 
 // GLFW library
@@ -32,19 +33,38 @@ public:
 
 private:
 	glm::mat4 projection;
+	glm::mat4 view;
 	
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// context of the headless mode when there is no window
+	HeadlessContext* m_pHeadlessContext;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
+	// calculate the projection matrix for the current mode
+	void UpdateProjection();
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// create a hidden window that only holds the context, for
+	// rendering without a display
+	GLFWwindow* CreateOffscreenWindow(const char* windowTitle);
+	// create the context of the headless mode through EGL,
+	// without a window or a display
+	bool CreateHeadlessContext();
+
+	// get the size of the frames drawn for the window or the
+	// headless context
+	void GetFramebufferSize(int& width, int& height) const;
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// get the camera matrices set by the last PrepareSceneView()
+	const glm::mat4& GetViewMatrix() const { return view; }
+	const glm::mat4& GetProjectionMatrix() const { return projection; }
 };
\ No newline at end of file
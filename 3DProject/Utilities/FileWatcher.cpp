@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// background thread reporting the files that changed on disk
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#include <chrono>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher(unsigned int intervalMilliseconds)
+{
+	m_bShutdown = false;
+	m_intervalMilliseconds = (intervalMilliseconds > 0) ? intervalMilliseconds : 1;
+	m_thread = std::thread(&FileWatcher::WatchLoop, this);
+}
+
+/***********************************************************
+ *  ~FileWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FileWatcher::~FileWatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bShutdown = true;
+	}
+	m_wakeCondition.notify_all();
+	m_thread.join();
+}
+
+/***********************************************************
+ *  Watch()
+ *
+ *  This method is used for adding a file to the watched
+ *  files.  A file that is watched already is not added
+ *  again.
+ ***********************************************************/
+void FileWatcher::Watch(const std::string& path)
+{
+	FILE_STAMP stamp = GetFileStamp(path);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		if (m_files[i].path == path)
+		{
+			return;
+		}
+	}
+
+	WATCHED_FILE file;
+	file.path = path;
+	file.stamp = stamp;
+	file.bChanged = false;
+	m_files.push_back(file);
+}
+
+/***********************************************************
+ *  PollChanges()
+ *
+ *  This method is used for picking up the files that
+ *  changed since the last call.  The list is only locked
+ *  for as long as it takes to copy the paths.
+ ***********************************************************/
+bool FileWatcher::PollChanges(std::vector<std::string>& changedPaths)
+{
+	changedPaths.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		if (m_files[i].bChanged == true)
+		{
+			changedPaths.push_back(m_files[i].path);
+			m_files[i].bChanged = false;
+		}
+	}
+
+	return(changedPaths.empty() == false);
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method returns the number of watched files.
+ ***********************************************************/
+size_t FileWatcher::GetCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_files.size());
+}
+
+/***********************************************************
+ *  WatchLoop()
+ *
+ *  This method is the main loop of the watcher thread.  The
+ *  files are checked without holding the lock, so adding
+ *  files and picking up changes never wait on the disk.  A
+ *  file that is missing, which happens while some editors
+ *  save, keeps its last stamp until it is back.
+ ***********************************************************/
+void FileWatcher::WatchLoop()
+{
+	std::vector<std::string> paths;
+	std::vector<FILE_STAMP> stamps;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_bShutdown == false)
+	{
+		m_wakeCondition.wait_for(lock, std::chrono::milliseconds(m_intervalMilliseconds));
+		if (m_bShutdown == true)
+		{
+			break;
+		}
+
+		paths.resize(m_files.size());
+		for (size_t i = 0; i < m_files.size(); i++)
+		{
+			paths[i] = m_files[i].path;
+		}
+
+		lock.unlock();
+		stamps.resize(paths.size());
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			stamps[i] = GetFileStamp(paths[i]);
+		}
+		lock.lock();
+
+		for (size_t i = 0; i < stamps.size(); i++)
+		{
+			FILE_STAMP& stamp = m_files[i].stamp;
+			if ((stamps[i].bExists == false) ||
+				((stamps[i].modifiedTime == stamp.modifiedTime) && (stamps[i].size == stamp.size) && (stamp.bExists == true)))
+			{
+				continue;
+			}
+
+			stamp = stamps[i];
+			m_files[i].bChanged = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetFileStamp()
+ *
+ *  This method is used for reading the modification time
+ *  and the size of a file.
+ ***********************************************************/
+FileWatcher::FILE_STAMP FileWatcher::GetFileStamp(const std::string& path)
+{
+	FILE_STAMP stamp;
+	stamp.modifiedTime = 0;
+	stamp.size = 0;
+	stamp.bExists = false;
+
+#ifdef _WIN32
+	struct _stat64 status;
+	if (_stat64(path.c_str(), &status) == 0)
+#else
+	struct stat status;
+	if (stat(path.c_str(), &status) == 0)
+#endif
+	{
+		stamp.modifiedTime = (int64_t)status.st_mtime;
+		stamp.size = (int64_t)status.st_size;
+		stamp.bExists = true;
+	}
+
+	return(stamp);
+}
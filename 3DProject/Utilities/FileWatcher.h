@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// background thread reporting the files that changed on disk
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  This class checks the modification time and size of a
+ *  list of files on its own thread, so the render loop never
+ *  waits on the file system.  The files that changed are
+ *  collected until the render loop picks them up between
+ *  frames, and a file that is changed several times before
+ *  then is only reported once.
+ *
+ *  The time has a resolution of one second on some file
+ *  systems, which is why the size is compared as well.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	// constructor - the files are checked every passed in
+	// number of milliseconds
+	FileWatcher(unsigned int intervalMilliseconds = 250);
+	// destructor
+	~FileWatcher();
+
+	// add a file to the watched files, which is only reported
+	// once it changes after this call
+	void Watch(const std::string& path);
+	// move the files changed since the last call into the
+	// passed in list, returns false when none changed
+	bool PollChanges(std::vector<std::string>& changedPaths);
+
+	// number of watched files
+	size_t GetCount();
+
+	// what a file looked like the last time it was checked
+	struct FILE_STAMP
+	{
+		int64_t modifiedTime;
+		int64_t size;
+		bool bExists;
+	};
+
+	// read the stamp of a file
+	static FILE_STAMP GetFileStamp(const std::string& path);
+
+private:
+	struct WATCHED_FILE
+	{
+		std::string path;
+		FILE_STAMP stamp;
+		bool bChanged;
+	};
+
+	// watcher thread main loop
+	void WatchLoop();
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	bool m_bShutdown;
+	unsigned int m_intervalMilliseconds;
+
+	// the files are only ever added, so their indices stay
+	// the same while the thread checks a copy of the list
+	std::vector<WATCHED_FILE> m_files;
+};
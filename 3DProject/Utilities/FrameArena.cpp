@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// linear allocator for the transient data of a frame
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <cstdint>
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t frameCapacity, unsigned int frameCount)
+{
+	if (frameCount == 0)
+	{
+		frameCount = 1;
+	}
+
+	m_frameCount = frameCount;
+	m_currentFrame = 0;
+	m_frames = new FRAME[frameCount];
+	for (unsigned int i = 0; i < frameCount; i++)
+	{
+		m_frames[i].pMemory = new char[frameCapacity];
+		m_frames[i].capacity = frameCapacity;
+		m_frames[i].used = 0;
+		m_frames[i].allocationCount = 0;
+		m_frames[i].heapAllocationCount = 0;
+	}
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	for (unsigned int i = 0; i < m_frameCount; i++)
+	{
+		ReleaseOverflow(m_frames[i]);
+		delete[] m_frames[i].pMemory;
+	}
+	delete[] m_frames;
+	m_frames = NULL;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for switching to the buffer of the
+ *  next frame.  Resetting the buffer only sets its offset
+ *  back to zero, unless the last frame that used it ran out
+ *  of room - then the heap blocks are freed and the buffer
+ *  is replaced by one large enough for that frame.
+ ***********************************************************/
+void FrameArena::BeginFrame()
+{
+	m_currentFrame = (m_currentFrame + 1) % m_frameCount;
+	FRAME& frame = m_frames[m_currentFrame];
+
+	frame.heapAllocationCount = 0;
+
+	size_t used = frame.used.load();
+	if (used > frame.capacity)
+	{
+		ReleaseOverflow(frame);
+
+		size_t capacity = frame.capacity * 2;
+		while (capacity < used)
+		{
+			capacity *= 2;
+		}
+
+		delete[] frame.pMemory;
+		frame.pMemory = new char[capacity];
+		frame.capacity = capacity;
+		frame.heapAllocationCount = 1;
+	}
+
+	frame.used = 0;
+	frame.allocationCount = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for taking memory from the buffer of
+ *  the current frame.  The offset is moved with an atomic
+ *  add so worker threads can allocate at the same time, and
+ *  only the rare allocation that does not fit takes a lock.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	FRAME& frame = m_frames[m_currentFrame];
+
+	// room for the worst case padding in front of the data
+	size_t paddedSize = size + alignment - 1;
+	size_t offset = frame.used.fetch_add(paddedSize, std::memory_order_relaxed);
+	frame.allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	char* pMemory = NULL;
+	if (offset + paddedSize <= frame.capacity)
+	{
+		pMemory = frame.pMemory + offset;
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_overflowMutex);
+		pMemory = new char[paddedSize];
+		frame.overflowBlocks.push_back(pMemory);
+		frame.heapAllocationCount++;
+	}
+
+	uintptr_t address = ((uintptr_t)pMemory + alignment - 1) & ~((uintptr_t)alignment - 1);
+	return((void*)address);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method returns the allocation counters of the
+ *  current frame.
+ ***********************************************************/
+FrameArena::ARENA_STATS FrameArena::GetStats() const
+{
+	const FRAME& frame = m_frames[m_currentFrame];
+
+	ARENA_STATS stats;
+	stats.allocationCount = frame.allocationCount.load();
+	stats.bytesUsed = frame.used.load();
+	stats.capacity = frame.capacity;
+	stats.heapAllocationCount = frame.heapAllocationCount;
+	return(stats);
+}
+
+/***********************************************************
+ *  ReleaseOverflow()
+ *
+ *  This method is used for freeing the heap blocks that a
+ *  frame took after its buffer was full.
+ ***********************************************************/
+void FrameArena::ReleaseOverflow(FRAME& frame)
+{
+	for (size_t i = 0; i < frame.overflowBlocks.size(); i++)
+	{
+		delete[] frame.overflowBlocks[i];
+	}
+	frame.overflowBlocks.clear();
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// linear allocator for the transient data of a frame
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class hands out memory for data that only lives for
+ *  one frame by moving an offset through a large buffer.
+ *  Nothing is freed on its own - BeginFrame() switches to the
+ *  next buffer and sets its offset back to zero.  There is
+ *  one buffer per frame in flight, so the data of a frame
+ *  stays valid while the following frames are prepared.
+ *
+ *  Allocate() can be called from several threads at once.
+ *  When a frame needs more memory than its buffer holds, the
+ *  rest comes from the heap and the buffer is grown to fit
+ *  the next time it is used, so a steady scene stops
+ *  touching the heap after a few frames.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// allocation counters of the current frame
+	struct ARENA_STATS
+	{
+		size_t allocationCount;
+		size_t bytesUsed;
+		size_t capacity;
+		// heap allocations made by the arena this frame, which
+		// is zero once the buffers have grown to fit
+		size_t heapAllocationCount;
+	};
+
+	// constructor
+	FrameArena(size_t frameCapacity = 1 << 20, unsigned int frameCount = 2);
+	// destructor
+	~FrameArena();
+
+	// switch to the buffer of the next frame and reset it
+	void BeginFrame();
+
+	// allocate memory that stays valid until the buffer of the
+	// current frame is used again
+	void* Allocate(size_t size, size_t alignment = 16);
+
+	// allocate an array - the values are not initialized, so
+	// this is meant for plain data
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		return((T*)Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// allocate and construct an object - the destructor is
+	// never called, so it must not own any memory
+	template <typename T>
+	T* New()
+	{
+		return(new (Allocate(sizeof(T), alignof(T))) T());
+	}
+
+	// allocate and construct an array of objects - the same
+	// as New(), for every element
+	template <typename T>
+	T* NewArray(size_t count)
+	{
+		T* pArray = AllocateArray<T>(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			new (&pArray[i]) T();
+		}
+		return(pArray);
+	}
+
+	ARENA_STATS GetStats() const;
+	unsigned int GetFrameCount() const { return m_frameCount; }
+
+private:
+	struct FRAME
+	{
+		char* pMemory;
+		size_t capacity;
+		// bytes requested this frame, which is past the
+		// capacity when the frame needed the heap
+		std::atomic<size_t> used;
+		std::atomic<size_t> allocationCount;
+		size_t heapAllocationCount;
+		// memory taken from the heap after the buffer was full
+		std::vector<char*> overflowBlocks;
+	};
+
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+	// free the heap memory of a frame
+	void ReleaseOverflow(FRAME& frame);
+
+	FRAME* m_frames;
+	unsigned int m_frameCount;
+	unsigned int m_currentFrame;
+	// guards the overflow blocks
+	std::mutex m_overflowMutex;
+};
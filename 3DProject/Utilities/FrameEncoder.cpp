@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameencoder.cpp
+// ============
+// worker threads writing rendered frames to image files
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameEncoder.h"
+#include "ImageWriter.h"
+
+/***********************************************************
+ *  FrameEncoder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameEncoder::FrameEncoder(unsigned int threadCount, size_t maxQueuedFrames)
+{
+	m_pendingFrames = 0;
+	m_failedFrames = 0;
+	m_bShutdown = false;
+
+	// the render thread is busy drawing, so it does not count
+	// against the hardware threads
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+	}
+	// two frames per thread keeps every thread busy while the
+	// next frame is being drawn
+	m_maxQueuedFrames = (maxQueuedFrames > 0) ? maxQueuedFrames : threadCount * 2;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&FrameEncoder::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  ~FrameEncoder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameEncoder::~FrameEncoder()
+{
+	Finish();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bShutdown = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+/***********************************************************
+ *  AcquireBuffer()
+ *
+ *  This method is used for getting a buffer for the next
+ *  frame.  The passed in vector is swapped with a free
+ *  buffer when there is one.
+ ***********************************************************/
+void FrameEncoder::AcquireBuffer(std::vector<unsigned char>& pixels)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_freeBuffers.empty() == false)
+	{
+		pixels.swap(m_freeBuffers.back());
+		m_freeBuffers.pop_back();
+	}
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for queueing a frame to be written.
+ *  The passed in vector is left empty when the frame is
+ *  queued.
+ ***********************************************************/
+bool FrameEncoder::Submit(
+	const std::string& path,
+	std::vector<unsigned char>& pixels,
+	int width,
+	int height,
+	bool bWait)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_frames.size() >= m_maxQueuedFrames)
+	{
+		if (bWait == false)
+		{
+			return(false);
+		}
+		m_doneCondition.wait(lock);
+	}
+
+	FRAME frame;
+	frame.path = path;
+	frame.pixels.swap(pixels);
+	frame.width = width;
+	frame.height = height;
+	m_frames.push_back(std::move(frame));
+	m_pendingFrames++;
+
+	lock.unlock();
+	m_wakeCondition.notify_one();
+	return(true);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for waiting until every queued frame
+ *  is written.  The count of failed frames starts over.
+ ***********************************************************/
+bool FrameEncoder::Finish()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_pendingFrames > 0)
+	{
+		m_doneCondition.wait(lock);
+	}
+
+	bool bWritten = (m_failedFrames == 0);
+	m_failedFrames = 0;
+	return(bWritten);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is the main loop of every worker thread.  The
+ *  frames are written without holding the lock.
+ ***********************************************************/
+void FrameEncoder::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		while ((m_frames.empty() == true) && (m_bShutdown == false))
+		{
+			m_wakeCondition.wait(lock);
+		}
+		if (m_frames.empty() == true)
+		{
+			return;
+		}
+
+		FRAME frame = std::move(m_frames.front());
+		m_frames.pop_front();
+		lock.unlock();
+
+		bool bWritten = ImageWriter::WriteImage(frame.path, frame.pixels.data(), frame.width, frame.height);
+
+		lock.lock();
+		if (bWritten == false)
+		{
+			m_failedFrames++;
+		}
+		m_freeBuffers.push_back(std::move(frame.pixels));
+		m_pendingFrames--;
+		m_doneCondition.notify_all();
+	}
+}
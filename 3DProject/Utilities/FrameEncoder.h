@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameencoder.h
+// ============
+// worker threads writing rendered frames to image files
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameEncoder
+ *
+ *  This class writes frames to image files on its own
+ *  threads, so the render thread can start on the next
+ *  frame as soon as the pixels of the last one are read
+ *  back.  The number of queued frames is limited, and the
+ *  pixel buffers of written frames are handed back out for
+ *  new frames, so a long run allocates only a few buffers.
+ ***********************************************************/
+class FrameEncoder
+{
+public:
+	// constructor - a thread count of 0 uses one thread per
+	// additional hardware thread
+	FrameEncoder(unsigned int threadCount = 0, size_t maxQueuedFrames = 0);
+	// destructor - waits for the queued frames
+	~FrameEncoder();
+
+	// get a buffer for the pixels of the next frame, reusing
+	// the buffer of a frame that has been written
+	void AcquireBuffer(std::vector<unsigned char>& pixels);
+	// queue RGBA pixels, bottom row first, to be written to the
+	// passed in file.  The pixels are taken over by the
+	// encoder.  While the queue is full the call waits, or
+	// drops the frame and leaves the pixels when bWait is false.
+	bool Submit(
+		const std::string& path,
+		std::vector<unsigned char>& pixels,
+		int width,
+		int height,
+		bool bWait = true);
+	// wait for all of the queued frames to be written and get
+	// whether every frame since the last call was written
+	bool Finish();
+
+private:
+	struct FRAME
+	{
+		std::string path;
+		std::vector<unsigned char> pixels;
+		int width;
+		int height;
+	};
+
+	// worker thread main loop
+	void WorkerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+	// frames waiting for a worker
+	std::deque<FRAME> m_frames;
+	// buffers of written frames, ready to be reused
+	std::vector<std::vector<unsigned char>> m_freeBuffers;
+	size_t m_maxQueuedFrames;
+	// frames queued or being written
+	size_t m_pendingFrames;
+	unsigned int m_failedFrames;
+	bool m_bShutdown;
+};
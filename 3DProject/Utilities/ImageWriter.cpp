@@ -0,0 +1,457 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.cpp
+// ============
+// writes rendered frames to image files or to a pipe
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageWriter.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// largest block of stored (uncompressed) deflate data
+	const size_t g_MaxStoredBlock = 65535;
+
+	// append a 32 bit value with the high byte first
+	void PutBigEndian(std::vector<unsigned char>& data, uint32_t value)
+	{
+		data.push_back((unsigned char)(value >> 24));
+		data.push_back((unsigned char)(value >> 16));
+		data.push_back((unsigned char)(value >> 8));
+		data.push_back((unsigned char)value);
+	}
+
+	// lookup table of the PNG chunk CRC
+	struct CRC_TABLE
+	{
+		uint32_t values[256];
+
+		CRC_TABLE()
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				values[n] = c;
+			}
+		}
+	};
+
+	// calculate the CRC of a PNG chunk
+	uint32_t CalculateCRC(const unsigned char* bytes, size_t count)
+	{
+		// built once, by whichever encoder thread gets here first
+		static const CRC_TABLE table;
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < count; i++)
+		{
+			crc = table.values[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(crc ^ 0xFFFFFFFFu);
+	}
+
+	// append a PNG chunk, with the chunk data already placed
+	// at the end of the passed in vector after the type
+	void FinishChunk(std::vector<unsigned char>& data, size_t typeStart)
+	{
+		size_t length = data.size() - typeStart - 4;
+		data[typeStart - 4] = (unsigned char)(length >> 24);
+		data[typeStart - 3] = (unsigned char)(length >> 16);
+		data[typeStart - 2] = (unsigned char)(length >> 8);
+		data[typeStart - 1] = (unsigned char)length;
+		PutBigEndian(data, CalculateCRC(data.data() + typeStart, data.size() - typeStart));
+	}
+
+	// start a PNG chunk and get where its type starts
+	size_t StartChunk(std::vector<unsigned char>& data, const char* type)
+	{
+		PutBigEndian(data, 0);
+		size_t typeStart = data.size();
+		data.insert(data.end(), type, type + 4);
+		return(typeStart);
+	}
+}
+
+/***********************************************************
+ *  WritePPM()
+ *
+ *  This method is used for writing RGBA pixels as a binary
+ *  PPM image.  The alpha is dropped and the rows are
+ *  written from the top.
+ ***********************************************************/
+bool ImageWriter::WritePPM(
+	FILE* pFile,
+	const unsigned char* pixels,
+	int width,
+	int height)
+{
+	if ((NULL == pFile) || (NULL == pixels) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+	if (fwrite(header.data(), 1, header.size(), pFile) != header.size())
+	{
+		return(false);
+	}
+
+	std::vector<unsigned char> row((size_t)width * 3);
+	for (int y = height - 1; y >= 0; y--)
+	{
+		const unsigned char* source = pixels + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++)
+		{
+			row[x * 3 + 0] = source[x * 4 + 0];
+			row[x * 3 + 1] = source[x * 4 + 1];
+			row[x * 3 + 2] = source[x * 4 + 2];
+		}
+		if (fwrite(row.data(), 1, row.size(), pFile) != row.size())
+		{
+			return(false);
+		}
+	}
+
+	return(fflush(pFile) == 0);
+}
+
+/***********************************************************
+ *  EncodePNG()
+ *
+ *  This method is used for encoding RGBA pixels as an RGB
+ *  PNG image.  The rows are stored without filtering in
+ *  uncompressed deflate blocks, so the cost is one copy and
+ *  the checksums, and the image can be compressed later by
+ *  any PNG tool.
+ ***********************************************************/
+void ImageWriter::EncodePNG(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	std::vector<unsigned char>& data)
+{
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	size_t rowSize = (size_t)width * 3 + 1;
+	size_t rawSize = rowSize * height;
+	size_t blockCount = (rawSize + g_MaxStoredBlock - 1) / g_MaxStoredBlock;
+
+	data.clear();
+	data.reserve(sizeof(signature) + 25 + rawSize + blockCount * 5 + 30);
+	data.insert(data.end(), signature, signature + sizeof(signature));
+
+	// 8 bits per channel RGB, no interlacing
+	size_t typeStart = StartChunk(data, "IHDR");
+	PutBigEndian(data, (uint32_t)width);
+	PutBigEndian(data, (uint32_t)height);
+	data.push_back(8);
+	data.push_back(2);
+	data.push_back(0);
+	data.push_back(0);
+	data.push_back(0);
+	FinishChunk(data, typeStart);
+
+	// zlib stream of stored blocks, each row starting with
+	// the filter type 0
+	typeStart = StartChunk(data, "IDAT");
+	data.push_back(0x78);
+	data.push_back(0x01);
+
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+	size_t blockLeft = 0;
+	size_t rawLeft = rawSize;
+	for (int y = height - 1; y >= 0; y--)
+	{
+		const unsigned char* source = pixels + (size_t)y * width * 4;
+		for (size_t i = 0; i < rowSize; i++)
+		{
+			if (blockLeft == 0)
+			{
+				blockLeft = (rawLeft < g_MaxStoredBlock) ? rawLeft : g_MaxStoredBlock;
+				data.push_back((rawLeft == blockLeft) ? 1 : 0);
+				data.push_back((unsigned char)blockLeft);
+				data.push_back((unsigned char)(blockLeft >> 8));
+				data.push_back((unsigned char)~blockLeft);
+				data.push_back((unsigned char)(~blockLeft >> 8));
+			}
+
+			unsigned char value = (i == 0) ? 0 : source[(i - 1) / 3 * 4 + (i - 1) % 3];
+			data.push_back(value);
+			adlerA += value;
+			adlerB += adlerA;
+			blockLeft--;
+			rawLeft--;
+
+			// the sums cannot overflow between reductions
+			if ((rawLeft & 0x3FF) == 0)
+			{
+				adlerA %= 65521;
+				adlerB %= 65521;
+			}
+		}
+	}
+	adlerA %= 65521;
+	adlerB %= 65521;
+	PutBigEndian(data, (adlerB << 16) | adlerA);
+	FinishChunk(data, typeStart);
+
+	typeStart = StartChunk(data, "IEND");
+	FinishChunk(data, typeStart);
+}
+
+/***********************************************************
+ *  EncodeQOI()
+ *
+ *  This method is used for encoding RGBA pixels as an RGB
+ *  QOI image.  QOI compresses runs, recent colors and small
+ *  color changes in one pass, which is several times smaller
+ *  than a stored PNG for rendered frames at a similar cost.
+ ***********************************************************/
+void ImageWriter::EncodeQOI(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	std::vector<unsigned char>& data)
+{
+	const unsigned char QOI_OP_INDEX = 0x00;
+	const unsigned char QOI_OP_DIFF = 0x40;
+	const unsigned char QOI_OP_LUMA = 0x80;
+	const unsigned char QOI_OP_RUN = 0xC0;
+	const unsigned char QOI_OP_RGB = 0xFE;
+
+	data.clear();
+	data.reserve(14 + (size_t)width * height * 4 + 8);
+	data.push_back('q');
+	data.push_back('o');
+	data.push_back('i');
+	data.push_back('f');
+	PutBigEndian(data, (uint32_t)width);
+	PutBigEndian(data, (uint32_t)height);
+	data.push_back(3);
+	data.push_back(0);
+
+	// recently seen colors, found by a hash of the color
+	unsigned char index[64][3];
+	memset(index, 0, sizeof(index));
+
+	unsigned char previous[3] = { 0, 0, 0 };
+	int run = 0;
+	for (int y = height - 1; y >= 0; y--)
+	{
+		const unsigned char* source = pixels + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++)
+		{
+			const unsigned char* color = source + x * 4;
+			if ((color[0] == previous[0]) && (color[1] == previous[1]) && (color[2] == previous[2]))
+			{
+				run++;
+				if (run == 62)
+				{
+					data.push_back(QOI_OP_RUN | (run - 1));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0)
+			{
+				data.push_back(QOI_OP_RUN | (run - 1));
+				run = 0;
+			}
+
+			int hash = (color[0] * 3 + color[1] * 5 + color[2] * 7 + 255 * 11) % 64;
+			if ((index[hash][0] == color[0]) && (index[hash][1] == color[1]) && (index[hash][2] == color[2]))
+			{
+				data.push_back(QOI_OP_INDEX | (unsigned char)hash);
+			}
+			else
+			{
+				index[hash][0] = color[0];
+				index[hash][1] = color[1];
+				index[hash][2] = color[2];
+
+				signed char dr = (signed char)(color[0] - previous[0]);
+				signed char dg = (signed char)(color[1] - previous[1]);
+				signed char db = (signed char)(color[2] - previous[2]);
+				signed char drg = (signed char)(dr - dg);
+				signed char dbg = (signed char)(db - dg);
+
+				if ((dr >= -2) && (dr <= 1) && (dg >= -2) && (dg <= 1) && (db >= -2) && (db <= 1))
+				{
+					data.push_back(QOI_OP_DIFF | (unsigned char)(((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+				}
+				else if ((dg >= -32) && (dg <= 31) && (drg >= -8) && (drg <= 7) && (dbg >= -8) && (dbg <= 7))
+				{
+					data.push_back(QOI_OP_LUMA | (unsigned char)(dg + 32));
+					data.push_back((unsigned char)(((drg + 8) << 4) | (dbg + 8)));
+				}
+				else
+				{
+					data.push_back(QOI_OP_RGB);
+					data.push_back(color[0]);
+					data.push_back(color[1]);
+					data.push_back(color[2]);
+				}
+			}
+
+			previous[0] = color[0];
+			previous[1] = color[1];
+			previous[2] = color[2];
+		}
+	}
+	if (run > 0)
+	{
+		data.push_back(QOI_OP_RUN | (run - 1));
+	}
+
+	const unsigned char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	data.insert(data.end(), padding, padding + sizeof(padding));
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  This method is used for writing RGBA pixels to an image
+ *  file.  Files ending in .png or .qoi are written in that
+ *  format, and all others are written as PPM images.
+ ***********************************************************/
+bool ImageWriter::WriteImage(
+	const std::string& path,
+	const unsigned char* pixels,
+	int width,
+	int height)
+{
+	if ((NULL == pixels) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	FILE* pFile = NULL;
+#ifdef _WIN32
+	if (fopen_s(&pFile, path.c_str(), "wb") != 0)
+	{
+		pFile = NULL;
+	}
+#else
+	pFile = fopen(path.c_str(), "wb");
+#endif
+	if (NULL == pFile)
+	{
+		std::cout << "Could not open image file:" << path << std::endl;
+		return(false);
+	}
+
+	std::string extension = path.substr(path.size() - ((path.size() < 4) ? path.size() : 4));
+	for (size_t i = 0; i < extension.size(); i++)
+	{
+		extension[i] = (char)tolower(extension[i]);
+	}
+
+	bool bWritten = false;
+	if ((extension == ".png") || (extension == ".qoi"))
+	{
+		// the encoded image is kept per thread, so the frame
+		// encoder threads allocate it only once
+		static thread_local std::vector<unsigned char> data;
+		if (extension == ".png")
+		{
+			EncodePNG(pixels, width, height, data);
+		}
+		else
+		{
+			EncodeQOI(pixels, width, height, data);
+		}
+		bWritten = (fwrite(data.data(), 1, data.size(), pFile) == data.size());
+	}
+	else
+	{
+		bWritten = WritePPM(pFile, pixels, width, height);
+	}
+	if ((fclose(pFile) != 0) || (bWritten == false))
+	{
+		std::cout << "Could not write image file:" << path << std::endl;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  GetFramePath()
+ *
+ *  This method is used for numbering the files of a run of
+ *  frames.  A pattern without '#' is used as it is.
+ ***********************************************************/
+std::string ImageWriter::GetFramePath(const std::string& pattern, int frame)
+{
+	size_t last = pattern.find_last_of('#');
+	if (last == std::string::npos)
+	{
+		return(pattern);
+	}
+	size_t first = last;
+	while ((first > 0) && (pattern[first - 1] == '#'))
+	{
+		first--;
+	}
+
+	std::string number = std::to_string(frame);
+	size_t digits = last - first + 1;
+	if (number.size() < digits)
+	{
+		number.insert(0, digits - number.size(), '0');
+	}
+	return(pattern.substr(0, first) + number + pattern.substr(last + 1));
+}
+
+/***********************************************************
+ *  OpenStandardOutput()
+ *
+ *  This method is used for keeping the standard output for
+ *  the frames when they are piped to another program.  The
+ *  output is duplicated for the frames, and the original
+ *  handle is pointed at the standard error so the messages
+ *  printed while rendering do not end up in the pipe.
+ ***********************************************************/
+FILE* ImageWriter::OpenStandardOutput()
+{
+	fflush(stdout);
+	std::cout.flush();
+
+#ifdef _WIN32
+	int frameHandle = _dup(_fileno(stdout));
+	if (frameHandle < 0)
+	{
+		return(NULL);
+	}
+	_setmode(frameHandle, _O_BINARY);
+	_dup2(_fileno(stderr), _fileno(stdout));
+	return(_fdopen(frameHandle, "wb"));
+#else
+	int frameHandle = dup(fileno(stdout));
+	if (frameHandle < 0)
+	{
+		return(NULL);
+	}
+	dup2(fileno(stderr), fileno(stdout));
+	return(fdopen(frameHandle, "wb"));
+#endif
+}
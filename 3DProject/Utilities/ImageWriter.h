@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.h
+// ============
+// writes rendered frames to image files or to a pipe
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ImageWriter
+ *
+ *  This class writes the pixels read back from OpenGL, which
+ *  start at the bottom row, as top down images.  Files are
+ *  written as PNG, QOI or binary PPM images depending on
+ *  their extension, and PPM frames can also be sent one
+ *  after the other down a pipe to a video encoder.  The
+ *  alpha of the frames is dropped.
+ ***********************************************************/
+class ImageWriter
+{
+public:
+	// write RGBA pixels as a binary PPM image
+	static bool WritePPM(
+		FILE* pFile,
+		const unsigned char* pixels,
+		int width,
+		int height);
+	// encode RGBA pixels as a PNG image with stored deflate
+	// blocks, which trades file size for encoding speed
+	static void EncodePNG(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		std::vector<unsigned char>& data);
+	// encode RGBA pixels as a QOI image
+	static void EncodeQOI(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		std::vector<unsigned char>& data);
+	// write RGBA pixels to the passed in file, choosing the
+	// format from the extension
+	static bool WriteImage(
+		const std::string& path,
+		const unsigned char* pixels,
+		int width,
+		int height);
+
+	// get the file name of a frame, with the last run of '#'
+	// in the pattern replaced by the zero padded frame number
+	static std::string GetFramePath(const std::string& pattern, int frame);
+
+	// take the standard output for writing frames, sending
+	// everything else printed there to the standard error
+	static FILE* OpenStandardOutput();
+};
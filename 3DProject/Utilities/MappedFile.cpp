@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.cpp
+// ============
+// read only memory mapping of whole files
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+/***********************************************************
+ *  MappedFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MappedFile::MappedFile()
+{
+	m_pData = NULL;
+	m_size = 0;
+#ifdef _WIN32
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+#endif
+}
+
+/***********************************************************
+ *  ~MappedFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping the whole passed in file
+ *  read only.  Empty files cannot be mapped.
+ ***********************************************************/
+bool MappedFile::Open(const char* filename)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		filename,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "Could not open file for mapping:" << filename << std::endl;
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	if ((GetFileSizeEx(file, &fileSize) == FALSE) || (fileSize.QuadPart <= 0) ||
+		((unsigned long long)fileSize.QuadPart > (size_t)-1))
+	{
+		std::cout << "Could not map empty or oversized file:" << filename << std::endl;
+		CloseHandle(file);
+		return(false);
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const void* pData = (NULL != mapping) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (NULL == pData)
+	{
+		std::cout << "Could not map file:" << filename << std::endl;
+		if (NULL != mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return(false);
+	}
+
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_pData = pData;
+	m_size = (size_t)fileSize.QuadPart;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+	{
+		std::cout << "Could not open file for mapping:" << filename << std::endl;
+		return(false);
+	}
+
+	struct stat fileStatus;
+	if ((fstat(file, &fileStatus) != 0) || (fileStatus.st_size <= 0))
+	{
+		std::cout << "Could not map empty file:" << filename << std::endl;
+		close(file);
+		return(false);
+	}
+
+	void* pData = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_SHARED, file, 0);
+	// the mapping keeps its own reference to the file
+	close(file);
+	if (pData == MAP_FAILED)
+	{
+		std::cout << "Could not map file:" << filename << std::endl;
+		return(false);
+	}
+
+	m_pData = pData;
+	m_size = (size_t)fileStatus.st_size;
+#endif
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the file.  Pointers into
+ *  the mapped data are invalid afterwards.
+ ***********************************************************/
+void MappedFile::Close()
+{
+	if (NULL == m_pData)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_pData);
+	CloseHandle((HANDLE)m_mappingHandle);
+	CloseHandle((HANDLE)m_fileHandle);
+	m_mappingHandle = NULL;
+	m_fileHandle = NULL;
+#else
+	munmap((void*)m_pData, m_size);
+#endif
+
+	m_pData = NULL;
+	m_size = 0;
+}
@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// read only memory mapping of whole files
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a whole file read only into the address
+ *  space of the process.  Pages are only read from disk when
+ *  they are first touched, and processes that map the same
+ *  file share the same physical pages.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the passed in file, closing any file mapped before
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	bool IsOpen() const { return(NULL != m_pData); }
+	const void* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	// the mapping is owned by one object only
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const void* m_pData;
+	size_t m_size;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+};
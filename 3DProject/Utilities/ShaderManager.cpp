@@ -5,6 +5,7 @@
 #include <fstream>
 #include <algorithm>
 #include <sstream>
+#include <chrono>
 using namespace std;
 
 #include <stdlib.h>
@@ -14,89 +15,271 @@ using namespace std;
 
 #include "ShaderManager.h"
 
+namespace {
+
+	// folder of the linked program binaries, which are only
+	// valid for the driver that wrote them
+	const char* g_ProgramCacheDirectory = "../../Utilities/shaders/cache/";
+	// marks the start of a program binary file
+	const uint32_t g_ProgramCacheMagic = 0x43505347;	// "GSPC"
+
+	struct PROGRAM_CACHE_HEADER {
+		uint32_t magic;
+		uint32_t binaryFormat;
+		uint64_t key;
+		uint32_t binaryLength;
+	};
+
+	// the #line directives number the files of a source, so
+	// the files are listed with the messages that use them
+	void PrintSourceFiles(const ShaderPreprocessor::SHADER_SOURCE* Source){
+		if (Source->files.size() < 2){
+			return;
+		}
+		for (size_t i = 0; i < Source->files.size(); i++){
+			printf("  %d: %s\n", (int)i, Source->files[i].c_str());
+		}
+	}
+}
+
+GLuint ShaderManager::s_boundProgramID = 0;
+
+/***********************************************************
+ *  ShaderManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderManager::ShaderManager()
+{
+	m_programID = 0;
+	m_variant = 0;
+	m_fallbackRequiredFeatures = 0;
+	m_bParallelCompile = false;
+	m_pProgramInfo = NULL;
+	m_pVertexSource = NULL;
+	m_pFragmentSource = NULL;
+	m_bProgramReplaced = false;
+}
+
+/***********************************************************
+ *  ~ShaderManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderManager::~ShaderManager()
+{
+	DeleteVariants();
+}
+
 /***********************************************************
  *  LoadShaders()
  *
  *  This method is called to load the shader data from 
- *  external GLSL compatible files.
+ *  external GLSL compatible files.  The #include lines are
+ *  resolved by the preprocessor, which keeps the result, so
+ *  files shared by several programs are only read once.
  ***********************************************************/
 GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
 	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::stringstream sstr;
-		sstr << VertexShaderStream.rdbuf();
-		VertexShaderCode = sstr.str();
-		VertexShaderStream.close();
-	}else{
+	const ShaderPreprocessor::SHADER_SOURCE* VertexSource = ShaderPreprocessor::Load(vertex_file_path);
+	if(VertexSource == NULL){
 		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
 		getchar();
 		return 0;
 	}
 
 	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::stringstream sstr;
-		sstr << FragmentShaderStream.rdbuf();
-		FragmentShaderCode = sstr.str();
-		FragmentShaderStream.close();
+	const ShaderPreprocessor::SHADER_SOURCE* FragmentSource = ShaderPreprocessor::Load(fragment_file_path);
+	if(FragmentSource == NULL){
+		printf("Impossible to open %s.\n", fragment_file_path);
+		return 0;
 	}
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+	// the source is kept for compiling the variants, and the
+	// program without any features is compiled right away
+	DeleteVariants();
+	m_vertexFilePath = vertex_file_path;
+	m_fragmentFilePath = fragment_file_path;
+	m_pVertexSource = VertexSource;
+	m_pFragmentSource = FragmentSource;
 
+	GLuint ProgramID = CompileProgram(m_variantDefines);
+	m_variants[0] = ProgramID;
+	m_variant = 0;
+	SelectProgram(ProgramID);
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s...", vertex_file_path);
+	return ProgramID;
+}
+
+/***********************************************************
+ *  CompileProgram()
+ *
+ *  This method is called to compile and link the loaded
+ *  shader source, waiting until the program is ready.
+ ***********************************************************/
+GLuint ShaderManager::CompileProgram(const std::string& defines){
+
+	PENDING_PROGRAM Pending;
+	if (StartProgram(m_pVertexSource, m_pFragmentSource, defines, Pending) == true){
+		return Pending.programID;
+	}
+	return FinishProgram(Pending);
+}
+
+/***********************************************************
+ *  StartProgram()
+ *
+ *  This method is called to submit the compile and link of
+ *  the loaded shader source.  The passed in defines are
+ *  inserted after the #version line, which has to stay
+ *  first, in front of the resolved body the preprocessor
+ *  has cached.  None of the results are read here, so with
+ *  parallel shader compiles the driver works on the program
+ *  in the background until FinishProgram() is called.
+ *
+ *  The linked programs are saved as binaries keyed by the
+ *  hashes of the sources, the defines and the driver, so
+ *  the source text is not hashed again, and a program
+ *  found there is ready at once, which is returned as true.
+ ***********************************************************/
+bool ShaderManager::StartProgram(
+	const ShaderPreprocessor::SHADER_SOURCE* vertexSource,
+	const ShaderPreprocessor::SHADER_SOURCE* fragmentSource,
+	const std::string& defines,
+	PENDING_PROGRAM& pending){
+
+	std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+
+	// a program linked by an earlier run from the same source
+	// on the same driver is loaded without compiling
+	uint64_t CacheKey = ShaderPreprocessor::HASH_SEED;
+	CacheKey = ShaderPreprocessor::HashText((const char*)glGetString(GL_VENDOR), CacheKey);
+	CacheKey = ShaderPreprocessor::HashText((const char*)glGetString(GL_RENDERER), CacheKey);
+	CacheKey = ShaderPreprocessor::HashText((const char*)glGetString(GL_VERSION), CacheKey);
+	CacheKey = ShaderPreprocessor::HashValue(vertexSource->hash, CacheKey);
+	CacheKey = ShaderPreprocessor::HashValue(fragmentSource->hash, CacheKey);
+	CacheKey = ShaderPreprocessor::HashText(defines.c_str(), CacheKey);
+
+	pending.cacheKey = CacheKey;
+	pending.startTime = StartTime;
+	pending.vertexShaderID = 0;
+	pending.fragmentShaderID = 0;
+	pending.pVertexSource = vertexSource;
+	pending.pFragmentSource = fragmentSource;
+	pending.programID = LoadProgramBinary(CacheKey);
+	if (pending.programID != 0){
+		PROGRAM_TIMES Times;
+		Times.defines = defines;
+		Times.compileMilliseconds = 0.0;
+		Times.linkMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+		Times.bFromCache = true;
+		m_programTimes.push_back(Times);
+		return true;
+	}
+
+	printf("Compiling shader : %s, %s...submitted\n", m_vertexFilePath.c_str(), m_fragmentFilePath.c_str());
+
+	std::string VertexShaderCode = ShaderPreprocessor::Assemble(*vertexSource, defines);
+	std::string FragmentShaderCode = ShaderPreprocessor::Assemble(*fragmentSource, defines);
+
+	// Create and compile the shaders
+	pending.vertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	pending.fragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
 	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
+	glShaderSource(pending.vertexShaderID, 1, &VertexSourcePointer , NULL);
+	glCompileShader(pending.vertexShaderID);
+	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
+	glShaderSource(pending.fragmentShaderID, 1, &FragmentSourcePointer , NULL);
+	glCompileShader(pending.fragmentShaderID);
+
+	// without parallel compiles the shaders are done here, so
+	// the time is split between compiling and linking
+	if (m_bParallelCompile == false){
+		GLint Result = GL_FALSE;
+		glGetShaderiv(pending.fragmentShaderID, GL_COMPILE_STATUS, &Result);
+	}
+	pending.compileTime = std::chrono::steady_clock::now();
+
+	// Link the program
+	pending.programID = glCreateProgram();
+	glAttachShader(pending.programID, pending.vertexShaderID);
+	glAttachShader(pending.programID, pending.fragmentShaderID);
+	glProgramParameteri(pending.programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(pending.programID);
+
+	pending.defines = defines;
+	return false;
+}
+
+/***********************************************************
+ *  IsProgramReady()
+ *
+ *  This method is called to find out if the driver has
+ *  finished a submitted program, without waiting for it.
+ *  Without parallel compiles the driver works on the
+ *  program when its results are read, so it is always
+ *  reported as ready.
+ ***********************************************************/
+bool ShaderManager::IsProgramReady(const PENDING_PROGRAM& pending) const{
+
+	if (m_bParallelCompile == false){
+		return true;
+	}
+
+	GLint Completed = GL_FALSE;
+	glGetProgramiv(pending.programID, GL_COMPLETION_STATUS_KHR, &Completed);
+	return (Completed == GL_TRUE);
+}
+
+/***********************************************************
+ *  FinishProgram()
+ *
+ *  This method is called to read the results of a submitted
+ *  program, waiting for the driver when it is not done.
+ *  The compile and link messages are printed, the times are
+ *  recorded and the linked binary is saved for later runs.
+ ***********************************************************/
+GLuint ShaderManager::FinishProgram(PENDING_PROGRAM& pending){
+
+	GLuint VertexShaderID = pending.vertexShaderID;
+	GLuint FragmentShaderID = pending.fragmentShaderID;
+	GLuint ProgramID = pending.programID;
+	const char* vertex_file_path = m_vertexFilePath.c_str();
+	const char* fragment_file_path = m_fragmentFilePath.c_str();
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+
 
 	// Check Vertex Shader
+	printf("Compiling shader : %s...", vertex_file_path);
 	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
 	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
 		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
 		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
 		printf("\n%s\n", &VertexShaderErrorMessage[0]);
+		PrintSourceFiles(pending.pVertexSource);
 	}
 
 	printf("success\n");
 
-	// Compile Fragment Shader
-	printf("Compiling shader : %s...", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
-
 	// Check Fragment Shader
+	printf("Compiling shader : %s...", fragment_file_path);
 	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
 	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
 		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
 		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
 		printf("\n%s\n", &FragmentShaderErrorMessage[0]);
+		PrintSourceFiles(pending.pFragmentSource);
 	}
 
 	printf("success\n");
 
-	// Link the program
-	printf("Linking shader program...");
-	GLuint ProgramID = glCreateProgram();
-	m_programID = ProgramID;
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
-
 	// Check the program
+	printf("Linking shader program...");
 	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
 	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 1 ){
@@ -105,7 +288,15 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 		printf("\n%s\n", &ProgramErrorMessage[0]);
 	}
 
-	printf("success\n");
+	std::chrono::steady_clock::time_point EndTime = std::chrono::steady_clock::now();
+	PROGRAM_TIMES Times;
+	Times.defines = pending.defines;
+	Times.compileMilliseconds = std::chrono::duration<double, std::milli>(pending.compileTime - pending.startTime).count();
+	Times.linkMilliseconds = std::chrono::duration<double, std::milli>(EndTime - pending.compileTime).count();
+	Times.bFromCache = false;
+	m_programTimes.push_back(Times);
+
+	printf("success (compile %.1f ms, link %.1f ms)\n", Times.compileMilliseconds, Times.linkMilliseconds);
 	
 	glDetachShader(ProgramID, VertexShaderID);
 	glDetachShader(ProgramID, FragmentShaderID);
@@ -113,5 +304,581 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	if (Result == GL_TRUE){
+		SaveProgramBinary(pending.cacheKey, ProgramID);
+	}
+
 	return ProgramID;
 }
+
+/***********************************************************
+ *  LoadProgramBinary()
+ *
+ *  This method is called to create a program from the
+ *  binary saved for the passed in key.  It returns 0 when
+ *  there is no binary, when the file does not hold the
+ *  length its header claims, or when the driver does not
+ *  accept it anymore, so the program is compiled instead.
+ ***********************************************************/
+GLuint ShaderManager::LoadProgramBinary(uint64_t key){
+
+	GLint FormatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &FormatCount);
+	if (FormatCount <= 0){
+		return 0;
+	}
+
+	std::string CachePath = GetProgramBinaryPath(key);
+	std::ifstream CacheStream(CachePath.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!CacheStream.is_open()){
+		return 0;
+	}
+
+	// a corrupt length must not decide how much is allocated
+	std::streamoff FileSize = CacheStream.tellg();
+	CacheStream.seekg(0, std::ios::beg);
+
+	PROGRAM_CACHE_HEADER Header;
+	std::vector<char> Binary;
+	CacheStream.read((char*)&Header, sizeof(Header));
+	if (CacheStream && (Header.magic == g_ProgramCacheMagic) && (Header.key == key) && (Header.binaryLength > 0) &&
+		((std::streamoff)Header.binaryLength == FileSize - (std::streamoff)sizeof(Header))){
+		Binary.resize(Header.binaryLength);
+		CacheStream.read(&Binary[0], Binary.size());
+	}
+	if (!CacheStream || Binary.empty()){
+		return 0;
+	}
+
+	printf("Loading shader program : %s...", CachePath.c_str());
+	GLuint ProgramID = glCreateProgram();
+	glProgramBinary(ProgramID, Header.binaryFormat, &Binary[0], (GLsizei)Binary.size());
+
+	// a driver update makes the old binaries fail to load
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if (Result == GL_FALSE){
+		printf("stale\n");
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+
+	printf("success\n");
+	return ProgramID;
+}
+
+/***********************************************************
+ *  SaveProgramBinary()
+ *
+ *  This method is called to save the binary of a linked
+ *  program, so the next run can load it.
+ ***********************************************************/
+void ShaderManager::SaveProgramBinary(uint64_t key, GLuint programID){
+
+	GLint BinaryLength = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &BinaryLength);
+	if (BinaryLength <= 0){
+		return;
+	}
+
+	std::vector<char> Binary(BinaryLength);
+	GLenum BinaryFormat = 0;
+	glGetProgramBinary(programID, BinaryLength, NULL, &BinaryFormat, &Binary[0]);
+
+	PROGRAM_CACHE_HEADER Header;
+	Header.magic = g_ProgramCacheMagic;
+	Header.binaryFormat = BinaryFormat;
+	Header.key = key;
+	Header.binaryLength = (uint32_t)BinaryLength;
+
+	// the cache only saves time, so a failed write is ignored
+	std::string CachePath = GetProgramBinaryPath(key);
+	std::ofstream CacheStream(CachePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (CacheStream.is_open()){
+		CacheStream.write((const char*)&Header, sizeof(Header));
+		CacheStream.write(&Binary[0], Binary.size());
+	}
+}
+
+/***********************************************************
+ *  GetProgramBinaryPath()
+ *
+ *  This method is called to get the file name of the
+ *  program binary of the passed in key.
+ ***********************************************************/
+std::string ShaderManager::GetProgramBinaryPath(uint64_t key){
+
+	char KeyText[17];
+	snprintf(KeyText, sizeof(KeyText), "%016llx", (unsigned long long)key);
+	return std::string(g_ProgramCacheDirectory) + KeyText + ".bin";
+}
+
+/***********************************************************
+ *  CompileVariants()
+ *
+ *  This method is called to submit the programs of all of
+ *  the passed in feature sets at once.  The driver compiles
+ *  them on its own threads when it supports parallel shader
+ *  compiles, and PollVariants() picks up the finished ones,
+ *  so rendering can go on with the fallback variants until
+ *  then.
+ ***********************************************************/
+void ShaderManager::CompileVariants(const std::vector<uint32_t>& featureSets){
+
+	// let the driver pick the number of compile threads
+	if (GLEW_KHR_parallel_shader_compile){
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		m_bParallelCompile = true;
+	}
+
+	for (size_t i = 0; i < featureSets.size(); i++){
+		uint32_t Features = featureSets[i];
+		if ((m_variants.find(Features) != m_variants.end()) ||
+			(m_pendingVariants.find(Features) != m_pendingVariants.end())){
+			continue;
+		}
+
+		PENDING_PROGRAM Pending;
+		if (StartProgram(m_pVertexSource, m_pFragmentSource, GetVariantDefines(Features), Pending) == true){
+			m_variants[Features] = Pending.programID;
+		}else{
+			m_pendingVariants[Features] = Pending;
+		}
+	}
+}
+
+/***********************************************************
+ *  PollVariants()
+ *
+ *  This method is called to move the submitted programs
+ *  the driver has finished into the compiled variants.  It
+ *  returns the number of programs that are still compiling.
+ ***********************************************************/
+int ShaderManager::PollVariants(){
+
+	std::map<uint32_t, PENDING_PROGRAM>::iterator it = m_pendingVariants.begin();
+	while (it != m_pendingVariants.end()){
+		if (IsProgramReady(it->second) == false){
+			++it;
+			continue;
+		}
+
+		m_variants[it->first] = FinishProgram(it->second);
+		it = m_pendingVariants.erase(it);
+	}
+	return (int)m_pendingVariants.size();
+}
+
+/***********************************************************
+ *  SetVariantFeatures()
+ *
+ *  This method is called to name the define of every
+ *  feature bit of the variants.
+ ***********************************************************/
+void ShaderManager::SetVariantFeatures(const char* const* defineNames, int featureCount){
+
+	m_featureNames.assign(defineNames, defineNames + featureCount);
+}
+
+/***********************************************************
+ *  SetVariantDefines()
+ *
+ *  This method is called to set the defines that every
+ *  variant is compiled with.  The variants compiled with
+ *  other defines are deleted, and the one in use is
+ *  compiled again and activated so the current program
+ *  stays valid.
+ ***********************************************************/
+void ShaderManager::SetVariantDefines(const std::string& defines){
+
+	if (defines == m_variantDefines){
+		return;
+	}
+
+	DeleteVariants();
+	m_variantDefines = defines;
+	if (m_pVertexSource == NULL){
+		return;
+	}
+
+	uint32_t Features = m_variant;
+	SelectProgram(0);
+	UseVariant(Features);
+}
+
+/***********************************************************
+ *  UseVariant()
+ *
+ *  This method is called to activate the program of the
+ *  passed in features, compiling it the first time the
+ *  combination is used.  A variant submitted by
+ *  CompileVariants() that is not done yet is replaced by a
+ *  compiled fallback when there is one.  The uniforms are kept by each
+ *  program, so the caller has to set them again when a
+ *  different program is returned.
+ ***********************************************************/
+bool ShaderManager::UseVariant(uint32_t features){
+
+	GLuint ProgramID = 0;
+	std::map<uint32_t, GLuint>::const_iterator Found = m_variants.find(features);
+	std::map<uint32_t, PENDING_PROGRAM>::iterator Pending = m_pendingVariants.find(features);
+	if (Found != m_variants.end()){
+		ProgramID = Found->second;
+	}else if (Pending != m_pendingVariants.end()){
+		// a variant that is still compiling is drawn with the
+		// compiled variant closest to it, which has a part of
+		// its features and all of the required ones
+		int FallbackBits = -1;
+		if (IsProgramReady(Pending->second) == false){
+			for (Found = m_variants.begin(); Found != m_variants.end(); ++Found){
+				uint32_t Candidate = Found->first;
+				int CandidateBits = 0;
+				for (uint32_t Bits = Candidate; Bits != 0; Bits &= Bits - 1){
+					CandidateBits++;
+				}
+				if (((Candidate & ~features) == 0) &&
+					((Candidate & m_fallbackRequiredFeatures) == (features & m_fallbackRequiredFeatures)) &&
+					(CandidateBits > FallbackBits)){
+					ProgramID = Found->second;
+					FallbackBits = CandidateBits;
+				}
+			}
+		}
+		if (FallbackBits < 0){
+			ProgramID = FinishProgram(Pending->second);
+			m_variants[features] = ProgramID;
+			m_pendingVariants.erase(Pending);
+		}
+	}else{
+		ProgramID = CompileProgram(GetVariantDefines(features));
+		m_variants[features] = ProgramID;
+	}
+
+	bool bChanged = (ProgramID != m_programID) || m_bProgramReplaced;
+	m_bProgramReplaced = false;
+	m_variant = features;
+	SelectProgram(ProgramID);
+	use();
+	return bChanged;
+}
+
+/***********************************************************
+ *  SelectProgram()
+ *
+ *  This method is called to make the passed in program the
+ *  one the uniform setters write to.  Its uniforms and
+ *  blocks are reflected the first time it is selected.
+ ***********************************************************/
+void ShaderManager::SelectProgram(GLuint programID){
+
+	m_programID = programID;
+	m_pProgramInfo = NULL;
+	if (programID == 0){
+		return;
+	}
+
+	std::map<GLuint, PROGRAM_INFO>::iterator Found = m_programInfo.find(programID);
+	if (Found == m_programInfo.end()){
+		Found = m_programInfo.insert(std::make_pair(programID, PROGRAM_INFO())).first;
+		ReflectProgram(programID, Found->second);
+	}
+	m_pProgramInfo = &Found->second;
+}
+
+/***********************************************************
+ *  ReflectProgram()
+ *
+ *  This method is called to list the active uniforms and
+ *  the uniform and shader storage blocks of a linked
+ *  program.  The first element of an array is also listed
+ *  under the name of the array.
+ ***********************************************************/
+void ShaderManager::ReflectProgram(GLuint programID, PROGRAM_INFO& info){
+
+	GLint UniformCount = 0;
+	GLint MaxNameLength = 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &UniformCount);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &MaxNameLength);
+
+	std::vector<char> Name(MaxNameLength + 1);
+	for (GLint i = 0; i < UniformCount; i++){
+		GLsizei NameLength = 0;
+		UNIFORM_INFO Uniform;
+		glGetActiveUniform(programID, (GLuint)i, (GLsizei)Name.size(), &NameLength, &Uniform.size, &Uniform.type, &Name[0]);
+		std::string UniformName(&Name[0], NameLength);
+
+		// the members of blocks have no location
+		Uniform.location = glGetUniformLocation(programID, UniformName.c_str());
+		if (Uniform.location < 0){
+			continue;
+		}
+
+		info.uniforms[UniformName] = Uniform;
+		if ((UniformName.size() > 3) && (UniformName.compare(UniformName.size() - 3, 3, "[0]") == 0)){
+			info.uniforms[UniformName.substr(0, UniformName.size() - 3)] = Uniform;
+		}
+	}
+
+	GLenum Interfaces[2] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+	for (int i = 0; i < 2; i++){
+		GLint BlockCount = 0;
+		GLint MaxBlockNameLength = 0;
+		glGetProgramInterfaceiv(programID, Interfaces[i], GL_ACTIVE_RESOURCES, &BlockCount);
+		glGetProgramInterfaceiv(programID, Interfaces[i], GL_MAX_NAME_LENGTH, &MaxBlockNameLength);
+
+		std::vector<char> BlockName(MaxBlockNameLength + 1);
+		for (GLint j = 0; j < BlockCount; j++){
+			GLsizei NameLength = 0;
+			glGetProgramResourceName(programID, Interfaces[i], (GLuint)j, (GLsizei)BlockName.size(), &NameLength, &BlockName[0]);
+
+			GLenum Properties[2] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+			GLint Values[2] = { 0, 0 };
+			glGetProgramResourceiv(programID, Interfaces[i], (GLuint)j, 2, Properties, 2, NULL, Values);
+
+			BLOCK_INFO Block;
+			Block.name.assign(&BlockName[0], NameLength);
+			Block.interfaceType = Interfaces[i];
+			Block.binding = Values[0];
+			Block.dataSize = Values[1];
+			info.blocks.push_back(Block);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetUniformLocation()
+ *
+ *  This method is called to get the location of a uniform
+ *  of the program in use.  A name the reflection did not
+ *  list, such as a later element of an array, is asked from
+ *  the driver once and remembered, including names that are
+ *  not in the program at all.
+ ***********************************************************/
+GLint ShaderManager::GetUniformLocation(const char* name) const{
+
+	if (m_pProgramInfo == NULL){
+		return glGetUniformLocation(m_programID, name);
+	}
+
+	std::map<std::string, UNIFORM_INFO, std::less<>>::const_iterator Found = m_pProgramInfo->uniforms.find(name);
+	if (Found != m_pProgramInfo->uniforms.end()){
+		return Found->second.location;
+	}
+
+	UNIFORM_INFO Uniform;
+	Uniform.location = glGetUniformLocation(m_programID, name);
+	Uniform.type = 0;
+	Uniform.size = 0;
+	m_pProgramInfo->uniforms[name] = Uniform;
+	return Uniform.location;
+}
+
+/***********************************************************
+ *  GetVariantDefines()
+ *
+ *  This method is called to build the defines of the
+ *  passed in features.
+ ***********************************************************/
+std::string ShaderManager::GetVariantDefines(uint32_t features) const{
+
+	std::string Defines = m_variantDefines;
+	for (size_t i = 0; i < m_featureNames.size(); i++){
+		if (features & (1u << i)){
+			Defines += "#define " + m_featureNames[i] + "\n";
+		}
+	}
+	return Defines;
+}
+
+/***********************************************************
+ *  DeleteVariants()
+ *
+ *  This method is called to delete the programs of all of
+ *  the compiled variants and of the ones still compiling.
+ ***********************************************************/
+void ShaderManager::DeleteVariants(){
+
+	for (std::map<uint32_t, GLuint>::const_iterator it = m_variants.begin(); it != m_variants.end(); ++it){
+		// a deleted program stays bound until another one is
+		// used, so the next use() has to bind again
+		if (it->second == s_boundProgramID){
+			s_boundProgramID = 0;
+		}
+		glDeleteProgram(it->second);
+	}
+	m_variants.clear();
+	m_programInfo.clear();
+	m_pProgramInfo = NULL;
+
+	for (std::map<uint32_t, PENDING_PROGRAM>::const_iterator it = m_pendingVariants.begin(); it != m_pendingVariants.end(); ++it){
+		glDeleteShader(it->second.vertexShaderID);
+		glDeleteShader(it->second.fragmentShaderID);
+		glDeleteProgram(it->second.programID);
+	}
+	m_pendingVariants.clear();
+
+	for (std::map<uint32_t, PENDING_PROGRAM>::const_iterator it = m_reloadVariants.begin(); it != m_reloadVariants.end(); ++it){
+		glDeleteShader(it->second.vertexShaderID);
+		glDeleteShader(it->second.fragmentShaderID);
+		glDeleteProgram(it->second.programID);
+	}
+	m_reloadVariants.clear();
+}
+
+/***********************************************************
+ *  UsesFile()
+ *
+ *  This method is called to find out if the passed in file
+ *  is part of the loaded source, either as one of the two
+ *  files or as an include.
+ ***********************************************************/
+bool ShaderManager::UsesFile(const std::string& path) const{
+
+	const ShaderPreprocessor::SHADER_SOURCE* Sources[2] = { m_pVertexSource, m_pFragmentSource };
+	for (int i = 0; i < 2; i++){
+		if ((Sources[i] != NULL) &&
+			(std::find(Sources[i]->files.begin(), Sources[i]->files.end(), path) != Sources[i]->files.end())){
+			return true;
+		}
+	}
+	return false;
+}
+
+/***********************************************************
+ *  GetSourceFiles()
+ *
+ *  This method is called to list the files of the loaded
+ *  source, including the files they include.
+ ***********************************************************/
+void ShaderManager::GetSourceFiles(std::vector<std::string>& files) const{
+
+	const ShaderPreprocessor::SHADER_SOURCE* Sources[2] = { m_pVertexSource, m_pFragmentSource };
+	for (int i = 0; i < 2; i++){
+		if (Sources[i] != NULL){
+			files.insert(files.end(), Sources[i]->files.begin(), Sources[i]->files.end());
+		}
+	}
+}
+
+/***********************************************************
+ *  StartReload()
+ *
+ *  This method is called to compile every variant again
+ *  from the files on disk.  The changed files must have
+ *  been invalidated in the preprocessor first.  The new
+ *  programs are only submitted here, and the ones in use
+ *  keep drawing until PollReload() swaps them.  A reload
+ *  that is still compiling is dropped for the new one.
+ ***********************************************************/
+bool ShaderManager::StartReload(){
+
+	if (m_pVertexSource == NULL){
+		return false;
+	}
+
+	const ShaderPreprocessor::SHADER_SOURCE* VertexSource = ShaderPreprocessor::Load(m_vertexFilePath.c_str());
+	const ShaderPreprocessor::SHADER_SOURCE* FragmentSource = ShaderPreprocessor::Load(m_fragmentFilePath.c_str());
+	if ((VertexSource == NULL) || (FragmentSource == NULL)){
+		printf("Could not reload %s, %s, keeping the current program\n", m_vertexFilePath.c_str(), m_fragmentFilePath.c_str());
+		return false;
+	}
+	// a file saved without changes resolves to the same source
+	if ((VertexSource == m_pVertexSource) && (FragmentSource == m_pFragmentSource)){
+		return false;
+	}
+
+	for (std::map<uint32_t, PENDING_PROGRAM>::const_iterator it = m_reloadVariants.begin(); it != m_reloadVariants.end(); ++it){
+		glDeleteShader(it->second.vertexShaderID);
+		glDeleteShader(it->second.fragmentShaderID);
+		glDeleteProgram(it->second.programID);
+	}
+	m_reloadVariants.clear();
+
+	// every variant compiled or submitted so far is replaced -
+	// one first used before the swap is compiled from the old
+	// files, dropped by the swap and compiled again on its
+	// next use
+	std::vector<uint32_t> FeatureSets(1, m_variant);
+	for (std::map<uint32_t, GLuint>::const_iterator it = m_variants.begin(); it != m_variants.end(); ++it){
+		if (it->first != m_variant){
+			FeatureSets.push_back(it->first);
+		}
+	}
+	for (std::map<uint32_t, PENDING_PROGRAM>::const_iterator it = m_pendingVariants.begin(); it != m_pendingVariants.end(); ++it){
+		if (it->first != m_variant){
+			FeatureSets.push_back(it->first);
+		}
+	}
+
+	for (size_t i = 0; i < FeatureSets.size(); i++){
+		// a program loaded from the cache has no shaders and is
+		// ready at once
+		PENDING_PROGRAM Pending;
+		StartProgram(VertexSource, FragmentSource, GetVariantDefines(FeatureSets[i]), Pending);
+		m_reloadVariants[FeatureSets[i]] = Pending;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  PollReload()
+ *
+ *  This method is called between frames to swap in the
+ *  reloaded variants.  Nothing changes until the driver is
+ *  done with all of them, and when any of them fails to
+ *  link they are all dropped so the previous programs stay
+ *  in use.  The uniforms are kept by each program, so the
+ *  next UseVariant() reports a change for the caller to set
+ *  them again.
+ ***********************************************************/
+bool ShaderManager::PollReload(){
+
+	if (m_reloadVariants.empty()){
+		return false;
+	}
+	for (std::map<uint32_t, PENDING_PROGRAM>::const_iterator it = m_reloadVariants.begin(); it != m_reloadVariants.end(); ++it){
+		if ((it->second.vertexShaderID != 0) && (IsProgramReady(it->second) == false)){
+			return false;
+		}
+	}
+
+	bool bLinked = true;
+	std::map<uint32_t, GLuint> Programs;
+	for (std::map<uint32_t, PENDING_PROGRAM>::iterator it = m_reloadVariants.begin(); it != m_reloadVariants.end(); ++it){
+		GLuint ProgramID = it->second.programID;
+		if (it->second.vertexShaderID != 0){
+			ProgramID = FinishProgram(it->second);
+		}
+
+		GLint Result = GL_FALSE;
+		glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+		if (Result != GL_TRUE){
+			bLinked = false;
+		}
+		Programs[it->first] = ProgramID;
+	}
+	const ShaderPreprocessor::SHADER_SOURCE* VertexSource = m_reloadVariants.begin()->second.pVertexSource;
+	const ShaderPreprocessor::SHADER_SOURCE* FragmentSource = m_reloadVariants.begin()->second.pFragmentSource;
+	m_reloadVariants.clear();
+
+	if (bLinked == false){
+		for (std::map<uint32_t, GLuint>::const_iterator it = Programs.begin(); it != Programs.end(); ++it){
+			glDeleteProgram(it->second);
+		}
+		printf("Reloading %s, %s failed, keeping the current program\n", m_vertexFilePath.c_str(), m_fragmentFilePath.c_str());
+		return false;
+	}
+
+	uint32_t Features = m_variant;
+	DeleteVariants();
+	m_variants = Programs;
+	m_pVertexSource = VertexSource;
+	m_pFragmentSource = FragmentSource;
+
+	SelectProgram(0);
+	UseVariant(Features);
+	m_bProgramReplaced = true;
+
+	printf("Reloaded %s, %s\n", m_vertexFilePath.c_str(), m_fragmentFilePath.c_str());
+	return true;
+}
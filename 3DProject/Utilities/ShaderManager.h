@@ -2,6 +2,8 @@
 
 #include <GL/glew.h>        // GLEW library
 
+#include "ShaderPreprocessor.h"
+
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -10,94 +12,267 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <chrono>
 
 class ShaderManager
 {
 public:
+	// how long a program took to get ready - with parallel
+	// compiles the link time includes the wait for the driver
+	struct PROGRAM_TIMES
+	{
+		std::string defines;
+		double compileMilliseconds;
+		double linkMilliseconds;
+		bool bFromCache;
+	};
+
+	// a uniform found in a linked program
+	struct UNIFORM_INFO
+	{
+		GLint location;
+		GLenum type;
+		GLint size;
+	};
+
+	// a uniform or shader storage block of a linked program
+	struct BLOCK_INFO
+	{
+		std::string name;
+		GLenum interfaceType;
+		GLint binding;
+		GLint dataSize;
+	};
+
+	// what a linked program reads, found once when the program
+	// is first used - the names are compared with std::less<>
+	// so the setters can look them up by C string
+	struct PROGRAM_INFO
+	{
+		std::map<std::string, UNIFORM_INFO, std::less<>> uniforms;
+		std::vector<BLOCK_INFO> blocks;
+	};
+
 	unsigned int m_programID;
+
+	ShaderManager();
+	~ShaderManager();
 	
 	GLuint LoadShaders(
 		const char* vertex_file_path, 
 		const char* fragment_file_path);
 
-	// activate the shader
+	// shader variants - the loaded source is compiled once for
+	// every combination of features that is used, with a
+	// #define for each feature bit that is set
+	// ------------------------------------------------------------------------
+	// name the define of every feature bit, starting at bit 0
+	void SetVariantFeatures(const char* const* defineNames, int featureCount);
+	// defines added to every variant, such as array sizes -
+	// the compiled variants are dropped when these change
+	void SetVariantDefines(const std::string& defines);
+	// use the program compiled for the passed in features,
+	// returns true when a different program is now in use
+	bool UseVariant(uint32_t features);
+	// the features of the program in use
+	uint32_t GetVariant() const { return m_variant; }
+	// submit the programs of the passed in feature sets
+	// without waiting for them
+	void CompileVariants(const std::vector<uint32_t>& featureSets);
+	// pick up the submitted programs that are done, returns
+	// the number still compiling
+	int PollVariants();
+	// features a fallback for a variant that is still
+	// compiling must match exactly
+	void SetFallbackRequiredFeatures(uint32_t features) { m_fallbackRequiredFeatures = features; }
+	// the times of every program made ready so far
+	const std::vector<PROGRAM_TIMES>& GetProgramTimes() const { return m_programTimes; }
+
+	// reloading - the variants are compiled again from the
+	// changed files while the old programs stay in use, and
+	// are swapped in together once all of them have linked
+	// ------------------------------------------------------------------------
+	// whether the program was loaded from the passed in file
+	// or includes it
+	bool UsesFile(const std::string& path) const;
+	// append the files the program was loaded from
+	void GetSourceFiles(std::vector<std::string>& files) const;
+	// submit the variants again from the files, returns false
+	// when the resolved source did not change
+	bool StartReload();
+	// swap in the reloaded variants once the driver is done
+	// with all of them, returns true when they replaced the
+	// programs in use
+	bool PollReload();
+
+	// the uniforms and blocks of the program in use
+	const PROGRAM_INFO* GetProgramInfo() const { return m_pProgramInfo; }
+	// location of a uniform of the program in use, from the
+	// reflected uniforms instead of asking the driver
+	GLint GetUniformLocation(const char* name) const;
+
+	// activate the shader - the bound program is shared by all
+	// of the shader managers, so binding it again is skipped
 	// ------------------------------------------------------------------------
 	inline void use()
 	{
-		glUseProgram(m_programID);
+		if (m_programID != s_boundProgramID)
+		{
+			glUseProgram(m_programID);
+			s_boundProgramID = m_programID;
+		}
+	}
+
+	// utility uniform functions - the names are C strings so the
+	// literals passed in every frame do not build std::string objects
+	// ------------------------------------------------------------------------
+	inline void setBoolValue(const char* name, bool value)
+	{
+		glUniform1i(GetUniformLocation(name), (int)value);
 	}
 
-	// utility uniform functions
 	// ------------------------------------------------------------------------
-	inline void setBoolValue(const std::string &name, bool value)
+	inline void setIntValue(const char* name, int value)
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), (int)value);
+		glUniform1i(GetUniformLocation(name), value);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setIntValue(const std::string &name, int value)
+	inline void setIVec3Value(const char* name, int x, int y, int z)
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+		glUniform3i(GetUniformLocation(name), x, y, z);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setFloatValue(const std::string &name, float value) const
+	inline void setFloatValue(const char* name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(m_programID, name.c_str()), value);
+		glUniform1f(GetUniformLocation(name), value);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec2Value(const std::string &name, const glm::vec2 &value)
+	inline void setVec2Value(const char* name, const glm::vec2 &value)
 	{
-		glUniform2fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		glUniform2fv(GetUniformLocation(name), 1, &value[0]);
 	}
 
-	inline void setVec2Value(const std::string &name, float x, float y) 
+	inline void setVec2Value(const char* name, float x, float y) 
 	{
-		glUniform2f(glGetUniformLocation(m_programID, name.c_str()), x, y);
+		glUniform2f(GetUniformLocation(name), x, y);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec3Value(const std::string &name, const glm::vec3 &value) 
+	inline void setVec3Value(const char* name, const glm::vec3 &value) 
 	{
-		glUniform3fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		glUniform3fv(GetUniformLocation(name), 1, &value[0]);
 	}
-	inline void setVec3Value(const std::string &name, float x, float y, float z) 
+	inline void setVec3Value(const char* name, float x, float y, float z) 
 	{
-		glUniform3f(glGetUniformLocation(m_programID, name.c_str()), x, y, z);
+		glUniform3f(GetUniformLocation(name), x, y, z);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec4Value(const std::string &name, const glm::vec4 &value) 
+	inline void setVec4Value(const char* name, const glm::vec4 &value) 
 	{
-		glUniform4fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		glUniform4fv(GetUniformLocation(name), 1, &value[0]);
 	}
-	inline void setVec4Value(const std::string &name, float x, float y, float z, float w)
+	inline void setVec4Value(const char* name, float x, float y, float z, float w)
 	{
-		glUniform4f(glGetUniformLocation(m_programID, name.c_str()), x, y, z, w);
+		glUniform4f(GetUniformLocation(name), x, y, z, w);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setMat2Value(const std::string &name, const glm::mat2 &mat) 
+	inline void setMat2Value(const char* name, const glm::mat2 &mat) 
 	{
-		glUniformMatrix2fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix2fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setMat3Value(const std::string &name, const glm::mat3 &mat) 
+	inline void setMat3Value(const char* name, const glm::mat3 &mat) 
 	{
-		glUniformMatrix3fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setMat4Value(const std::string &name, const glm::mat4 &mat) 
+	inline void setMat4Value(const char* name, const glm::mat4 &mat) 
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+		glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat));
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setSampler2DValue(const std::string& name, const int &value) 
+	inline void setSampler2DValue(const char* name, const int &value) 
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+		glUniform1i(GetUniformLocation(name), value);
 	}
+
+private:
+	// a program submitted to the driver and not checked yet
+	struct PENDING_PROGRAM
+	{
+		GLuint programID;
+		GLuint vertexShaderID;
+		GLuint fragmentShaderID;
+		const ShaderPreprocessor::SHADER_SOURCE* pVertexSource;
+		const ShaderPreprocessor::SHADER_SOURCE* pFragmentSource;
+		uint64_t cacheKey;
+		std::string defines;
+		std::chrono::steady_clock::time_point startTime;
+		std::chrono::steady_clock::time_point compileTime;
+	};
+
+	// compile and link the loaded source with the passed in
+	// defines inserted after the #version line
+	GLuint CompileProgram(const std::string& defines);
+	// submit a program, returns true when it was loaded from
+	// the cache and is ready already
+	bool StartProgram(
+		const ShaderPreprocessor::SHADER_SOURCE* vertexSource,
+		const ShaderPreprocessor::SHADER_SOURCE* fragmentSource,
+		const std::string& defines,
+		PENDING_PROGRAM& pending);
+	// whether the driver is done with a submitted program
+	bool IsProgramReady(const PENDING_PROGRAM& pending) const;
+	// read the results of a submitted program
+	GLuint FinishProgram(PENDING_PROGRAM& pending);
+	// the defines of the passed in features
+	std::string GetVariantDefines(uint32_t features) const;
+	// make the passed in program the current one of this
+	// shader manager, reflecting it the first time
+	void SelectProgram(GLuint programID);
+	// find the uniforms and blocks of a linked program
+	static void ReflectProgram(GLuint programID, PROGRAM_INFO& info);
+	// delete the programs of all of the compiled variants
+	void DeleteVariants();
+	// program binaries saved by earlier runs, keyed by a hash
+	// of the source and the driver
+	GLuint LoadProgramBinary(uint64_t key);
+	void SaveProgramBinary(uint64_t key, GLuint programID);
+	static std::string GetProgramBinaryPath(uint64_t key);
+
+	std::string m_vertexFilePath;
+	std::string m_fragmentFilePath;
+	// the resolved source, shared with the other programs
+	// loaded from the same files
+	const ShaderPreprocessor::SHADER_SOURCE* m_pVertexSource;
+	const ShaderPreprocessor::SHADER_SOURCE* m_pFragmentSource;
+	std::vector<std::string> m_featureNames;
+	std::string m_variantDefines;
+	std::map<uint32_t, GLuint> m_variants;
+	std::map<uint32_t, PENDING_PROGRAM> m_pendingVariants;
+	// the variants being compiled from reloaded files
+	std::map<uint32_t, PENDING_PROGRAM> m_reloadVariants;
+	// the program in use was swapped by a reload, so the next
+	// UseVariant() reports a change even for the same features
+	bool m_bProgramReplaced;
+	uint32_t m_variant;
+	uint32_t m_fallbackRequiredFeatures;
+	bool m_bParallelCompile;
+	std::vector<PROGRAM_TIMES> m_programTimes;
+	std::map<GLuint, PROGRAM_INFO> m_programInfo;
+	PROGRAM_INFO* m_pProgramInfo;
+
+	// the program bound to the GL context
+	static GLuint s_boundProgramID;
 };
\ No newline at end of file
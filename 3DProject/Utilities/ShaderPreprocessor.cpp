@@ -0,0 +1,317 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpreprocessor.cpp
+// ============
+// resolves the #include lines of the GLSL files and caches the result
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// deepest chain of includes, which stops include cycles
+	// the once only rule does not catch
+	const int g_MaxIncludeDepth = 16;
+
+	// get the file name of an #include "file" line, returns
+	// false for any other line
+	bool GetIncludeName(
+		const std::string& text,
+		size_t lineStart,
+		size_t lineEnd,
+		std::string& name)
+	{
+		size_t position = text.find_first_not_of(" \t", lineStart);
+		if ((position == std::string::npos) || (position >= lineEnd) || (text[position] != '#'))
+		{
+			return(false);
+		}
+		position = text.find_first_not_of(" \t", position + 1);
+		if ((position == std::string::npos) || (text.compare(position, 7, "include") != 0))
+		{
+			return(false);
+		}
+		size_t nameStart = text.find('"', position + 7);
+		if ((nameStart == std::string::npos) || (nameStart >= lineEnd))
+		{
+			return(false);
+		}
+		size_t nameEnd = text.find('"', nameStart + 1);
+		if ((nameEnd == std::string::npos) || (nameEnd >= lineEnd))
+		{
+			return(false);
+		}
+
+		name = text.substr(nameStart + 1, nameEnd - nameStart - 1);
+		return(true);
+	}
+}
+
+std::map<std::string, ShaderPreprocessor::MODULE> ShaderPreprocessor::s_modules;
+std::map<uint64_t, ShaderPreprocessor::SHADER_SOURCE> ShaderPreprocessor::s_sources;
+std::map<std::string, uint64_t> ShaderPreprocessor::s_loadedSources;
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for resolving a GLSL file into one
+ *  source.  A file resolved before is returned from the
+ *  cache until it or one of its includes is invalidated.
+ *  The sources are never freed, so the returned pointer
+ *  stays valid for the shader managers compiling from it.
+ ***********************************************************/
+const ShaderPreprocessor::SHADER_SOURCE* ShaderPreprocessor::Load(const char* path)
+{
+	std::map<std::string, uint64_t>::const_iterator loaded = s_loadedSources.find(path);
+	if (loaded != s_loadedSources.end())
+	{
+		return(&s_sources[loaded->second]);
+	}
+
+	SHADER_SOURCE source;
+	std::string text;
+	if (Resolve(path, source, text, 0) == false)
+	{
+		return(NULL);
+	}
+
+	// the #version line has to stay first, so the defines of
+	// the variants go right after it and a #line puts the
+	// line numbers of the body back where they were
+	size_t split = 0;
+	size_t versionLine = text.find("#version");
+	if (versionLine != std::string::npos)
+	{
+		split = text.find('\n', versionLine);
+		split = (split == std::string::npos) ? text.size() : split + 1;
+	}
+	int bodyLine = 1 + (int)std::count(text.begin(), text.begin() + split, '\n');
+
+	source.header = text.substr(0, split);
+	source.body = "#line " + std::to_string(bodyLine) + " 0\n" + text.substr(split);
+	source.hash = HashText(source.header.c_str(), HashText(source.body.c_str(), HASH_SEED));
+
+	// files with the same resolved text share one source
+	if (s_sources.find(source.hash) == s_sources.end())
+	{
+		s_sources[source.hash] = source;
+	}
+	s_loadedSources[path] = source.hash;
+
+	return(&s_sources[source.hash]);
+}
+
+/***********************************************************
+ *  Assemble()
+ *
+ *  This method is used for building the text of a variant
+ *  from a resolved source and its defines.  Nothing is read
+ *  or resolved here.
+ ***********************************************************/
+std::string ShaderPreprocessor::Assemble(
+	const SHADER_SOURCE& source,
+	const std::string& defines)
+{
+	std::string text;
+	text.reserve(source.header.size() + defines.size() + source.body.size());
+	text += source.header;
+	text += defines;
+	text += source.body;
+	return(text);
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting the text of a file
+ *  that has changed.  Every source that includes the file
+ *  is resolved again the next time it is loaded.
+ ***********************************************************/
+void ShaderPreprocessor::Invalidate(const char* path)
+{
+	s_modules.erase(path);
+
+	std::map<std::string, uint64_t>::iterator it = s_loadedSources.begin();
+	while (it != s_loadedSources.end())
+	{
+		const std::vector<std::string>& files = s_sources[it->second].files;
+		if (std::find(files.begin(), files.end(), path) != files.end())
+		{
+			it = s_loadedSources.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+/***********************************************************
+ *  InvalidateAll()
+ *
+ *  This method is used for forgetting the text of every
+ *  file, so all of the sources are read again.
+ ***********************************************************/
+void ShaderPreprocessor::InvalidateAll()
+{
+	s_modules.clear();
+	s_loadedSources.clear();
+}
+
+/***********************************************************
+ *  HashText()
+ *
+ *  This method is used for continuing a FNV-1a hash with
+ *  the passed in text.  The end of every text is hashed
+ *  too, so moving text from one string to the next changes
+ *  the hash.
+ ***********************************************************/
+uint64_t ShaderPreprocessor::HashText(const char* text, uint64_t hash)
+{
+	if (NULL == text)
+	{
+		return(hash);
+	}
+	for (const unsigned char* p = (const unsigned char*)text; *p != 0; p++)
+	{
+		hash ^= *p;
+		hash *= 0x100000001b3ULL;
+	}
+	hash ^= 0xff;
+	hash *= 0x100000001b3ULL;
+	return(hash);
+}
+
+/***********************************************************
+ *  HashValue()
+ *
+ *  This method is used for continuing a FNV-1a hash with
+ *  the bytes of the passed in value.
+ ***********************************************************/
+uint64_t ShaderPreprocessor::HashValue(uint64_t value, uint64_t hash)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		hash ^= (value >> (i * 8)) & 0xff;
+		hash *= 0x100000001b3ULL;
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  ReadModule()
+ *
+ *  This method is used for getting the text of a file,
+ *  which is only read the first time it is asked for.
+ ***********************************************************/
+const ShaderPreprocessor::MODULE* ShaderPreprocessor::ReadModule(const std::string& path)
+{
+	std::map<std::string, MODULE>::const_iterator found = s_modules.find(path);
+	if (found != s_modules.end())
+	{
+		return(&found->second);
+	}
+
+	std::ifstream stream(path.c_str(), std::ios::in);
+	if (stream.is_open() == false)
+	{
+		return(NULL);
+	}
+	std::stringstream sstr;
+	sstr << stream.rdbuf();
+
+	MODULE& module = s_modules[path];
+	module.text = sstr.str();
+	module.hash = HashText(module.text.c_str(), HASH_SEED);
+	return(&module);
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for appending a file to the text of
+ *  a source, with its #include lines replaced by the files
+ *  they name.  A file that is already part of the source is
+ *  skipped, and #line directives keep the line numbers of
+ *  every file.
+ ***********************************************************/
+bool ShaderPreprocessor::Resolve(
+	const std::string& path,
+	SHADER_SOURCE& source,
+	std::string& text,
+	int depth)
+{
+	if (std::find(source.files.begin(), source.files.end(), path) != source.files.end())
+	{
+		return(true);
+	}
+	if (depth > g_MaxIncludeDepth)
+	{
+		std::cout << "Shader includes are nested too deep at " << path << std::endl;
+		return(false);
+	}
+
+	const MODULE* pModule = ReadModule(path);
+	if (NULL == pModule)
+	{
+		std::cout << "Could not read the shader file " << path << std::endl;
+		return(false);
+	}
+
+	int fileIndex = (int)source.files.size();
+	source.files.push_back(path);
+
+	// included files are found next to the file including them
+	size_t slash = path.find_last_of("/\\");
+	std::string directory = (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+
+	// the first file holds the #version line, which nothing
+	// may come before
+	if (depth > 0)
+	{
+		text += "#line 1 " + std::to_string(fileIndex) + "\n";
+	}
+
+	const std::string& moduleText = pModule->text;
+	size_t lineStart = 0;
+	int lineNumber = 1;
+	while (lineStart < moduleText.size())
+	{
+		size_t lineEnd = moduleText.find('\n', lineStart);
+		lineEnd = (lineEnd == std::string::npos) ? moduleText.size() : lineEnd + 1;
+
+		std::string includeName;
+		if (GetIncludeName(moduleText, lineStart, lineEnd, includeName))
+		{
+			if (Resolve(directory + includeName, source, text, depth + 1) == false)
+			{
+				return(false);
+			}
+			text += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+		}
+		else
+		{
+			text.append(moduleText, lineStart, lineEnd - lineStart);
+		}
+
+		lineStart = lineEnd;
+		lineNumber++;
+	}
+
+	// a file without a line break at the end would run into
+	// the directive that follows it
+	if ((text.empty() == false) && (text[text.size() - 1] != '\n'))
+	{
+		text += '\n';
+	}
+
+	return(true);
+}
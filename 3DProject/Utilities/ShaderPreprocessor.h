@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpreprocessor.h
+// ============
+// resolves the #include lines of the GLSL files and caches the result
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderPreprocessor
+ *
+ *  This class turns a GLSL file into one source string by
+ *  replacing every #include "file" line with the text of
+ *  the file, found next to the file including it.  Each
+ *  file is included once per source, so shared modules such
+ *  as the lighting structs can include each other freely.
+ *  A #line directive is written at every file boundary with
+ *  the index of the file as its source string number, so
+ *  the compile errors point at the right file and line.
+ *
+ *  The files are read once and the resolved sources are
+ *  kept by the hash of their text, so compiling the many
+ *  variants of a program only puts the #version line, the
+ *  defines of the variant and the cached body together.
+ *  The same hash keys the variants and the program binary
+ *  cache without hashing the whole source again.
+ ***********************************************************/
+class ShaderPreprocessor
+{
+public:
+	// a resolved source, split after the #version line so the
+	// defines of a variant can be placed there
+	struct SHADER_SOURCE
+	{
+		std::string header;				// text up to and including the #version line
+		std::string body;				// resolved text after it, starting with a #line
+		uint64_t hash;					// hash of the header and body
+		std::vector<std::string> files;	// path of every source string number
+	};
+
+	// resolve the passed in file, returns NULL when it or one
+	// of its includes cannot be read
+	static const SHADER_SOURCE* Load(const char* path);
+	// put a source and the defines of a variant together
+	static std::string Assemble(
+		const SHADER_SOURCE& source,
+		const std::string& defines);
+	// forget the text read from the passed in file, so the
+	// sources using it are resolved again by the next Load()
+	static void Invalidate(const char* path);
+	// forget the text of every file
+	static void InvalidateAll();
+
+	// FNV-1a hash of a text or a value, continued from the
+	// passed in hash
+	static uint64_t HashText(const char* text, uint64_t hash);
+	static uint64_t HashValue(uint64_t value, uint64_t hash);
+
+	// starting value of the hashes
+	static const uint64_t HASH_SEED = 0xcbf29ce484222325ULL;
+
+private:
+	// the text of a file as it was read
+	struct MODULE
+	{
+		std::string text;
+		uint64_t hash;
+	};
+
+	// read a file, or get the text read before
+	static const MODULE* ReadModule(const std::string& path);
+	// append a file and its includes to a source
+	static bool Resolve(
+		const std::string& path,
+		SHADER_SOURCE& source,
+		std::string& text,
+		int depth);
+
+	// the text of every file read, by path
+	static std::map<std::string, MODULE> s_modules;
+	// every resolved source, by hash
+	static std::map<uint64_t, SHADER_SOURCE> s_sources;
+	// the hash of the source resolved from each file
+	static std::map<std::string, uint64_t> s_loadedSources;
+};
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderregistry.cpp
+// ============
+// named shader programs shared by the render passes
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderRegistry.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  ShaderRegistry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderRegistry::ShaderRegistry()
+{
+}
+
+/***********************************************************
+ *  ~ShaderRegistry()
+ *
+ *  The destructor for the class.  The programs still
+ *  referenced are deleted too, since the GL context goes
+ *  away with the registry.
+ ***********************************************************/
+ShaderRegistry::~ShaderRegistry()
+{
+	for (PROGRAM_MAP::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+	{
+		delete it->second.pShader;
+	}
+	m_programs.clear();
+}
+
+/***********************************************************
+ *  Acquire()
+ *
+ *  This method is used for getting the program of the
+ *  passed in name.  A program that is not in the registry
+ *  yet is created and loaded from the passed in files.
+ ***********************************************************/
+ShaderManager* ShaderRegistry::Acquire(
+	const char* name,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath)
+{
+	PROGRAM_MAP::iterator found = m_programs.find(name);
+	if (found != m_programs.end())
+	{
+		found->second.referenceCount++;
+		return(found->second.pShader);
+	}
+
+	ShaderManager* pShader = new ShaderManager();
+	if ((NULL != vertexShaderPath) && (NULL != fragmentShaderPath))
+	{
+		if (pShader->LoadShaders(vertexShaderPath, fragmentShaderPath) == 0)
+		{
+			std::cout << "Could not load the shader program:" << name << std::endl;
+			delete pShader;
+			return(NULL);
+		}
+	}
+
+	PROGRAM_ENTRY entry;
+	entry.pShader = pShader;
+	entry.referenceCount = 1;
+	m_programs[name] = entry;
+	return(pShader);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for looking up a program by name.
+ ***********************************************************/
+ShaderManager* ShaderRegistry::Find(const char* name) const
+{
+	PROGRAM_MAP::const_iterator found = m_programs.find(name);
+	if (found == m_programs.end())
+	{
+		return(NULL);
+	}
+	return(found->second.pShader);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for dropping a reference to a
+ *  program.  The program is deleted when nothing uses it
+ *  anymore.
+ ***********************************************************/
+void ShaderRegistry::Release(ShaderManager* pShader)
+{
+	if (NULL == pShader)
+	{
+		return;
+	}
+
+	for (PROGRAM_MAP::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+	{
+		if (it->second.pShader != pShader)
+		{
+			continue;
+		}
+
+		it->second.referenceCount--;
+		if (it->second.referenceCount <= 0)
+		{
+			delete pShader;
+			m_programs.erase(it);
+		}
+		return;
+	}
+}
+
+/***********************************************************
+ *  GetSourceFiles()
+ *
+ *  This method is used for listing the files of all of the
+ *  programs, for watching them while the application runs.
+ ***********************************************************/
+void ShaderRegistry::GetSourceFiles(std::vector<std::string>& files) const
+{
+	std::vector<std::string> programFiles;
+	for (PROGRAM_MAP::const_iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+	{
+		it->second.pShader->GetSourceFiles(programFiles);
+	}
+
+	for (size_t i = 0; i < programFiles.size(); i++)
+	{
+		if (std::find(files.begin(), files.end(), programFiles[i]) == files.end())
+		{
+			files.push_back(programFiles[i]);
+		}
+	}
+}
+
+/***********************************************************
+ *  ReloadFile()
+ *
+ *  This method is used for compiling the programs that use
+ *  a changed file again.  The other programs are left
+ *  alone, and the ones reloading keep drawing with their
+ *  current variants until PollReloads() swaps them.
+ ***********************************************************/
+int ShaderRegistry::ReloadFile(const std::string& path)
+{
+	ShaderPreprocessor::Invalidate(path.c_str());
+
+	int reloadCount = 0;
+	for (PROGRAM_MAP::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+	{
+		if ((it->second.pShader->UsesFile(path) == true) &&
+			(it->second.pShader->StartReload() == true))
+		{
+			reloadCount++;
+		}
+	}
+	return(reloadCount);
+}
+
+/***********************************************************
+ *  PollReloads()
+ *
+ *  This method is used for swapping in the reloaded
+ *  programs that are done, which must be called between
+ *  frames.
+ ***********************************************************/
+int ShaderRegistry::PollReloads()
+{
+	int swapCount = 0;
+	for (PROGRAM_MAP::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+	{
+		if (it->second.pShader->PollReload() == true)
+		{
+			swapCount++;
+		}
+	}
+	return(swapCount);
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderregistry.h
+// ============
+// named shader programs shared by the render passes
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderRegistry
+ *
+ *  This class keeps every shader program of the application
+ *  under a name, so the scene shader, the depth only shader
+ *  and the shaders of the other passes live side by side
+ *  and a pass that asks for a program already loaded by
+ *  another one gets the same object.  The programs are
+ *  reference counted and deleted with their last user.
+ *
+ *  Every program tracks its own uniforms and blocks, and
+ *  all of them share the record of the bound program, so
+ *  switching between them only calls glUseProgram when the
+ *  program really changes.
+ ***********************************************************/
+class ShaderRegistry
+{
+public:
+	// constructor
+	ShaderRegistry();
+	// destructor
+	~ShaderRegistry();
+
+	// get the program of the passed in name, adding a
+	// reference - a new program is loaded from the passed in
+	// files, or left empty for the caller to load when no
+	// files are passed in.  NULL is returned when the files
+	// cannot be loaded.
+	ShaderManager* Acquire(
+		const char* name,
+		const char* vertexShaderPath = NULL,
+		const char* fragmentShaderPath = NULL);
+	// find a program without adding a reference
+	ShaderManager* Find(const char* name) const;
+	// drop a reference, deleting the program with the last one
+	void Release(ShaderManager* pShader);
+
+	// number of programs in the registry
+	size_t GetCount() const { return m_programs.size(); }
+
+	// every file the programs were loaded from, with the
+	// files they include, each listed once
+	void GetSourceFiles(std::vector<std::string>& files) const;
+	// start reloading the programs that use the passed in
+	// changed file, returns the number of programs reloading
+	int ReloadFile(const std::string& path);
+	// swap in the reloaded programs that are ready, returns
+	// the number of programs that were replaced
+	int PollReloads();
+
+private:
+	struct PROGRAM_ENTRY
+	{
+		ShaderManager* pShader;
+		int referenceCount;
+	};
+
+	// the names are compared with std::less<> so a program
+	// can be found by a C string without building a string
+	typedef std::map<std::string, PROGRAM_ENTRY, std::less<>> PROGRAM_MAP;
+
+	PROGRAM_MAP m_programs;
+};
@@ -0,0 +1,258 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.cpp
+// ============
+// fixed set of worker threads for splitting CPU work across all cores
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+// declaration of global variables
+namespace
+{
+	uint64_t PackRange(uint32_t first, uint32_t end)
+	{
+		return((((uint64_t)first) << 32) | end);
+	}
+}
+
+/***********************************************************
+ *  ThreadPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	m_jobGeneration = 0;
+	m_activeWorkers = 0;
+	m_bShutdown = false;
+	m_pTask = NULL;
+
+	// the calling thread takes part in every job, so only the
+	// additional hardware threads need a dedicated worker
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+	}
+
+	m_pRanges = new WORK_RANGE[threadCount + 1];
+	for (unsigned int i = 0; i <= threadCount; i++)
+	{
+		m_pRanges[i].range = 0;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~ThreadPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bShutdown = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+
+	delete[] m_pRanges;
+	m_pRanges = NULL;
+}
+
+/***********************************************************
+ *  GetThreadCount()
+ *
+ *  This method returns the number of threads that take part
+ *  in every ParallelFor() call.
+ ***********************************************************/
+unsigned int ThreadPool::GetThreadCount() const
+{
+	return((unsigned int)m_workers.size() + 1);
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running the passed in task once
+ *  for every index in [0, count).  The indices are split
+ *  evenly between the threads up front, and stolen between
+ *  them as they run out.  The method returns after every
+ *  index is done.
+ ***********************************************************/
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& task)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	// nothing to gain from waking the workers for one item
+	if ((count == 1) || (m_workers.size() == 0))
+	{
+		for (int i = 0; i < count; i++)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	unsigned int threadCount = GetThreadCount();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pTask = &task;
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			m_pRanges[i].range = PackRange(
+				(uint32_t)((uint64_t)count * i / threadCount),
+				(uint32_t)((uint64_t)count * (i + 1) / threadCount));
+		}
+		m_activeWorkers = (unsigned int)m_workers.size();
+		m_jobGeneration++;
+	}
+	m_wakeCondition.notify_all();
+
+	// the calling thread works on the job as well, with the
+	// range after the workers
+	RunJobIndices(threadCount - 1);
+
+	// wait for the workers to finish their last indices
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return(m_activeWorkers == 0); });
+	m_pTask = NULL;
+}
+
+/***********************************************************
+ *  RunJobIndices()
+ *
+ *  This method claims and runs indices of the current job
+ *  until all of them have been handed out - first from the
+ *  thread's own range, then from stolen ones.
+ ***********************************************************/
+void ThreadPool::RunJobIndices(unsigned int thread)
+{
+	int index = 0;
+	while (true)
+	{
+		if (PopIndex(thread, index))
+		{
+			(*m_pTask)(index);
+		}
+		else if (StealRange(thread) == false)
+		{
+			return;
+		}
+	}
+}
+
+/***********************************************************
+ *  PopIndex()
+ *
+ *  This method is used for taking the first index of a
+ *  thread's own range.  Thieves may shorten the range at
+ *  the same time, so the range is only changed when it has
+ *  not moved since it was read.
+ ***********************************************************/
+bool ThreadPool::PopIndex(unsigned int thread, int& index)
+{
+	std::atomic<uint64_t>& range = m_pRanges[thread].range;
+	uint64_t current = range.load();
+	while (true)
+	{
+		uint32_t first = (uint32_t)(current >> 32);
+		uint32_t end = (uint32_t)current;
+		if (first >= end)
+		{
+			return(false);
+		}
+		if (range.compare_exchange_weak(current, PackRange(first + 1, end)))
+		{
+			index = (int)first;
+			return(true);
+		}
+	}
+}
+
+/***********************************************************
+ *  StealRange()
+ *
+ *  This method is used for moving the back half of the
+ *  range of another thread to an idle thread, starting with
+ *  the thread after it.  The method returns false once every
+ *  range is empty.  The idle thread's own range is empty, so
+ *  no other thread changes it while it is replaced.
+ ***********************************************************/
+bool ThreadPool::StealRange(unsigned int thread)
+{
+	unsigned int threadCount = GetThreadCount();
+	for (unsigned int offset = 1; offset < threadCount; offset++)
+	{
+		std::atomic<uint64_t>& victim = m_pRanges[(thread + offset) % threadCount].range;
+		uint64_t current = victim.load();
+		while (true)
+		{
+			uint32_t first = (uint32_t)(current >> 32);
+			uint32_t end = (uint32_t)current;
+			if (first >= end)
+			{
+				break;
+			}
+
+			uint32_t middle = first + (end - first) / 2;
+			if (victim.compare_exchange_weak(current, PackRange(first, middle)))
+			{
+				m_pRanges[thread].range = PackRange(middle, end);
+				return(true);
+			}
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is the main loop of every worker thread.  It
+ *  sleeps until a new job is submitted or the pool shuts
+ *  down.
+ ***********************************************************/
+void ThreadPool::WorkerLoop(unsigned int thread)
+{
+	unsigned int lastGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [this, lastGeneration]()
+				{ return(m_bShutdown || (m_jobGeneration != lastGeneration)); });
+
+			if (m_bShutdown)
+			{
+				return;
+			}
+			lastGeneration = m_jobGeneration;
+		}
+
+		RunJobIndices(thread);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_activeWorkers--;
+		}
+		m_doneCondition.notify_one();
+	}
+}
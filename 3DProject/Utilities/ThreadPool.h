@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ============
+// fixed set of worker threads for splitting CPU work across all cores
+//
+//  AUTHOR: Joseph Les / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  ThreadPool
+ *
+ *  This class owns a fixed set of worker threads that are
+ *  used for running data-parallel loops.  The calling
+ *  thread always takes part in the work, so a pool with
+ *  zero workers simply runs the loop inline.
+ *
+ *  Every thread starts a loop with its own contiguous range
+ *  of indices and works through it from the front.  A thread
+ *  that runs out steals the back half of the range of
+ *  another thread, so neighbouring indices mostly run on the
+ *  same thread and uneven work still balances out.
+ ***********************************************************/
+class ThreadPool
+{
+public:
+	// constructor - a thread count of 0 uses one worker per
+	// additional hardware thread
+	ThreadPool(unsigned int threadCount = 0);
+	// destructor
+	~ThreadPool();
+
+	// run the passed in task for every index in [0, count) and
+	// block until all of the indices have been processed
+	void ParallelFor(int count, const std::function<void(int)>& task);
+
+	// total number of threads taking part in ParallelFor(),
+	// including the calling thread
+	unsigned int GetThreadCount() const;
+
+private:
+	// the indices left to a thread, packed as the first index
+	// in the high and the end in the low 32 bits, and padded
+	// to a cache line so the threads do not share one
+	struct WORK_RANGE
+	{
+		std::atomic<uint64_t> range;
+		char padding[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	// worker thread main loop
+	void WorkerLoop(unsigned int thread);
+	// process indices of the current job until none are left
+	void RunJobIndices(unsigned int thread);
+	// take the next index of a thread's own range
+	bool PopIndex(unsigned int thread, int& index);
+	// move half of the range of another thread to this one
+	bool StealRange(unsigned int thread);
+
+	// worker threads
+	std::vector<std::thread> m_workers;
+	// synchronization for handing jobs to the workers
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+	// incremented every time a new job is submitted
+	unsigned int m_jobGeneration;
+	// number of workers still busy with the current job
+	unsigned int m_activeWorkers;
+	// set when the pool is being destroyed
+	bool m_bShutdown;
+
+	// the current job
+	const std::function<void(int)>* m_pTask;
+	// index ranges of the workers, followed by the calling thread
+	WORK_RANGE* m_pRanges;
+};
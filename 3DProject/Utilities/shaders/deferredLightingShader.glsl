@@ -0,0 +1,69 @@
+#version 440 core
+
+// the number of scene wide lights and USE_CLUSTERED_LIGHTS
+// are defined in front of this file
+#include "lighting.glsl"
+
+// the materials of the scene, indexed by the G-buffer
+struct GBufferMaterial
+{
+    vec4 ambientColorStrength;
+    vec4 diffuseColorShininess;
+    vec4 specularColor;
+};
+
+layout(std430, binding = 3) readonly buffer GBufferMaterials
+{
+    GBufferMaterial materials[];
+};
+
+in vec2 screenCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D gBufferAlbedo;
+uniform sampler2D gBufferNormal;
+uniform sampler2D gBufferDepth;
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPosition;
+
+void main()
+{
+   ivec2 pixel = ivec2(screenCoordinate * vec2(textureSize(gBufferDepth, 0)));
+   float depth = texelFetch(gBufferDepth, pixel, 0).r;
+
+   // nothing was drawn here, keep the cleared color
+   if(depth >= 1.0)
+   {
+      discard;
+   }
+
+   // the alpha of the albedo marks the lit surfaces
+   vec4 albedo = texelFetch(gBufferAlbedo, pixel, 0);
+   if(albedo.a < 0.5)
+   {
+      outFragmentColor = vec4(albedo.rgb, 1.0);
+      return;
+   }
+
+   // the material of the pixel being shaded, read from the
+   // G-buffer so the light functions match the forward shader
+   vec4 normalMaterial = texelFetch(gBufferNormal, pixel, 0);
+   GBufferMaterial surface = materials[int(normalMaterial.w + 0.5)];
+   Material material;
+   material.ambientColor = surface.ambientColorStrength.rgb;
+   material.ambientStrength = surface.ambientColorStrength.w;
+   material.diffuseColor = surface.diffuseColorShininess.rgb;
+   material.shininess = surface.diffuseColorShininess.w;
+   material.specularColor = surface.specularColor.rgb;
+
+   // rebuild the world position from the depth
+   vec4 worldPosition = inverseViewProjection * vec4(vec3(screenCoordinate, depth) * 2.0 - 1.0, 1.0);
+   vec3 fragmentPosition = worldPosition.xyz / worldPosition.w;
+
+   vec3 lightNormal = normalize(normalMaterial.xyz);
+   vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+   vec3 phongResult = CalcSceneLights(material, lightNormal, fragmentPosition, viewDirection);
+
+   outFragmentColor = vec4(phongResult * albedo.rgb, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 440 core
+
+out vec2 screenCoordinate;
+
+void main()
+{
+   // one triangle covering the whole screen, built from the
+   // vertex index so no vertex buffer is needed
+   vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+   screenCoordinate = position;
+   gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
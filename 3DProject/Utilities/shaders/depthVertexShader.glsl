@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 inVertexPosition;
+
+// the same expression as the scene vertex shader, so the depth
+// matches exactly for the GL_EQUAL test of the main pass
+invariant gl_Position;
+
+uniform mat4 modelViewProjection;
+
+void main()
+{
+   gl_Position = modelViewProjection * vec4(inVertexPosition, 1.0f);
+}
\ No newline at end of file
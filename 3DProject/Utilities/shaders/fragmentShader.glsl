@@ -1,108 +1,70 @@
 #version 440 core
 
-struct Material 
-{
-    vec3 ambientColor;
-    float ambientStrength;
-    vec3 diffuseColor;
-    vec3 specularColor;
-    float shininess;
-}; 
-
-struct LightSource 
-{
-    vec3 position;	
-    vec3 ambientColor;
-    vec3 diffuseColor;
-    vec3 specularColor;
-    float focalStrength;
-    float specularIntensity;
-};
-
-#define TOTAL_LIGHTS 4
+// the variants are compiled with feature flags defined in
+// front of this file - USE_TEXTURE, USE_LIGHTING,
+// USE_CLUSTERED_LIGHTS, WRITE_GBUFFER and USE_LIGHTMAP - and
+// the number of scene wide lights in TOTAL_LIGHTS
+#include "lighting.glsl"
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+in vec2 fragmentLightmapCoordinate;
 
-out vec4 outFragmentColor;
+layout(location = 0) out vec4 outFragmentColor;
+#ifdef WRITE_GBUFFER
+// second G-buffer target of the deferred path
+layout(location = 1) out vec4 outGBufferNormal;
+#endif
 
-uniform bool bUseTexture=false;
-uniform bool bUseLighting=false;
 uniform vec4 objectColor = vec4(1.0f);
 uniform sampler2D objectTexture;
+// light baked for the static batches, in the units of the
+// diffuse term of the lights
+uniform sampler2D lightmapTexture;
 uniform vec3 viewPosition;
 uniform vec2 UVscale = vec2(1.0f, 1.0f);
-uniform LightSource lightSources[TOTAL_LIGHTS];
 uniform Material material;
-
-// function prototypes
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+uniform int materialIndex = 0;
 
 void main()
 {
-   if(bUseLighting == true)
-   {
-      // properties
-      vec3 lightNormal = normalize(fragmentVertexNormal);
-      vec3 viewDirection = normalize(viewPosition - fragmentPosition);
-      vec3 phongResult = vec3(0.0f);
-
-      for(int i = 0; i < TOTAL_LIGHTS; i++)
-      {
-         phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
-      }   
-    
-      if(bUseTexture == true)
-      {
-         vec4 textureColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
-         outFragmentColor = vec4(phongResult * textureColor.xyz, 1.0);
-      }
-      else
-      {
-         outFragmentColor = vec4(phongResult * objectColor.xyz, objectColor.w);
-      }
-   }
-   else 
-   {
-      if(bUseTexture == true)
-      {
-         outFragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
-      }
-      else
-      {
-         outFragmentColor = objectColor;
-      }
-   }
+#ifdef USE_TEXTURE
+   vec4 surfaceColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+#else
+   vec4 surfaceColor = objectColor;
+#endif
+
+#ifdef USE_LIGHTMAP
+   // the diffuse light of the static surfaces, bounced light
+   // included, is baked, so they are lit without the lights
+   // and without the view dependent specular term
+   surfaceColor.rgb *= texture(lightmapTexture, fragmentLightmapCoordinate).rgb * material.diffuseColor;
+#endif
+
+#ifdef WRITE_GBUFFER
+   // the deferred path only stores the surface here, it is lit
+   // by the lighting pass afterwards
+#ifdef USE_LIGHTING
+   outFragmentColor = vec4(surfaceColor.rgb, 1.0);
+#else
+   outFragmentColor = vec4(surfaceColor.rgb, 0.0);
+#endif
+   outGBufferNormal = vec4(normalize(fragmentVertexNormal), float(materialIndex));
+#elif defined(USE_LIGHTMAP)
+   outFragmentColor = surfaceColor;
+#elif defined(USE_LIGHTING)
+   // properties
+   vec3 lightNormal = normalize(fragmentVertexNormal);
+   vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+   vec3 phongResult = CalcSceneLights(material, lightNormal, fragmentPosition, viewDirection);
+
+#ifdef USE_TEXTURE
+   outFragmentColor = vec4(phongResult * surfaceColor.xyz, 1.0);
+#else
+   outFragmentColor = vec4(phongResult * surfaceColor.xyz, surfaceColor.w);
+#endif
+#else
+   outFragmentColor = surfaceColor;
+#endif
 }
-
-// calculates the color when using a directional light.
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
-{
-   vec3 ambient;
-   vec3 diffuse;
-   vec3 specular;
-
-   //**Calculate Ambient lighting**
-
-   ambient = light.ambientColor + (material.ambientColor * material.ambientStrength);
-
-   //**Calculate Diffuse lighting**
-
-   // Calculate distance (light direction) between light source and fragments/pixels
-   vec3 lightDirection = normalize(light.position - vertexPosition); 
-   // Calculate diffuse impact by generating dot product of normal and light
-   float impact = max(dot(lightNormal, lightDirection), 0.0);
-   // Generate diffuse material color   
-   diffuse = impact * material.diffuseColor; 
-
-   //**Calculate Specular lighting**
-
-   // Calculate reflection vector
-   vec3 reflectDir = reflect(-lightDirection, lightNormal);
-   // Calculate specular component
-   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), 32.0);
-   specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
-  
-   return(ambient + diffuse + specular);
-}
\ No newline at end of file
@@ -0,0 +1,146 @@
+// the lights and the light functions shared by the forward and
+// the deferred shaders, included after their #version line
+
+struct Material
+{
+    vec3 ambientColor;
+    float ambientStrength;
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+};
+
+struct LightSource
+{
+    vec3 position;
+    vec3 ambientColor;
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float focalStrength;
+    float specularIntensity;
+};
+
+// the number of scene wide lights and USE_CLUSTERED_LIGHTS are
+// defined in front of the including file
+#ifndef TOTAL_LIGHTS
+#define TOTAL_LIGHTS 4
+#endif
+
+// point light with a range, shaded only by the fragments of
+// the clusters it reaches
+struct PointLight
+{
+    vec4 positionRange;
+    vec4 diffuseColor;
+    vec4 specularColor;
+};
+
+// all point lights of the scene
+layout(std430, binding = 0) readonly buffer PointLights
+{
+    PointLight pointLights[];
+};
+
+// offset and count of the light list of every cluster
+layout(std430, binding = 1) readonly buffer ClusterRanges
+{
+    uvec2 clusterRanges[];
+};
+
+// the light lists of all clusters, one after the other
+layout(std430, binding = 2) readonly buffer ClusterLightIndices
+{
+    uint clusterLightIndices[];
+};
+
+#if TOTAL_LIGHTS > 0
+uniform LightSource lightSources[TOTAL_LIGHTS];
+#endif
+uniform mat4 view;
+uniform ivec3 clusterCounts;
+uniform vec2 clusterTileSize;
+uniform float clusterNear;
+uniform float clusterDepthScale;
+
+// calculates the color when using a directional light.
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 ambient;
+   vec3 diffuse;
+   vec3 specular;
+
+   //**Calculate Ambient lighting**
+
+   ambient = light.ambientColor + (material.ambientColor * material.ambientStrength);
+
+   //**Calculate Diffuse lighting**
+
+   // Calculate distance (light direction) between light source and fragments/pixels
+   vec3 lightDirection = normalize(light.position - vertexPosition);
+   // Calculate diffuse impact by generating dot product of normal and light
+   float impact = max(dot(lightNormal, lightDirection), 0.0);
+   // Generate diffuse material color
+   diffuse = impact * material.diffuseColor;
+
+   //**Calculate Specular lighting**
+
+   // Calculate reflection vector
+   vec3 reflectDir = reflect(-lightDirection, lightNormal);
+   // Calculate specular component
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), 32.0);
+   specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
+
+   return(ambient + diffuse + specular);
+}
+
+// calculates the color added by a point light, which fades
+// out to nothing at its range.
+vec3 CalcPointLight(PointLight light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 toLight = light.positionRange.xyz - vertexPosition;
+   float distanceSquared = dot(toLight, toLight);
+   float range = light.positionRange.w;
+   float falloff = clamp(1.0 - distanceSquared / (range * range), 0.0, 1.0);
+   falloff *= falloff;
+
+   vec3 lightDirection = toLight * inversesqrt(max(distanceSquared, 0.0001));
+   float impact = max(dot(lightNormal, lightDirection), 0.0);
+   vec3 diffuse = impact * light.diffuseColor.rgb * material.diffuseColor;
+
+   vec3 reflectDir = reflect(-lightDirection, lightNormal);
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), 32.0);
+   vec3 specular = (light.specularColor.w * material.shininess) * specularComponent * light.specularColor.rgb * material.specularColor;
+
+   return(falloff * (diffuse + specular));
+}
+
+// calculates the color of all of the scene wide lights and the
+// point lights of the cluster holding the fragment.
+vec3 CalcSceneLights(Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 phongResult = vec3(0.0f);
+
+#if TOTAL_LIGHTS > 0
+   for(int i = 0; i < TOTAL_LIGHTS; i++)
+   {
+      phongResult += CalcLightSource(lightSources[i], material, lightNormal, vertexPosition, viewDirection);
+   }
+#endif
+
+#ifdef USE_CLUSTERED_LIGHTS
+   // find the cluster from the screen tile and the depth slice
+   float viewDepth = -(view * vec4(vertexPosition, 1.0)).z;
+   ivec3 cluster;
+   cluster.xy = ivec2(gl_FragCoord.xy / clusterTileSize);
+   cluster.z = int(log(max(viewDepth, clusterNear) / clusterNear) * clusterDepthScale);
+   cluster = clamp(cluster, ivec3(0), clusterCounts - 1);
+
+   uvec2 range = clusterRanges[cluster.x + clusterCounts.x * (cluster.y + clusterCounts.y * cluster.z)];
+   for(uint i = 0u; i < range.y; i++)
+   {
+      phongResult += CalcPointLight(pointLights[clusterLightIndices[range.x + i]], material, lightNormal, vertexPosition, viewDirection);
+   }
+#endif
+
+   return(phongResult);
+}
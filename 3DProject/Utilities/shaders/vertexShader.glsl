@@ -2,19 +2,39 @@
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// only the static batches have a lightmap coordinate
+layout (location = 3) in vec2 inLightmapCoordinate;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+out vec2 fragmentLightmapCoordinate;
 
+// the depth pre-pass uses the same expression, so its depth
+// matches exactly for the GL_EQUAL test
+invariant gl_Position;
+
+// the model view projection and the normal matrix are built
+// on the CPU once for every object instead of every vertex
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat4 modelViewProjection;
+uniform mat3 normalMatrix;
 
+// the outputs are only written for the features of the
+// variant that read them
 void main()
 {
+   gl_Position = modelViewProjection * vec4(inVertexPosition, 1.0f);
+#ifdef USE_LIGHTING
    fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
+#endif
+#if defined(USE_LIGHTING) || defined(WRITE_GBUFFER)
+   fragmentVertexNormal = normalMatrix * inVertexNormal;
+#endif
+#ifdef USE_TEXTURE
    fragmentTextureCoordinate = inTextureCoordinate;
+#endif
+#ifdef USE_LIGHTMAP
+   fragmentLightmapCoordinate = inLightmapCoordinate;
+#endif
 }
\ No newline at end of file